@@ -26,48 +26,47 @@
  * src/array/array.c
  */
 
+#include <math.h>
+#include <pthread.h>
+#include <sys/param.h>
+#include <uuid/uuid.h>
 #include <daos_hl.h>
 #include <daos_hl/common.h>
+#include <daos_hl/io.h>
+#include <daos_hl/layout.h>
+#include <daos_hl/array.h>
+
+/** dkey holding the array metadata. It never parses as a data dkey. */
+#define DAOS_HL_MD_DKEY			"daos_hl_md"
+/** akey under the metadata dkey holding the array attributes */
+#define DAOS_HL_MD_ATTR_AKEY		"attr"
+/** akey under the metadata dkey holding the block presence map */
+#define DAOS_HL_MD_BITMAP_AKEY		"bitmap"
+/** akey under the metadata dkey holding the fields of compound records */
+#define DAOS_HL_MD_FIELDS_AKEY		"fields"
+/**
+ * prefix of the akeys under the metadata dkey holding the zone maps, one per
+ * handle writing the array
+ */
+#define DAOS_HL_MD_ZONEMAP_AKEY		"zonemap_"
+/** prefix of the akeys under the metadata dkey holding the size marks */
+#define DAOS_HL_MD_SIZE_AKEY		"size_"
+/**
+ * Slots of a size mark. Successive raises of a mark go to successive slots, so
+ * that updates in flight together never overwrite each other whatever order
+ * they land in, and the mark is the highest of its slots.
+ */
+#define DAOS_HL_SIZE_SLOTS		64
+/** Value returned for never written blocks of arrays with a presence map */
+#define DAOS_HL_FILL_VALUE		0
 
-/* #define ARRAY_DEBUG */
-
-/** MSC - Those need to be configurable later through hints */
-/** Array cell size - curently a byte array i.e. 1 byte */
-#define DAOS_HL_CELL_SIZE 1
-/** Bytes to store in a dkey before moving to the next one in the group */
-#define DAOS_HL_DKEY_BLOCK_SIZE		16//1048576
-/** Num blocks to store in each dkey before creating the next group */
-#define DAOS_HL_DKEY_NUM_BLOCKS		3
-/** Number of dkeys in a group */
-#define DAOS_HL_DKEY_NUM		4
-#define DAOS_HL_DKEY_GRP_CHUNK		(DAOS_HL_DKEY_BLOCK_SIZE * \
-					 DAOS_HL_DKEY_NUM)
-#define DAOS_HL_DKEY_GRP_SIZE		(DAOS_HL_DKEY_BLOCK_SIZE * \
-					 DAOS_HL_DKEY_NUM_BLOCKS * \
-					 DAOS_HL_DKEY_NUM)
-
-typedef enum {
-	DAOS_HL_OP_WRITE,
-	DAOS_HL_OP_READ,
-} daos_hl_op_type_t;
-
-typedef struct _io_params{
-	daos_key_t		dkey;
-	char			*dkey_str;
-	char			*akey_str;
-	daos_vec_iod_t		iod;
-	daos_sg_list_t		sgl;
-	daos_event_t		event;
-	struct _io_params	*next;
-} io_params;
+#define ENUM_KEY_BUF	32
+#define ENUM_DESC_BUF	512
+#define ENUM_DESC_NR	5
 
 static int
 daos_hl_extent_same(daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl);
 
-static int
-compute_dkey(daos_off_t array_i, daos_size_t *num_records,
-	     daos_off_t *record_i, char **obj_dkey);
-
 static int
 create_sgl(daos_sg_list_t *user_sgl, daos_size_t num_records,
 	   daos_off_t *sgl_off, daos_size_t *sgl_i, daos_sg_list_t *sgl);
@@ -75,8 +74,13 @@ create_sgl(daos_sg_list_t *user_sgl, daos_size_t num_records,
 static int
 daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
-		   daos_csum_buf_t *csums, daos_event_t *ev,
-		   daos_hl_op_type_t op_type);
+		   daos_csum_buf_t *csums, daos_hl_comp_cb_t cb, void *cb_arg,
+		   daos_event_t *ev, daos_hl_op_type_t op_type);
+
+static int
+daos_hl_access_multi(daos_epoch_t epoch, unsigned int nr,
+		     daos_hl_array_io_t *ios, daos_event_t *ev,
+		     daos_hl_op_type_t op_type);
 
 static int
 get_highest_dkey(daos_handle_t oh, daos_epoch_t epoch, daos_event_t *ev,
@@ -95,8 +99,8 @@ daos_hl_parse_env_vars(void)
 	if (cell_size_val) {
 		sscanf(cell_size_val, "%zu", &cell_size_g);
 
-		printf("DAOS_HL_ARRAY_CELL_SIZE = %s %zu\n",
-		       cell_size_val, cell_size_g);
+		DHL_INFO("DAOS_HL_ARRAY_CELL_SIZE = %s %zu\n",
+			 cell_size_val, cell_size_g);
 
 		if (cell_size_g != 1) {
 			DHL_ERROR("Only a 1 byte cell size is supported.\n");
@@ -111,8 +115,8 @@ daos_hl_parse_env_vars(void)
 	if (dkey_block_len_val) {
 		sscanf(dkey_block_len_val, "%zu", &dkey_block_len_g);
 
-		printf("DAOS_HL_ARRAY_DKEY_BLOCK_LEN = %s %zu\n",
-		       dkey_block_len_val, dkey_block_len_g);
+		DHL_INFO("DAOS_HL_ARRAY_DKEY_BLOCK_LEN = %s %zu\n",
+			 dkey_block_len_val, dkey_block_len_g);
 	}
 	else {
 		dkey_block_len_g = DAOS_HL_DKEY_BLOCK_SIZE;
@@ -122,8 +126,8 @@ daos_hl_parse_env_vars(void)
 	if (dkey_num_blocks_val) {
 		sscanf(dkey_num_blocks_val, "%zu", &dkey_num_blocks_g);
 
-		printf("DAOS_HL_ARRAY_DKEY_NUM_BLOCKS = %s %zu\n",
-		       dkey_num_blocks_val, dkey_num_blocks_g);
+		DHL_INFO("DAOS_HL_ARRAY_DKEY_NUM_BLOCKS = %s %zu\n",
+			 dkey_num_blocks_val, dkey_num_blocks_g);
 	}
 	else {
 		dkey_num_blocks_g = DAOS_HL_DKEY_NUM_BLOCKS;
@@ -133,8 +137,8 @@ daos_hl_parse_env_vars(void)
 	if (num_dkeys_val) {
 		sscanf(num_dkeys_val, "%zu", &num_dkeys_g);
 
-		printf("DAOS_HL_ARRAY_NUM_DKEYS = %s %zu\n",
-		       num_dkeys_val, num_dkeys_g);
+		DHL_INFO("DAOS_HL_ARRAY_NUM_DKEYS = %s %zu\n",
+			 num_dkeys_val, num_dkeys_g);
 	}
 	else {
 		num_dkeys_g = DAOS_HL_DKEY_NUM;
@@ -150,78 +154,24 @@ daos_hl_extent_same(daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl)
 	daos_size_t u;
 
 	ranges_len = 0;
-#ifdef ARRAY_DEBUG
-	printf("USER ARRAY RANGE -----------------------\n");
-	printf("ranges_nr = %zu\n", ranges->ranges_nr);
-#endif
+	DHL_DEBUG("user ranges_nr = %zu\n", ranges->ranges_nr);
 	for (u = 0 ; u < ranges->ranges_nr ; u++) {
 		ranges_len += ranges->ranges[u].len;
-#ifdef ARRAY_DEBUG
-		printf("%zu: length %zu, index %d\n",
-			u, ranges->ranges[u].len, (int)ranges->ranges[u].index);
-#endif
+		DHL_DEBUG("%zu: length %zu, index %d\n",
+			  u, ranges->ranges[u].len,
+			  (int)ranges->ranges[u].index);
 	}
-#ifdef ARRAY_DEBUG
-	printf("------------------------------------\n");
-	printf("USER SGL -----------------------\n");
-	printf("sg_nr = %u\n", sgl->sg_nr.num);
-#endif
+	DHL_DEBUG("user sg_nr = %u\n", sgl->sg_nr.num);
 	sgl_len = 0;
 	for (u = 0 ; u < sgl->sg_nr.num; u++) {
 		sgl_len += sgl->sg_iovs[u].iov_len;
-#ifdef ARRAY_DEBUG
-		printf("%zu: length %zu, Buf %p\n",
-			u, sgl->sg_iovs[u].iov_len, sgl->sg_iovs[u].iov_buf);
-#endif
+		DHL_DEBUG("%zu: length %zu, Buf %p\n",
+			  u, sgl->sg_iovs[u].iov_len, sgl->sg_iovs[u].iov_buf);
 	}
 
 	return ((ranges_len == sgl_len) ? 1 : 0);
 }
 
-static int
-compute_dkey(daos_off_t array_i, daos_size_t *num_records, daos_off_t *record_i,
-	     char **dkey_str)
-{
-	daos_off_t 	byte_a; 	/* Byte address of I/O */
-	daos_size_t 	dkey_grp; 	/* Which grp of dkeys to look into */
-	daos_off_t 	dkey_grp_a; 	/* Byte address of dkey_grp */
-	daos_off_t 	rel_byte_a; 	/* offset relative to grp */
-	daos_size_t 	dkey_num; 	/* The dkey number for access */
-	daos_size_t 	grp_iter; 	/* round robin iteration number */
-	daos_off_t	dkey_byte_a;	/* address of dkey relative to group */
-
-	byte_a = array_i * DAOS_HL_CELL_SIZE;
-
-	/* Compute dkey group number and address */
-	dkey_grp = byte_a / DAOS_HL_DKEY_GRP_SIZE;
-	dkey_grp_a = dkey_grp * DAOS_HL_DKEY_GRP_SIZE;
-
-	/* Compute dkey number within dkey group */
-	rel_byte_a = byte_a - dkey_grp_a;
-	dkey_num = (size_t)(rel_byte_a / DAOS_HL_DKEY_BLOCK_SIZE) %
-		DAOS_HL_DKEY_NUM;
-
-	/* Compute relative offset/index in dkey */
-	grp_iter = rel_byte_a / DAOS_HL_DKEY_GRP_CHUNK;
-	dkey_byte_a = (grp_iter * DAOS_HL_DKEY_GRP_CHUNK) +
-		(dkey_num * DAOS_HL_DKEY_BLOCK_SIZE);
-	*record_i = (DAOS_HL_DKEY_BLOCK_SIZE * grp_iter) +
-		(rel_byte_a - dkey_byte_a);
-
-	/* Number of records to access in current dkey */
-	*num_records = ((grp_iter + 1) * DAOS_HL_DKEY_BLOCK_SIZE) - *record_i;
-
-	if (dkey_str) {
-		asprintf(dkey_str, "%zu_%zu", dkey_grp, dkey_num);
-		if (NULL == *dkey_str) {
-			DHL_ERROR("Failed memory allocation\n");
-			return -1;
-		}
-	}
-
-	return 0;
-}
-
 static int
 create_sgl(daos_sg_list_t *user_sgl, daos_size_t num_records,
 	   daos_off_t *sgl_off, daos_size_t *sgl_i, daos_sg_list_t *sgl)
@@ -281,11 +231,42 @@ create_sgl(daos_sg_list_t *user_sgl, daos_size_t num_records,
 	return 0;
 }
 
+/**
+ * Number of bytes of the user sgl from iov cur_i at offset cur_off that fit
+ * in at most max_iovs iovs.
+ */
+static daos_size_t
+sgl_span(daos_sg_list_t *user_sgl, daos_size_t cur_i, daos_off_t cur_off,
+	 daos_size_t max_iovs)
+{
+	daos_size_t	bytes = 0;
+	daos_size_t	len;
+	daos_size_t	n = 0;
+
+	for (; n < max_iovs && cur_i < user_sgl->sg_nr.num; cur_i++) {
+		len = user_sgl->sg_iovs[cur_i].iov_len - cur_off;
+		cur_off = 0;
+		/** empty iovs do not take a slot, so the split always moves */
+		if (len == 0)
+			continue;
+		bytes += len;
+		n ++;
+	}
+
+	return bytes;
+}
+
+/**
+ * Build the list of dkey I/Os for the array ranges and the user sgl, and
+ * append them to the request. The ranges are split into dkey I/Os by the
+ * layout of the array, and a dkey I/O going over the RPC limits is split
+ * further into several I/Os on the same dkey that run concurrently. Only the
+ * payload cap splits the dkey I/Os of a request with whole_dkeys set.
+ */
 static int
-daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
-		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *user_sgl,
-		   daos_csum_buf_t *csums, daos_event_t *ev,
-		   daos_hl_op_type_t op_type)
+array_req_plan(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+	       const array_layout *layout, daos_hl_array_ranges_t *ranges,
+	       daos_sg_list_t *user_sgl, bool blocking)
 {
 	daos_off_t 	cur_off;/* offset into user buffer sgl to track current
 				 * position */
@@ -298,10 +279,9 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 	daos_size_t	u;
 	daos_size_t	num_records;
 	daos_off_t 	record_i;
+	uint32_t	hi, lo;
+	daos_size_t	max_bytes, max_vecs;
 	daos_csum_buf_t	null_csum;
-	char		*akey = strdup("akey_not_used");
-	io_params	*head, *current;
-	daos_size_t	num_ios;
 	int		rc;
 
 	if (NULL == ranges) {
@@ -316,24 +296,21 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 	rc = daos_hl_extent_same(ranges, user_sgl);
 	if (1 != rc) {
 		DHL_ERROR("Unequal extents of memory and array descriptors\n");
-		return rc;
+		return -1;
 	}
 
-#if 0
-	rc = daos_hl_parse_env_vars();
-	if (0 != rc) {
-		DHL_ERROR("Array read failed (%d)\n", rc);
-		return rc;
-	}
-#endif
+	if (0 == ranges->ranges_nr)
+		return 0;
 
 	cur_off = 0;
 	cur_i = 0;
 	u = 0;
-	num_ios = 0;
 	records = ranges->ranges[0].len;
 	array_i = ranges->ranges[0].index;
 	daos_csum_set(&null_csum, NULL, 0);
+	io_rpc_limits(&max_bytes, &max_vecs);
+	if (req->whole_dkeys)
+		max_vecs = (daos_size_t)-1;
 
 	/** 
 	 * Loop over every range, but at the same time combine consecutive
@@ -342,13 +319,11 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 	 * the separating ranges also belong to the same dkey.
 	 */
 	while(u < ranges->ranges_nr) {
-		daos_vec_iod_t 	*iod, local_iod;
-		daos_sg_list_t 	*sgl, local_sgl;
-		char		*dkey_str;
-		daos_key_t 	*dkey, local_dkey;
-		bool		user_sgl_used = false;
+		io_params	*params = NULL;
+		daos_vec_iod_t 	*iod;
+		daos_sg_list_t 	*sgl;
 		daos_size_t	dkey_records;
-		daos_event_t	*io_event;
+		daos_size_t	budget;
 		daos_size_t	i;
 
 		if (0 == ranges->ranges[u].len) {
@@ -360,39 +335,12 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 			continue;
 		}
 
-		if (ev != NULL) {
-			io_params *params = NULL;
-
-			params = (io_params *)malloc(sizeof(io_params));
-			if (NULL == params) {
-				DHL_ERROR("Failed memory allocation\n");
-				return -1;
-			}
-
-			if(num_ios == 0) {
-				head = params;
-				current = head;
-			} else {
-				current->next = params;
-				current = params;
-			}
-
-			iod = &params->iod;
-			sgl = &params->sgl;
-			io_event = &params->event;
-			dkey_str = params->dkey_str;
-			dkey = &params->dkey;
-			params->akey_str = akey;
-			params->next = NULL;
+		params = io_req_add(req, oh, epoch);
+		if (NULL == params)
+			return -1;
 
-			num_ios++;
-		} else {
-			iod = &local_iod;
-			sgl = &local_sgl;
-			dkey_str = NULL;
-			dkey = &local_dkey;
-			io_event = NULL;
-		}
+		iod = &params->iod;
+		sgl = &params->sgl;
 
 		/**
 		 * Compute the dkey given the array index for this range. Also
@@ -400,20 +348,21 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 		 * starting at the index where we start writing. - the record
 		 * index relative to the dkey.
 		 */
-		rc = compute_dkey(array_i, &num_records, &record_i, &dkey_str);
+		rc = array_layout_split(layout, array_i, &hi, &lo, &record_i,
+					&num_records, &params->dkey_str);
 		if (rc != 0) {
 			DHL_ERROR("Failed to compute dkey\n");
 			return rc;
 		}
-#ifdef ARRAY_DEBUG
-		printf("DKEY IOD %s ---------------------------\n", dkey_str);
-		printf("array_i = %d\t num_records = %zu\t record_i = %d\n",
-		       (int)array_i , num_records, (int)record_i);
-#endif
-		daos_iov_set(dkey, (void *)dkey_str, strlen(dkey_str));
+		DHL_DEBUG("dkey %s: array_i = %d, num_records = %zu, "
+			  "record_i = %d\n", params->dkey_str, (int)array_i,
+			  num_records, (int)record_i);
+		daos_iov_set(&params->dkey, (void *)params->dkey_str,
+			     strlen(params->dkey_str));
 
 		/* set descriptor for KV object */
-		daos_iov_set(&iod->vd_name, (void *)akey, strlen(akey));
+		daos_iov_set(&iod->vd_name, (void *)req->akey,
+			     strlen(req->akey));
 		iod->vd_kcsum = null_csum;
 		iod->vd_nr = 0;
 		iod->vd_csums = NULL;
@@ -422,13 +371,19 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 		i = 0;
 		dkey_records = 0;
 
+		/** records the RPC can carry, within the payload and iov caps */
+		budget = sgl_span(user_sgl, cur_i, cur_off, max_vecs);
+		if (budget > max_bytes)
+			budget = max_bytes;
+
 		/**
 		 * Create the IO descriptor for this dkey. If the entire range
 		 * fits in the dkey, continue to the next range to see if we can
 		 * combine it fully or partially in the current dkey IOD/
 		 */
 		do {
-			daos_off_t 	old_array_i;
+			uint32_t	next_hi, next_lo;
+			daos_size_t	take;
 
 			iod->vd_nr ++;
 
@@ -440,25 +395,40 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 				return -1;
 			}
 
+			/** and the array range it covers, in case it fails */
+			params->ranges = (daos_hl_range_t *)realloc
+				(params->ranges,
+				 sizeof(daos_hl_range_t) * iod->vd_nr);
+			if (NULL == params->ranges) {
+				DHL_ERROR("Failed memory allocation\n");
+				return -1;
+			}
+
+			take = (num_records > records) ? records : num_records;
+			if (take > budget - dkey_records)
+				take = budget - dkey_records;
+
 			/** set the record access for this range */
 			iod->vd_recxs[i].rx_rsize = 1;
 			iod->vd_recxs[i].rx_idx = record_i;
-			iod->vd_recxs[i].rx_nr = (num_records > records) ? 
-				records : num_records;
-#ifdef ARRAY_DEBUG
-			printf("Adding Vector %zu to ARRAY IOD (size = %zu, index = %d)\n",
-			       u, iod->vd_recxs[i].rx_nr, (int)iod->vd_recxs[i].rx_idx);
-#endif
+			iod->vd_recxs[i].rx_nr = take;
+			params->ranges[i].index = array_i;
+			params->ranges[i].len = take;
+			DHL_DEBUG("Adding Vector %zu to ARRAY IOD (size = %zu, "
+				  "index = %d)\n", u, iod->vd_recxs[i].rx_nr,
+				  (int)iod->vd_recxs[i].rx_idx);
 			/** 
-			 * if the current range is bigger than what the dkey can
-			 * hold, update the array index and number of records in
-			 * the current range and break to issue the I/O on the
-			 * current KV.
+			 * if the current range is bigger than what the dkey, or
+			 * the RPC, can hold, update the array index and number
+			 * of records in the current range and break to issue
+			 * the I/O on the current KV. The rest of the range
+			 * lands in the next dkey I/O, on the same dkey if the
+			 * RPC was the limit.
 			 */
-			if(records > num_records) {
-				array_i += num_records;
-				records -= num_records;
-				dkey_records += num_records;
+			if(records > take) {
+				array_i += take;
+				records -= take;
+				dkey_records += take;
 				break;
 			}
 
@@ -470,57 +440,40 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 			if(ranges->ranges_nr <= u)
 				break;
 
-			old_array_i = array_i;
 			records = ranges->ranges[u].len;
 			array_i = ranges->ranges[u].index;
-
-			/** 
-			 * Boundary case where number of records align with the
-			 * end boundary of the KV. break after advancing to the
-			 * next range
-			 */
-			if(records == num_records)
+			if (0 == records)
 				break;
 
-			/** continue processing the next range in the current dkey */
-			if(array_i < old_array_i + num_records &&
-			   array_i >= ((old_array_i + num_records) - 
-				       DAOS_HL_DKEY_BLOCK_SIZE)) {
-				char	*dkey_str_tmp = NULL;
-
-				/** 
-				 * verify that the dkey is the same as the one
-				 * we are working on given the array index, and
-				 * also compute the number of records left in
-				 * the dkey and the record indexin the dkey.
-				 */
-				rc = compute_dkey(array_i, &num_records, 
-						  &record_i, &dkey_str_tmp);
-				if (rc != 0) {
-					DHL_ERROR("Failed to compute dkey\n");
-					return rc;
-				}
-
-				DHL_ASSERT(0 == strcmp(dkey_str_tmp, dkey_str));
+			/** the RPC is full, in records or in recxs */
+			if (dkey_records >= budget || iod->vd_nr >= max_vecs)
+				break;
 
-				free(dkey_str_tmp);
-				dkey_str_tmp = NULL;
+			/** 
+			 * continue processing the next range in the current
+			 * dkey if the layout maps it there, with the number of
+			 * records left in the dkey and the record index in the
+			 * dkey at the new array index.
+			 */
+			rc = array_layout_split(layout, array_i, &next_hi,
+						&next_lo, &record_i,
+						&num_records, NULL);
+			if (rc != 0) {
+				DHL_ERROR("Failed to compute dkey\n");
+				return rc;
 			}
-			else {
+			if (next_hi != hi || next_lo != lo)
 				break;
-			}
 		} while(1);
-#ifdef ARRAY_DEBUG
-		printf("END DKEY IOD %s ---------------------------\n", dkey_str);
-#endif
+		DHL_DEBUG("end of dkey %s\n", params->dkey_str);
 		/** 
 		 * if the user sgl maps directly to the array range, no need to
 		 * partition it.
 		 */
 		if (1 == ranges->ranges_nr && 1 == user_sgl->sg_nr.num &&
-		    dkey_records == ranges->ranges[0].len && ev == NULL) {
-			sgl = user_sgl;
-			user_sgl_used = true;
+		    dkey_records == ranges->ranges[0].len && blocking) {
+			*sgl = *user_sgl;
+			params->user_sgl_used = true;
 		}
 		/** create an sgl from the user sgl for the current IOD */
 		else {
@@ -531,244 +484,2199 @@ daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
 				DHL_ERROR("Failed to create sgl\n");
 				return rc;
 			}
-#ifdef ARRAY_DEBUG
-			daos_size_t s;
-
-			printf("DKEY SGL -----------------------\n");
-			printf("sg_nr = %u\n", sgl->sg_nr.num);
-			for (s = 0; s < sgl->sg_nr.num; s++) {
-				printf("%zu: length %zu, Buf %p\n",
-				       s, sgl->sg_iovs[s].iov_len, sgl->sg_iovs[s].iov_buf);
-			}
-			printf("------------------------------------\n");
-#endif
-		}
-
-		/** 
-		 * If this is an asynchronous call, add the I/Os generated here
-		 * as children of the event passed from the user. The user polls
-		 * on the completion of their event which polls on all the
-		 * events here.
-		 */
-		if (ev != NULL) {
-			rc = daos_event_init(io_event, DAOS_HDL_INVAL, ev);
-			if (rc != 0) {
-				DHL_ERROR("Failed to init child event (%d)\n", 
-					rc);
-				return rc;
+			if (DHL_LOG_ENABLED(DAOS_HL_LOG_DEBUG)) {
+				daos_size_t s;
+
+				DHL_DEBUG("dkey sg_nr = %u\n", sgl->sg_nr.num);
+				for (s = 0; s < sgl->sg_nr.num; s++)
+					DHL_DEBUG("%zu: length %zu, Buf %p\n", s,
+						  sgl->sg_iovs[s].iov_len,
+						  sgl->sg_iovs[s].iov_buf);
 			}
 		}
+	} /* end while */
 
-		/* issue KV IO to DAOS */
-		if(DAOS_HL_OP_READ == op_type) {
-			rc = daos_obj_fetch(oh, epoch, dkey, 1, iod, sgl, NULL,
-					    io_event);
-			if (rc != 0) {
-				DHL_ERROR("KV Fetch of dkey %s failed (%d)\n", 
-					dkey_str, rc);
-				return rc;
-			}
-		}
-		else if(DAOS_HL_OP_WRITE == op_type) {
-			rc = daos_obj_update(oh, epoch, dkey, 1, iod, sgl,
-					     io_event);
-			if (rc != 0) {
-				DHL_ERROR("KV Update of dkey %s failed (%d)\n", 
-					dkey_str, rc);
-				return rc;
-			}
-		}
-		else {
-			DHL_ASSERTF(0, "Invalid array operation.\n");
-		}
+	return 0;
+}
 
-		if (ev == NULL) {
-			if (dkey_str) {
-				free(dkey_str);
-				dkey_str = NULL;
-			}
+/** Cached metadata of an array opened with daos_hl_array_open/create */
+typedef struct _array_md {
+	daos_handle_t		oh;
+	daos_hl_array_attr_t	attr;
+	/** layout of the array described by attr */
+	array_layout		layout;
+	/** block presence map, one byte per block */
+	uint8_t			*bitmap;
+	daos_size_t		nblocks;
+	/** fields of the records, with DAOS_HL_ARRAY_FIELDS */
+	array_fields		fields;
+	/**
+	 * zone map, one entry per block, with DAOS_HL_ARRAY_ZONEMAP: the
+	 * summaries of all the writers merged, and the ones of the writes
+	 * through the handle, stored under zone_akey
+	 */
+	daos_hl_zone_t		*zones;
+	daos_size_t		nzones;
+	daos_hl_zone_t		*own_zones;
+	daos_size_t		own_nzones;
+	char			zone_akey[48];
+	/**
+	 * akey of the size mark of the handle, the end of the data written
+	 * through it, and next slot of the mark to update
+	 */
+	char			size_akey[48];
+	daos_size_t		size_mark;
+	uint64_t		size_seq;
+	pthread_mutex_t		lock;
+	struct _array_md	*next;
+} array_md;
+
+static array_md		*array_md_list;
+static pthread_mutex_t	array_md_lock = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * Serializes the appends without a context, whatever handle of an object they
+ * go through
+ */
+static pthread_mutex_t	append_lock = PTHREAD_MUTEX_INITIALIZER;
 
-			if(!user_sgl_used && sgl->sg_iovs) {
-				free(sgl->sg_iovs);
-				sgl->sg_iovs = NULL;
-			}
+static array_md *
+array_md_lookup(daos_handle_t oh)
+{
+	array_md *md;
 
-			if(iod->vd_recxs) {
-				free(iod->vd_recxs);
-				iod->vd_recxs = NULL;
-			}
-		}
-	} /* end while */
+	pthread_mutex_lock(&array_md_lock);
+	for (md = array_md_list; md != NULL; md = md->next)
+		if (md->oh.cookie == oh.cookie)
+			break;
+	pthread_mutex_unlock(&array_md_lock);
 
-	if(ev && num_ios) {
-		rc = daos_event_parent_barrier(ev);
-		if (rc != 0) {
-			DHL_ERROR("daos_event_launch Failed (%d)\n", rc);
-			return rc;
-		}
-	}
+	return md;
+}
 
-	if(ev == NULL) {
-		free(akey);
-		akey = NULL;
-	}
+const array_layout *
+array_layout_get(daos_handle_t oh)
+{
+	array_md *md = array_md_lookup(oh);
 
-	return 0;
+	return md ? &md->layout : &array_layout_default;
 }
 
-int
-daos_hl_array_read(daos_handle_t oh, daos_epoch_t epoch,
-		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
-		   daos_csum_buf_t *csums, daos_event_t *ev)
+const array_fields *
+array_fields_get(daos_handle_t oh)
 {
-	int rc;
+	array_md *md = array_md_lookup(oh);
 
-	rc = daos_hl_access_obj(oh, epoch, ranges, sgl, csums, ev,
-				DAOS_HL_OP_READ);
-	if (0 != rc) {
-		DHL_ERROR("Array read failed (%d)\n", rc);
-		return rc;
+	if (NULL == md || !(md->attr.da_flags & DAOS_HL_ARRAY_FIELDS))
+		return NULL;
+
+	return &md->fields;
+}
+
+daos_size_t
+array_type_size(uint32_t type)
+{
+	switch (type) {
+	case DAOS_HL_TYPE_INT32:
+	case DAOS_HL_TYPE_UINT32:
+	case DAOS_HL_TYPE_FLOAT:
+		return 4;
+	case DAOS_HL_TYPE_INT64:
+	case DAOS_HL_TYPE_UINT64:
+	case DAOS_HL_TYPE_DOUBLE:
+		return 8;
+	default:
+		return 0;
 	}
-	
-	return rc;
+}
+
+uint32_t
+array_type_get(daos_handle_t oh)
+{
+	array_md *md = array_md_lookup(oh);
+
+	return md ? md->attr.da_type : DAOS_HL_TYPE_NONE;
 }
 
 int
-daos_hl_array_write(daos_handle_t oh, daos_epoch_t epoch,
-		    daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
-		    daos_csum_buf_t *csums, daos_event_t *ev)
+array_attr_get(daos_handle_t oh, daos_hl_array_attr_t *attr)
 {
-	int rc;
+	array_md *md = array_md_lookup(oh);
 
-	rc = daos_hl_access_obj(oh, epoch, ranges, sgl, csums, ev,
-				DAOS_HL_OP_WRITE);
-	if (0 != rc) {
-		DHL_ERROR("Array write failed (%d)\n", rc);
-		return rc;
-	}
-	
-	return rc;
+	if (NULL == md)
+		return -1;
+
+	*attr = md->attr;
+	return 0;
 }
 
-#define ENUM_KEY_BUF	32
-#define ENUM_DESC_BUF	512
-#define ENUM_DESC_NR	5
+static bool
+bitmap_test(array_md *md, daos_size_t blk)
+{
+	return blk < md->nblocks && md->bitmap[blk];
+}
 
+bool
+array_present(daos_handle_t oh, daos_off_t index, daos_size_t len)
+{
+	array_md	*md = array_md_lookup(oh);
+	daos_size_t	blk, last;
+	bool		present = false;
+
+	if (NULL == md || !(md->attr.da_flags & DAOS_HL_ARRAY_BITMAP) ||
+	    0 == len)
+		return true;
+
+	last = (index + len - 1) / md->layout.block_size;
+	pthread_mutex_lock(&md->lock);
+	for (blk = index / md->layout.block_size; blk <= last && !present;
+	     blk++)
+		present = bitmap_test(md, blk);
+	pthread_mutex_unlock(&md->lock);
+
+	return present;
+}
+
+/** Grow the cached presence map to hold at least nblocks blocks */
 static int
-get_highest_dkey(daos_handle_t oh, daos_epoch_t epoch, daos_event_t *ev,
-		 uint32_t *max_hi, uint32_t *max_lo)
+bitmap_grow(array_md *md, daos_size_t nblocks)
 {
-	uint32_t	key_nr, i, j;
-	daos_sg_list_t  sgl;
-	daos_hash_out_t hash_out;
-	char		key[ENUM_KEY_BUF];
-	daos_key_desc_t kds[ENUM_DESC_NR];
-	daos_size_t 	len = ENUM_DESC_BUF;
-	char		*ptr;
-	char		*buf;
-	int             rc = 0;
+	uint8_t		*bitmap;
+	daos_size_t	nr;
 
-	memset(&hash_out, 0, sizeof(hash_out));
-	buf = malloc(ENUM_DESC_BUF);
-	if (NULL == buf) {
+	if (nblocks <= md->nblocks)
+		return 0;
+
+	nr = (md->nblocks == 0) ? 64 : md->nblocks;
+	while (nr < nblocks)
+		nr *= 2;
+
+	bitmap = (uint8_t *)realloc(md->bitmap, nr);
+	if (NULL == bitmap) {
 		DHL_ERROR("Failed memory allocation\n");
 		return -1;
 	}
+	memset(bitmap + md->nblocks, 0, nr - md->nblocks);
 
-	*max_hi = 0;
-	*max_lo = 0;
-
-	/** enumerate records */
-	for (i = ENUM_DESC_NR, key_nr = 0; !daos_hash_is_eof(&hash_out);
-	     i = ENUM_DESC_NR) {
-		daos_iov_t 	iov;
+	md->bitmap = bitmap;
+	md->nblocks = nr;
 
-		memset(buf, 0, ENUM_DESC_BUF);
+	return 0;
+}
 
-		sgl.sg_nr.num = 1;
-		daos_iov_set(&iov, buf, len);
-		sgl.sg_iovs = &iov;
+/** Append a range to a range list, merging it with the last one if possible */
+static int
+ranges_append(daos_hl_array_ranges_t *ranges, daos_size_t *cap,
+	      daos_off_t index, daos_size_t len)
+{
+	daos_hl_range_t *last;
 
-		rc = daos_obj_list_dkey(oh, epoch, &i, kds, &sgl, &hash_out,
-					ev);
-		if (0 != rc) {
-			DHL_ERROR("DKey list failed (%d)\n", rc);
-			return rc;
+	if (ranges->ranges_nr) {
+		last = &ranges->ranges[ranges->ranges_nr - 1];
+		if (last->index + last->len == index) {
+			last->len += len;
+			return 0;
 		}
+	}
 
-		if (i == 0)
-			continue; /* loop should break for EOF */
-
-		key_nr += i;
-		for (ptr = buf, j = 0; j < i; j++) {
-			uint32_t hi, lo;
-
-			snprintf(key, kds[j].kd_key_len + 1, ptr);
-#ifdef ARRAY_DEBUG
-			printf("%d: key %s len %d\n", j, key,
-				      (int)kds[j].kd_key_len);
-#endif
-			/** Keep a record of the highest dkey */
-			sscanf(key, "%u_%u", &hi, &lo);
-			if(hi >= *max_hi) {
-				*max_hi = hi;
-				if(lo > *max_lo)
-					*max_lo = lo;
-			}
-			ptr += kds[j].kd_key_len;
+	if (ranges->ranges_nr == *cap) {
+		*cap = (*cap == 0) ? 16 : *cap * 2;
+		ranges->ranges = (daos_hl_range_t *)realloc
+			(ranges->ranges, sizeof(daos_hl_range_t) * *cap);
+		if (NULL == ranges->ranges) {
+			DHL_ERROR("Failed memory allocation\n");
+			return -1;
 		}
 	}
 
-	free(buf);
-	buf = NULL;
+	ranges->ranges[ranges->ranges_nr].index = index;
+	ranges->ranges[ranges->ranges_nr].len = len;
+	ranges->ranges_nr ++;
 
-	return rc;
+	return 0;
 }
 
-int
-daos_hl_array_get_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t *size,
-		       daos_event_t *ev)
+/** Append a buffer to an sgl, merging it with the last iov if possible */
+static int
+sgl_append(daos_sg_list_t *sgl, daos_size_t *cap, char *buf, daos_size_t len)
 {
-	uint32_t	i;
-	uint32_t	max_hi, max_lo;
-	daos_off_t 	max_offset;
-	daos_size_t	max_iter;
-	int 		rc;
+	daos_iov_t *last;
+
+	if (sgl->sg_nr.num) {
+		last = &sgl->sg_iovs[sgl->sg_nr.num - 1];
+		if ((char *)last->iov_buf + last->iov_len == buf) {
+			last->iov_len += len;
+			last->iov_buf_len = last->iov_len;
+			return 0;
+		}
+	}
 
-	rc = get_highest_dkey(oh, epoch, NULL, &max_hi, &max_lo);
-	if (0 != rc) {
-		DHL_ERROR("Failed to retrieve max dkey (%d)\n", rc);
-		return rc;
+	if (sgl->sg_nr.num == *cap) {
+		*cap = (*cap == 0) ? 16 : *cap * 2;
+		sgl->sg_iovs = (daos_iov_t *)realloc
+			(sgl->sg_iovs, sizeof(daos_iov_t) * *cap);
+		if (NULL == sgl->sg_iovs) {
+			DHL_ERROR("Failed memory allocation\n");
+			return -1;
+		}
 	}
 
-	printf("MAX DKEY = (%u %u)\n", max_hi, max_lo);
+	daos_iov_set(&sgl->sg_iovs[sgl->sg_nr.num], buf, len);
+	sgl->sg_nr.num ++;
 
-	/* 
-	 * Go through all the dkeys in the current group (maxhi_x) and get the
-	 * highest index to determine which dkey in the group has the highest
-	 * bit.
-	 */
-	max_iter = 0;
-	max_offset = 0;
+	return 0;
+}
+
+/** Whether a block is worth fetching, called with md->lock held */
+typedef bool (*block_keep_t)(array_md *md, daos_size_t blk, const void *arg);
+
+static bool
+bitmap_keep(array_md *md, daos_size_t blk, const void *arg)
+{
+	return bitmap_test(md, blk);
+}
+
+/**
+ * Split the ranges of a read at block boundaries. The ranges and sgl of the
+ * blocks kept are returned for fetching, and the parts of the user buffers
+ * that map to the other blocks are filled locally if fill is set.
+ */
+static int
+blocks_filter(array_md *md, daos_hl_array_ranges_t *ranges,
+	      daos_sg_list_t *user_sgl, block_keep_t keep, const void *arg,
+	      bool fill, daos_hl_array_ranges_t *out_ranges,
+	      daos_sg_list_t *out_sgl)
+{
+	daos_size_t	ranges_cap = 0, sgl_cap = 0;
+	daos_size_t	cur_i = 0;
+	daos_off_t	cur_off = 0;
+	daos_size_t	u;
+	int		rc = 0;
+
+	out_ranges->ranges_nr = 0;
+	out_ranges->ranges = NULL;
+	out_sgl->sg_nr.num = 0;
+	out_sgl->sg_nr.num_out = 0;
+	out_sgl->sg_iovs = NULL;
+
+	pthread_mutex_lock(&md->lock);
+	for (u = 0; u < ranges->ranges_nr && rc == 0; u++) {
+		daos_off_t	index = ranges->ranges[u].index;
+		daos_size_t	rem = ranges->ranges[u].len;
+
+		while (rem && rc == 0) {
+			daos_size_t	blk = index / md->layout.block_size;
+			daos_size_t	n;
+			bool		present;
+
+			n = (blk + 1) * md->layout.block_size - index;
+			if (n > rem)
+				n = rem;
+			present = keep(md, blk, arg);
+
+			if (present)
+				rc = ranges_append(out_ranges, &ranges_cap,
+						   index, n);
+			index += n;
+			rem -= n;
+
+			/** walk the user sgl for the n bytes of this block */
+			while (n && rc == 0) {
+				daos_iov_t	*iov = &user_sgl->sg_iovs[cur_i];
+				char		*buf;
+				daos_size_t	c;
+
+				DHL_ASSERT(user_sgl->sg_nr.num > cur_i);
+				buf = (char *)iov->iov_buf + cur_off;
+				c = iov->iov_len - cur_off;
+				if (c > n)
+					c = n;
+
+				if (present)
+					rc = sgl_append(out_sgl, &sgl_cap,
+							buf, c);
+				else if (fill)
+					memset(buf, DAOS_HL_FILL_VALUE, c);
+
+				n -= c;
+				cur_off += c;
+				if (cur_off == iov->iov_len) {
+					cur_i ++;
+					cur_off = 0;
+				}
+			}
+		}
+	}
+	pthread_mutex_unlock(&md->lock);
+
+	if (rc != 0) {
+		free(out_ranges->ranges);
+		free(out_sgl->sg_iovs);
+		out_ranges->ranges = NULL;
+		out_sgl->sg_iovs = NULL;
+	}
+
+	return rc;
+}
+
+/**
+ * Comp hook of a presence map update: only mark the blocks in the cached map
+ * once the update is persistent, so a failed update is retried by the next
+ * write to those blocks.
+ */
+static int
+bitmap_update_comp_cb(io_params *params, int rc)
+{
+	array_md	*md = (array_md *)params->comp_arg;
+	unsigned int	k;
+
+	if (rc != 0)
+		return rc;
+
+	pthread_mutex_lock(&md->lock);
+	for (k = 0; k < params->iod.vd_nr; k++) {
+		daos_recx_t *recx = &params->iod.vd_recxs[k];
+
+		if (bitmap_grow(md, recx->rx_idx + recx->rx_nr) == 0)
+			memset(md->bitmap + recx->rx_idx, 1, recx->rx_nr);
+	}
+	pthread_mutex_unlock(&md->lock);
+
+	return 0;
+}
+
+/**
+ * Add to a write request an update of the presence map entries of the blocks
+ * written for the first time. Each entry is a byte, so concurrent writers of
+ * different blocks never overwrite each other's entries.
+ */
+static int
+bitmap_mark(array_md *md, io_req *req, daos_epoch_t epoch,
+	    daos_hl_array_ranges_t *ranges)
+{
+	io_params	*params;
+	daos_recx_t	*recxs = NULL;
+	daos_size_t	nr = 0, cap = 0, max_run = 0;
+	daos_csum_buf_t	null_csum;
+	daos_size_t	u, blk, last;
+	uint8_t		*ones;
+	daos_iov_t	*iovs;
+	int		rc = 0;
+
+	pthread_mutex_lock(&md->lock);
+	for (u = 0; u < ranges->ranges_nr; u++) {
+		if (ranges->ranges[u].len == 0)
+			continue;
+
+		blk = ranges->ranges[u].index / md->layout.block_size;
+		last = (ranges->ranges[u].index + ranges->ranges[u].len - 1) /
+			md->layout.block_size;
+
+		for (; blk <= last; blk++) {
+			if (bitmap_test(md, blk))
+				continue;
+
+			if (nr && recxs[nr - 1].rx_idx +
+			    recxs[nr - 1].rx_nr == blk) {
+				recxs[nr - 1].rx_nr ++;
+			}
+			else if (nr && recxs[nr - 1].rx_idx <= blk &&
+				 blk < recxs[nr - 1].rx_idx +
+				 recxs[nr - 1].rx_nr) {
+				continue;
+			}
+			else {
+				if (nr == cap) {
+					cap = (cap == 0) ? 8 : cap * 2;
+					recxs = (daos_recx_t *)realloc
+						(recxs,
+						 sizeof(daos_recx_t) * cap);
+					if (NULL == recxs) {
+						DHL_ERROR("Failed memory "
+							  "allocation\n");
+						rc = -1;
+						goto out;
+					}
+				}
+				recxs[nr].rx_rsize = 1;
+				recxs[nr].rx_idx = blk;
+				recxs[nr].rx_nr = 1;
+				nr ++;
+			}
+			if (recxs[nr - 1].rx_nr > max_run)
+				max_run = recxs[nr - 1].rx_nr;
+		}
+	}
+out:
+	pthread_mutex_unlock(&md->lock);
+
+	if (rc != 0 || nr == 0)
+		return rc;
+
+	params = io_req_add(req, md->oh, epoch);
+	if (NULL == params) {
+		free(recxs);
+		return -1;
+	}
+
+	params->iod.vd_recxs = recxs;
+	params->iod.vd_nr = nr;
+	params->comp_cb = bitmap_update_comp_cb;
+	params->comp_arg = md;
+	params->uncounted = true;
+
+	params->dkey_str = strdup(DAOS_HL_MD_DKEY);
+	params->sgl.sg_iovs = (daos_iov_t *)malloc(sizeof(daos_iov_t) * nr);
+	params->priv = malloc(max_run);
+	if (NULL == params->dkey_str || NULL == params->sgl.sg_iovs ||
+	    NULL == params->priv) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+	daos_iov_set(&params->dkey, (void *)params->dkey_str,
+		     strlen(params->dkey_str));
+
+	daos_csum_set(&null_csum, NULL, 0);
+	daos_iov_set(&params->iod.vd_name, (void *)DAOS_HL_MD_BITMAP_AKEY,
+		     strlen(DAOS_HL_MD_BITMAP_AKEY));
+	params->iod.vd_kcsum = null_csum;
+	params->iod.vd_csums = NULL;
+	params->iod.vd_eprs = NULL;
+
+	ones = (uint8_t *)params->priv;
+	memset(ones, 1, max_run);
+	iovs = params->sgl.sg_iovs;
+	for (u = 0; u < nr; u++)
+		daos_iov_set(&iovs[u], ones, recxs[u].rx_nr);
+	params->sgl.sg_nr.num = nr;
+	params->sgl.sg_nr.num_out = 0;
+
+	return 0;
+}
+
+/**
+ * Add to a write request an update of the size mark of the handle if the write
+ * ends past it. Every handle has a mark of its own, so concurrent writers never
+ * overwrite each other's, and the size of the array is the highest mark.
+ */
+static int
+size_mark(array_md *md, io_req *req, daos_epoch_t epoch,
+	  daos_hl_array_ranges_t *ranges)
+{
+	io_params	*params;
+	daos_csum_buf_t	null_csum;
+	daos_recx_t	*recx;
+	daos_iov_t	*iov;
+	uint64_t	*val;
+	daos_size_t	end = 0;
+	daos_size_t	u, slot;
+
+	for (u = 0; u < ranges->ranges_nr; u++)
+		if (ranges->ranges[u].len != 0 &&
+		    ranges->ranges[u].index + ranges->ranges[u].len > end)
+			end = ranges->ranges[u].index + ranges->ranges[u].len;
+
+	pthread_mutex_lock(&md->lock);
+	if (end <= md->size_mark) {
+		pthread_mutex_unlock(&md->lock);
+		return 0;
+	}
+	md->size_mark = end;
+	slot = md->size_seq++ % DAOS_HL_SIZE_SLOTS;
+	pthread_mutex_unlock(&md->lock);
+
+	params = io_req_add(req, md->oh, epoch);
+	if (NULL == params)
+		return -1;
+
+	params->op_type = DAOS_HL_OP_WRITE;
+	params->uncounted = true;
+	params->dkey_str = strdup(DAOS_HL_MD_DKEY);
+	params->priv = malloc(sizeof(daos_recx_t) + sizeof(daos_iov_t) +
+			      sizeof(uint64_t));
+	if (NULL == params->dkey_str || NULL == params->priv) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+	params->priv_desc = true;
+	recx = (daos_recx_t *)params->priv;
+	iov = (daos_iov_t *)(recx + 1);
+	val = (uint64_t *)(iov + 1);
+	*val = end;
+
+	daos_iov_set(&params->dkey, (void *)params->dkey_str,
+		     strlen(params->dkey_str));
+
+	daos_csum_set(&null_csum, NULL, 0);
+	daos_iov_set(&params->iod.vd_name, (void *)md->size_akey,
+		     strlen(md->size_akey));
+	params->iod.vd_kcsum = null_csum;
+	params->iod.vd_nr = 1;
+	params->iod.vd_csums = NULL;
+	params->iod.vd_eprs = NULL;
+	recx->rx_rsize = 1;
+	recx->rx_idx = slot * sizeof(uint64_t);
+	recx->rx_nr = sizeof(uint64_t);
+	params->iod.vd_recxs = recx;
+
+	daos_iov_set(iov, val, sizeof(uint64_t));
+	params->sgl.sg_nr.num = 1;
+	params->sgl.sg_nr.num_out = 0;
+	params->sgl.sg_iovs = iov;
+
+	return 0;
+}
+
+int
+array_size_mark(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+		daos_hl_array_ranges_t *ranges)
+{
+	array_md *md = array_md_lookup(oh);
+
+	if (NULL == md || NULL == ranges)
+		return 0;
+
+	return size_mark(md, req, epoch, ranges);
+}
+
+/** Value of the element of the given type at buf */
+static daos_hl_value_t
+zone_value(uint32_t type, const void *buf)
+{
+	daos_hl_value_t	v;
+	int32_t		i32;
+	uint32_t	u32;
+	float		f;
+
+	switch (type) {
+	case DAOS_HL_TYPE_INT32:
+		memcpy(&i32, buf, sizeof(i32));
+		v.v_i = i32;
+		break;
+	case DAOS_HL_TYPE_UINT32:
+		memcpy(&u32, buf, sizeof(u32));
+		v.v_u = u32;
+		break;
+	case DAOS_HL_TYPE_FLOAT:
+		memcpy(&f, buf, sizeof(f));
+		v.v_d = f;
+		break;
+	default:
+		/** 64 bit types are stored as is */
+		memcpy(&v, buf, sizeof(v));
+		break;
+	}
+
+	return v;
+}
+
+/** Compare two values of the given type, as strcmp() */
+static int
+zone_cmp(uint32_t type, daos_hl_value_t a, daos_hl_value_t b)
+{
+	switch (type) {
+	case DAOS_HL_TYPE_INT32:
+	case DAOS_HL_TYPE_INT64:
+		return (a.v_i > b.v_i) - (a.v_i < b.v_i);
+	case DAOS_HL_TYPE_UINT32:
+	case DAOS_HL_TYPE_UINT64:
+		return (a.v_u > b.v_u) - (a.v_u < b.v_u);
+	default:
+		return (a.v_d > b.v_d) - (a.v_d < b.v_d);
+	}
+}
+
+/** Empty summary, with min and max set so that any element replaces them */
+static void
+zone_init(uint32_t type, daos_hl_zone_t *zone)
+{
+	memset(zone, 0, sizeof(*zone));
+
+	switch (type) {
+	case DAOS_HL_TYPE_INT32:
+	case DAOS_HL_TYPE_INT64:
+		zone->dz_min.v_i = INT64_MAX;
+		zone->dz_max.v_i = INT64_MIN;
+		break;
+	case DAOS_HL_TYPE_UINT32:
+	case DAOS_HL_TYPE_UINT64:
+		zone->dz_min.v_u = UINT64_MAX;
+		zone->dz_max.v_u = 0;
+		break;
+	default:
+		zone->dz_min.v_d = INFINITY;
+		zone->dz_max.v_d = -INFINITY;
+		break;
+	}
+}
+
+/**
+ * Summary of a block holding elements written only in part, which can not be
+ * decoded: it covers every value, so the block is never pruned.
+ */
+static void
+zone_unknown(uint32_t type, daos_hl_zone_t *zone, daos_size_t per_blk)
+{
+	switch (type) {
+	case DAOS_HL_TYPE_INT32:
+	case DAOS_HL_TYPE_INT64:
+		zone->dz_min.v_i = INT64_MIN;
+		zone->dz_max.v_i = INT64_MAX;
+		break;
+	case DAOS_HL_TYPE_UINT32:
+	case DAOS_HL_TYPE_UINT64:
+		zone->dz_min.v_u = 0;
+		zone->dz_max.v_u = UINT64_MAX;
+		break;
+	default:
+		zone->dz_min.v_d = -INFINITY;
+		zone->dz_max.v_d = INFINITY;
+		break;
+	}
+	zone->dz_count = per_blk;
+	zone->dz_zeros = per_blk;
+}
+
+static void
+zone_add(uint32_t type, daos_hl_zone_t *zone, daos_hl_value_t v)
+{
+	daos_hl_value_t zero;
+
+	zone->dz_count ++;
+	if ((DAOS_HL_TYPE_FLOAT == type || DAOS_HL_TYPE_DOUBLE == type) &&
+	    isnan(v.v_d))
+		return;
+
+	memset(&zero, 0, sizeof(zero));
+	if (zone_cmp(type, v, zero) == 0)
+		zone->dz_zeros ++;
+	if (zone_cmp(type, v, zone->dz_min) < 0)
+		zone->dz_min = v;
+	if (zone_cmp(type, v, zone->dz_max) > 0)
+		zone->dz_max = v;
+}
+
+/** Widen dst to cover src, counts are capped at the elements of a block */
+static void
+zone_merge(uint32_t type, daos_hl_zone_t *dst, const daos_hl_zone_t *src,
+	   daos_size_t per_blk)
+{
+	if (0 == src->dz_count)
+		return;
+	if (0 == dst->dz_count) {
+		*dst = *src;
+		return;
+	}
+
+	if (zone_cmp(type, src->dz_min, dst->dz_min) < 0)
+		dst->dz_min = src->dz_min;
+	if (zone_cmp(type, src->dz_max, dst->dz_max) > 0)
+		dst->dz_max = src->dz_max;
+	dst->dz_count = MIN(dst->dz_count + src->dz_count, per_blk);
+	dst->dz_zeros = MIN(dst->dz_zeros + src->dz_zeros, per_blk);
+}
+
+static bool
+zone_keep(array_md *md, daos_size_t blk, const void *arg)
+{
+	const daos_hl_predicate_t	*pred = arg;
+	uint32_t			type = md->attr.da_type;
+	const daos_hl_zone_t		*zone;
+
+	if (blk >= md->nzones || 0 == md->zones[blk].dz_count)
+		return false;
+
+	zone = &md->zones[blk];
+	return zone_cmp(type, zone->dz_max, pred->dp_lo) >= 0 &&
+		zone_cmp(type, zone->dz_min, pred->dp_hi) <= 0;
+}
+
+/** Grow a cached zone map to hold at least nblocks blocks */
+static int
+zones_grow(daos_hl_zone_t **zonesp, daos_size_t *nzones, daos_size_t nblocks)
+{
+	daos_hl_zone_t	*zones;
+	daos_size_t	nr;
+
+	if (nblocks <= *nzones)
+		return 0;
+
+	nr = (*nzones == 0) ? 64 : *nzones;
+	while (nr < nblocks)
+		nr *= 2;
+
+	zones = (daos_hl_zone_t *)realloc(*zonesp, nr * sizeof(*zones));
+	if (NULL == zones) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+	memset(zones + *nzones, 0, (nr - *nzones) * sizeof(*zones));
+
+	*zonesp = zones;
+	*nzones = nr;
+
+	return 0;
+}
+
+/** Run cb on every akey of the metadata dkey starting with prefix */
+static int
+md_akeys_iter(daos_handle_t oh, daos_epoch_t epoch, const char *prefix,
+	      int (*cb)(void *arg, const char *akey), void *arg)
+{
+	daos_key_t	dkey;
+	daos_sg_list_t  sgl;
+	daos_hash_out_t hash_out;
+	char		key[ENUM_KEY_BUF * 2];
+	daos_key_desc_t kds[ENUM_DESC_NR];
+	daos_iov_t 	iov;
+	uint32_t	i, j;
+	char		*ptr;
+	char		*buf;
+	int             rc = 0;
+
+	buf = malloc(ENUM_DESC_BUF);
+	if (NULL == buf) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	memset(&hash_out, 0, sizeof(hash_out));
+	daos_iov_set(&dkey, (void *)DAOS_HL_MD_DKEY, strlen(DAOS_HL_MD_DKEY));
+
+	for (i = ENUM_DESC_NR; !daos_hash_is_eof(&hash_out);
+	     i = ENUM_DESC_NR) {
+		memset(buf, 0, ENUM_DESC_BUF);
+		sgl.sg_nr.num = 1;
+		daos_iov_set(&iov, buf, ENUM_DESC_BUF);
+		sgl.sg_iovs = &iov;
+
+		rc = daos_obj_list_akey(oh, epoch, &dkey, &i, kds, &sgl,
+					&hash_out, NULL);
+		if (0 != rc) {
+			DHL_ERROR("AKey list failed (%d)\n", rc);
+			goto out;
+		}
+
+		for (ptr = buf, j = 0; j < i; j++) {
+			snprintf(key, MIN(kds[j].kd_key_len + 1, sizeof(key)),
+				 "%s", ptr);
+			ptr += kds[j].kd_key_len;
+
+			if (strncmp(key, prefix, strlen(prefix)) != 0)
+				continue;
+
+			rc = cb(arg, key);
+			if (rc != 0)
+				goto out;
+		}
+	}
+
+out:
+	free(buf);
+	return rc;
+}
+
+typedef struct {
+	array_md	*md;
+	daos_epoch_t	epoch;
+	/** summaries of blocks [0, nr) merged so far, and a fetch buffer */
+	daos_hl_zone_t	*merged;
+	daos_hl_zone_t	*buf;
+	daos_size_t	nr;
+} zones_load_arg;
+
+static int
+zones_load_cb(void *arg, const char *akey)
+{
+	zones_load_arg	*la = (zones_load_arg *)arg;
+	uint32_t	type = la->md->attr.da_type;
+	daos_size_t	per_blk = la->md->layout.block_size /
+				  array_type_size(type);
+	daos_size_t	i;
+	int		rc;
+
+	rc = array_md_access(la->md->oh, la->epoch, akey, la->buf,
+			     la->nr * sizeof(daos_hl_zone_t), DAOS_HL_OP_READ);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read zone map %s (%d)\n", akey, rc);
+		return rc;
+	}
+
+	for (i = 0; i < la->nr; i++)
+		zone_merge(type, &la->merged[i], &la->buf[i], per_blk);
+
+	return 0;
+}
+
+/**
+ * Rebuild the cached zone map of blocks [0, nblocks) from the zone maps of all
+ * the writers of the array, and the summaries of the writes through the handle
+ * that may not be stored yet.
+ */
+static int
+zones_load(array_md *md, daos_epoch_t epoch, daos_size_t nblocks)
+{
+	zones_load_arg	la;
+	uint32_t	type = md->attr.da_type;
+	daos_size_t	per_blk = md->layout.block_size / array_type_size(type);
+	daos_size_t	i;
+	int		rc;
+
+	la.md = md;
+	la.epoch = epoch;
+	la.nr = nblocks;
+	la.merged = (daos_hl_zone_t *)calloc(nblocks, sizeof(daos_hl_zone_t));
+	la.buf = (daos_hl_zone_t *)malloc(nblocks * sizeof(daos_hl_zone_t));
+	if (nblocks && (NULL == la.merged || NULL == la.buf)) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto out;
+	}
+
+	rc = md_akeys_iter(md->oh, epoch, DAOS_HL_MD_ZONEMAP_AKEY,
+			   zones_load_cb, &la);
+	if (rc != 0)
+		goto out;
+
+	pthread_mutex_lock(&md->lock);
+	rc = zones_grow(&md->zones, &md->nzones, nblocks);
+	for (i = 0; i < nblocks && rc == 0; i++) {
+		if (i < md->own_nzones)
+			zone_merge(type, &la.merged[i], &md->own_zones[i],
+				   per_blk);
+		md->zones[i] = la.merged[i];
+	}
+	pthread_mutex_unlock(&md->lock);
+
+out:
+	free(la.buf);
+	free(la.merged);
+	return rc;
+}
+
+/**
+ * Copy the next len bytes of an sgl walked from (*cur_i, *cur_off), which may
+ * straddle several iovs, or skip them if buf is NULL.
+ */
+static void
+sgl_copy_out(daos_sg_list_t *sgl, daos_size_t *cur_i, daos_off_t *cur_off,
+	     char *buf, daos_size_t len)
+{
+	while (len) {
+		daos_iov_t	*iov;
+		daos_size_t	c;
+
+		DHL_ASSERT(sgl->sg_nr.num > *cur_i);
+		iov = &sgl->sg_iovs[*cur_i];
+		c = MIN(iov->iov_len - *cur_off, len);
+		if (buf) {
+			memcpy(buf, (char *)iov->iov_buf + *cur_off, c);
+			buf += c;
+		}
+		len -= c;
+		*cur_off += c;
+		if (*cur_off == iov->iov_len) {
+			(*cur_i) ++;
+			*cur_off = 0;
+		}
+	}
+}
+
+/** Summary of the part of one block written by a request */
+typedef struct {
+	daos_size_t	blk;
+	/** the whole block is written, its summary is replaced */
+	bool		whole;
+	daos_hl_zone_t	zone;
+} zone_upd;
+
+static int
+zone_upd_cmp(const void *a, const void *b)
+{
+	const zone_upd *ua = (const zone_upd *)a;
+	const zone_upd *ub = (const zone_upd *)b;
+
+	return (ua->blk > ub->blk) - (ua->blk < ub->blk);
+}
+
+/**
+ * Summarize the elements written by a request per block, and add to the
+ * request an update of the entries of those blocks in the zone map of the
+ * handle. Each handle only merges with its own summaries, so writers never
+ * overwrite each other's; the merged map is widened right away. A summary
+ * covering more than the block holds only costs useless fetches, so a failed
+ * write does not need to undo it. Blocks holding elements written in part get
+ * a summary covering every value.
+ */
+static int
+zonemap_mark(array_md *md, io_req *req, daos_epoch_t epoch,
+	     daos_hl_array_ranges_t *ranges, daos_sg_list_t *user_sgl)
+{
+	uint32_t	type = md->attr.da_type;
+	daos_size_t	esize = array_type_size(type);
+	daos_size_t	bsize = md->layout.block_size;
+	daos_size_t	per_blk = bsize / esize;
+	io_params	*params;
+	zone_upd	*upds = NULL;
+	daos_recx_t	*recxs;
+	daos_hl_zone_t	*zones;
+	daos_csum_buf_t	null_csum;
+	daos_size_t	nr = 0, cap = 0, nrecx = 0;
+	daos_size_t	cur_i = 0;
+	daos_off_t	cur_off = 0;
+	daos_size_t	u, k;
+	char		elem[sizeof(daos_hl_value_t)];
+	int		rc = 0;
+
+	for (u = 0; u < ranges->ranges_nr; u++) {
+		daos_off_t	index = ranges->ranges[u].index;
+		daos_size_t	rem = ranges->ranges[u].len;
+
+		while (rem) {
+			daos_size_t	blk = index / bsize;
+			daos_size_t	n, e;
+
+			n = MIN((blk + 1) * bsize - index, rem);
+			if (nr == cap) {
+				zone_upd *tmp;
+
+				cap = (cap == 0) ? 16 : cap * 2;
+				tmp = (zone_upd *)realloc(upds,
+							  cap * sizeof(*upds));
+				if (NULL == tmp) {
+					DHL_ERROR("Failed memory allocation\n");
+					rc = -1;
+					goto out;
+				}
+				upds = tmp;
+			}
+			upds[nr].blk = blk;
+			upds[nr].whole = (n == bsize);
+			zone_init(type, &upds[nr].zone);
+
+			if (index % esize || n % esize) {
+				zone_unknown(type, &upds[nr].zone, per_blk);
+				sgl_copy_out(user_sgl, &cur_i, &cur_off, NULL,
+					     n);
+			} else {
+				for (e = 0; e < n / esize; e++) {
+					sgl_copy_out(user_sgl, &cur_i,
+						     &cur_off, elem, esize);
+					zone_add(type, &upds[nr].zone,
+						 zone_value(type, elem));
+				}
+			}
+			nr ++;
+			index += n;
+			rem -= n;
+		}
+	}
+	if (nr == 0)
+		goto out;
+
+	/** one entry per block, and one recx per run of blocks */
+	qsort(upds, nr, sizeof(*upds), zone_upd_cmp);
+	for (u = 1, k = 0; u < nr; u++) {
+		if (upds[u].blk == upds[k].blk) {
+			zone_merge(type, &upds[k].zone, &upds[u].zone,
+				   per_blk);
+			upds[k].whole |= upds[u].whole;
+		} else {
+			upds[++k] = upds[u];
+		}
+	}
+	nr = k + 1;
+	for (u = 0; u < nr; u++)
+		if (u == 0 || upds[u].blk != upds[u - 1].blk + 1)
+			nrecx ++;
+
+	pthread_mutex_lock(&md->lock);
+	rc = zones_grow(&md->own_zones, &md->own_nzones, upds[nr - 1].blk + 1);
+	if (rc == 0)
+		rc = zones_grow(&md->zones, &md->nzones, upds[nr - 1].blk + 1);
+	for (u = 0; u < nr && rc == 0; u++) {
+		if (!upds[u].whole)
+			zone_merge(type, &upds[u].zone,
+				   &md->own_zones[upds[u].blk], per_blk);
+		md->own_zones[upds[u].blk] = upds[u].zone;
+		zone_merge(type, &md->zones[upds[u].blk], &upds[u].zone,
+			   per_blk);
+	}
+	pthread_mutex_unlock(&md->lock);
+	if (rc != 0)
+		goto out;
+
+	params = io_req_add(req, md->oh, epoch);
+	if (NULL == params) {
+		rc = -1;
+		goto out;
+	}
+	params->uncounted = true;
+
+	params->dkey_str = strdup(DAOS_HL_MD_DKEY);
+	params->iod.vd_recxs = (daos_recx_t *)malloc(sizeof(daos_recx_t) *
+						      nrecx);
+	params->sgl.sg_iovs = (daos_iov_t *)malloc(sizeof(daos_iov_t) * nrecx);
+	params->priv = malloc(sizeof(daos_hl_zone_t) * nr);
+	if (NULL == params->dkey_str || NULL == params->iod.vd_recxs ||
+	    NULL == params->sgl.sg_iovs || NULL == params->priv) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto out;
+	}
+	daos_iov_set(&params->dkey, (void *)params->dkey_str,
+		     strlen(params->dkey_str));
+
+	daos_csum_set(&null_csum, NULL, 0);
+	daos_iov_set(&params->iod.vd_name, (void *)md->zone_akey,
+		     strlen(md->zone_akey));
+	params->iod.vd_kcsum = null_csum;
+	params->iod.vd_csums = NULL;
+	params->iod.vd_eprs = NULL;
+
+	/** entries are stored as bytes, like the other metadata akeys */
+	zones = (daos_hl_zone_t *)params->priv;
+	recxs = params->iod.vd_recxs;
+	for (u = 0, k = 0; u < nr; u++) {
+		zones[u] = upds[u].zone;
+		if (u && upds[u].blk == upds[u - 1].blk + 1) {
+			recxs[k - 1].rx_nr += sizeof(daos_hl_zone_t);
+			params->sgl.sg_iovs[k - 1].iov_len +=
+				sizeof(daos_hl_zone_t);
+			params->sgl.sg_iovs[k - 1].iov_buf_len +=
+				sizeof(daos_hl_zone_t);
+			continue;
+		}
+		recxs[k].rx_rsize = 1;
+		recxs[k].rx_idx = upds[u].blk * sizeof(daos_hl_zone_t);
+		recxs[k].rx_nr = sizeof(daos_hl_zone_t);
+		daos_iov_set(&params->sgl.sg_iovs[k], &zones[u],
+			     sizeof(daos_hl_zone_t));
+		k ++;
+	}
+	params->iod.vd_nr = nrecx;
+	params->sgl.sg_nr.num = nrecx;
+	params->sgl.sg_nr.num_out = 0;
+
+out:
+	free(upds);
+	return rc;
+}
+
+/**
+ * Add the access to one array to a request, skipping the blocks that were
+ * never written on reads and recording the blocks written on writes for
+ * arrays with a presence map. Writes through a handle of
+ * daos_hl_array_open/create also raise its size mark.
+ */
+static int
+array_req_add(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+	      daos_hl_array_ranges_t *ranges, daos_sg_list_t *user_sgl,
+	      bool blocking)
+{
+	daos_hl_array_ranges_t	f_ranges;
+	daos_sg_list_t		f_sgl;
+	array_md		*md;
+	int			rc;
+
+	md = array_md_lookup(oh);
+	if (NULL == md)
+		return array_req_plan(req, oh, epoch, &array_layout_default,
+				      ranges, user_sgl, blocking);
+
+	if (DAOS_HL_OP_WRITE == req->op_type && ranges) {
+		rc = size_mark(md, req, epoch, ranges);
+		if (rc != 0)
+			return rc;
+	}
+
+	if (!(md->attr.da_flags &
+	      (DAOS_HL_ARRAY_BITMAP | DAOS_HL_ARRAY_ZONEMAP)) ||
+	    NULL == ranges || NULL == user_sgl)
+		return array_req_plan(req, oh, epoch, &md->layout, ranges,
+				      user_sgl, blocking);
+
+	if (1 != daos_hl_extent_same(ranges, user_sgl)) {
+		DHL_ERROR("Unequal extents of memory and array descriptors\n");
+		return -1;
+	}
+
+	if (DAOS_HL_OP_WRITE == req->op_type) {
+		if (md->attr.da_flags & DAOS_HL_ARRAY_ZONEMAP) {
+			rc = zonemap_mark(md, req, epoch, ranges, user_sgl);
+			if (rc != 0)
+				return rc;
+		}
+
+		rc = array_req_plan(req, oh, epoch, &md->layout, ranges,
+				    user_sgl, blocking);
+		if (rc != 0)
+			return rc;
+
+		if (!(md->attr.da_flags & DAOS_HL_ARRAY_BITMAP))
+			return 0;
+
+		return bitmap_mark(md, req, epoch, ranges);
+	}
+
+	if (!(md->attr.da_flags & DAOS_HL_ARRAY_BITMAP))
+		return array_req_plan(req, oh, epoch, &md->layout, ranges,
+				      user_sgl, blocking);
+
+	rc = blocks_filter(md, ranges, user_sgl, bitmap_keep, NULL, true,
+			   &f_ranges, &f_sgl);
+	if (rc != 0)
+		return rc;
+
+	/** the per dkey sgls point to the user buffers, not to f_sgl */
+	rc = array_req_plan(req, oh, epoch, &md->layout, &f_ranges, &f_sgl,
+			    false);
+
+	free(f_ranges.ranges);
+	free(f_sgl.sg_iovs);
+
+	return rc;
+}
+
+static io_req *
+array_req_create(daos_hl_op_type_t op_type)
+{
+	io_req	*req;
+
+	req = io_req_create(op_type);
+	if (NULL == req)
+		return NULL;
+
+	req->akey = strdup("akey_not_used");
+	if (NULL == req->akey) {
+		DHL_ERROR("Failed memory allocation\n");
+		io_req_free(req);
+		return NULL;
+	}
+
+	return req;
+}
+
+static int
+daos_hl_access_obj(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *user_sgl,
+		   daos_csum_buf_t *csums, daos_hl_comp_cb_t cb, void *cb_arg,
+		   daos_event_t *ev, daos_hl_op_type_t op_type)
+{
+	io_req		*req;
+	int		rc;
+
+#if 0
+	rc = daos_hl_parse_env_vars();
+	if (0 != rc) {
+		DHL_ERROR("Array read failed (%d)\n", rc);
+		return rc;
+	}
+#endif
+
+	req = array_req_create(op_type);
+	if (NULL == req)
+		return -1;
+
+	rc = array_req_add(req, oh, epoch, ranges, user_sgl, ev == NULL);
+	if (rc != 0) {
+		io_req_free(req);
+		return rc;
+	}
+
+	if (cb)
+		io_req_set_comp_cb(req, cb, cb_arg);
+
+	return io_req_launch(req, ev);
+}
+
+/**
+ * Plan the accesses to several array objects together and run them as a
+ * single operation sharing one in-flight window.
+ */
+static int
+daos_hl_access_multi(daos_epoch_t epoch, unsigned int nr,
+		     daos_hl_array_io_t *ios, daos_event_t *ev,
+		     daos_hl_op_type_t op_type)
+{
+	io_req		*req;
+	unsigned int	i;
+	int		rc;
+
+	if (nr != 0 && NULL == ios) {
+		DHL_ERROR("NULL array I/O list passed\n");
+		return -1;
+	}
+
+	req = array_req_create(op_type);
+	if (NULL == req)
+		return -1;
+
+	for (i = 0; i < nr; i++) {
+		rc = array_req_add(req, ios[i].oh, epoch, ios[i].ranges,
+				   ios[i].sgl, ev == NULL);
+		if (rc != 0) {
+			DHL_ERROR("Failed to plan I/O %u (%d)\n", i, rc);
+			io_req_free(req);
+			return rc;
+		}
+	}
+
+	return io_req_launch(req, ev);
+}
+
+int
+daos_hl_array_read(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		   daos_csum_buf_t *csums, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_obj(oh, epoch, ranges, sgl, csums, NULL, NULL,
+				ev, DAOS_HL_OP_READ);
+	if (0 != rc) {
+		DHL_ERROR("Array read failed (%d)\n", rc);
+		return rc;
+	}
+	
+	return rc;
+}
+
+int
+daos_hl_array_write(daos_handle_t oh, daos_epoch_t epoch,
+		    daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		    daos_csum_buf_t *csums, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_obj(oh, epoch, ranges, sgl, csums, NULL, NULL,
+				ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("Array write failed (%d)\n", rc);
+		return rc;
+	}
+	
+	return rc;
+}
+
+int
+daos_hl_array_read_cb(daos_handle_t oh, daos_epoch_t epoch,
+		      daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		      daos_csum_buf_t *csums, daos_hl_comp_cb_t cb,
+		      void *cb_arg, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_obj(oh, epoch, ranges, sgl, csums, cb, cb_arg,
+				ev, DAOS_HL_OP_READ);
+	if (0 != rc) {
+		DHL_ERROR("Array read failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_array_write_cb(daos_handle_t oh, daos_epoch_t epoch,
+		       daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		       daos_csum_buf_t *csums, daos_hl_comp_cb_t cb,
+		       void *cb_arg, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_obj(oh, epoch, ranges, sgl, csums, cb, cb_arg,
+				ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("Array write failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_array_read_multi(daos_epoch_t epoch, unsigned int nr,
+			 daos_hl_array_io_t *ios, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_multi(epoch, nr, ios, ev, DAOS_HL_OP_READ);
+	if (0 != rc) {
+		DHL_ERROR("Multi array read failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_array_write_multi(daos_epoch_t epoch, unsigned int nr,
+			  daos_hl_array_io_t *ios, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_multi(epoch, nr, ios, ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("Multi array write failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+/** MSC - This needs to be configurable later through hints */
+/** Number of ranges pulled from a range generator per planning step */
+#define DAOS_HL_GEN_BATCH	64
+
+/** Planner state of an array access streamed from a range generator */
+typedef struct {
+	daos_handle_t		oh;
+	daos_epoch_t		epoch;
+	daos_hl_range_gen_t	gen;
+	void			*arg;
+	/** current batch of ranges and buffers, reused by every step */
+	daos_hl_range_t		ranges[DAOS_HL_GEN_BATCH];
+	daos_iov_t		iovs[DAOS_HL_GEN_BATCH];
+} array_gen;
+
+/** Pull the next batch of ranges from the generator and plan their dkey I/Os */
+static int
+array_gen_plan(io_req *req, void *arg, bool *done)
+{
+	array_gen		*gen = (array_gen *)arg;
+	daos_hl_array_ranges_t	ranges;
+	daos_sg_list_t		sgl;
+	unsigned int		nr = 0;
+	int			rc;
+
+	while (nr < DAOS_HL_GEN_BATCH) {
+		rc = gen->gen(gen->arg, &gen->ranges[nr], &gen->iovs[nr]);
+		if (rc < 0) {
+			DHL_ERROR("Range generator failed (%d)\n", rc);
+			return rc;
+		}
+		if (rc == 0) {
+			*done = true;
+			break;
+		}
+		if (gen->ranges[nr].len != gen->iovs[nr].iov_len) {
+			DHL_ERROR("Unequal extents of memory and array range\n");
+			return -1;
+		}
+		nr ++;
+	}
+
+	ranges.ranges_nr = nr;
+	ranges.ranges = gen->ranges;
+	sgl.sg_nr.num = nr;
+	sgl.sg_nr.num_out = 0;
+	sgl.sg_iovs = gen->iovs;
+
+	/** the dkey sgls must not borrow the batch iovs, they are reused */
+	return array_req_add(req, gen->oh, gen->epoch, &ranges, &sgl, false);
+}
+
+static int
+daos_hl_access_gen(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_range_gen_t gen_cb, void *arg, daos_event_t *ev,
+		   daos_hl_op_type_t op_type)
+{
+	io_req		*req;
+	array_gen	*gen;
+
+	if (NULL == gen_cb) {
+		DHL_ERROR("NULL range generator passed\n");
+		return -1;
+	}
+
+	req = array_req_create(op_type);
+	if (NULL == req)
+		return -1;
+
+	gen = (array_gen *)calloc(1, sizeof(array_gen));
+	if (NULL == gen) {
+		DHL_ERROR("Failed memory allocation\n");
+		io_req_free(req);
+		return -1;
+	}
+	gen->oh = oh;
+	gen->epoch = epoch;
+	gen->gen = gen_cb;
+	gen->arg = arg;
+
+	io_req_set_planner(req, array_gen_plan, gen);
+
+	return io_req_launch(req, ev);
+}
+
+int
+daos_hl_array_read_gen(daos_handle_t oh, daos_epoch_t epoch,
+		       daos_hl_range_gen_t gen, void *arg, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_gen(oh, epoch, gen, arg, ev, DAOS_HL_OP_READ);
+	if (0 != rc) {
+		DHL_ERROR("Array read failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_array_write_gen(daos_handle_t oh, daos_epoch_t epoch,
+			daos_hl_range_gen_t gen, void *arg, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_gen(oh, epoch, gen, arg, ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("Array write failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+/**
+ * Sort the element numbers in order by key, keeping the current order of the
+ * elements with equal keys. LSD radix sort on 8 bit digits, skipping the
+ * digits shared by all the keys.
+ */
+static int
+radix_sort(const uint64_t *keys, daos_size_t nr, daos_size_t *order)
+{
+	daos_size_t	count[8][256];
+	daos_size_t	*tmp, *src, *dst, *swap;
+	daos_size_t	i, sum, c;
+	unsigned int	d, b;
+
+	if (nr == 0)
+		return 0;
+
+	tmp = (daos_size_t *)malloc(nr * sizeof(daos_size_t));
+	if (NULL == tmp) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < nr; i++) {
+		for (d = 0; d < 8; d++)
+			count[d][(keys[i] >> (d * 8)) & 0xff] ++;
+	}
+
+	src = order;
+	dst = tmp;
+	for (d = 0; d < 8; d++) {
+		if (count[d][(keys[0] >> (d * 8)) & 0xff] == nr)
+			continue;
+
+		for (b = 0, sum = 0; b < 256; b++) {
+			c = count[d][b];
+			count[d][b] = sum;
+			sum += c;
+		}
+
+		for (i = 0; i < nr; i++)
+			dst[count[d][(keys[src[i]] >> (d * 8)) & 0xff] ++] =
+				src[i];
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != order)
+		memcpy(order, src, nr * sizeof(daos_size_t));
+	free(tmp);
+
+	return 0;
+}
+
+/**
+ * Access single elements at random indices. The elements are sorted by dkey,
+ * then by record index in the dkey, and turned into ranges in that order, so
+ * that the planner puts all the elements of a dkey in the same dkey I/O with
+ * its recxs in increasing index order. The memory of each range is the
+ * slot of the element in the caller buffer, so the fetched values land in
+ * caller order with no extra copy.
+ */
+static int
+daos_hl_access_points(daos_handle_t oh, daos_epoch_t epoch, daos_size_t nr,
+		      const daos_off_t *indices, daos_size_t elem_size,
+		      void *values, daos_event_t *ev,
+		      daos_hl_op_type_t op_type)
+{
+	const array_layout	*layout;
+	daos_hl_array_ranges_t	ranges;
+	daos_sg_list_t		sgl;
+	uint64_t		*keys = NULL;
+	uint64_t		*idxs = NULL;
+	daos_size_t		*order = NULL;
+	io_req			*req;
+	daos_size_t		i, n;
+	int			rc;
+
+	if (nr != 0 && (NULL == indices || NULL == values || 0 == elem_size)) {
+		DHL_ERROR("Invalid element list passed\n");
+		return -1;
+	}
+
+	ranges.ranges = NULL;
+	sgl.sg_iovs = NULL;
+
+	keys = (uint64_t *)malloc(nr * sizeof(uint64_t));
+	idxs = (uint64_t *)malloc(nr * sizeof(uint64_t));
+	order = (daos_size_t *)malloc(nr * sizeof(daos_size_t));
+	ranges.ranges = (daos_hl_range_t *)malloc(nr *
+						  sizeof(daos_hl_range_t));
+	sgl.sg_iovs = (daos_iov_t *)malloc(nr * sizeof(daos_iov_t));
+	if (nr != 0 && (NULL == keys || NULL == idxs || NULL == order ||
+			NULL == ranges.ranges || NULL == sgl.sg_iovs)) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto out;
+	}
+
+	/**
+	 * the key of an element is the dkey of its first record, and its
+	 * index the one of that record in the dkey
+	 */
+	layout = array_layout_get(oh);
+	for (i = 0; i < nr; i++) {
+		daos_size_t	num_records;
+		daos_off_t	record_i;
+		uint32_t	hi, lo;
+
+		rc = array_layout_split(layout, indices[i] * elem_size, &hi,
+					&lo, &record_i, &num_records, NULL);
+		if (rc != 0) {
+			DHL_ERROR("Failed to compute dkey\n");
+			goto out;
+		}
+		keys[i] = ((uint64_t)hi << 32) | lo;
+		idxs[i] = record_i;
+		order[i] = i;
+	}
+
+	/** the sort by dkey is stable and keeps the index order in a dkey */
+	rc = radix_sort(idxs, nr, order);
+	if (rc == 0)
+		rc = radix_sort(keys, nr, order);
+	if (rc != 0)
+		goto out;
+
+	for (i = 0, n = 0; i < nr; i++) {
+		daos_off_t	index = indices[order[i]] * elem_size;
+		char		*buf = (char *)values + order[i] * elem_size;
+
+		/** merge elements adjacent both in the array and in memory */
+		if (n && ranges.ranges[n - 1].index +
+		    ranges.ranges[n - 1].len == index &&
+		    (char *)sgl.sg_iovs[n - 1].iov_buf +
+		    sgl.sg_iovs[n - 1].iov_len == buf) {
+			ranges.ranges[n - 1].len += elem_size;
+			sgl.sg_iovs[n - 1].iov_len += elem_size;
+			sgl.sg_iovs[n - 1].iov_buf_len += elem_size;
+			continue;
+		}
+
+		ranges.ranges[n].index = index;
+		ranges.ranges[n].len = elem_size;
+		daos_iov_set(&sgl.sg_iovs[n], buf, elem_size);
+		n ++;
+	}
+	ranges.ranges_nr = n;
+	sgl.sg_nr.num = n;
+	sgl.sg_nr.num_out = 0;
+
+	req = array_req_create(op_type);
+	if (NULL == req) {
+		rc = -1;
+		goto out;
+	}
+	req->whole_dkeys = true;
+
+	/** the dkey sgls must not borrow the sorted iovs, freed below */
+	rc = array_req_add(req, oh, epoch, &ranges, &sgl, false);
+	if (rc != 0) {
+		io_req_free(req);
+		goto out;
+	}
+
+	rc = io_req_launch(req, ev);
+
+out:
+	free(sgl.sg_iovs);
+	free(ranges.ranges);
+	free(order);
+	free(idxs);
+	free(keys);
+
+	return rc;
+}
+
+int
+daos_hl_array_gather(daos_handle_t oh, daos_epoch_t epoch, daos_size_t nr,
+		     const daos_off_t *indices, daos_size_t elem_size,
+		     void *values, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_points(oh, epoch, nr, indices, elem_size, values,
+				   ev, DAOS_HL_OP_READ);
+	if (0 != rc) {
+		DHL_ERROR("Array gather failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_array_scatter(daos_handle_t oh, daos_epoch_t epoch, daos_size_t nr,
+		      const daos_off_t *indices, daos_size_t elem_size,
+		      const void *values, daos_event_t *ev)
+{
+	int rc;
+
+	rc = daos_hl_access_points(oh, epoch, nr, indices, elem_size,
+				   (void *)values, ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("Array scatter failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_array_read_where(daos_handle_t oh, daos_epoch_t epoch,
+			 daos_hl_range_t *range,
+			 const daos_hl_predicate_t *pred, daos_sg_list_t *sgl,
+			 daos_hl_array_ranges_t *matched, daos_event_t *ev)
+{
+	daos_hl_array_ranges_t	ranges, f_ranges;
+	daos_sg_list_t		f_sgl;
+	array_md		*md;
+	io_req			*req;
+	int			rc;
+
+	md = array_md_lookup(oh);
+	if (NULL == md || !(md->attr.da_flags & DAOS_HL_ARRAY_ZONEMAP)) {
+		DHL_ERROR("Array has no zone map\n");
+		return -1;
+	}
+	if (NULL == range || NULL == pred || NULL == sgl) {
+		DHL_ERROR("Invalid range, predicate or sgl passed\n");
+		return -1;
+	}
+
+	ranges.ranges_nr = 1;
+	ranges.ranges = range;
+	if (1 != daos_hl_extent_same(&ranges, sgl)) {
+		DHL_ERROR("Unequal extents of memory and array descriptors\n");
+		return -1;
+	}
+
+	/** see the blocks written by the other handles since the last scan */
+	if (range->len) {
+		rc = zones_load(md, epoch, (range->index + range->len - 1) /
+				md->layout.block_size + 1);
+		if (rc != 0)
+			return rc;
+	}
+
+	rc = blocks_filter(md, &ranges, sgl, zone_keep, pred, false,
+			   &f_ranges, &f_sgl);
+	if (rc != 0)
+		return rc;
+
+	req = array_req_create(DAOS_HL_OP_READ);
+	if (NULL == req) {
+		rc = -1;
+		goto out;
+	}
+
+	/** the per dkey sgls point to the user buffers, not to f_sgl */
+	rc = array_req_plan(req, oh, epoch, &md->layout, &f_ranges, &f_sgl,
+			    false);
+	if (rc != 0) {
+		io_req_free(req);
+		goto out;
+	}
+
+	rc = io_req_launch(req, ev);
+
+out:
+	free(f_sgl.sg_iovs);
+	if (rc == 0 && matched) {
+		*matched = f_ranges;
+		return 0;
+	}
+	free(f_ranges.ranges);
+	if (0 != rc)
+		DHL_ERROR("Array read where failed (%d)\n", rc);
+
+	return rc;
+}
+
+int
+daos_hl_array_zones_get(daos_handle_t oh, daos_size_t first, daos_size_t nr,
+			daos_hl_zone_t *zones)
+{
+	array_md	*md;
+	daos_size_t	i;
+
+	md = array_md_lookup(oh);
+	if (NULL == md || !(md->attr.da_flags & DAOS_HL_ARRAY_ZONEMAP)) {
+		DHL_ERROR("Array has no zone map\n");
+		return -1;
+	}
+	if (nr && NULL == zones) {
+		DHL_ERROR("NULL zone buffer passed\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&md->lock);
+	for (i = 0; i < nr; i++) {
+		if (first + i < md->nzones)
+			zones[i] = md->zones[first + i];
+		else
+			memset(&zones[i], 0, sizeof(zones[i]));
+	}
+	pthread_mutex_unlock(&md->lock);
+
+	return 0;
+}
+
+/** MSC - Those need to be configurable later through hints */
+/** Number of buffers in the ring of an array copy */
+#define DAOS_HL_COPY_DEPTH	4
+/** Size of each buffer of an array copy */
+#define DAOS_HL_COPY_BUF_SIZE	1048576
+
+typedef enum {
+	COPY_SLOT_FREE,
+	COPY_SLOT_READ,
+	COPY_SLOT_WRITE,
+} copy_slot_state_t;
+
+/** One buffer of the copy ring and the piece of the ranges it carries */
+typedef struct {
+	copy_slot_state_t	state;
+	daos_event_t		ev;
+	char			*buf;
+	daos_hl_array_ranges_t	ranges;
+	daos_size_t		ranges_cap;
+	daos_sg_list_t		sgl;
+	daos_size_t		sgl_cap;
+} copy_slot;
+
+/**
+ * Fill a slot with the next piece of the ranges to copy, up to the size of
+ * its buffer. The blocks missing from the presence map of the source are
+ * holes and are left out. Returns 1 if the piece has data to copy, 0 if it is
+ * all holes.
+ */
+static int
+copy_slot_fill(copy_slot *slot, array_md *src_md,
+	       daos_hl_array_ranges_t *ranges, daos_size_t *u,
+	       daos_off_t *off)
+{
+	daos_size_t	used = 0;
+	int		rc = 0;
+
+	slot->ranges.ranges_nr = 0;
+	slot->sgl.sg_nr.num = 0;
+	slot->sgl.sg_nr.num_out = 0;
+
+	while (*u < ranges->ranges_nr && used < DAOS_HL_COPY_BUF_SIZE) {
+		daos_off_t	index = ranges->ranges[*u].index + *off;
+		daos_size_t	n = ranges->ranges[*u].len - *off;
+		bool		present = true;
+
+		if (n > DAOS_HL_COPY_BUF_SIZE - used)
+			n = DAOS_HL_COPY_BUF_SIZE - used;
+
+		if (src_md && (src_md->attr.da_flags & DAOS_HL_ARRAY_BITMAP)) {
+			daos_size_t blk = index / src_md->layout.block_size;
+
+			if (n > (blk + 1) * src_md->layout.block_size - index)
+				n = (blk + 1) * src_md->layout.block_size -
+					index;
+			pthread_mutex_lock(&src_md->lock);
+			present = bitmap_test(src_md, blk);
+			pthread_mutex_unlock(&src_md->lock);
+		}
+
+		if (present) {
+			rc = ranges_append(&slot->ranges, &slot->ranges_cap,
+					   index, n);
+			if (rc == 0)
+				rc = sgl_append(&slot->sgl, &slot->sgl_cap,
+						slot->buf + used, n);
+			if (rc != 0)
+				return rc;
+			used += n;
+		}
+
+		*off += n;
+		if (*off == ranges->ranges[*u].len) {
+			(*u) ++;
+			*off = 0;
+		}
+	}
+
+	return (slot->ranges.ranges_nr != 0) ? 1 : 0;
+}
+
+int
+daos_hl_array_copy(daos_handle_t src_oh, daos_epoch_t src_epoch,
+		   daos_handle_t dst_oh, daos_epoch_t dst_epoch,
+		   daos_hl_array_ranges_t *ranges)
+{
+	copy_slot	slots[DAOS_HL_COPY_DEPTH];
+	array_md	*src_md;
+	daos_handle_t	eqh;
+	daos_event_t	*evp;
+	daos_size_t	u = 0;
+	daos_off_t	off = 0;
+	unsigned int	inflight = 0;
+	unsigned int	i;
+	int		status = 0;
+	int		rc;
+
+	if (NULL == ranges) {
+		DHL_ERROR("NULL ranges passed\n");
+		return -1;
+	}
+
+	src_md = array_md_lookup(src_oh);
+
+	memset(slots, 0, sizeof(slots));
+	for (i = 0; i < DAOS_HL_COPY_DEPTH; i++) {
+		slots[i].buf = (char *)malloc(DAOS_HL_COPY_BUF_SIZE);
+		if (NULL == slots[i].buf) {
+			DHL_ERROR("Failed memory allocation\n");
+			status = -1;
+			goto out;
+		}
+	}
+
+	rc = daos_eq_create(&eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create event queue (%d)\n", rc);
+		status = rc;
+		goto out;
+	}
+
+	/**
+	 * Each slot goes through a fetch from the source then an update of the
+	 * destination, so the fetches of the next pieces run while the
+	 * previous ones are written.
+	 */
+	do {
+		copy_slot *slot;
+
+		for (i = 0; i < DAOS_HL_COPY_DEPTH && status == 0 &&
+		     u < ranges->ranges_nr; i++) {
+			slot = &slots[i];
+			if (slot->state != COPY_SLOT_FREE)
+				continue;
+
+			rc = copy_slot_fill(slot, src_md, ranges, &u, &off);
+			if (rc <= 0) {
+				if (rc < 0)
+					status = rc;
+				continue;
+			}
+
+			rc = daos_event_init(&slot->ev, eqh, NULL);
+			if (rc == 0) {
+				rc = daos_hl_array_read(src_oh, src_epoch,
+							&slot->ranges,
+							&slot->sgl, NULL,
+							&slot->ev);
+				if (rc != 0)
+					daos_event_fini(&slot->ev);
+			}
+			if (rc != 0) {
+				DHL_ERROR("Failed to start copy read (%d)\n",
+					  rc);
+				status = rc;
+				break;
+			}
+			slot->state = COPY_SLOT_READ;
+			inflight ++;
+		}
+
+		if (inflight == 0)
+			break;
+
+		rc = daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp);
+		if (rc != 1) {
+			DHL_ERROR("Failed to poll event queue (%d)\n", rc);
+			status = (rc < 0) ? rc : -1;
+			break;
+		}
+
+		for (i = 0; i < DAOS_HL_COPY_DEPTH; i++)
+			if (&slots[i].ev == evp)
+				break;
+		DHL_ASSERT(i < DAOS_HL_COPY_DEPTH);
+		slot = &slots[i];
+
+		rc = evp->ev_error;
+		daos_event_fini(&slot->ev);
+		if (rc != 0 && status == 0) {
+			DHL_ERROR("Copy %s failed (%d)\n",
+				  (slot->state == COPY_SLOT_READ) ?
+				  "read" : "write", rc);
+			status = rc;
+		}
+
+		if (slot->state == COPY_SLOT_READ && status == 0) {
+			rc = daos_event_init(&slot->ev, eqh, NULL);
+			if (rc == 0) {
+				rc = daos_hl_array_write(dst_oh, dst_epoch,
+							 &slot->ranges,
+							 &slot->sgl, NULL,
+							 &slot->ev);
+				if (rc != 0)
+					daos_event_fini(&slot->ev);
+			}
+			if (rc == 0) {
+				slot->state = COPY_SLOT_WRITE;
+				continue;
+			}
+			DHL_ERROR("Failed to start copy write (%d)\n", rc);
+			status = rc;
+		}
+
+		slot->state = COPY_SLOT_FREE;
+		inflight --;
+	} while (1);
+
+	/** drain the I/Os still in flight after a failure */
+	while (inflight) {
+		if (daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp) != 1)
+			break;
+		daos_event_fini(evp);
+		inflight --;
+	}
+
+	daos_eq_destroy(eqh, 0);
+out:
+	for (i = 0; i < DAOS_HL_COPY_DEPTH; i++) {
+		free(slots[i].buf);
+		free(slots[i].ranges.ranges);
+		free(slots[i].sgl.sg_iovs);
+	}
+
+	if (status != 0)
+		DHL_ERROR("Array copy failed (%d)\n", status);
+
+	return status;
+}
+
+static int
+get_highest_dkey(daos_handle_t oh, daos_epoch_t epoch, daos_event_t *ev,
+		 uint32_t *max_hi, uint32_t *max_lo)
+{
+	uint32_t	key_nr, i, j;
+	daos_sg_list_t  sgl;
+	daos_hash_out_t hash_out;
+	char		key[ENUM_KEY_BUF];
+	daos_key_desc_t kds[ENUM_DESC_NR];
+	daos_size_t 	len = ENUM_DESC_BUF;
+	char		*ptr;
+	char		*buf;
+	int             rc = 0;
+
+	memset(&hash_out, 0, sizeof(hash_out));
+	buf = malloc(ENUM_DESC_BUF);
+	if (NULL == buf) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	*max_hi = 0;
+	*max_lo = 0;
+
+	/** enumerate records */
+	for (i = ENUM_DESC_NR, key_nr = 0; !daos_hash_is_eof(&hash_out);
+	     i = ENUM_DESC_NR) {
+		daos_iov_t 	iov;
+
+		memset(buf, 0, ENUM_DESC_BUF);
+
+		sgl.sg_nr.num = 1;
+		daos_iov_set(&iov, buf, len);
+		sgl.sg_iovs = &iov;
+
+		rc = daos_obj_list_dkey(oh, epoch, &i, kds, &sgl, &hash_out,
+					ev);
+		if (0 != rc) {
+			DHL_ERROR("DKey list failed (%d)\n", rc);
+			return rc;
+		}
+
+		if (i == 0)
+			continue; /* loop should break for EOF */
+
+		key_nr += i;
+		for (ptr = buf, j = 0; j < i; j++) {
+			uint32_t hi, lo;
+
+			snprintf(key, kds[j].kd_key_len + 1, ptr);
+			DHL_DEBUG("%d: key %s len %d\n", j, key,
+				  (int)kds[j].kd_key_len);
+			ptr += kds[j].kd_key_len;
+
+			/** skip dkeys that do not hold array data */
+			if (2 != sscanf(key, "%u_%u", &hi, &lo))
+				continue;
+
+			/** Keep a record of the highest dkey */
+			if(hi >= *max_hi) {
+				*max_hi = hi;
+				if(lo > *max_lo)
+					*max_lo = lo;
+			}
+		}
+	}
+
+	free(buf);
+	buf = NULL;
+
+	return rc;
+}
+
+/**
+ * Run cb on every size mark of the array, with the highest of its slots. The
+ * slots are passed too, with the size of the mark, and written back if cb
+ * returns 1.
+ */
+typedef struct {
+	daos_handle_t	oh;
+	daos_epoch_t	epoch;
+	int		(*cb)(void *arg, uint64_t *slots, daos_size_t mark);
+	void		*arg;
+} size_marks_arg;
+
+static int
+size_marks_cb(void *arg, const char *akey)
+{
+	size_marks_arg	*ma = (size_marks_arg *)arg;
+	uint64_t	slots[DAOS_HL_SIZE_SLOTS];
+	daos_size_t	mark;
+	uint32_t	k;
+	int		rc;
+
+	rc = array_md_access(ma->oh, ma->epoch, akey, slots, sizeof(slots),
+			     DAOS_HL_OP_READ);
+	if (rc != 0)
+		return rc;
+
+	for (mark = 0, k = 0; k < DAOS_HL_SIZE_SLOTS; k++)
+		mark = MAX(mark, slots[k]);
+
+	if (ma->cb(ma->arg, slots, mark) != 1)
+		return 0;
+
+	return array_md_access(ma->oh, ma->epoch, akey, slots, sizeof(slots),
+			       DAOS_HL_OP_WRITE);
+}
+
+static int
+size_marks_iter(daos_handle_t oh, daos_epoch_t epoch,
+		int (*cb)(void *arg, uint64_t *slots, daos_size_t mark),
+		void *arg)
+{
+	size_marks_arg	ma;
+
+	ma.oh = oh;
+	ma.epoch = epoch;
+	ma.cb = cb;
+	ma.arg = arg;
+
+	return md_akeys_iter(oh, epoch, DAOS_HL_MD_SIZE_AKEY, size_marks_cb,
+			     &ma);
+}
+
+static int
+size_max_cb(void *arg, uint64_t *slots, daos_size_t mark)
+{
+	daos_size_t *size = (daos_size_t *)arg;
+
+	*size = MAX(*size, mark);
+
+	return 0;
+}
+
+static int
+size_clamp_cb(void *arg, uint64_t *slots, daos_size_t mark)
+{
+	daos_size_t	size = *(daos_size_t *)arg;
+	unsigned int	k;
+
+	if (mark <= size)
+		return 0;
+
+	for (k = 0; k < DAOS_HL_SIZE_SLOTS; k++)
+		slots[k] = MIN(slots[k], size);
+
+	return 1;
+}
+
+/**
+ * Legacy size of an object accessed through a plain handle, whose writes are
+ * not tracked: it is derived from the highest dkey holding array data.
+ */
+static int
+size_get_dkeys(daos_handle_t oh, daos_epoch_t epoch, daos_size_t *size)
+{
+	const array_layout *layout = array_layout_get(oh);
+	uint32_t	i;
+	uint32_t	max_hi, max_lo;
+	daos_off_t 	max_offset;
+	daos_size_t	max_iter;
+	int 		rc;
+
+	rc = get_highest_dkey(oh, epoch, NULL, &max_hi, &max_lo);
+	if (0 != rc) {
+		DHL_ERROR("Failed to retrieve max dkey (%d)\n", rc);
+		return rc;
+	}
+
+	DHL_DEBUG("MAX DKEY = (%u %u)\n", max_hi, max_lo);
+
+	/* 
+	 * Go through all the dkeys in the current group (maxhi_x) and get the
+	 * highest index to determine which dkey in the group has the highest
+	 * bit.
+	 */
+	max_iter = 0;
+	max_offset = 0;
 
 	for (i = 0 ; i <= max_lo; i++) {
 		daos_off_t 	offset, index_hi = 0;
 		daos_size_t 	iter;
-		char		key[ENUM_KEY_BUF];
 
-		sprintf(key, "%u_%u", max_hi, i);
-		printf("checking offset in dkey %s\n", key);
+		DHL_DEBUG("checking offset in dkey %u_%u\n", max_hi, i);
 		/** retrieve the highest index */
 		/** MSC - need new functionality from DAOS to retrieve that. */
 
 		/** Compute the iteration where the highest record is stored */
-		iter = index_hi / DAOS_HL_DKEY_BLOCK_SIZE;
+		iter = index_hi / layout->block_size;
 
-		offset = iter * DAOS_HL_DKEY_GRP_CHUNK + 
-			(index_hi - iter * DAOS_HL_DKEY_BLOCK_SIZE);
+		offset = iter * layout->block_size * layout->dkey_nr +
+			(index_hi - iter * layout->block_size);
 
 		if (iter == max_iter || max_iter == 0) {
-			//DHL_ASSERT(offset > max_offset);
 			max_offset = offset;
 			max_iter = iter;
 		}
@@ -778,16 +2686,107 @@ daos_hl_array_get_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t *size,
 		}
 	}
 
-	*size = max_hi * DAOS_HL_DKEY_GRP_SIZE + max_offset;
+	*size = max_hi * layout->block_size * layout->grp_blocks + max_offset;
 
 	return rc;
+}
+
+/**
+ * The size of an array is the end of the data written through the handles of
+ * daos_hl_array_open/create, whatever the layout: each handle keeps the end of
+ * its writes in a size mark of its own, so the size is the highest mark. The
+ * writes through plain object handles are not tracked, and their size is
+ * still derived from the highest dkey.
+ */
+int
+daos_hl_array_get_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t *size,
+		       daos_event_t *ev)
+{
+	int rc;
+
+	if (NULL == size) {
+		DHL_ERROR("NULL size pointer passed\n");
+		return -1;
+	}
+
+	if (NULL == array_md_lookup(oh))
+		return size_get_dkeys(oh, epoch, size);
+
+	*size = 0;
+	rc = size_marks_iter(oh, epoch, size_max_cb, size);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read the size marks (%d)\n", rc);
+		return rc;
+	}
+
+	DHL_DEBUG("array size = %zu\n", *size);
+
+	return 0;
 } /* end daos_hl_array_get_size */
 
+/**
+ * Set the size of an array opened with daos_hl_array_open/create: growing
+ * writes a zero byte at the new end, shrinking truncates, punching the data
+ * past the new size and lowering the size marks above it, so that growing the
+ * array back reads holes there.
+ */
+static int
+size_set_md(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	daos_size_t		cur;
+	uint8_t			val = 0;
+	int			rc;
+
+	rc = daos_hl_array_get_size(oh, epoch, &cur, NULL);
+	if (rc != 0)
+		return rc;
+
+	if (size < cur) {
+		array_md *md = array_md_lookup(oh);
+
+		rc = array_punch(oh, epoch, size, cur - size);
+		if (rc != 0) {
+			DHL_ERROR("Failed to punch the array tail (%d)\n", rc);
+			return rc;
+		}
+
+		pthread_mutex_lock(&md->lock);
+		md->size_mark = MIN(md->size_mark, size);
+		pthread_mutex_unlock(&md->lock);
+
+		rc = size_marks_iter(oh, epoch, size_clamp_cb, &size);
+		if (rc != 0)
+			DHL_ERROR("Failed to lower the size marks (%d)\n", rc);
+		return rc;
+	}
+
+	if (size == cur)
+		return 0;
+
+	ranges.ranges_nr = 1;
+	rg.len = 1;
+	rg.index = size - 1;
+	ranges.ranges = &rg;
+
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, &val, 1);
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_write(oh, epoch, &ranges, &sgl, NULL, NULL);
+	if (rc != 0)
+		DHL_ERROR("Failed to write array (%d)\n", rc);
+
+	return rc;
+}
+
 int
 daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
 		       daos_event_t *ev)
 {
-	char            *dkey_str = NULL;
 	daos_size_t	num_records;
 	daos_off_t	record_i;
 	uint32_t	new_hi, new_lo;
@@ -802,12 +2801,15 @@ daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
 	bool		shrinking;
 	int 		rc;
 
-	rc = compute_dkey(size, &num_records, &record_i, &dkey_str);
+	if (NULL != array_md_lookup(oh))
+		return size_set_md(oh, epoch, size);
+
+	rc = array_layout_split(array_layout_get(oh), size, &new_hi, &new_lo,
+				&record_i, &num_records, NULL);
 	if (rc != 0) {
 		DHL_ERROR("Failed to compute dkey\n");
 		return rc;
 	}
-	sscanf(key, "%u_%u", &new_hi, &new_lo);
 
 	memset(&hash_out, 0, sizeof(hash_out));
 	buf = malloc(ENUM_DESC_BUF);
@@ -842,12 +2844,15 @@ daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
 			uint32_t hi, lo;
 
 			snprintf(key, kds[j].kd_key_len + 1, ptr);
-#ifdef ARRAY_DEBUG
-			printf("%d: key %s len %d\n", j, key,
-				      (int)kds[j].kd_key_len);
-#endif
+			DHL_DEBUG("%d: key %s len %d\n", j, key,
+				  (int)kds[j].kd_key_len);
+			ptr += kds[j].kd_key_len;
+
+			/** skip dkeys that do not hold array data */
+			if (2 != sscanf(key, "%u_%u", &hi, &lo))
+				continue;
+
 			/** Keep a record of the highest dkey */
-			sscanf(key, "%u_%u", &hi, &lo);
 			if (hi >= new_hi) {
 				/** Punch this entire dkey */
 				if (lo > new_lo) {
@@ -861,7 +2866,6 @@ daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
 					shrinking = true;
 				}
 			}
-			ptr += kds[j].kd_key_len;
 		}
 	}
 
@@ -897,3 +2901,496 @@ daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
 
 	return rc;
 } /* end daos_hl_array_set_size */
+
+int
+array_punch(daos_handle_t oh, daos_epoch_t epoch, daos_off_t off,
+	    daos_size_t len)
+{
+	const array_layout *layout = array_layout_get(oh);
+	daos_csum_buf_t	null_csum;
+	io_req		*req;
+	int		rc;
+
+	if (0 == len)
+		return 0;
+
+	req = io_req_create(DAOS_HL_OP_WRITE);
+	if (NULL == req)
+		return -1;
+
+	req->akey = strdup("akey_not_used");
+	if (NULL == req->akey) {
+		DHL_ERROR("Failed memory allocation\n");
+		io_req_free(req);
+		return -1;
+	}
+	daos_csum_set(&null_csum, NULL, 0);
+
+	/** one zero size recx per dkey covered, which punches its records */
+	while (len > 0) {
+		io_params	*params;
+		daos_recx_t	*recx;
+		daos_off_t	record_i;
+		daos_size_t	num_records;
+		uint32_t	hi, lo;
+
+		params = io_req_add(req, oh, epoch);
+		if (NULL == params) {
+			io_req_free(req);
+			return -1;
+		}
+		params->uncounted = true;
+
+		rc = array_layout_split(layout, off, &hi, &lo, &record_i,
+					&num_records, &params->dkey_str);
+		if (rc != 0) {
+			DHL_ERROR("Failed to compute dkey\n");
+			io_req_free(req);
+			return rc;
+		}
+		if (num_records > len)
+			num_records = len;
+		daos_iov_set(&params->dkey, (void *)params->dkey_str,
+			     strlen(params->dkey_str));
+
+		recx = (daos_recx_t *)malloc(sizeof(daos_recx_t));
+		if (NULL == recx) {
+			DHL_ERROR("Failed memory allocation\n");
+			io_req_free(req);
+			return -1;
+		}
+		recx->rx_rsize = 0;
+		recx->rx_idx = record_i;
+		recx->rx_nr = num_records;
+
+		daos_iov_set(&params->iod.vd_name, (void *)req->akey,
+			     strlen(req->akey));
+		params->iod.vd_kcsum = null_csum;
+		params->iod.vd_nr = 1;
+		params->iod.vd_csums = NULL;
+		params->iod.vd_eprs = NULL;
+		params->iod.vd_recxs = recx;
+
+		params->sgl.sg_nr.num = 0;
+		params->sgl.sg_nr.num_out = 0;
+		params->sgl.sg_iovs = NULL;
+
+		off += num_records;
+		len -= num_records;
+	}
+
+	return io_req_launch(req, NULL);
+}
+
+int
+array_md_access(daos_handle_t oh, daos_epoch_t epoch, const char *akey,
+		void *buf, daos_size_t size, daos_hl_op_type_t op_type)
+{
+	daos_key_t	dkey;
+	daos_vec_iod_t	iod;
+	daos_recx_t	recx;
+	daos_sg_list_t	sgl;
+	daos_iov_t	iov;
+	daos_csum_buf_t	null_csum;
+	int		rc;
+
+	daos_csum_set(&null_csum, NULL, 0);
+	daos_iov_set(&dkey, (void *)DAOS_HL_MD_DKEY, strlen(DAOS_HL_MD_DKEY));
+
+	daos_iov_set(&iod.vd_name, (void *)akey, strlen(akey));
+	iod.vd_kcsum = null_csum;
+	iod.vd_nr = 1;
+	iod.vd_csums = NULL;
+	iod.vd_eprs = NULL;
+	recx.rx_rsize = 1;
+	recx.rx_idx = 0;
+	recx.rx_nr = size;
+	iod.vd_recxs = &recx;
+
+	sgl.sg_nr.num = 1;
+	sgl.sg_nr.num_out = 0;
+	daos_iov_set(&iov, buf, size);
+	sgl.sg_iovs = &iov;
+
+	if (DAOS_HL_OP_READ == op_type) {
+		memset(buf, 0, size);
+		rc = daos_obj_fetch(oh, epoch, &dkey, 1, &iod, &sgl, NULL,
+				    NULL);
+	}
+	else {
+		rc = daos_obj_update(oh, epoch, &dkey, 1, &iod, &sgl, NULL);
+	}
+	if (rc != 0) {
+		DHL_ERROR("Metadata %s of akey %s failed (%d)\n",
+			  (DAOS_HL_OP_READ == op_type) ? "fetch" : "update",
+			  akey, rc);
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Reserve len bytes at the end of the appended data and return the offset of
+ * the reservation. Without a context, the read-modify-write of the append end
+ * is serialized between the threads of the process only.
+ */
+static int
+append_reserve(daos_handle_t oh, daos_epoch_t epoch,
+	       daos_hl_append_ctx_t *ctx, uint64_t len, uint64_t *offset)
+{
+	uint64_t	end;
+	int		rc;
+
+	if (ctx) {
+#ifdef DAOS_HL_MPI
+		return append_ctx_reserve(ctx, oh, epoch, len, offset);
+#else
+		DHL_ERROR("Append contexts need the MPI support\n");
+		return -1;
+#endif
+	}
+
+	pthread_mutex_lock(&append_lock);
+	rc = array_md_access(oh, epoch, DAOS_HL_MD_APPEND_AKEY, offset,
+			     sizeof(*offset), DAOS_HL_OP_READ);
+	if (rc == 0) {
+		end = *offset + len;
+		rc = array_md_access(oh, epoch, DAOS_HL_MD_APPEND_AKEY, &end,
+				     sizeof(end), DAOS_HL_OP_WRITE);
+	}
+	pthread_mutex_unlock(&append_lock);
+
+	return rc;
+}
+
+int
+daos_hl_array_append(daos_handle_t oh, daos_epoch_t epoch,
+		     daos_hl_append_ctx_t *ctx, daos_sg_list_t *sgl,
+		     daos_off_t *offset, daos_event_t *ev)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	uint64_t		off;
+	daos_size_t		len;
+	daos_size_t		u;
+	int			rc;
+
+	if (NULL == sgl) {
+		DHL_ERROR("NULL scatter-gather list passed\n");
+		return -1;
+	}
+
+	len = 0;
+	for (u = 0 ; u < sgl->sg_nr.num; u++)
+		len += sgl->sg_iovs[u].iov_len;
+
+	rc = append_reserve(oh, epoch, ctx, len, &off);
+	if (rc != 0) {
+		DHL_ERROR("Failed to reserve append range (%d)\n", rc);
+		return rc;
+	}
+
+	if (offset)
+		*offset = off;
+
+	if (len == 0)
+		return 0;
+
+	ranges.ranges_nr = 1;
+	rg.len = len;
+	rg.index = off;
+	ranges.ranges = &rg;
+
+	rc = daos_hl_access_obj(oh, epoch, &ranges, sgl, NULL, NULL, NULL,
+				ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("Array append failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+/** Register the cached metadata of an open array */
+static int
+array_md_register(daos_handle_t oh, daos_epoch_t epoch,
+		  daos_hl_array_attr_t *attr, const array_fields *fields)
+{
+	array_md	*md;
+	uint32_t	max_hi, max_lo;
+	uuid_t		uuid;
+	char		uuid_str[37];
+	int		rc;
+
+	md = (array_md *)calloc(1, sizeof(array_md));
+	if (NULL == md) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	md->oh = oh;
+	md->attr = *attr;
+	rc = array_layout_init(&md->attr, &md->layout);
+	if (rc != 0) {
+		free(md);
+		return rc;
+	}
+	pthread_mutex_init(&md->lock, NULL);
+
+	uuid_generate(uuid);
+	uuid_unparse(uuid, uuid_str);
+	snprintf(md->size_akey, sizeof(md->size_akey), "%s%s",
+		 DAOS_HL_MD_SIZE_AKEY, uuid_str);
+	snprintf(md->zone_akey, sizeof(md->zone_akey), "%s%s",
+		 DAOS_HL_MD_ZONEMAP_AKEY, uuid_str);
+
+	if (fields) {
+		md->fields = *fields;
+	} else if (md->attr.da_flags & DAOS_HL_ARRAY_FIELDS) {
+		rc = array_md_access(oh, epoch, DAOS_HL_MD_FIELDS_AKEY,
+				     &md->fields, sizeof(md->fields),
+				     DAOS_HL_OP_READ);
+		if (rc != 0) {
+			DHL_ERROR("Failed to read record fields (%d)\n", rc);
+			goto err;
+		}
+	}
+
+	if (md->attr.da_flags &
+	    (DAOS_HL_ARRAY_BITMAP | DAOS_HL_ARRAY_ZONEMAP)) {
+		/** the maps can not extend past the highest dkey group */
+		rc = get_highest_dkey(oh, epoch, NULL, &max_hi, &max_lo);
+		if (rc != 0) {
+			DHL_ERROR("Failed to retrieve max dkey (%d)\n", rc);
+			goto err;
+		}
+	}
+
+	if (md->attr.da_flags & DAOS_HL_ARRAY_ZONEMAP) {
+		rc = zones_load(md, epoch, (daos_size_t)(max_hi + 1) *
+				md->layout.grp_blocks);
+		if (rc != 0)
+			goto err;
+	}
+
+	if (md->attr.da_flags & DAOS_HL_ARRAY_BITMAP) {
+		rc = bitmap_grow(md, (daos_size_t)(max_hi + 1) *
+				 md->layout.grp_blocks);
+		if (rc != 0)
+			goto err;
+
+		rc = array_md_access(oh, epoch, DAOS_HL_MD_BITMAP_AKEY,
+				     md->bitmap, md->nblocks,
+				     DAOS_HL_OP_READ);
+		if (rc != 0) {
+			DHL_ERROR("Failed to read presence map (%d)\n", rc);
+			goto err;
+		}
+	}
+
+	pthread_mutex_lock(&array_md_lock);
+	md->next = array_md_list;
+	array_md_list = md;
+	pthread_mutex_unlock(&array_md_lock);
+
+	return 0;
+
+err:
+	pthread_mutex_destroy(&md->lock);
+	free(md->bitmap);
+	free(md->zones);
+	free(md->own_zones);
+	free(md);
+	return rc;
+}
+
+static int
+array_create(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+	     daos_hl_array_attr_t *attr, const array_fields *fields,
+	     daos_handle_t *oh)
+{
+	daos_hl_array_attr_t	md_attr;
+	array_layout		layout;
+	int			rc;
+
+	if (NULL == oh) {
+		DHL_ERROR("NULL object handle pointer passed\n");
+		return -1;
+	}
+
+	if (attr)
+		md_attr = *attr;
+	else
+		memset(&md_attr, 0, sizeof(md_attr));
+
+	/** store the layout parameters actually used */
+	rc = array_layout_init(&md_attr, &layout);
+	if (rc != 0)
+		return rc;
+
+	if (md_attr.da_type >= DAOS_HL_TYPE_NR) {
+		DHL_ERROR("Invalid element type %u\n", md_attr.da_type);
+		return -1;
+	}
+	if ((md_attr.da_flags & DAOS_HL_ARRAY_ZONEMAP) &&
+	    (fields || 0 == array_type_size(md_attr.da_type) ||
+	     layout.block_size % array_type_size(md_attr.da_type))) {
+		DHL_ERROR("A zone map needs typed elements and blocks holding "
+			  "whole elements\n");
+		return -1;
+	}
+
+	rc = daos_obj_open(coh, oid, epoch, DAOS_OO_RW, oh, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to open object (%d)\n", rc);
+		return rc;
+	}
+
+	if (fields) {
+		md_attr.da_flags |= DAOS_HL_ARRAY_FIELDS;
+		rc = array_md_access(*oh, epoch, DAOS_HL_MD_FIELDS_AKEY,
+				     (void *)fields, sizeof(*fields),
+				     DAOS_HL_OP_WRITE);
+		if (rc != 0) {
+			DHL_ERROR("Failed to write record fields (%d)\n", rc);
+			daos_obj_close(*oh, NULL);
+			return rc;
+		}
+	}
+
+	rc = array_md_access(*oh, epoch, DAOS_HL_MD_ATTR_AKEY, &md_attr,
+			     sizeof(md_attr), DAOS_HL_OP_WRITE);
+	if (rc != 0) {
+		DHL_ERROR("Failed to write array attributes (%d)\n", rc);
+		daos_obj_close(*oh, NULL);
+		return rc;
+	}
+
+	rc = array_md_register(*oh, epoch, &md_attr, fields);
+	if (rc != 0) {
+		daos_obj_close(*oh, NULL);
+		return rc;
+	}
+
+	return 0;
+}
+
+int
+daos_hl_array_create(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		     daos_hl_array_attr_t *attr, daos_handle_t *oh)
+{
+	if (attr && (attr->da_flags & DAOS_HL_ARRAY_FIELDS)) {
+		DHL_ERROR("Compound arrays need daos_hl_array_create_fields\n");
+		return -1;
+	}
+
+	return array_create(coh, oid, epoch, attr, NULL, oh);
+}
+
+int
+daos_hl_array_create_fields(daos_handle_t coh, daos_obj_id_t oid,
+			    daos_epoch_t epoch, daos_hl_array_attr_t *attr,
+			    unsigned int nr, const daos_hl_field_t *fields,
+			    daos_handle_t *oh)
+{
+	array_fields	md_fields;
+	unsigned int	i, j;
+
+	if (0 == nr || nr > DAOS_HL_FIELDS_MAX || NULL == fields) {
+		DHL_ERROR("Invalid number of fields %u\n", nr);
+		return -1;
+	}
+	if (attr && (attr->da_flags & DAOS_HL_ARRAY_BITMAP)) {
+		DHL_ERROR("Compound arrays do not support a presence map\n");
+		return -1;
+	}
+
+	memset(&md_fields, 0, sizeof(md_fields));
+	md_fields.nr = nr;
+	for (i = 0; i < nr; i++) {
+		daos_size_t len = strnlen(fields[i].df_name,
+					  DAOS_HL_FIELD_NAME_MAX);
+
+		if (0 == len || DAOS_HL_FIELD_NAME_MAX == len ||
+		    0 == fields[i].df_size) {
+			DHL_ERROR("Invalid field %u\n", i);
+			return -1;
+		}
+		for (j = 0; j < i; j++) {
+			if (strcmp(fields[i].df_name, fields[j].df_name) == 0) {
+				DHL_ERROR("Duplicate field %s\n",
+					  fields[i].df_name);
+				return -1;
+			}
+		}
+		md_fields.fields[i] = fields[i];
+	}
+
+	return array_create(coh, oid, epoch, attr, &md_fields, oh);
+}
+
+int
+daos_hl_array_open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		   unsigned int mode, daos_hl_array_attr_t *attr,
+		   daos_handle_t *oh)
+{
+	daos_hl_array_attr_t	md_attr;
+	int			rc;
+
+	if (NULL == oh) {
+		DHL_ERROR("NULL object handle pointer passed\n");
+		return -1;
+	}
+
+	rc = daos_obj_open(coh, oid, epoch, mode, oh, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to open object (%d)\n", rc);
+		return rc;
+	}
+
+	rc = array_md_access(*oh, epoch, DAOS_HL_MD_ATTR_AKEY, &md_attr,
+			     sizeof(md_attr), DAOS_HL_OP_READ);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read array attributes (%d)\n", rc);
+		daos_obj_close(*oh, NULL);
+		return rc;
+	}
+
+	rc = array_md_register(*oh, epoch, &md_attr, NULL);
+	if (rc != 0) {
+		daos_obj_close(*oh, NULL);
+		return rc;
+	}
+
+	if (attr)
+		*attr = array_md_lookup(*oh)->attr;
+
+	return 0;
+}
+
+int
+daos_hl_array_close(daos_handle_t oh)
+{
+	array_md	*md, **prev;
+
+	pthread_mutex_lock(&array_md_lock);
+	for (prev = &array_md_list; *prev != NULL; prev = &(*prev)->next) {
+		if ((*prev)->oh.cookie == oh.cookie)
+			break;
+	}
+	md = *prev;
+	if (md)
+		*prev = md->next;
+	pthread_mutex_unlock(&array_md_lock);
+
+	if (md) {
+		pthread_mutex_destroy(&md->lock);
+		free(md->bitmap);
+		free(md->zones);
+		free(md->own_zones);
+		free(md);
+	}
+
+	return daos_obj_close(oh, NULL);
+}
@@ -0,0 +1,142 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/array_mpi.c
+ *
+ * MPI helpers of the array module, built with the DAOS_HL_MPI option.
+ */
+
+#include <daos_hl_mpi.h>
+#include <daos_hl/common.h>
+#include <daos_hl/array.h>
+
+struct daos_hl_append_ctx {
+	daos_handle_t	oh;
+	daos_epoch_t	epoch;
+	MPI_Comm	comm;
+	MPI_Win		win;
+	/** append counter, only exposed by rank 0 of comm */
+	uint64_t	*counter;
+	int		rank;
+};
+
+int
+daos_hl_array_append_ctx_create(daos_handle_t oh, daos_epoch_t epoch,
+				MPI_Comm comm, daos_hl_append_ctx_t **ctxp)
+{
+	daos_hl_append_ctx_t	*ctx;
+	uint64_t		end = 0;
+	int			rc = 0;
+
+	if (NULL == ctxp) {
+		DHL_ERROR("NULL context pointer passed\n");
+		return -1;
+	}
+
+	ctx = (daos_hl_append_ctx_t *)calloc(1, sizeof(daos_hl_append_ctx_t));
+	if (NULL == ctx) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	ctx->oh = oh;
+	ctx->epoch = epoch;
+	MPI_Comm_dup(comm, &ctx->comm);
+	MPI_Comm_rank(ctx->comm, &ctx->rank);
+
+	/** rank 0 loads the persistent end of the appended data */
+	if (ctx->rank == 0)
+		rc = array_md_access(oh, epoch, DAOS_HL_MD_APPEND_AKEY, &end,
+				     sizeof(end), DAOS_HL_OP_READ);
+	MPI_Bcast(&rc, 1, MPI_INT, 0, ctx->comm);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read append offset (%d)\n", rc);
+		MPI_Comm_free(&ctx->comm);
+		free(ctx);
+		return rc;
+	}
+
+	MPI_Win_allocate((ctx->rank == 0) ? sizeof(uint64_t) : 0,
+			 sizeof(uint64_t), MPI_INFO_NULL, ctx->comm,
+			 &ctx->counter, &ctx->win);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, ctx->win);
+	if (ctx->rank == 0) {
+		*ctx->counter = end;
+		MPI_Win_sync(ctx->win);
+	}
+	MPI_Barrier(ctx->comm);
+
+	*ctxp = ctx;
+
+	return 0;
+}
+
+int
+daos_hl_array_append_ctx_destroy(daos_hl_append_ctx_t *ctx)
+{
+	uint64_t	end;
+	int		rc = 0;
+
+	if (NULL == ctx)
+		return 0;
+
+	MPI_Win_flush_all(ctx->win);
+	MPI_Barrier(ctx->comm);
+
+	/** rank 0 persists the end of the appended data */
+	if (ctx->rank == 0) {
+		MPI_Win_sync(ctx->win);
+		end = *ctx->counter;
+		rc = array_md_access(ctx->oh, ctx->epoch,
+				     DAOS_HL_MD_APPEND_AKEY, &end, sizeof(end),
+				     DAOS_HL_OP_WRITE);
+	}
+	MPI_Bcast(&rc, 1, MPI_INT, 0, ctx->comm);
+
+	MPI_Win_unlock_all(ctx->win);
+	MPI_Win_free(&ctx->win);
+	MPI_Comm_free(&ctx->comm);
+	free(ctx);
+
+	if (rc != 0)
+		DHL_ERROR("Failed to persist append offset (%d)\n", rc);
+
+	return rc;
+}
+
+int
+append_ctx_reserve(daos_hl_append_ctx_t *ctx, daos_handle_t oh,
+		   daos_epoch_t epoch, uint64_t len, uint64_t *offset)
+{
+	if (ctx->oh.cookie != oh.cookie || ctx->epoch != epoch) {
+		DHL_ERROR("Append context does not match the object/epoch\n");
+		return -1;
+	}
+
+	MPI_Fetch_and_op(&len, offset, MPI_UINT64_T, 0, 0, MPI_SUM, ctx->win);
+	MPI_Win_flush(0, ctx->win);
+
+	return 0;
+}
@@ -0,0 +1,528 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/ckpt.c
+ *
+ * Checkpoint writer. Array writes are copied into a pool of staging buffers,
+ * or borrow the buffers of the application, and return as soon as their I/O
+ * is started. A thread of the writer polls the event queue of the writes, so
+ * they drain while the application computes the next timestep.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+
+/** MSC - Those need to be configurable later through hints */
+/** Default number of staging buffers */
+#define DAOS_HL_CKPT_BUF_NR		2
+/** Default size of each staging buffer */
+#define DAOS_HL_CKPT_BUF_SIZE		4194304
+/** Time in us the drain thread waits in each poll */
+#define DAOS_HL_CKPT_POLL_TIMEOUT	1000
+/** Initial number of failed epochs the writer keeps track of */
+#define DAOS_HL_CKPT_ERRS_NR		4
+
+/** A write in flight, with the staging buffer it owns */
+typedef struct {
+	daos_event_t		ev;
+	bool			busy;
+	daos_epoch_t		epoch;
+	char			*buf;
+	daos_hl_array_ranges_t	ranges;
+	daos_size_t		ranges_cap;
+	daos_iov_t		iov;
+	daos_sg_list_t		sgl;
+} ckpt_slot;
+
+/** First error of the writes of one epoch, not returned yet */
+typedef struct {
+	daos_epoch_t		epoch;
+	int			rc;
+} ckpt_err;
+
+struct daos_hl_ckpt {
+	daos_handle_t		coh;
+	daos_handle_t		eqh;
+	daos_size_t		buf_size;
+	unsigned int		slot_nr;
+	ckpt_slot		*slots;
+	unsigned int		inflight;
+	/** epochs with a failed write, in no order */
+	ckpt_err		*errs;
+	unsigned int		errs_nr;
+	unsigned int		errs_cap;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	pthread_t		thread;
+	volatile bool		stop;
+};
+
+/**
+ * Record the failure of a write of an epoch, unless the epoch already failed.
+ * Called with the lock held.
+ */
+static void
+ckpt_err_record(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch, int rc)
+{
+	unsigned int i;
+
+	for (i = 0; i < ckpt->errs_nr; i++)
+		if (ckpt->errs[i].epoch == epoch)
+			return;
+
+	if (ckpt->errs_nr == ckpt->errs_cap) {
+		unsigned int	cap = 2 * ckpt->errs_cap;
+		ckpt_err	*errs;
+
+		errs = realloc(ckpt->errs, cap * sizeof(ckpt_err));
+		if (errs == NULL) {
+			/** keep the failure, folded into another epoch */
+			DHL_ERROR("Failed memory allocation\n");
+			if (epoch < ckpt->errs[0].epoch)
+				ckpt->errs[0].epoch = epoch;
+			return;
+		}
+		ckpt->errs = errs;
+		ckpt->errs_cap = cap;
+	}
+
+	ckpt->errs[ckpt->errs_nr].epoch = epoch;
+	ckpt->errs[ckpt->errs_nr].rc = rc;
+	ckpt->errs_nr ++;
+}
+
+/**
+ * Take the error of the lowest failed epoch up to \a epoch, and clear the
+ * errors of all the epochs up to \a epoch. Called with the lock held.
+ */
+static int
+ckpt_err_take(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch)
+{
+	daos_epoch_t	lowest = 0;
+	unsigned int	i, j;
+	int		rc = 0;
+
+	for (i = 0, j = 0; i < ckpt->errs_nr; i++) {
+		if (ckpt->errs[i].epoch > epoch) {
+			ckpt->errs[j++] = ckpt->errs[i];
+			continue;
+		}
+		if (rc == 0 || ckpt->errs[i].epoch < lowest) {
+			rc = ckpt->errs[i].rc;
+			lowest = ckpt->errs[i].epoch;
+		}
+	}
+	ckpt->errs_nr = j;
+
+	return rc;
+}
+
+static void
+ckpt_slot_put(daos_hl_ckpt_t *ckpt, ckpt_slot *slot, int rc)
+{
+	pthread_mutex_lock(&ckpt->lock);
+	if (rc != 0)
+		ckpt_err_record(ckpt, slot->epoch, rc);
+	slot->busy = false;
+	ckpt->inflight --;
+	pthread_cond_broadcast(&ckpt->cond);
+	pthread_mutex_unlock(&ckpt->lock);
+}
+
+static void *
+ckpt_drain_func(void *arg)
+{
+	daos_hl_ckpt_t	*ckpt = arg;
+	daos_event_t	*evp;
+	ckpt_slot	*slot;
+	int		rc;
+
+	while (!ckpt->stop) {
+		rc = daos_eq_poll(ckpt->eqh, 0, DAOS_HL_CKPT_POLL_TIMEOUT, 1,
+				  &evp);
+		if (rc < 0)
+			/** the writes in flight still need to be reaped */
+			DHL_ERROR("Checkpoint failed to poll (%d)\n", rc);
+		if (rc <= 0)
+			continue;
+
+		slot = (ckpt_slot *)((char *)evp - offsetof(ckpt_slot, ev));
+		rc = evp->ev_error;
+		daos_event_fini(evp);
+		if (rc != 0)
+			DHL_ERROR("Checkpoint write at epoch %"PRIu64" failed "
+				  "(%d)\n", slot->epoch, rc);
+		ckpt_slot_put(ckpt, slot, rc);
+	}
+
+	return NULL;
+}
+
+/** Wait for a free slot, the backpressure of the writer */
+static ckpt_slot *
+ckpt_slot_get(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch)
+{
+	ckpt_slot	*slot = NULL;
+	unsigned int	i;
+
+	pthread_mutex_lock(&ckpt->lock);
+	while (ckpt->inflight == ckpt->slot_nr)
+		pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+	for (i = 0; i < ckpt->slot_nr; i++) {
+		if (!ckpt->slots[i].busy) {
+			slot = &ckpt->slots[i];
+			break;
+		}
+	}
+	DHL_ASSERT(slot != NULL);
+	slot->busy = true;
+	slot->epoch = epoch;
+	ckpt->inflight ++;
+	pthread_mutex_unlock(&ckpt->lock);
+
+	return slot;
+}
+
+static int
+ckpt_slot_launch(daos_hl_ckpt_t *ckpt, ckpt_slot *slot, daos_handle_t oh,
+		 daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl)
+{
+	int rc;
+
+	rc = daos_event_init(&slot->ev, ckpt->eqh, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to init event (%d)\n", rc);
+		ckpt_slot_put(ckpt, slot, 0);
+		return rc;
+	}
+
+	rc = daos_hl_array_write(oh, slot->epoch, ranges, sgl, NULL,
+				 &slot->ev);
+	if (rc != 0) {
+		DHL_ERROR("Failed to start checkpoint write (%d)\n", rc);
+		daos_event_fini(&slot->ev);
+		ckpt_slot_put(ckpt, slot, 0);
+	}
+
+	return rc;
+}
+
+static int
+ckpt_ranges_append(ckpt_slot *slot, daos_off_t index, daos_size_t len)
+{
+	daos_hl_array_ranges_t *ranges = &slot->ranges;
+
+	if (ranges->ranges_nr == slot->ranges_cap) {
+		daos_size_t	cap = slot->ranges_cap ? 2 * slot->ranges_cap :
+				      16;
+		daos_hl_range_t	*rg;
+
+		rg = realloc(ranges->ranges, cap * sizeof(daos_hl_range_t));
+		if (rg == NULL) {
+			DHL_ERROR("Failed memory allocation\n");
+			return -1;
+		}
+		ranges->ranges = rg;
+		slot->ranges_cap = cap;
+	}
+
+	ranges->ranges[ranges->ranges_nr].index = index;
+	ranges->ranges[ranges->ranges_nr].len = len;
+	ranges->ranges_nr ++;
+	return 0;
+}
+
+int
+daos_hl_ckpt_create(daos_handle_t coh, daos_hl_ckpt_attr_t *attr,
+		    daos_hl_ckpt_t **ckptp)
+{
+	daos_hl_ckpt_t	*ckpt;
+	unsigned int	i;
+	int		rc;
+
+	if (ckptp == NULL) {
+		DHL_ERROR("NULL checkpoint pointer passed\n");
+		return -1;
+	}
+
+	ckpt = calloc(1, sizeof(daos_hl_ckpt_t));
+	if (ckpt == NULL) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	ckpt->coh = coh;
+	ckpt->slot_nr = DAOS_HL_CKPT_BUF_NR;
+	ckpt->buf_size = DAOS_HL_CKPT_BUF_SIZE;
+	if (attr) {
+		if (attr->dc_buf_nr)
+			ckpt->slot_nr = attr->dc_buf_nr;
+		if (attr->dc_buf_size)
+			ckpt->buf_size = attr->dc_buf_size;
+	}
+
+	ckpt->errs_cap = DAOS_HL_CKPT_ERRS_NR;
+	ckpt->errs = calloc(ckpt->errs_cap, sizeof(ckpt_err));
+	ckpt->slots = calloc(ckpt->slot_nr, sizeof(ckpt_slot));
+	if (ckpt->errs == NULL || ckpt->slots == NULL) {
+		DHL_ERROR("Failed memory allocation\n");
+		free(ckpt->slots);
+		free(ckpt->errs);
+		free(ckpt);
+		return -1;
+	}
+	for (i = 0; i < ckpt->slot_nr; i++) {
+		ckpt->slots[i].buf = malloc(ckpt->buf_size);
+		if (ckpt->slots[i].buf == NULL) {
+			DHL_ERROR("Failed memory allocation\n");
+			rc = -1;
+			goto err_slots;
+		}
+	}
+
+	rc = daos_eq_create(&ckpt->eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create event queue (%d)\n", rc);
+		goto err_slots;
+	}
+
+	pthread_mutex_init(&ckpt->lock, NULL);
+	pthread_cond_init(&ckpt->cond, NULL);
+
+	rc = pthread_create(&ckpt->thread, NULL, ckpt_drain_func, ckpt);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create checkpoint thread (%d)\n", rc);
+		pthread_cond_destroy(&ckpt->cond);
+		pthread_mutex_destroy(&ckpt->lock);
+		daos_eq_destroy(ckpt->eqh, 0);
+		rc = -1;
+		goto err_slots;
+	}
+
+	*ckptp = ckpt;
+	return 0;
+
+err_slots:
+	for (i = 0; i < ckpt->slot_nr; i++)
+		free(ckpt->slots[i].buf);
+	free(ckpt->slots);
+	free(ckpt->errs);
+	free(ckpt);
+	return rc;
+}
+
+int
+daos_hl_ckpt_write(daos_hl_ckpt_t *ckpt, daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		   unsigned int flags)
+{
+	ckpt_slot	*slot;
+	daos_size_t	ranges_len = 0, sgl_len = 0;
+	daos_size_t	u, s = 0;
+	daos_off_t	roff = 0, soff = 0;
+	bool		launched = false;
+	int		rc = 0;
+
+	if (ckpt == NULL || ranges == NULL || sgl == NULL) {
+		DHL_ERROR("NULL checkpoint, ranges or sgl passed\n");
+		return -1;
+	}
+
+	for (u = 0; u < ranges->ranges_nr; u++)
+		ranges_len += ranges->ranges[u].len;
+	for (u = 0; u < sgl->sg_nr.num; u++)
+		sgl_len += sgl->sg_iovs[u].iov_len;
+	if (ranges_len != sgl_len) {
+		DHL_ERROR("Unequal extents of memory and array descriptors\n");
+		return -1;
+	}
+
+	/** a borrowed write only takes a slot to bound the writes in flight */
+	if (flags & DAOS_HL_CKPT_BORROW) {
+		slot = ckpt_slot_get(ckpt, epoch);
+		return ckpt_slot_launch(ckpt, slot, oh, ranges, sgl);
+	}
+
+	/** copy the data one staging buffer at a time */
+	u = 0;
+	while (u < ranges->ranges_nr) {
+		daos_size_t used = 0;
+
+		slot = ckpt_slot_get(ckpt, epoch);
+		slot->ranges.ranges_nr = 0;
+
+		while (u < ranges->ranges_nr && used < ckpt->buf_size) {
+			daos_size_t	n = ranges->ranges[u].len - roff;
+			daos_size_t	left;
+
+			n = MIN(n, ckpt->buf_size - used);
+			if (n == 0) {
+				u ++;
+				roff = 0;
+				continue;
+			}
+
+			rc = ckpt_ranges_append(slot, ranges->ranges[u].index +
+						roff, n);
+			if (rc != 0) {
+				ckpt_slot_put(ckpt, slot, 0);
+				goto out;
+			}
+
+			for (left = n; left > 0; ) {
+				daos_iov_t	*iov = &sgl->sg_iovs[s];
+				daos_size_t	m;
+
+				m = MIN(left, iov->iov_len - soff);
+				memcpy(slot->buf + used + (n - left),
+				       (char *)iov->iov_buf + soff, m);
+				left -= m;
+				soff += m;
+				if (soff == iov->iov_len) {
+					s ++;
+					soff = 0;
+				}
+			}
+
+			used += n;
+			roff += n;
+			if (roff == ranges->ranges[u].len) {
+				u ++;
+				roff = 0;
+			}
+		}
+
+		if (used == 0) {
+			/** only empty ranges were left */
+			ckpt_slot_put(ckpt, slot, 0);
+			break;
+		}
+
+		daos_iov_set(&slot->iov, slot->buf, used);
+		slot->sgl.sg_nr.num = 1;
+		slot->sgl.sg_iovs = &slot->iov;
+
+		rc = ckpt_slot_launch(ckpt, slot, oh, &slot->ranges,
+				      &slot->sgl);
+		if (rc != 0)
+			goto out;
+		launched = true;
+	}
+
+out:
+	/** the buffers already launched leave the epoch partly written */
+	if (rc != 0 && launched) {
+		pthread_mutex_lock(&ckpt->lock);
+		ckpt_err_record(ckpt, epoch, rc);
+		pthread_mutex_unlock(&ckpt->lock);
+	}
+	return rc;
+}
+
+int
+daos_hl_ckpt_wait(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch)
+{
+	unsigned int	i;
+	int		rc;
+
+	if (ckpt == NULL) {
+		DHL_ERROR("NULL checkpoint passed\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&ckpt->lock);
+	for (i = 0; i < ckpt->slot_nr; i++) {
+		/** writes of later epochs keep draining */
+		while (ckpt->slots[i].busy && ckpt->slots[i].epoch <= epoch)
+			pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+	}
+
+	rc = ckpt_err_take(ckpt, epoch);
+	pthread_mutex_unlock(&ckpt->lock);
+
+	return rc;
+}
+
+int
+daos_hl_ckpt_commit(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch)
+{
+	int rc;
+
+	rc = daos_hl_ckpt_wait(ckpt, epoch);
+	if (rc != 0) {
+		DHL_ERROR("Checkpoint at epoch %"PRIu64" failed (%d)\n",
+			  epoch, rc);
+		return rc;
+	}
+
+	rc = daos_epoch_commit(ckpt->coh, epoch, NULL, NULL);
+	if (rc != 0)
+		DHL_ERROR("Failed to commit epoch %"PRIu64" (%d)\n", epoch,
+			  rc);
+
+	return rc;
+}
+
+int
+daos_hl_ckpt_destroy(daos_hl_ckpt_t *ckpt)
+{
+	unsigned int	i;
+	int		rc;
+
+	if (ckpt == NULL) {
+		DHL_ERROR("NULL checkpoint passed\n");
+		return -1;
+	}
+
+	/** drain all the writes, the thread still polls their completions */
+	pthread_mutex_lock(&ckpt->lock);
+	while (ckpt->inflight)
+		pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+	rc = ckpt_err_take(ckpt, (daos_epoch_t)-1);
+	pthread_mutex_unlock(&ckpt->lock);
+
+	ckpt->stop = true;
+	pthread_join(ckpt->thread, NULL);
+
+	daos_eq_destroy(ckpt->eqh, 0);
+	pthread_cond_destroy(&ckpt->cond);
+	pthread_mutex_destroy(&ckpt->lock);
+
+	for (i = 0; i < ckpt->slot_nr; i++) {
+		free(ckpt->slots[i].buf);
+		free(ckpt->slots[i].ranges.ranges);
+	}
+	free(ckpt->slots);
+	free(ckpt->errs);
+	free(ckpt);
+
+	return rc;
+}
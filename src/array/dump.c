@@ -0,0 +1,1036 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/dump.c
+ *
+ * Dump of array ranges to local files and load back. A dump file is a header,
+ * holding the attributes of the array when it was opened with
+ * daos_hl_array_open/create, followed by a stream of records, each one
+ * describing an extent of the array as either data or a hole, and ending with
+ * an end record:
+ *
+ *	dump_hdr | dump_rec data... | dump_rec | ... | dump_rec (DUMP_REC_END)
+ *
+ * Every header and record carries a CRC-32C of its fields and data. Holes are
+ * runs of zero bytes, and take no space past their record. All the fields are
+ * in host byte order.
+ *
+ * Each process of the communicator dumps a contiguous share of the range to a
+ * file of its own, so the files can be loaded by any number of processes. On
+ * each process, the array I/Os of the next chunks are in flight while a disk
+ * thread writes or reads the file.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <daos_hl_mpi.h>
+#include <daos_hl/common.h>
+#include <daos_hl/array.h>
+
+#define DUMP_MAGIC		0x31504d55444c4844ULL	/* "DHLDUMP1" */
+#define DUMP_VERSION		2
+/** The header holds the attributes of the array */
+#define DUMP_HDR_ATTR		(1U << 0)
+
+/** Array bytes fetched or updated by one I/O */
+#define DAOS_HL_DUMP_CHUNK	(4 << 20)
+/** Chunks in flight per process */
+#define DAOS_HL_DUMP_DEPTH	8
+/** Granularity of the hole detection */
+#define DAOS_HL_DUMP_GRAIN	4096
+/** Most records in a chunk */
+#define DUMP_SLOT_RECS		(DAOS_HL_DUMP_CHUNK / DAOS_HL_DUMP_GRAIN + 1)
+
+/** Header of a dump file */
+typedef struct {
+	uint64_t	magic;
+	uint32_t	version;
+	/** number of files of the dump */
+	uint32_t	nfiles;
+	/** array range of the whole dump */
+	uint64_t	index;
+	uint64_t	len;
+	/** largest record of the file */
+	uint64_t	chunk;
+	/** attributes of the array, with DUMP_HDR_ATTR */
+	daos_hl_array_attr_t attr;
+	/** DUMP_HDR_* flags */
+	uint32_t	flags;
+	/** CRC-32C of the fields above */
+	uint32_t	crc;
+} dump_hdr;
+
+#define DUMP_REC_DATA	0
+#define DUMP_REC_HOLE	1
+#define DUMP_REC_END	2
+/** Zeros to write when loading, never in a file */
+#define DUMP_REC_ZERO	3
+
+/** Record of a dump file, followed by len bytes if it holds data */
+typedef struct {
+	uint64_t	index;
+	uint64_t	len;
+	uint32_t	type;
+	/** CRC-32C of the fields above and of the data */
+	uint32_t	crc;
+} dump_rec;
+
+/** CRC-32C (Castagnoli), reflected */
+#define CRC32C_POLY	0x82f63b78
+
+static uint32_t		crc32c_table[256];
+static pthread_once_t	crc32c_once = PTHREAD_ONCE_INIT;
+static uint32_t		(*crc32c_func)(uint32_t crc, const void *buf,
+				       size_t len);
+
+static uint32_t
+crc32c_sw(uint32_t crc, const void *buf, size_t len)
+{
+	const uint8_t	*p = buf;
+
+	crc = ~crc;
+	while (len--)
+		crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32c_hw(uint32_t crc, const void *buf, size_t len)
+{
+	const uint8_t	*p = buf;
+	uint64_t	c = ~crc;
+
+	for (; len && ((uintptr_t)p & 7); len--)
+		c = __builtin_ia32_crc32qi(c, *p++);
+	for (; len >= 8; len -= 8, p += 8)
+		c = __builtin_ia32_crc32di(c, *(const uint64_t *)p);
+	for (; len; len--)
+		c = __builtin_ia32_crc32qi(c, *p++);
+
+	return ~(uint32_t)c;
+}
+#endif
+
+static void
+crc32c_init(void)
+{
+	uint32_t	i, j, c;
+
+	for (i = 0; i < 256; i++) {
+		for (c = i, j = 0; j < 8; j++)
+			c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+		crc32c_table[i] = c;
+	}
+
+	crc32c_func = crc32c_sw;
+#if defined(__x86_64__)
+	if (__builtin_cpu_supports("sse4.2"))
+		crc32c_func = crc32c_hw;
+#endif
+}
+
+static uint32_t
+crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	pthread_once(&crc32c_once, crc32c_init);
+	return crc32c_func(crc, buf, len);
+}
+
+static uint32_t
+dump_rec_crc(dump_rec *rec, const void *data)
+{
+	uint32_t crc = crc32c(0, rec, offsetof(dump_rec, crc));
+
+	return data ? crc32c(crc, data, rec->len) : crc;
+}
+
+static int
+dump_write(int fd, const void *buf, size_t len)
+{
+	const char	*p = buf;
+	ssize_t		n;
+
+	while (len) {
+		n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			DHL_ERROR("Failed to write dump file (%d)\n", errno);
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/** Read len bytes, failing on a short read */
+static int
+dump_read(int fd, void *buf, size_t len)
+{
+	char	*p = buf;
+	ssize_t	n;
+
+	while (len) {
+		n = read(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			DHL_ERROR("Failed to read dump file (%d)\n",
+				  n ? errno : -1);
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/** Name of file i of a dump of nfiles files */
+static void
+dump_path(char *name, size_t size, const char *path, uint32_t nfiles,
+	  uint32_t i)
+{
+	if (nfiles == 1)
+		snprintf(name, size, "%s", path);
+	else
+		snprintf(name, size, "%s.%u", path, i);
+}
+
+typedef enum {
+	DUMP_SLOT_FREE,
+	/** array I/O in flight */
+	DUMP_SLOT_IO,
+	/** waiting for the disk thread (dump) or the array (load) */
+	DUMP_SLOT_READY,
+} dump_slot_state_t;
+
+/** One chunk buffer and the array extents it carries */
+typedef struct {
+	dump_slot_state_t	state;
+	daos_event_t		ev;
+	char			*buf;
+	daos_hl_range_t		rgs[DUMP_SLOT_RECS];
+	daos_hl_array_ranges_t	ranges;
+	daos_iov_t		iov;
+	daos_sg_list_t		sgl;
+} dump_slot;
+
+/** State shared by the array side and the disk thread of a dump or load */
+typedef struct {
+	dump_slot		slots[DAOS_HL_DUMP_DEPTH];
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	int			fd;
+	daos_size_t		chunk;
+	/** no more slots will be made ready by the producer */
+	bool			done;
+	/** first error of either side */
+	int			status;
+	/** end of the range of the whole dump */
+	daos_off_t		end;
+} dump_pipe;
+
+static int
+dump_pipe_init(dump_pipe *pipe, int fd, daos_size_t chunk)
+{
+	int i;
+
+	memset(pipe, 0, sizeof(*pipe));
+	pipe->fd = fd;
+	pipe->chunk = chunk;
+	pthread_mutex_init(&pipe->lock, NULL);
+	pthread_cond_init(&pipe->cond, NULL);
+
+	for (i = 0; i < DAOS_HL_DUMP_DEPTH; i++) {
+		dump_slot *slot = &pipe->slots[i];
+
+		slot->buf = malloc(chunk);
+		if (NULL == slot->buf) {
+			DHL_ERROR("Failed memory allocation\n");
+			return -1;
+		}
+		slot->ranges.ranges = slot->rgs;
+		slot->sgl.sg_nr.num = 1;
+		slot->sgl.sg_iovs = &slot->iov;
+	}
+
+	return 0;
+}
+
+static void
+dump_pipe_fini(dump_pipe *pipe)
+{
+	int i;
+
+	for (i = 0; i < DAOS_HL_DUMP_DEPTH; i++)
+		free(pipe->slots[i].buf);
+	pthread_cond_destroy(&pipe->cond);
+	pthread_mutex_destroy(&pipe->lock);
+}
+
+/** Move slot to state, failing the pipe if rc is not 0 */
+static void
+dump_pipe_set(dump_pipe *pipe, dump_slot *slot, dump_slot_state_t state,
+	      int rc)
+{
+	pthread_mutex_lock(&pipe->lock);
+	if (slot)
+		slot->state = state;
+	if (rc != 0 && pipe->status == 0)
+		pipe->status = rc;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+static void
+dump_pipe_fail(dump_pipe *pipe, int rc)
+{
+	dump_pipe_set(pipe, NULL, DUMP_SLOT_FREE, rc);
+}
+
+/** Slot of the pipe whose event is ev */
+static dump_slot *
+dump_pipe_slot(dump_pipe *pipe, daos_event_t *ev)
+{
+	int i;
+
+	for (i = 0; i < DAOS_HL_DUMP_DEPTH; i++)
+		if (&pipe->slots[i].ev == ev)
+			break;
+	DHL_ASSERT(i < DAOS_HL_DUMP_DEPTH);
+
+	return &pipe->slots[i];
+}
+
+/**
+ * Wait until slot is in state, or until the pipe fails or, if check_done,
+ * until the producer is done. Returns true if the slot is in state.
+ */
+static bool
+dump_pipe_wait(dump_pipe *pipe, dump_slot *slot, dump_slot_state_t state,
+	       bool check_done)
+{
+	bool ok;
+
+	pthread_mutex_lock(&pipe->lock);
+	while (slot->state != state && pipe->status == 0 &&
+	       !(check_done && pipe->done))
+		pthread_cond_wait(&pipe->cond, &pipe->lock);
+	ok = (slot->state == state && pipe->status == 0);
+	pthread_mutex_unlock(&pipe->lock);
+
+	return ok;
+}
+
+static bool
+zero_grain(const char *p, daos_size_t len)
+{
+	return p[0] == 0 && memcmp(p, p + 1, len - 1) == 0;
+}
+
+/** Write the chunk of a slot as data and hole records */
+static int
+dump_emit(dump_pipe *pipe, dump_slot *slot)
+{
+	daos_off_t	index = slot->rgs[0].index;
+	daos_size_t	len = slot->rgs[0].len;
+	daos_off_t	off = 0;
+	dump_rec	rec;
+	int		rc;
+
+	while (off < len) {
+		daos_size_t	n = MIN(DAOS_HL_DUMP_GRAIN, len - off);
+		bool		hole = zero_grain(slot->buf + off, n);
+		daos_off_t	start = off;
+
+		/** extend the run while the grains are of the same kind */
+		for (off += n; off < len; off += n) {
+			n = MIN(DAOS_HL_DUMP_GRAIN, len - off);
+			if (zero_grain(slot->buf + off, n) != hole)
+				break;
+		}
+
+		rec.index = index + start;
+		rec.len = off - start;
+		rec.type = hole ? DUMP_REC_HOLE : DUMP_REC_DATA;
+		rec.crc = dump_rec_crc(&rec, hole ? NULL : slot->buf + start);
+
+		rc = dump_write(pipe->fd, &rec, sizeof(rec));
+		if (rc == 0 && !hole)
+			rc = dump_write(pipe->fd, slot->buf + start, rec.len);
+		if (rc != 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+/** Disk thread of a dump: write the ready slots in order */
+static void *
+dump_writer(void *arg)
+{
+	dump_pipe	*pipe = arg;
+	dump_rec	rec;
+	unsigned int	next = 0;
+	int		rc = 0;
+
+	while (1) {
+		dump_slot *slot = &pipe->slots[next % DAOS_HL_DUMP_DEPTH];
+
+		if (!dump_pipe_wait(pipe, slot, DUMP_SLOT_READY, true))
+			break;
+
+		rc = dump_emit(pipe, slot);
+		dump_pipe_set(pipe, slot, DUMP_SLOT_FREE, rc);
+		if (rc != 0)
+			return NULL;
+		next ++;
+	}
+
+	pthread_mutex_lock(&pipe->lock);
+	rc = pipe->status;
+	pthread_mutex_unlock(&pipe->lock);
+	if (rc != 0)
+		return NULL;
+
+	rec.index = pipe->end;
+	rec.len = 0;
+	rec.type = DUMP_REC_END;
+	rec.crc = dump_rec_crc(&rec, NULL);
+	rc = dump_write(pipe->fd, &rec, sizeof(rec));
+	if (rc == 0 && fsync(pipe->fd) != 0) {
+		DHL_ERROR("Failed to sync dump file (%d)\n", errno);
+		rc = -1;
+	}
+	if (rc != 0)
+		dump_pipe_fail(pipe, rc);
+
+	return NULL;
+}
+
+/** Dump [index, index + len) of the array to fd, after its header */
+static int
+dump_file(daos_handle_t oh, daos_epoch_t epoch, daos_off_t index,
+	  daos_size_t len, int fd)
+{
+	dump_pipe	pipe;
+	pthread_t	writer;
+	daos_handle_t	eqh;
+	daos_event_t	*evp;
+	daos_size_t	nchunks = (len + DAOS_HL_DUMP_CHUNK - 1) /
+				  DAOS_HL_DUMP_CHUNK;
+	daos_size_t	fill = 0;
+	unsigned int	inflight = 0;
+	int		rc;
+
+	rc = dump_pipe_init(&pipe, fd, DAOS_HL_DUMP_CHUNK);
+	if (rc != 0)
+		goto out;
+	pipe.end = index + len;
+
+	rc = daos_eq_create(&eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create event queue (%d)\n", rc);
+		goto out;
+	}
+
+	rc = pthread_create(&writer, NULL, dump_writer, &pipe);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create disk thread (%d)\n", rc);
+		daos_eq_destroy(eqh, 0);
+		rc = -1;
+		goto out;
+	}
+
+	/**
+	 * Chunks go through the slots in order, so that the disk thread finds
+	 * them in file order, while the fetches of the next chunks run.
+	 */
+	while (1) {
+		dump_slot	*slot;
+		bool		free_slot;
+
+		while (fill < nchunks) {
+			slot = &pipe.slots[fill % DAOS_HL_DUMP_DEPTH];
+
+			pthread_mutex_lock(&pipe.lock);
+			free_slot = (slot->state == DUMP_SLOT_FREE &&
+				     pipe.status == 0);
+			pthread_mutex_unlock(&pipe.lock);
+			if (!free_slot)
+				break;
+
+			slot->rgs[0].index = index + fill * DAOS_HL_DUMP_CHUNK;
+			slot->rgs[0].len = MIN(DAOS_HL_DUMP_CHUNK,
+					       len - fill * DAOS_HL_DUMP_CHUNK);
+			slot->ranges.ranges_nr = 1;
+			daos_iov_set(&slot->iov, slot->buf, slot->rgs[0].len);
+			fill ++;
+
+			/** unwritten extents read back as zeros */
+			memset(slot->buf, 0, slot->rgs[0].len);
+			if (!array_present(oh, slot->rgs[0].index,
+					   slot->rgs[0].len)) {
+				dump_pipe_set(&pipe, slot, DUMP_SLOT_READY, 0);
+				continue;
+			}
+
+			dump_pipe_set(&pipe, slot, DUMP_SLOT_IO, 0);
+			rc = daos_event_init(&slot->ev, eqh, NULL);
+			if (rc == 0) {
+				rc = daos_hl_array_read(oh, epoch,
+							&slot->ranges,
+							&slot->sgl, NULL,
+							&slot->ev);
+				if (rc != 0)
+					daos_event_fini(&slot->ev);
+			}
+			if (rc != 0) {
+				DHL_ERROR("Failed to start dump read (%d)\n",
+					  rc);
+				dump_pipe_set(&pipe, slot, DUMP_SLOT_FREE, rc);
+				break;
+			}
+			inflight ++;
+		}
+
+		if (inflight == 0) {
+			if (fill == nchunks)
+				break;
+			/** all the slots wait for the disk */
+			slot = &pipe.slots[fill % DAOS_HL_DUMP_DEPTH];
+			if (!dump_pipe_wait(&pipe, slot, DUMP_SLOT_FREE,
+					    false))
+				break;
+			continue;
+		}
+
+		rc = daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp);
+		if (rc != 1) {
+			DHL_ERROR("Failed to poll event queue (%d)\n", rc);
+			dump_pipe_fail(&pipe, rc < 0 ? rc : -1);
+			break;
+		}
+		inflight --;
+
+		slot = dump_pipe_slot(&pipe, evp);
+		rc = evp->ev_error;
+		daos_event_fini(evp);
+		if (rc != 0)
+			DHL_ERROR("Dump read failed (%d)\n", rc);
+		dump_pipe_set(&pipe, slot, DUMP_SLOT_READY, rc);
+	}
+
+	/** drain the reads still in flight after a failure */
+	while (inflight) {
+		if (daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp) != 1)
+			break;
+		daos_event_fini(evp);
+		inflight --;
+	}
+
+	pthread_mutex_lock(&pipe.lock);
+	pipe.done = true;
+	pthread_cond_broadcast(&pipe.cond);
+	pthread_mutex_unlock(&pipe.lock);
+	pthread_join(writer, NULL);
+
+	daos_eq_destroy(eqh, 0);
+	rc = pipe.status;
+out:
+	dump_pipe_fini(&pipe);
+	return rc;
+}
+
+int
+daos_hl_array_dump(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_range_t *range, MPI_Comm comm, const char *path)
+{
+	dump_hdr	hdr;
+	daos_size_t	nchunks, first, last;
+	char		name[PATH_MAX];
+	int		rank, size;
+	int		fd;
+	int		rc = 0, rc_reduce;
+
+	if (NULL == path) {
+		DHL_ERROR("NULL path passed\n");
+		return -1;
+	}
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = DUMP_MAGIC;
+	hdr.version = DUMP_VERSION;
+	hdr.nfiles = size;
+	hdr.chunk = DAOS_HL_DUMP_CHUNK;
+	if (array_attr_get(oh, &hdr.attr) == 0)
+		hdr.flags |= DUMP_HDR_ATTR;
+
+	if (hdr.attr.da_flags & DAOS_HL_ARRAY_FIELDS) {
+		DHL_ERROR("Compound arrays can not be dumped\n");
+		return -1;
+	}
+	if (NULL == range && !(hdr.flags & DUMP_HDR_ATTR)) {
+		DHL_ERROR("Dumping up to the array size needs a handle of "
+			  "daos_hl_array_open/create\n");
+		return -1;
+	}
+
+	if (range) {
+		hdr.index = range->index;
+		hdr.len = range->len;
+	} else if (rank == 0) {
+		rc = daos_hl_array_get_size(oh, epoch, &hdr.len, NULL);
+	}
+	MPI_Bcast(&rc, 1, MPI_INT, 0, comm);
+	if (rc != 0)
+		return rc;
+	MPI_Bcast(&hdr.len, 1, MPI_UINT64_T, 0, comm);
+	hdr.crc = crc32c(0, &hdr, offsetof(dump_hdr, crc));
+
+	/** share of the chunks of this process */
+	nchunks = (hdr.len + DAOS_HL_DUMP_CHUNK - 1) / DAOS_HL_DUMP_CHUNK;
+	first = nchunks * rank / size * DAOS_HL_DUMP_CHUNK;
+	last = MIN(nchunks * (rank + 1) / size * DAOS_HL_DUMP_CHUNK,
+		   hdr.len);
+
+	dump_path(name, sizeof(name), path, size, rank);
+	fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		DHL_ERROR("Failed to create %s (%d)\n", name, errno);
+		rc = -1;
+		goto out;
+	}
+
+	rc = dump_write(fd, &hdr, sizeof(hdr));
+	if (rc == 0)
+		rc = dump_file(oh, epoch, hdr.index + first, last - first, fd);
+	if (close(fd) != 0 && rc == 0) {
+		DHL_ERROR("Failed to close %s (%d)\n", name, errno);
+		rc = -1;
+	}
+
+out:
+	MPI_Allreduce(&rc, &rc_reduce, 1, MPI_INT, MPI_MIN, comm);
+	return rc_reduce;
+}
+
+/**
+ * Read the next record header of a load and check it. The checksum of a data
+ * record is checked with its data. A hole that ends the dump turns into a
+ * zero record of its last cell, so that the load sets the array size.
+ */
+static int
+load_rec(dump_pipe *pipe, dump_rec *rec)
+{
+	int rc;
+
+	rc = dump_read(pipe->fd, rec, sizeof(*rec));
+	if (rc != 0)
+		return rc;
+
+	if (rec->type > DUMP_REC_END ||
+	    (rec->type == DUMP_REC_DATA && rec->len > pipe->chunk) ||
+	    (rec->type != DUMP_REC_DATA &&
+	     rec->crc != dump_rec_crc(rec, NULL))) {
+		DHL_ERROR("Corrupted dump record at index %"PRIu64"\n",
+			  rec->index);
+		return -1;
+	}
+
+	if (rec->type == DUMP_REC_HOLE && rec->len != 0 &&
+	    rec->index + rec->len == pipe->end) {
+		rec->type = DUMP_REC_ZERO;
+		rec->index = pipe->end - DAOS_HL_CELL_SIZE;
+		rec->len = DAOS_HL_CELL_SIZE;
+	}
+
+	return 0;
+}
+
+/**
+ * Disk thread of a load: read the records of the file into the slots in
+ * order, packing the data of a slot back to back in its buffer. Holes are not
+ * written.
+ */
+static void *
+load_reader(void *arg)
+{
+	dump_pipe	*pipe = arg;
+	dump_rec	rec;
+	bool		pending = false;
+	bool		end = false;
+	unsigned int	next = 0;
+	int		rc = 0;
+
+	while (!end) {
+		dump_slot	*slot = &pipe->slots[next % DAOS_HL_DUMP_DEPTH];
+		daos_size_t	used = 0;
+		daos_size_t	nr = 0;
+
+		if (!dump_pipe_wait(pipe, slot, DUMP_SLOT_FREE, false))
+			return NULL;
+
+		while (nr < DUMP_SLOT_RECS) {
+			if (!pending) {
+				rc = load_rec(pipe, &rec);
+				if (rc != 0)
+					goto out;
+			}
+			pending = false;
+
+			if (rec.type == DUMP_REC_END) {
+				end = true;
+				break;
+			}
+			if (rec.type == DUMP_REC_HOLE)
+				continue;
+
+			if (used + rec.len > pipe->chunk) {
+				/** goes to the next slot */
+				pending = true;
+				break;
+			}
+
+			if (rec.type == DUMP_REC_DATA) {
+				rc = dump_read(pipe->fd, slot->buf + used,
+					       rec.len);
+				if (rc != 0)
+					goto out;
+				if (rec.crc != dump_rec_crc(&rec,
+							    slot->buf + used)) {
+					DHL_ERROR("Checksum mismatch at index "
+						  "%"PRIu64"\n", rec.index);
+					rc = -1;
+					goto out;
+				}
+			} else {
+				memset(slot->buf + used, 0, rec.len);
+			}
+
+			slot->rgs[nr].index = rec.index;
+			slot->rgs[nr].len = rec.len;
+			nr ++;
+			used += rec.len;
+		}
+
+		if (nr == 0)
+			continue;
+
+		slot->ranges.ranges_nr = nr;
+		daos_iov_set(&slot->iov, slot->buf, used);
+		dump_pipe_set(pipe, slot, DUMP_SLOT_READY, 0);
+		next ++;
+	}
+
+out:
+	pthread_mutex_lock(&pipe->lock);
+	pipe->done = true;
+	if (rc != 0 && pipe->status == 0)
+		pipe->status = rc;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+
+	return NULL;
+}
+
+/** Load the records of fd, after its header, into the array */
+static int
+load_file(daos_handle_t oh, daos_epoch_t epoch, dump_hdr *hdr, int fd)
+{
+	dump_pipe	pipe;
+	pthread_t	reader;
+	daos_handle_t	eqh;
+	daos_event_t	*evp;
+	unsigned int	next = 0;
+	unsigned int	inflight = 0;
+	int		rc;
+
+	rc = dump_pipe_init(&pipe, fd, hdr->chunk);
+	if (rc != 0)
+		goto out;
+	pipe.end = hdr->index + hdr->len;
+
+	rc = daos_eq_create(&eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create event queue (%d)\n", rc);
+		goto out;
+	}
+
+	rc = pthread_create(&reader, NULL, load_reader, &pipe);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create disk thread (%d)\n", rc);
+		daos_eq_destroy(eqh, 0);
+		rc = -1;
+		goto out;
+	}
+
+	while (1) {
+		dump_slot	*slot = &pipe.slots[next % DAOS_HL_DUMP_DEPTH];
+		bool		ready;
+
+		/** wait for a slot to write only when nothing is in flight */
+		pthread_mutex_lock(&pipe.lock);
+		while (inflight == 0 && slot->state != DUMP_SLOT_READY &&
+		       !pipe.done && pipe.status == 0)
+			pthread_cond_wait(&pipe.cond, &pipe.lock);
+		ready = (slot->state == DUMP_SLOT_READY && pipe.status == 0);
+		pthread_mutex_unlock(&pipe.lock);
+
+		if (ready) {
+			dump_pipe_set(&pipe, slot, DUMP_SLOT_IO, 0);
+			rc = daos_event_init(&slot->ev, eqh, NULL);
+			if (rc == 0) {
+				rc = daos_hl_array_write(oh, epoch,
+							 &slot->ranges,
+							 &slot->sgl, NULL,
+							 &slot->ev);
+				if (rc != 0)
+					daos_event_fini(&slot->ev);
+			}
+			if (rc != 0) {
+				DHL_ERROR("Failed to start load write (%d)\n",
+					  rc);
+				dump_pipe_set(&pipe, slot, DUMP_SLOT_FREE, rc);
+				break;
+			}
+			inflight ++;
+			next ++;
+			continue;
+		}
+
+		if (inflight == 0)
+			break;
+
+		rc = daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp);
+		if (rc != 1) {
+			DHL_ERROR("Failed to poll event queue (%d)\n", rc);
+			dump_pipe_fail(&pipe, rc < 0 ? rc : -1);
+			break;
+		}
+		inflight --;
+
+		slot = dump_pipe_slot(&pipe, evp);
+		rc = evp->ev_error;
+		daos_event_fini(evp);
+		if (rc != 0)
+			DHL_ERROR("Load write failed (%d)\n", rc);
+		dump_pipe_set(&pipe, slot, DUMP_SLOT_FREE, rc);
+	}
+
+	while (inflight) {
+		if (daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp) != 1)
+			break;
+		daos_event_fini(evp);
+		inflight --;
+	}
+
+	/** stop the disk thread if it waits for a free slot after a failure */
+	pthread_mutex_lock(&pipe.lock);
+	if (pipe.status == 0 && !pipe.done)
+		pipe.status = -1;
+	pthread_cond_broadcast(&pipe.cond);
+	pthread_mutex_unlock(&pipe.lock);
+	pthread_join(reader, NULL);
+
+	daos_eq_destroy(eqh, 0);
+	rc = pipe.status;
+out:
+	dump_pipe_fini(&pipe);
+	return rc;
+}
+
+/** Open file i of a dump and check its header against the first file */
+static int
+load_open(const char *path, uint32_t nfiles, uint32_t i, dump_hdr *first,
+	  dump_hdr *hdr)
+{
+	char	name[PATH_MAX];
+	int	fd;
+
+	dump_path(name, sizeof(name), path, nfiles, i);
+	fd = open(name, O_RDONLY);
+	if (fd < 0) {
+		DHL_ERROR("Failed to open %s (%d)\n", name, errno);
+		return -1;
+	}
+
+	if (dump_read(fd, hdr, sizeof(*hdr)) != 0 ||
+	    hdr->magic != DUMP_MAGIC || hdr->version != DUMP_VERSION ||
+	    hdr->crc != crc32c(0, hdr, offsetof(dump_hdr, crc)) ||
+	    hdr->chunk == 0 ||
+	    (first && (hdr->nfiles != first->nfiles ||
+		       hdr->index != first->index ||
+		       hdr->len != first->len || hdr->flags != first->flags ||
+		       memcmp(&hdr->attr, &first->attr,
+			      sizeof(hdr->attr))))) {
+		DHL_ERROR("%s is not a valid dump file\n", name);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/**
+ * Read the header of the first file of a dump on rank 0 of comm and share it
+ * with the other ranks. Collective over comm.
+ */
+static int
+load_hdr(MPI_Comm comm, const char *path, dump_hdr *first)
+{
+	char	name[PATH_MAX];
+	int	rank;
+	int	fd;
+	int	rc = 0;
+
+	if (NULL == path) {
+		DHL_ERROR("NULL path passed\n");
+		return -1;
+	}
+
+	MPI_Comm_rank(comm, &rank);
+
+	/** a dump of one file is named path, the others path.<i> */
+	if (rank == 0) {
+		dump_path(name, sizeof(name), path, 1, 0);
+		fd = load_open(path, (access(name, F_OK) == 0) ? 1 : 2, 0,
+			       NULL, first);
+		if (fd < 0)
+			rc = -1;
+		else
+			close(fd);
+	}
+	MPI_Bcast(&rc, 1, MPI_INT, 0, comm);
+	if (rc != 0)
+		return rc;
+	MPI_Bcast(first, sizeof(*first), MPI_BYTE, 0, comm);
+
+	return 0;
+}
+
+/** Load the files of a dump whose first header is first, collective */
+static int
+load_files(daos_handle_t oh, daos_epoch_t epoch, MPI_Comm comm,
+	   const char *path, dump_hdr *first)
+{
+	dump_hdr	hdr;
+	uint32_t	nfiles = first->nfiles;
+	uint32_t	i;
+	int		rank, size;
+	int		fd;
+	int		rc = 0, rc_reduce;
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	for (i = rank; i < nfiles && rc == 0; i += size) {
+		fd = load_open(path, nfiles, i, first, &hdr);
+		if (fd < 0) {
+			rc = -1;
+			break;
+		}
+		rc = load_file(oh, epoch, &hdr, fd);
+		close(fd);
+	}
+
+	MPI_Allreduce(&rc, &rc_reduce, 1, MPI_INT, MPI_MIN, comm);
+	return rc_reduce;
+}
+
+int
+daos_hl_array_load(daos_handle_t oh, daos_epoch_t epoch, MPI_Comm comm,
+		   const char *path)
+{
+	dump_hdr	first;
+	int		rc;
+
+	rc = load_hdr(comm, path, &first);
+	if (rc != 0)
+		return rc;
+
+	return load_files(oh, epoch, comm, path, &first);
+}
+
+int
+daos_hl_array_load_create(daos_handle_t coh, daos_obj_id_t oid,
+			  daos_epoch_t epoch, MPI_Comm comm, const char *path,
+			  daos_handle_t *oh)
+{
+	dump_hdr	first;
+	int		rank;
+	int		rc, rc_reduce;
+
+	if (NULL == oh) {
+		DHL_ERROR("NULL object handle pointer passed\n");
+		return -1;
+	}
+
+	rc = load_hdr(comm, path, &first);
+	if (rc != 0)
+		return rc;
+	if (!(first.flags & DUMP_HDR_ATTR)) {
+		DHL_ERROR("%s holds no array attributes\n", path);
+		return -1;
+	}
+
+	/** rank 0 creates the array, the others open it once it exists */
+	MPI_Comm_rank(comm, &rank);
+	if (rank == 0)
+		rc = daos_hl_array_create(coh, oid, epoch, &first.attr, oh);
+	MPI_Bcast(&rc, 1, MPI_INT, 0, comm);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create array (%d)\n", rc);
+		return rc;
+	}
+	if (rank != 0) {
+		rc = daos_hl_array_open(coh, oid, epoch, DAOS_OO_RW, NULL, oh);
+		if (rc != 0)
+			DHL_ERROR("Failed to open array (%d)\n", rc);
+	}
+	MPI_Allreduce(&rc, &rc_reduce, 1, MPI_INT, MPI_MIN, comm);
+
+	if (rc_reduce == 0)
+		rc_reduce = load_files(*oh, epoch, comm, path, &first);
+	if (rc_reduce != 0 && rc == 0)
+		daos_hl_array_close(*oh);
+
+	return rc_reduce;
+}
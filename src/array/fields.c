@@ -0,0 +1,411 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/fields.c
+ *
+ * Accesses to arrays of compound records, stored as a struct of arrays: field
+ * f of the record at array index i is record i of akey f, under the dkey the
+ * layout maps index i to. A dkey I/O carries one iod per accessed field, all
+ * with the same record extents.
+ */
+
+#include <sys/param.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/io.h>
+#include <daos_hl/layout.h>
+#include <daos_hl/array.h>
+
+/** One field of an access */
+typedef struct {
+	const char	*name;
+	daos_size_t	size;
+	char		*buf;
+	daos_size_t	stride;
+	/** bounce buffer of a field in AoS memory, NULL if accessed in place */
+	char		*bounce;
+} field_access;
+
+/** Fields of a dkey I/O, kept in its private buffer */
+typedef struct {
+	unsigned int	nr;
+	/** index in the access of the first record of the dkey I/O */
+	daos_size_t	first;
+	/** number of records of the dkey I/O */
+	daos_size_t	n;
+	field_access	fa[];
+} fields_io;
+
+/** Copy the records of a bounce buffer to strided memory, or back */
+static void
+fields_copy(fields_io *fio, bool to_user)
+{
+	unsigned int	f;
+	daos_size_t	k;
+
+	for (f = 0; f < fio->nr; f++) {
+		field_access	*fa = &fio->fa[f];
+		char		*user;
+
+		if (NULL == fa->bounce)
+			continue;
+
+		user = fa->buf + fio->first * fa->stride;
+		for (k = 0; k < fio->n; k++) {
+			if (to_user)
+				memcpy(user + k * fa->stride,
+				       fa->bounce + k * fa->size, fa->size);
+			else
+				memcpy(fa->bounce + k * fa->size,
+				       user + k * fa->stride, fa->size);
+		}
+	}
+}
+
+static int
+fields_read_comp_cb(io_params *params, int rc)
+{
+	if (rc == 0)
+		fields_copy((fields_io *)params->comp_arg, true);
+
+	return rc;
+}
+
+/**
+ * Add the dkey I/O of n records of the access, starting at record first,
+ * whose extents in the dkey are recxs (with a record size of 1) and whose
+ * array ranges are ranges.
+ */
+static int
+fields_io_add(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+	      char *dkey_str, unsigned int nr, field_access *fa,
+	      daos_size_t first, daos_size_t n, unsigned int recx_nr,
+	      daos_recx_t *recxs, daos_hl_range_t *ranges)
+{
+	io_params	*params;
+	fields_io	*fio;
+	daos_recx_t	*rxs;
+	daos_iov_t	*iovs;
+	char		*bounce;
+	daos_size_t	hdr, bounce_size = 0;
+	daos_csum_buf_t	null_csum;
+	unsigned int	f, i;
+
+	params = io_req_add(req, oh, epoch);
+	if (NULL == params) {
+		free(dkey_str);
+		free(ranges);
+		return -1;
+	}
+	params->dkey_str = dkey_str;
+	params->ranges = ranges;
+	daos_iov_set(&params->dkey, (void *)dkey_str, strlen(dkey_str));
+
+	for (f = 0; f < nr; f++)
+		if (fa[f].stride != fa[f].size)
+			bounce_size += n * fa[f].size;
+
+	/** fields, recxs of every iod and iovs of every sgl, then bounce */
+	hdr = sizeof(fields_io) + nr * sizeof(field_access) +
+		nr * recx_nr * sizeof(daos_recx_t) + nr * sizeof(daos_iov_t);
+	params->iods = (daos_vec_iod_t *)calloc(nr, sizeof(daos_vec_iod_t));
+	params->sgls = (daos_sg_list_t *)calloc(nr, sizeof(daos_sg_list_t));
+	params->priv = malloc(hdr + bounce_size);
+	if (NULL == params->iods || NULL == params->sgls ||
+	    NULL == params->priv) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+	params->iod_nr = nr;
+	params->priv_desc = true;
+
+	fio = (fields_io *)params->priv;
+	rxs = (daos_recx_t *)&fio->fa[nr];
+	iovs = (daos_iov_t *)(rxs + nr * recx_nr);
+	bounce = (char *)params->priv + hdr;
+
+	fio->nr = nr;
+	fio->first = first;
+	fio->n = n;
+	daos_csum_set(&null_csum, NULL, 0);
+
+	for (f = 0; f < nr; f++) {
+		daos_vec_iod_t	*iod = &params->iods[f];
+		daos_sg_list_t	*sgl = &params->sgls[f];
+		char		*data;
+
+		fio->fa[f] = fa[f];
+		if (fa[f].stride != fa[f].size) {
+			fio->fa[f].bounce = bounce;
+			bounce += n * fa[f].size;
+			data = fio->fa[f].bounce;
+		} else {
+			fio->fa[f].bounce = NULL;
+			data = fa[f].buf + first * fa[f].size;
+		}
+
+		daos_iov_set(&iod->vd_name, (void *)fa[f].name,
+			     strlen(fa[f].name));
+		iod->vd_kcsum = null_csum;
+		iod->vd_nr = recx_nr;
+		iod->vd_csums = NULL;
+		iod->vd_eprs = NULL;
+		iod->vd_recxs = &rxs[f * recx_nr];
+		for (i = 0; i < recx_nr; i++) {
+			iod->vd_recxs[i] = recxs[i];
+			iod->vd_recxs[i].rx_rsize = fa[f].size;
+		}
+
+		daos_iov_set(&iovs[f], data, n * fa[f].size);
+		sgl->sg_nr.num = 1;
+		sgl->sg_nr.num_out = 0;
+		sgl->sg_iovs = &iovs[f];
+	}
+
+	if (DAOS_HL_OP_READ == req->op_type) {
+		params->comp_cb = fields_read_comp_cb;
+		params->comp_arg = fio;
+	} else {
+		fields_copy(fio, false);
+	}
+
+	return 0;
+}
+
+/**
+ * Build the dkey I/Os of an access to nr fields over ranges. Consecutive
+ * ranges mapped to the same dkey share a dkey I/O, within the RPC limits.
+ */
+static int
+fields_req_plan(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+		const array_layout *layout, daos_hl_array_ranges_t *ranges,
+		unsigned int nr, field_access *fa)
+{
+	daos_size_t	rec_size = 0;
+	daos_size_t	max_bytes, max_vecs;
+	daos_size_t	budget;
+	daos_size_t	first = 0;
+	daos_size_t	u = 0;
+	daos_size_t	records = 0;
+	daos_off_t	array_i = 0;
+	unsigned int	f;
+	int		rc;
+
+	for (f = 0; f < nr; f++)
+		rec_size += fa[f].size;
+
+	/** records a dkey I/O can carry within the payload cap */
+	io_rpc_limits(&max_bytes, &max_vecs);
+	budget = max_bytes / rec_size;
+	if (budget == 0)
+		budget = 1;
+
+	if (ranges->ranges_nr) {
+		records = ranges->ranges[0].len;
+		array_i = ranges->ranges[0].index;
+	}
+
+	while (u < ranges->ranges_nr) {
+		daos_recx_t	*recxs;
+		daos_hl_range_t	*rgs;
+		daos_size_t	dkey_records = 0;
+		daos_size_t	num_records;
+		daos_off_t	record_i;
+		unsigned int	i = 0;
+		uint32_t	hi, lo, next_hi, next_lo;
+		char		*dkey_str;
+
+		if (0 == records) {
+			if (++u < ranges->ranges_nr) {
+				records = ranges->ranges[u].len;
+				array_i = ranges->ranges[u].index;
+			}
+			continue;
+		}
+
+		rc = array_layout_split(layout, array_i, &hi, &lo, &record_i,
+					&num_records, &dkey_str);
+		if (rc != 0) {
+			DHL_ERROR("Failed to compute dkey\n");
+			return rc;
+		}
+
+		recxs = (daos_recx_t *)malloc(max_vecs * sizeof(daos_recx_t));
+		rgs = (daos_hl_range_t *)malloc(max_vecs *
+						sizeof(daos_hl_range_t));
+		if (NULL == recxs || NULL == rgs) {
+			DHL_ERROR("Failed memory allocation\n");
+			free(recxs);
+			free(rgs);
+			free(dkey_str);
+			return -1;
+		}
+
+		next_hi = hi;
+		next_lo = lo;
+		do {
+			daos_size_t	take;
+
+			take = MIN(MIN(num_records, records),
+				   budget - dkey_records);
+			recxs[i].rx_rsize = 1;
+			recxs[i].rx_idx = record_i;
+			recxs[i].rx_nr = take;
+			rgs[i].index = array_i;
+			rgs[i].len = take;
+			i ++;
+			dkey_records += take;
+			array_i += take;
+			records -= take;
+
+			/** the dkey or the RPC is full */
+			if (records)
+				break;
+
+			if (++u >= ranges->ranges_nr)
+				break;
+			records = ranges->ranges[u].len;
+			array_i = ranges->ranges[u].index;
+			if (0 == records || dkey_records >= budget ||
+			    i >= max_vecs)
+				break;
+
+			rc = array_layout_split(layout, array_i, &next_hi,
+						&next_lo, &record_i,
+						&num_records, NULL);
+			if (rc != 0) {
+				DHL_ERROR("Failed to compute dkey\n");
+				free(recxs);
+				free(rgs);
+				free(dkey_str);
+				return rc;
+			}
+		} while (next_hi == hi && next_lo == lo);
+
+		rc = fields_io_add(req, oh, epoch, dkey_str, nr, fa, first,
+				   dkey_records, i, recxs, rgs);
+		free(recxs);
+		if (rc != 0)
+			return rc;
+		first += dkey_records;
+	}
+
+	return 0;
+}
+
+static int
+daos_hl_access_fields(daos_handle_t oh, daos_epoch_t epoch,
+		      daos_hl_array_ranges_t *ranges, unsigned int nr,
+		      daos_hl_field_mem_t *mem, daos_event_t *ev,
+		      daos_hl_op_type_t op_type)
+{
+	const array_fields	*fields = array_fields_get(oh);
+	field_access		fa[DAOS_HL_FIELDS_MAX];
+	io_req			*req;
+	unsigned int		f, i;
+	int			rc;
+
+	if (NULL == fields) {
+		DHL_ERROR("Array was not created with fields\n");
+		return -1;
+	}
+	if (NULL == ranges || NULL == mem || 0 == nr ||
+	    nr > fields->nr) {
+		DHL_ERROR("Invalid ranges or fields passed\n");
+		return -1;
+	}
+
+	for (f = 0; f < nr; f++) {
+		for (i = 0; i < f; i++) {
+			if (mem[f].fm_name && mem[i].fm_name &&
+			    strcmp(mem[f].fm_name, mem[i].fm_name) == 0) {
+				DHL_ERROR("Duplicate field %s\n",
+					  mem[f].fm_name);
+				return -1;
+			}
+		}
+		for (i = 0; i < fields->nr; i++)
+			if (mem[f].fm_name &&
+			    strcmp(mem[f].fm_name,
+				   fields->fields[i].df_name) == 0)
+				break;
+		if (i == fields->nr) {
+			DHL_ERROR("Unknown field %s\n",
+				  mem[f].fm_name ? mem[f].fm_name : "(null)");
+			return -1;
+		}
+		if (NULL == mem[f].fm_buf ||
+		    mem[f].fm_stride < fields->fields[i].df_size) {
+			DHL_ERROR("Invalid memory for field %s\n",
+				  mem[f].fm_name);
+			return -1;
+		}
+
+		fa[f].name = fields->fields[i].df_name;
+		fa[f].size = fields->fields[i].df_size;
+		fa[f].buf = (char *)mem[f].fm_buf;
+		fa[f].stride = mem[f].fm_stride;
+		fa[f].bounce = NULL;
+	}
+
+	req = io_req_create(op_type);
+	if (NULL == req)
+		return -1;
+
+	rc = fields_req_plan(req, oh, epoch, array_layout_get(oh), ranges, nr,
+			     fa);
+	if (rc != 0) {
+		io_req_free(req);
+		return rc;
+	}
+
+	if (op_type == DAOS_HL_OP_WRITE) {
+		rc = array_size_mark(req, oh, epoch, ranges);
+		if (rc != 0) {
+			io_req_free(req);
+			return rc;
+		}
+	}
+
+	return io_req_launch(req, ev);
+}
+
+int
+daos_hl_array_read_fields(daos_handle_t oh, daos_epoch_t epoch,
+			  daos_hl_array_ranges_t *ranges, unsigned int nr,
+			  daos_hl_field_mem_t *mem, daos_event_t *ev)
+{
+	return daos_hl_access_fields(oh, epoch, ranges, nr, mem, ev,
+				     DAOS_HL_OP_READ);
+}
+
+int
+daos_hl_array_write_fields(daos_handle_t oh, daos_epoch_t epoch,
+			   daos_hl_array_ranges_t *ranges, unsigned int nr,
+			   daos_hl_field_mem_t *mem, daos_event_t *ev)
+{
+	return daos_hl_access_fields(oh, epoch, ranges, nr, mem, ev,
+				     DAOS_HL_OP_WRITE);
+}
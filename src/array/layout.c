@@ -0,0 +1,177 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/layout.c
+ */
+
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/layout.h>
+
+/**
+ * Striped: the blocks of a group go round-robin over its dkeys, so dkey lo of
+ * group hi holds blocks lo, lo + dkey_nr, ... of the group back to back.
+ */
+static void
+striped_split(const array_layout *layout, daos_off_t array_i, uint32_t *hi,
+	      uint32_t *lo, daos_off_t *record_i, daos_size_t *num_records)
+{
+	daos_off_t 	byte_a; 	/* Byte address of I/O */
+	daos_size_t	grp_size;	/* Bytes in a group of dkeys */
+	daos_size_t	grp_chunk;	/* Bytes in one round of the group */
+	daos_size_t 	dkey_grp; 	/* Which grp of dkeys to look into */
+	daos_off_t 	rel_byte_a; 	/* offset relative to grp */
+	daos_size_t 	dkey_num; 	/* The dkey number for access */
+	daos_size_t 	grp_iter; 	/* round robin iteration number */
+	daos_off_t	dkey_byte_a;	/* address of dkey relative to group */
+
+	byte_a = array_i * DAOS_HL_CELL_SIZE;
+	grp_chunk = layout->block_size * layout->dkey_nr;
+	grp_size = grp_chunk * layout->dkey_blocks;
+
+	/* Compute dkey group number and address */
+	dkey_grp = byte_a / grp_size;
+
+	/* Compute dkey number within dkey group */
+	rel_byte_a = byte_a - dkey_grp * grp_size;
+	dkey_num = (rel_byte_a / layout->block_size) % layout->dkey_nr;
+
+	/* Compute relative offset/index in dkey */
+	grp_iter = rel_byte_a / grp_chunk;
+	dkey_byte_a = (grp_iter * grp_chunk) +
+		(dkey_num * layout->block_size);
+	*record_i = (layout->block_size * grp_iter) +
+		(rel_byte_a - dkey_byte_a);
+
+	/* Number of records to access in current dkey */
+	*num_records = ((grp_iter + 1) * layout->block_size) - *record_i;
+
+	*hi = (uint32_t)dkey_grp;
+	*lo = (uint32_t)dkey_num;
+}
+
+/** Contiguous: dkey hi_0 holds chunk hi of dkey_blocks blocks */
+static void
+contig_split(const array_layout *layout, daos_off_t array_i, uint32_t *hi,
+	     uint32_t *lo, daos_off_t *record_i, daos_size_t *num_records)
+{
+	daos_off_t	byte_a = array_i * DAOS_HL_CELL_SIZE;
+	daos_size_t	chunk = layout->block_size * layout->dkey_blocks;
+
+	*hi = (uint32_t)(byte_a / chunk);
+	*lo = 0;
+	*record_i = byte_a % chunk;
+	*num_records = chunk - *record_i;
+}
+
+/** Scramble a block number to pick its dkey in the hashed layout */
+static uint32_t
+block_hash(uint64_t blk)
+{
+	blk ^= blk >> 33;
+	blk *= 0xff51afd7ed558ccdULL;
+	blk ^= blk >> 33;
+	blk *= 0xc4ceb9fe1a85ec53ULL;
+	blk ^= blk >> 33;
+
+	return (uint32_t)blk;
+}
+
+/**
+ * Hashed: each block of a group goes to the dkey of the group picked by the
+ * hash of its block number. Records are indexed by their offset in the group,
+ * so the blocks sharing a dkey never overlap.
+ */
+static void
+hashed_split(const array_layout *layout, daos_off_t array_i, uint32_t *hi,
+	     uint32_t *lo, daos_off_t *record_i, daos_size_t *num_records)
+{
+	daos_off_t	byte_a = array_i * DAOS_HL_CELL_SIZE;
+	daos_size_t	grp_size = layout->block_size * layout->grp_blocks;
+	daos_size_t	blk = byte_a / layout->block_size;
+
+	*hi = (uint32_t)(byte_a / grp_size);
+	*lo = block_hash(blk) % layout->dkey_nr;
+	*record_i = byte_a % grp_size;
+	*num_records = layout->block_size - (byte_a % layout->block_size);
+}
+
+static const array_layout_ops layout_ops[DAOS_HL_LAYOUT_NR] = {
+	[DAOS_HL_LAYOUT_STRIPED]	= { striped_split },
+	[DAOS_HL_LAYOUT_CONTIG]		= { contig_split },
+	[DAOS_HL_LAYOUT_HASHED]		= { hashed_split },
+};
+
+const array_layout array_layout_default = {
+	.ops		= &layout_ops[DAOS_HL_LAYOUT_STRIPED],
+	.block_size	= DAOS_HL_DKEY_BLOCK_SIZE,
+	.dkey_nr	= DAOS_HL_DKEY_NUM,
+	.dkey_blocks	= DAOS_HL_DKEY_NUM_BLOCKS,
+	.grp_blocks	= DAOS_HL_DKEY_NUM * DAOS_HL_DKEY_NUM_BLOCKS,
+};
+
+int
+array_layout_init(daos_hl_array_attr_t *attr, array_layout *layout)
+{
+	if (attr->da_layout >= DAOS_HL_LAYOUT_NR) {
+		DHL_ERROR("Invalid array layout %u\n", attr->da_layout);
+		return -1;
+	}
+
+	if (0 == attr->da_block_size)
+		attr->da_block_size = DAOS_HL_DKEY_BLOCK_SIZE;
+	if (0 == attr->da_dkey_blocks)
+		attr->da_dkey_blocks = DAOS_HL_DKEY_NUM_BLOCKS;
+	if (DAOS_HL_LAYOUT_CONTIG == attr->da_layout)
+		attr->da_dkey_nr = 1;
+	else if (0 == attr->da_dkey_nr)
+		attr->da_dkey_nr = DAOS_HL_DKEY_NUM;
+
+	layout->ops = &layout_ops[attr->da_layout];
+	layout->block_size = attr->da_block_size;
+	layout->dkey_nr = attr->da_dkey_nr;
+	layout->dkey_blocks = attr->da_dkey_blocks;
+	layout->grp_blocks = layout->dkey_nr * layout->dkey_blocks;
+
+	return 0;
+}
+
+int
+array_layout_split(const array_layout *layout, daos_off_t array_i,
+		   uint32_t *hi, uint32_t *lo, daos_off_t *record_i,
+		   daos_size_t *num_records, char **dkey_str)
+{
+	layout->ops->lo_split(layout, array_i, hi, lo, record_i, num_records);
+
+	if (dkey_str) {
+		asprintf(dkey_str, "%u_%u", *hi, *lo);
+		if (NULL == *dkey_str) {
+			DHL_ERROR("Failed memory allocation\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,553 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/mmap.c
+ *
+ * Read-only memory mappings of array ranges. The mapping is anonymous memory
+ * registered with userfaultfd: the first touch of a page that is not resident
+ * raises a fault that a handler thread resolves by reading the array unit
+ * holding the page, plus a few following units, and copying them in. Filled
+ * pages are marked MADV_FREE, so the kernel may drop them under memory
+ * pressure instead of swapping them out; touching them again faults them back
+ * in from the array.
+ *
+ * The handler fetches with raw DAOS calls on an event queue of its own, not
+ * through the daos_hl I/O engine: the faulting thread may hold the engine
+ * lock, e.g. when the mapping is the buffer of a daos_hl write, and the
+ * handler would wait for it forever. When the process is not allowed to use
+ * userfaultfd, the whole range is read up front instead.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/array.h>
+#include <daos_hl/layout.h>
+
+/** Smallest amount of data fetched by a fault */
+#define DAOS_HL_MMAP_UNIT	(64 << 10)
+/** Units read ahead of the faulting one when not resident yet */
+#define DAOS_HL_MMAP_READAHEAD	3
+/** Max number of dkey fetches of a fault in flight at a time */
+#define DAOS_HL_MMAP_DEPTH	16
+
+/** One dkey fetch of the fault handler */
+typedef struct {
+	daos_event_t	ev;
+	char		*dkey_str;
+	daos_key_t	dkey;
+	daos_vec_iod_t	iod;
+	daos_recx_t	recx;
+	daos_sg_list_t	sgl;
+	daos_iov_t	iov;
+} map_fetch_t;
+
+struct daos_hl_array_map {
+	daos_handle_t	oh;
+	daos_epoch_t	epoch;
+	const array_layout *layout;
+	/** array range backing the mapping */
+	daos_hl_range_t	range;
+	char		*addr;
+	/** range length rounded up to pages */
+	daos_size_t	map_len;
+	/** bytes fetched per fault, whole pages and whole blocks */
+	daos_size_t	unit;
+	size_t		page_size;
+	/** -1 if the range was read up front, without userfaultfd */
+	int		uffd;
+	/** private event queue of the fault handler, and its fetches */
+	daos_handle_t	eqh;
+	bool		eq_created;
+	map_fetch_t	fetches[DAOS_HL_MMAP_DEPTH];
+	/** written to stop the handler thread */
+	int		stop_fd[2];
+	pthread_t	thread;
+	/** fault buffer of 1 + DAOS_HL_MMAP_READAHEAD units */
+	char		*buf;
+	/** mincore() vector of the pages of one unit */
+	unsigned char	*vec;
+	/** first fetch error, reported by daos_hl_array_munmap */
+	int		status;
+};
+
+/** Whether all the pages of unit u are resident */
+static bool
+map_resident(daos_hl_array_map_t *map, daos_size_t u)
+{
+	daos_off_t	start = u * map->unit;
+	daos_size_t	len = MIN(map->unit, map->map_len - start);
+	daos_size_t	i;
+
+	if (mincore(map->addr + start, len, map->vec) != 0)
+		return false;
+
+	for (i = 0; i < len / map->page_size; i++)
+		if (!(map->vec[i] & 1))
+			return false;
+
+	return true;
+}
+
+/**
+ * Copy len bytes of the fault buffer at offset start of the mapping. Pages
+ * that are still resident are skipped.
+ */
+static int
+map_copy(daos_hl_array_map_t *map, daos_off_t start, daos_size_t len)
+{
+	struct uffdio_copy	copy;
+	daos_size_t		done = 0;
+
+	while (done < len) {
+		copy.dst = (uintptr_t)(map->addr + start + done);
+		copy.src = (uintptr_t)(map->buf + done);
+		copy.len = len - done;
+		copy.mode = 0;
+		copy.copy = 0;
+
+		if (ioctl(map->uffd, UFFDIO_COPY, &copy) == 0)
+			break;
+
+		if (copy.copy > 0) {
+			done += copy.copy;
+			continue;
+		}
+		if (errno == EEXIST) {
+			done += map->page_size;
+			continue;
+		}
+		if (errno == EAGAIN)
+			continue;
+
+		DHL_ERROR("UFFDIO_COPY failed (%d)\n", errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Wait for the first nr fetches in flight and return the first error */
+static int
+map_fetch_wait(daos_hl_array_map_t *map, unsigned int nr)
+{
+	daos_event_t	*evp;
+	unsigned int	i;
+	int		rc = 0;
+
+	for (i = 0; i < nr; i++) {
+		if (daos_eq_poll(map->eqh, 0, DAOS_EQ_WAIT, 1, &evp) != 1) {
+			DHL_ERROR("Failed to poll the fault event queue\n");
+			if (rc == 0)
+				rc = -1;
+			continue;
+		}
+		if (evp->ev_error != 0 && rc == 0)
+			rc = evp->ev_error;
+	}
+
+	for (i = 0; i < nr; i++) {
+		daos_event_fini(&map->fetches[i].ev);
+		free(map->fetches[i].dkey_str);
+		map->fetches[i].dkey_str = NULL;
+	}
+
+	return rc;
+}
+
+/**
+ * Fetch len bytes of the array at index into buf, one dkey fetch per dkey,
+ * up to DAOS_HL_MMAP_DEPTH in flight.
+ */
+static int
+map_fetch(daos_hl_array_map_t *map, daos_off_t index, daos_size_t len,
+	  char *buf)
+{
+	daos_csum_buf_t	null_csum;
+	unsigned int	nr = 0;
+	int		rc = 0;
+	int		rc2;
+
+	daos_csum_set(&null_csum, NULL, 0);
+
+	while (len > 0 && rc == 0) {
+		map_fetch_t	*f = &map->fetches[nr];
+		daos_size_t	num_records;
+		daos_off_t	record_i;
+		uint32_t	hi, lo;
+
+		rc = array_layout_split(map->layout, index, &hi, &lo,
+					&record_i, &num_records,
+					&f->dkey_str);
+		if (rc != 0) {
+			DHL_ERROR("Failed to compute dkey\n");
+			break;
+		}
+		num_records = MIN(num_records, len);
+
+		daos_iov_set(&f->dkey, f->dkey_str, strlen(f->dkey_str));
+		daos_iov_set(&f->iod.vd_name, "akey_not_used",
+			     strlen("akey_not_used"));
+		f->iod.vd_kcsum = null_csum;
+		f->iod.vd_nr = 1;
+		f->iod.vd_recxs = &f->recx;
+		f->iod.vd_csums = NULL;
+		f->iod.vd_eprs = NULL;
+		f->recx.rx_rsize = 1;
+		f->recx.rx_idx = record_i;
+		f->recx.rx_nr = num_records;
+		daos_iov_set(&f->iov, buf, num_records);
+		f->sgl.sg_nr.num = 1;
+		f->sgl.sg_nr.num_out = 0;
+		f->sgl.sg_iovs = &f->iov;
+
+		rc = daos_event_init(&f->ev, map->eqh, NULL);
+		if (rc != 0) {
+			free(f->dkey_str);
+			f->dkey_str = NULL;
+			break;
+		}
+		rc = daos_obj_fetch(map->oh, map->epoch, &f->dkey, 1, &f->iod,
+				    &f->sgl, NULL, &f->ev);
+		if (rc != 0) {
+			DHL_ERROR("Failed to fetch dkey %s (%d)\n",
+				  f->dkey_str, rc);
+			daos_event_fini(&f->ev);
+			free(f->dkey_str);
+			f->dkey_str = NULL;
+			break;
+		}
+		nr ++;
+
+		index += num_records;
+		len -= num_records;
+		buf += num_records;
+
+		if (nr == DAOS_HL_MMAP_DEPTH) {
+			rc = map_fetch_wait(map, nr);
+			nr = 0;
+		}
+	}
+
+	rc2 = map_fetch_wait(map, nr);
+	return rc ? rc : rc2;
+}
+
+/** Resolve a fault at offset off of the mapping */
+static void
+map_fault(daos_hl_array_map_t *map, daos_off_t off)
+{
+	struct uffdio_range	wake;
+	daos_size_t		first = off / map->unit;
+	daos_size_t		nr = 1;
+	daos_off_t		start, end;
+	int			rc;
+
+	/** read ahead the following units that are not resident yet */
+	while (nr <= DAOS_HL_MMAP_READAHEAD &&
+	       (first + nr) * map->unit < map->map_len &&
+	       !map_resident(map, first + nr))
+		nr++;
+
+	start = first * map->unit;
+	end = MIN((first + nr) * map->unit, map->map_len);
+	memset(map->buf, 0, end - start);
+
+	/** the tail of the last page, past the range, reads as zeros */
+	if (start < map->range.len) {
+		rc = map_fetch(map, map->range.index + start,
+			       MIN(end, map->range.len) - start, map->buf);
+		if (rc != 0) {
+			/** the faulting thread can't be failed, give it zeros */
+			DHL_ERROR("Failed to fetch mapped range (%d)\n", rc);
+			memset(map->buf, 0, end - start);
+			if (map->status == 0)
+				map->status = rc;
+		}
+	}
+
+	if (map_copy(map, start, end - start) != 0 && map->status == 0)
+		map->status = -1;
+
+#ifdef MADV_FREE
+	madvise(map->addr + start, end - start, MADV_FREE);
+#endif
+
+	/** the faulting page may have been resident already */
+	wake.start = (uintptr_t)map->addr + (off & ~(map->page_size - 1));
+	wake.len = map->page_size;
+	ioctl(map->uffd, UFFDIO_WAKE, &wake);
+}
+
+static void *
+map_handler(void *arg)
+{
+	daos_hl_array_map_t	*map = arg;
+	struct uffd_msg		msg;
+	struct pollfd		pfd[2];
+	ssize_t			n;
+
+	pfd[0].fd = map->uffd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = map->stop_fd[0];
+	pfd[1].events = POLLIN;
+
+	while (1) {
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			DHL_ERROR("Failed to poll userfaultfd (%d)\n", errno);
+			break;
+		}
+		if (pfd[1].revents)
+			break;
+		if (!(pfd[0].revents & POLLIN))
+			continue;
+
+		n = read(map->uffd, &msg, sizeof(msg));
+		if (n != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT)
+			continue;
+
+		map_fault(map, (char *)(uintptr_t)msg.arg.pagefault.address -
+			  map->addr);
+	}
+
+	return NULL;
+}
+
+static void
+map_free(daos_hl_array_map_t *map)
+{
+	if (map->addr != MAP_FAILED)
+		munmap(map->addr, map->map_len);
+	if (map->uffd >= 0)
+		close(map->uffd);
+	if (map->eq_created)
+		daos_eq_destroy(map->eqh, 0);
+	if (map->stop_fd[0] >= 0) {
+		close(map->stop_fd[0]);
+		close(map->stop_fd[1]);
+	}
+	free(map->buf);
+	free(map->vec);
+	free(map);
+}
+
+/**
+ * Create the userfaultfd of a mapping, limited to faults from user space when
+ * the kernel supports it, so that it is allowed to unprivileged processes.
+ */
+static int
+map_uffd_create(void)
+{
+	int	fd;
+
+#ifdef UFFD_USER_MODE_ONLY
+	fd = syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK |
+		     UFFD_USER_MODE_ONLY);
+	if (fd >= 0 || errno != EINVAL)
+		return fd;
+#endif
+	fd = syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+	return fd;
+}
+
+/**
+ * Read the whole range into the anonymous mapping, for processes not allowed
+ * to use userfaultfd.
+ */
+static int
+map_read_eager(daos_hl_array_map_t *map)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	int			rc;
+
+	if (mprotect(map->addr, map->map_len, PROT_READ | PROT_WRITE) != 0) {
+		DHL_ERROR("Failed to make the mapping writable (%d)\n", errno);
+		return -1;
+	}
+
+	ranges.ranges_nr = 1;
+	ranges.ranges = &map->range;
+	daos_iov_set(&iov, map->addr, map->range.len);
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_read(map->oh, map->epoch, &ranges, &sgl, NULL, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read mapped range (%d)\n", rc);
+		return rc;
+	}
+
+	if (mprotect(map->addr, map->map_len, PROT_READ) != 0) {
+		DHL_ERROR("Failed to make the mapping read-only (%d)\n",
+			  errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+daos_hl_array_mmap(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_range_t *range, daos_hl_array_map_t **mapp,
+		   void **addr)
+{
+	daos_hl_array_map_t	*map;
+	const array_layout	*layout = array_layout_get(oh);
+	struct uffdio_api	api;
+	struct uffdio_register	reg;
+	daos_size_t		block;
+	int			rc;
+
+	if (range == NULL || range->len == 0 || mapp == NULL || addr == NULL) {
+		DHL_ERROR("Invalid range or output pointers\n");
+		return -1;
+	}
+
+	map = calloc(1, sizeof(*map));
+	if (map == NULL)
+		return -1;
+
+	map->oh = oh;
+	map->epoch = epoch;
+	map->layout = layout;
+	map->range = *range;
+	map->addr = MAP_FAILED;
+	map->uffd = -1;
+	map->stop_fd[0] = map->stop_fd[1] = -1;
+	map->page_size = sysconf(_SC_PAGESIZE);
+	map->map_len = roundup(range->len * DAOS_HL_CELL_SIZE, map->page_size);
+
+	/** whole pages, and whole blocks for power of two block sizes */
+	block = layout->block_size;
+	map->unit = roundup(MAX(block, DAOS_HL_MMAP_UNIT), map->page_size);
+
+	map->buf = malloc((1 + DAOS_HL_MMAP_READAHEAD) * map->unit);
+	map->vec = malloc(map->unit / map->page_size);
+	if (map->buf == NULL || map->vec == NULL)
+		goto err;
+
+	map->addr = mmap(NULL, map->map_len, PROT_READ,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (map->addr == MAP_FAILED) {
+		DHL_ERROR("Failed to map %zu bytes (%d)\n",
+			  (size_t)map->map_len, errno);
+		goto err;
+	}
+
+	map->uffd = map_uffd_create();
+	if (map->uffd < 0 && errno == EPERM) {
+		DHL_INFO("userfaultfd not allowed, reading the range now\n");
+		if (map_read_eager(map) != 0)
+			goto err;
+		goto out;
+	}
+	if (map->uffd < 0) {
+		DHL_ERROR("Failed to create userfaultfd (%d)\n", errno);
+		goto err;
+	}
+
+	api.api = UFFD_API;
+	api.features = 0;
+	if (ioctl(map->uffd, UFFDIO_API, &api) != 0) {
+		DHL_ERROR("UFFDIO_API failed (%d)\n", errno);
+		goto err;
+	}
+
+	reg.range.start = (uintptr_t)map->addr;
+	reg.range.len = map->map_len;
+	reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+	if (ioctl(map->uffd, UFFDIO_REGISTER, &reg) != 0) {
+		DHL_ERROR("UFFDIO_REGISTER failed (%d)\n", errno);
+		goto err;
+	}
+
+	rc = daos_eq_create(&map->eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create fault event queue (%d)\n", rc);
+		goto err;
+	}
+	map->eq_created = true;
+
+	if (pipe(map->stop_fd) != 0) {
+		map->stop_fd[0] = map->stop_fd[1] = -1;
+		goto err;
+	}
+
+	rc = pthread_create(&map->thread, NULL, map_handler, map);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create fault handler thread (%d)\n", rc);
+		goto err;
+	}
+
+out:
+	*mapp = map;
+	*addr = map->addr;
+	return 0;
+
+err:
+	map_free(map);
+	return -1;
+}
+
+int
+daos_hl_array_munmap(daos_hl_array_map_t *map)
+{
+	char	c = 0;
+	int	rc;
+
+	if (map == NULL)
+		return -1;
+
+	/** read up front, no handler thread to stop */
+	if (map->uffd < 0) {
+		rc = map->status;
+		map_free(map);
+		return rc;
+	}
+
+	if (write(map->stop_fd[1], &c, 1) != 1) {
+		DHL_ERROR("Failed to stop fault handler thread (%d)\n",
+			  errno);
+		return -1;
+	}
+	pthread_join(map->thread, NULL);
+
+	rc = map->status;
+	map_free(map);
+	return rc;
+}
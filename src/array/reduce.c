@@ -0,0 +1,635 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/array/reduce.c
+ *
+ * Reductions of typed arrays, computed over a ring of fetch buffers.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <sys/param.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/array.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/** MSC - Those need to be configurable later through hints */
+/** Number of buffers of the ring */
+#define DAOS_HL_REDUCE_DEPTH	4
+/** Size of each buffer */
+#define DAOS_HL_REDUCE_BUF_SIZE	1048576
+
+/** Running state of a reduction */
+typedef struct {
+	daos_hl_value_t		value;
+	/** histogram: lower bound, bins per unit, and counters */
+	double			lo;
+	double			scale;
+	uint64_t		nbins;
+	uint64_t		*bins;
+} reduce_acc;
+
+typedef void (*reduce_kern_t)(const void *buf, daos_size_t n,
+			      reduce_acc *acc);
+
+static reduce_kern_t	reduce_kernels[DAOS_HL_TYPE_NR][DAOS_HL_REDUCE_NR];
+static pthread_once_t	reduce_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Scalar kernels of one type: ctype is the element type, acc_t the type of
+ * the sum, and f the member of daos_hl_value_t holding the values. NaNs fail
+ * every comparison, so min and max skip them.
+ */
+#define REDUCE_SCALAR(sfx, ctype, acc_t, f)				\
+static void								\
+reduce_sum_##sfx(const void *buf, daos_size_t n, reduce_acc *acc)	\
+{									\
+	const ctype	*v = buf;					\
+	acc_t		s = acc->value.f;				\
+	daos_size_t	i;						\
+									\
+	for (i = 0; i < n; i++)						\
+		s += v[i];						\
+	acc->value.f = s;						\
+}									\
+									\
+static void								\
+reduce_min_##sfx(const void *buf, daos_size_t n, reduce_acc *acc)	\
+{									\
+	const ctype	*v = buf;					\
+	daos_size_t	i;						\
+									\
+	for (i = 0; i < n; i++)						\
+		if (v[i] < acc->value.f)				\
+			acc->value.f = v[i];				\
+}									\
+									\
+static void								\
+reduce_max_##sfx(const void *buf, daos_size_t n, reduce_acc *acc)	\
+{									\
+	const ctype	*v = buf;					\
+	daos_size_t	i;						\
+									\
+	for (i = 0; i < n; i++)						\
+		if (v[i] > acc->value.f)				\
+			acc->value.f = v[i];				\
+}									\
+									\
+static void								\
+reduce_hist_##sfx(const void *buf, daos_size_t n, reduce_acc *acc)	\
+{									\
+	const ctype	*v = buf;					\
+	daos_size_t	i;						\
+									\
+	for (i = 0; i < n; i++) {					\
+		double	 x = ((double)v[i] - acc->lo) * acc->scale;	\
+									\
+		if (x >= 0 && x < acc->nbins)				\
+			acc->bins[(uint64_t)x] ++;			\
+	}								\
+}
+
+REDUCE_SCALAR(int32, int32_t, int64_t, v_i)
+REDUCE_SCALAR(int64, int64_t, int64_t, v_i)
+REDUCE_SCALAR(uint32, uint32_t, uint64_t, v_u)
+REDUCE_SCALAR(uint64, uint64_t, uint64_t, v_u)
+REDUCE_SCALAR(float, float, double, v_d)
+REDUCE_SCALAR(double, double, double, v_d)
+
+#if defined(__x86_64__)
+/**
+ * Vector kernels of float and double. MINPS/MAXPS return their second operand
+ * when either is a NaN, so passing the accumulator second skips NaNs as the
+ * scalar kernels do. Floats are summed in doubles.
+ */
+__attribute__((target("avx2")))
+static void
+reduce_sum_float_avx2(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const float	*v = buf;
+	__m256d		s0 = _mm256_setzero_pd();
+	__m256d		s1 = _mm256_setzero_pd();
+	double		t[4];
+	daos_size_t	i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(v + i);
+
+		s0 = _mm256_add_pd(s0, _mm256_cvtps_pd(
+					   _mm256_castps256_ps128(x)));
+		s1 = _mm256_add_pd(s1, _mm256_cvtps_pd(
+					   _mm256_extractf128_ps(x, 1)));
+	}
+	_mm256_storeu_pd(t, _mm256_add_pd(s0, s1));
+	acc->value.v_d += t[0] + t[1] + t[2] + t[3];
+
+	reduce_sum_float(v + i, n - i, acc);
+}
+
+__attribute__((target("avx2")))
+static void
+reduce_min_float_avx2(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const float	*v = buf;
+	__m256		m = _mm256_set1_ps((float)acc->value.v_d);
+	float		t[8];
+	daos_size_t	i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		m = _mm256_min_ps(_mm256_loadu_ps(v + i), m);
+	_mm256_storeu_ps(t, m);
+
+	reduce_min_float(t, 8, acc);
+	reduce_min_float(v + i, n - i, acc);
+}
+
+__attribute__((target("avx2")))
+static void
+reduce_max_float_avx2(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const float	*v = buf;
+	__m256		m = _mm256_set1_ps((float)acc->value.v_d);
+	float		t[8];
+	daos_size_t	i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		m = _mm256_max_ps(_mm256_loadu_ps(v + i), m);
+	_mm256_storeu_ps(t, m);
+
+	reduce_max_float(t, 8, acc);
+	reduce_max_float(v + i, n - i, acc);
+}
+
+__attribute__((target("avx2")))
+static void
+reduce_sum_double_avx2(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const double	*v = buf;
+	__m256d		s0 = _mm256_setzero_pd();
+	__m256d		s1 = _mm256_setzero_pd();
+	double		t[4];
+	daos_size_t	i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		s0 = _mm256_add_pd(s0, _mm256_loadu_pd(v + i));
+		s1 = _mm256_add_pd(s1, _mm256_loadu_pd(v + i + 4));
+	}
+	_mm256_storeu_pd(t, _mm256_add_pd(s0, s1));
+	acc->value.v_d += t[0] + t[1] + t[2] + t[3];
+
+	reduce_sum_double(v + i, n - i, acc);
+}
+
+__attribute__((target("avx2")))
+static void
+reduce_min_double_avx2(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const double	*v = buf;
+	__m256d		m = _mm256_set1_pd(acc->value.v_d);
+	double		t[4];
+	daos_size_t	i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		m = _mm256_min_pd(_mm256_loadu_pd(v + i), m);
+	_mm256_storeu_pd(t, m);
+
+	reduce_min_double(t, 4, acc);
+	reduce_min_double(v + i, n - i, acc);
+}
+
+__attribute__((target("avx2")))
+static void
+reduce_max_double_avx2(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const double	*v = buf;
+	__m256d		m = _mm256_set1_pd(acc->value.v_d);
+	double		t[4];
+	daos_size_t	i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		m = _mm256_max_pd(_mm256_loadu_pd(v + i), m);
+	_mm256_storeu_pd(t, m);
+
+	reduce_max_double(t, 4, acc);
+	reduce_max_double(v + i, n - i, acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+reduce_sum_float_avx512(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const float	*v = buf;
+	__m512d		s0 = _mm512_setzero_pd();
+	__m512d		s1 = _mm512_setzero_pd();
+	daos_size_t	i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m512	x = _mm512_loadu_ps(v + i);
+		__m256	hi;
+
+		hi = _mm256_castpd_ps(_mm512_extractf64x4_pd(
+					      _mm512_castps_pd(x), 1));
+		s0 = _mm512_add_pd(s0, _mm512_cvtps_pd(
+					   _mm512_castps512_ps256(x)));
+		s1 = _mm512_add_pd(s1, _mm512_cvtps_pd(hi));
+	}
+	acc->value.v_d += _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+
+	reduce_sum_float(v + i, n - i, acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+reduce_min_float_avx512(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const float	*v = buf;
+	__m512		m = _mm512_set1_ps((float)acc->value.v_d);
+	float		t[16];
+	daos_size_t	i;
+
+	for (i = 0; i + 16 <= n; i += 16)
+		m = _mm512_min_ps(_mm512_loadu_ps(v + i), m);
+	_mm512_storeu_ps(t, m);
+
+	reduce_min_float(t, 16, acc);
+	reduce_min_float(v + i, n - i, acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+reduce_max_float_avx512(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const float	*v = buf;
+	__m512		m = _mm512_set1_ps((float)acc->value.v_d);
+	float		t[16];
+	daos_size_t	i;
+
+	for (i = 0; i + 16 <= n; i += 16)
+		m = _mm512_max_ps(_mm512_loadu_ps(v + i), m);
+	_mm512_storeu_ps(t, m);
+
+	reduce_max_float(t, 16, acc);
+	reduce_max_float(v + i, n - i, acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+reduce_sum_double_avx512(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const double	*v = buf;
+	__m512d		s0 = _mm512_setzero_pd();
+	__m512d		s1 = _mm512_setzero_pd();
+	daos_size_t	i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		s0 = _mm512_add_pd(s0, _mm512_loadu_pd(v + i));
+		s1 = _mm512_add_pd(s1, _mm512_loadu_pd(v + i + 8));
+	}
+	acc->value.v_d += _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+
+	reduce_sum_double(v + i, n - i, acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+reduce_min_double_avx512(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const double	*v = buf;
+	__m512d		m = _mm512_set1_pd(acc->value.v_d);
+	double		t[8];
+	daos_size_t	i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		m = _mm512_min_pd(_mm512_loadu_pd(v + i), m);
+	_mm512_storeu_pd(t, m);
+
+	reduce_min_double(t, 8, acc);
+	reduce_min_double(v + i, n - i, acc);
+}
+
+__attribute__((target("avx512f")))
+static void
+reduce_max_double_avx512(const void *buf, daos_size_t n, reduce_acc *acc)
+{
+	const double	*v = buf;
+	__m512d		m = _mm512_set1_pd(acc->value.v_d);
+	double		t[8];
+	daos_size_t	i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		m = _mm512_max_pd(_mm512_loadu_pd(v + i), m);
+	_mm512_storeu_pd(t, m);
+
+	reduce_max_double(t, 8, acc);
+	reduce_max_double(v + i, n - i, acc);
+}
+#endif
+
+#define REDUCE_SET(type, sfx)						\
+do {									\
+	reduce_kernels[type][DAOS_HL_REDUCE_SUM] = reduce_sum_##sfx;	\
+	reduce_kernels[type][DAOS_HL_REDUCE_MIN] = reduce_min_##sfx;	\
+	reduce_kernels[type][DAOS_HL_REDUCE_MAX] = reduce_max_##sfx;	\
+	reduce_kernels[type][DAOS_HL_REDUCE_HIST] = reduce_hist_##sfx;	\
+} while (0)
+
+/** Pick the widest kernels the CPU runs, histograms stay scalar */
+static void
+reduce_init(void)
+{
+	char *val;
+
+	REDUCE_SET(DAOS_HL_TYPE_INT32, int32);
+	REDUCE_SET(DAOS_HL_TYPE_INT64, int64);
+	REDUCE_SET(DAOS_HL_TYPE_UINT32, uint32);
+	REDUCE_SET(DAOS_HL_TYPE_UINT64, uint64);
+	REDUCE_SET(DAOS_HL_TYPE_FLOAT, float);
+	REDUCE_SET(DAOS_HL_TYPE_DOUBLE, double);
+
+	val = getenv("DAOS_HL_REDUCE_SIMD");
+	if (val && atoi(val) == 0)
+		return;
+
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		reduce_kernels[DAOS_HL_TYPE_FLOAT][DAOS_HL_REDUCE_SUM] =
+			reduce_sum_float_avx512;
+		reduce_kernels[DAOS_HL_TYPE_FLOAT][DAOS_HL_REDUCE_MIN] =
+			reduce_min_float_avx512;
+		reduce_kernels[DAOS_HL_TYPE_FLOAT][DAOS_HL_REDUCE_MAX] =
+			reduce_max_float_avx512;
+		reduce_kernels[DAOS_HL_TYPE_DOUBLE][DAOS_HL_REDUCE_SUM] =
+			reduce_sum_double_avx512;
+		reduce_kernels[DAOS_HL_TYPE_DOUBLE][DAOS_HL_REDUCE_MIN] =
+			reduce_min_double_avx512;
+		reduce_kernels[DAOS_HL_TYPE_DOUBLE][DAOS_HL_REDUCE_MAX] =
+			reduce_max_double_avx512;
+	} else if (__builtin_cpu_supports("avx2")) {
+		reduce_kernels[DAOS_HL_TYPE_FLOAT][DAOS_HL_REDUCE_SUM] =
+			reduce_sum_float_avx2;
+		reduce_kernels[DAOS_HL_TYPE_FLOAT][DAOS_HL_REDUCE_MIN] =
+			reduce_min_float_avx2;
+		reduce_kernels[DAOS_HL_TYPE_FLOAT][DAOS_HL_REDUCE_MAX] =
+			reduce_max_float_avx2;
+		reduce_kernels[DAOS_HL_TYPE_DOUBLE][DAOS_HL_REDUCE_SUM] =
+			reduce_sum_double_avx2;
+		reduce_kernels[DAOS_HL_TYPE_DOUBLE][DAOS_HL_REDUCE_MIN] =
+			reduce_min_double_avx2;
+		reduce_kernels[DAOS_HL_TYPE_DOUBLE][DAOS_HL_REDUCE_MAX] =
+			reduce_max_double_avx2;
+	}
+#endif
+}
+
+/** Start value of a reduction, any element replaces the one of min/max */
+static int
+reduce_acc_init(uint32_t type, daos_hl_reduce_op_t op,
+		daos_hl_reduce_t *result, reduce_acc *acc)
+{
+	bool	is_fp = (DAOS_HL_TYPE_FLOAT == type ||
+			 DAOS_HL_TYPE_DOUBLE == type);
+	bool	is_signed = (DAOS_HL_TYPE_INT32 == type ||
+			     DAOS_HL_TYPE_INT64 == type);
+	double	lo, hi;
+
+	memset(acc, 0, sizeof(*acc));
+
+	switch (op) {
+	case DAOS_HL_REDUCE_SUM:
+		break;
+	case DAOS_HL_REDUCE_MIN:
+		if (is_fp)
+			acc->value.v_d = INFINITY;
+		else if (is_signed)
+			acc->value.v_i = INT64_MAX;
+		else
+			acc->value.v_u = UINT64_MAX;
+		break;
+	case DAOS_HL_REDUCE_MAX:
+		if (is_fp)
+			acc->value.v_d = -INFINITY;
+		else if (is_signed)
+			acc->value.v_i = INT64_MIN;
+		else
+			acc->value.v_u = 0;
+		break;
+	case DAOS_HL_REDUCE_HIST:
+		if (is_fp) {
+			lo = result->dr_lo.v_d;
+			hi = result->dr_hi.v_d;
+		} else if (is_signed) {
+			lo = (double)result->dr_lo.v_i;
+			hi = (double)result->dr_hi.v_i;
+		} else {
+			lo = (double)result->dr_lo.v_u;
+			hi = (double)result->dr_hi.v_u;
+		}
+		if (0 == result->dr_nbins || NULL == result->dr_bins ||
+		    !(lo < hi)) {
+			DHL_ERROR("Invalid histogram parameters\n");
+			return -1;
+		}
+		acc->lo = lo;
+		acc->scale = result->dr_nbins / (hi - lo);
+		acc->nbins = result->dr_nbins;
+		acc->bins = result->dr_bins;
+		memset(acc->bins, 0, acc->nbins * sizeof(uint64_t));
+		break;
+	default:
+		DHL_ERROR("Invalid reduction %d\n", op);
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Buffer of the ring, holding [index, index + len) of the array */
+typedef struct {
+	char			*buf;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	daos_event_t		ev;
+	bool			busy;
+} reduce_slot;
+
+int
+daos_hl_array_reduce(daos_handle_t oh, daos_epoch_t epoch,
+		     daos_hl_range_t *range, daos_hl_reduce_op_t op,
+		     daos_hl_reduce_t *result)
+{
+	reduce_slot	slots[DAOS_HL_REDUCE_DEPTH];
+	reduce_kern_t	kern;
+	reduce_acc	acc;
+	uint32_t	type = array_type_get(oh);
+	daos_size_t	esize = array_type_size(type);
+	daos_size_t	chunk;
+	daos_handle_t	eqh;
+	daos_event_t	*evp;
+	daos_off_t	off;
+	unsigned int	inflight = 0;
+	unsigned int	i;
+	int		status = 0;
+	int		rc;
+
+	if (NULL == range || NULL == result) {
+		DHL_ERROR("NULL range or result passed\n");
+		return -1;
+	}
+	if (0 == esize) {
+		DHL_ERROR("Reductions need an array with an element type\n");
+		return -1;
+	}
+	if (range->index % esize || range->len % esize) {
+		DHL_ERROR("Range is not aligned on elements\n");
+		return -1;
+	}
+
+	rc = reduce_acc_init(type, op, result, &acc);
+	if (rc != 0)
+		return rc;
+
+	pthread_once(&reduce_once, reduce_init);
+	kern = reduce_kernels[type][op];
+	chunk = DAOS_HL_REDUCE_BUF_SIZE - DAOS_HL_REDUCE_BUF_SIZE % esize;
+
+	memset(slots, 0, sizeof(slots));
+	for (i = 0; i < DAOS_HL_REDUCE_DEPTH; i++) {
+		slots[i].buf = (char *)malloc(chunk);
+		if (NULL == slots[i].buf) {
+			DHL_ERROR("Failed memory allocation\n");
+			status = -1;
+			goto out;
+		}
+		slots[i].ranges.ranges_nr = 1;
+		slots[i].ranges.ranges = &slots[i].rg;
+		slots[i].sgl.sg_nr.num = 1;
+		slots[i].sgl.sg_iovs = &slots[i].iov;
+	}
+
+	rc = daos_eq_create(&eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create event queue (%d)\n", rc);
+		status = rc;
+		goto out;
+	}
+
+	/**
+	 * Keep every free buffer fetching the next piece of the range, and
+	 * reduce each buffer when its fetch completes.
+	 */
+	off = 0;
+	do {
+		reduce_slot *slot;
+
+		for (i = 0; i < DAOS_HL_REDUCE_DEPTH && status == 0 &&
+		     off < range->len; i++) {
+			slot = &slots[i];
+			if (slot->busy)
+				continue;
+
+			slot->rg.index = range->index + off;
+			slot->rg.len = MIN(chunk, range->len - off);
+			slot->sgl.sg_nr.num_out = 0;
+			daos_iov_set(&slot->iov, slot->buf, slot->rg.len);
+			/** fetches leave holes untouched, they reduce as 0 */
+			memset(slot->buf, 0, slot->rg.len);
+
+			rc = daos_event_init(&slot->ev, eqh, NULL);
+			if (rc == 0) {
+				rc = daos_hl_array_read(oh, epoch,
+							&slot->ranges,
+							&slot->sgl, NULL,
+							&slot->ev);
+				if (rc != 0)
+					daos_event_fini(&slot->ev);
+			}
+			if (rc != 0) {
+				DHL_ERROR("Failed to start reduce read (%d)\n",
+					  rc);
+				status = rc;
+				break;
+			}
+			slot->busy = true;
+			off += slot->rg.len;
+			inflight ++;
+		}
+
+		if (inflight == 0)
+			break;
+
+		rc = daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp);
+		if (rc != 1) {
+			DHL_ERROR("Failed to poll event queue (%d)\n", rc);
+			status = (rc < 0) ? rc : -1;
+			break;
+		}
+
+		for (i = 0; i < DAOS_HL_REDUCE_DEPTH; i++)
+			if (&slots[i].ev == evp)
+				break;
+		DHL_ASSERT(i < DAOS_HL_REDUCE_DEPTH);
+		slot = &slots[i];
+
+		rc = evp->ev_error;
+		daos_event_fini(&slot->ev);
+		slot->busy = false;
+		inflight --;
+		if (rc != 0 && status == 0) {
+			DHL_ERROR("Reduce read failed (%d)\n", rc);
+			status = rc;
+		}
+		if (status == 0)
+			kern(slot->buf, slot->rg.len / esize, &acc);
+	} while (1);
+
+	/** drain the reads still in flight after a failure */
+	while (inflight) {
+		if (daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp) != 1)
+			break;
+		daos_event_fini(evp);
+		inflight --;
+	}
+
+	daos_eq_destroy(eqh, 0);
+out:
+	for (i = 0; i < DAOS_HL_REDUCE_DEPTH; i++)
+		free(slots[i].buf);
+
+	if (status != 0) {
+		DHL_ERROR("Array reduce failed (%d)\n", status);
+		return status;
+	}
+
+	result->dr_value = acc.value;
+	result->dr_count = range->len / esize;
+
+	return 0;
+}
@@ -0,0 +1,558 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/file/file.c
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/array.h>
+
+/** akey under the array metadata dkey holding the file size */
+#define DAOS_HL_FILE_SIZE_AKEY		"file_size"
+
+/** MSC - Those need to be configurable later through hints */
+/** Size of the buffer coalescing small writes */
+#define DAOS_HL_FILE_WBUF_SIZE		1048576
+/** Size of the read-ahead buffer */
+#define DAOS_HL_FILE_RA_SIZE		1048576
+
+struct daos_hl_file {
+	daos_handle_t		oh;
+	daos_epoch_t		epoch;
+	bool			rdonly;
+	pthread_mutex_t		lock;
+	/** cached file size, persisted on fsync/close when dirty */
+	uint64_t		size;
+	bool			size_dirty;
+	daos_size_t		blksize;
+	/** buffered writes, all adjacent, starting at wb_off */
+	char			*wbuf;
+	daos_off_t		wb_off;
+	daos_size_t		wb_len;
+	/** read-ahead data of [ra_off, ra_off + ra_len) */
+	char			*rabuf;
+	daos_off_t		ra_off;
+	daos_size_t		ra_len;
+	/** end of the last read, to detect sequential reads */
+	daos_off_t		last_end;
+	/** the write and read-ahead buffers are off */
+	bool			nocache;
+};
+
+/** Read or write a single contiguous range of the array */
+static int
+file_io(daos_hl_file_t *file, void *buf, daos_size_t len, daos_off_t off,
+	bool write)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+
+	ranges.ranges_nr = 1;
+	rg.len = len;
+	rg.index = off;
+	ranges.ranges = &rg;
+
+	sgl.sg_nr.num = 1;
+	sgl.sg_nr.num_out = 0;
+	daos_iov_set(&iov, buf, len);
+	sgl.sg_iovs = &iov;
+
+	if (write)
+		return daos_hl_array_write(file->oh, file->epoch, &ranges,
+					   &sgl, NULL, NULL);
+
+	return daos_hl_array_read(file->oh, file->epoch, &ranges, &sgl, NULL,
+				  NULL);
+}
+
+/** Write out the buffered writes */
+static int
+file_flush(daos_hl_file_t *file)
+{
+	int rc;
+
+	if (file->wb_len == 0)
+		return 0;
+
+	rc = file_io(file, file->wbuf, file->wb_len, file->wb_off, true);
+	if (rc != 0) {
+		DHL_ERROR("Failed to flush write buffer (%d)\n", rc);
+		return rc;
+	}
+	file->wb_len = 0;
+
+	return 0;
+}
+
+static bool
+file_overlap(daos_off_t a_off, daos_size_t a_len, daos_off_t b_off,
+	     daos_size_t b_len)
+{
+	return a_len && b_len && a_off < b_off + b_len && b_off < a_off + a_len;
+}
+
+int
+daos_hl_file_open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		  int flags, daos_hl_file_t **filep)
+{
+	daos_hl_file_t		*file;
+	daos_hl_array_attr_t	attr;
+	int			rc;
+
+	if (NULL == filep) {
+		DHL_ERROR("NULL file pointer passed\n");
+		return -1;
+	}
+
+	file = (daos_hl_file_t *)calloc(1, sizeof(daos_hl_file_t));
+	if (NULL == file) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	file->epoch = epoch;
+	file->rdonly = ((flags & O_ACCMODE) == O_RDONLY);
+	pthread_mutex_init(&file->lock, NULL);
+
+	file->rabuf = (char *)malloc(DAOS_HL_FILE_RA_SIZE);
+	if (!file->rdonly)
+		file->wbuf = (char *)malloc(DAOS_HL_FILE_WBUF_SIZE);
+	if (NULL == file->rabuf || (!file->rdonly && NULL == file->wbuf)) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto err;
+	}
+
+	rc = daos_hl_array_open(coh, oid, epoch,
+				file->rdonly ? DAOS_OO_RO : DAOS_OO_RW, &attr,
+				&file->oh);
+	if (rc != 0)
+		goto err;
+	file->blksize = attr.da_block_size;
+
+	rc = array_md_access(file->oh, epoch, DAOS_HL_FILE_SIZE_AKEY,
+			     &file->size, sizeof(file->size), DAOS_HL_OP_READ);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read file size (%d)\n", rc);
+		daos_hl_array_close(file->oh);
+		goto err;
+	}
+
+	if (!file->rdonly && (flags & O_TRUNC)) {
+		rc = daos_hl_file_ftruncate(file, 0);
+		if (rc != 0) {
+			daos_hl_array_close(file->oh);
+			goto err;
+		}
+	}
+
+	*filep = file;
+
+	return 0;
+
+err:
+	pthread_mutex_destroy(&file->lock);
+	free(file->rabuf);
+	free(file->wbuf);
+	free(file);
+	return rc;
+}
+
+int
+daos_hl_file_close(daos_hl_file_t *file)
+{
+	int rc, ret;
+
+	if (NULL == file)
+		return 0;
+
+	rc = daos_hl_file_fsync(file);
+
+	ret = daos_hl_array_close(file->oh);
+	if (rc == 0)
+		rc = ret;
+
+	pthread_mutex_destroy(&file->lock);
+	free(file->rabuf);
+	free(file->wbuf);
+	free(file);
+
+	return rc;
+}
+
+ssize_t
+daos_hl_file_pread(daos_hl_file_t *file, void *buf, size_t len, off_t off)
+{
+	int rc = 0;
+
+	if (NULL == file || off < 0) {
+		DHL_ERROR("Invalid file or offset passed\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&file->lock);
+
+	/** other handles may have written past the cached size */
+	if (file->nocache && off + len > file->size) {
+		daos_size_t size;
+
+		rc = daos_hl_array_get_size(file->oh, file->epoch, &size,
+					    NULL);
+		if (rc != 0)
+			goto out;
+		if (size > file->size)
+			file->size = size;
+	}
+
+	if ((uint64_t)off >= file->size) {
+		len = 0;
+		goto out;
+	}
+	if (len > file->size - off)
+		len = file->size - off;
+
+	/** buffered writes must reach the array before reading them back */
+	if (file_overlap(file->wb_off, file->wb_len, off, len)) {
+		rc = file_flush(file);
+		if (rc != 0)
+			goto out;
+	}
+
+	if (file->nocache) {
+		rc = file_io(file, buf, len, off, false);
+		if (rc != 0)
+			goto out;
+	}
+	else if (file->ra_len && off >= file->ra_off &&
+	    off + len <= file->ra_off + file->ra_len) {
+		memcpy(buf, file->rabuf + (off - file->ra_off), len);
+	}
+	/** a small read continuing the last one fills the read-ahead buffer */
+	else if (off == file->last_end && len < DAOS_HL_FILE_RA_SIZE) {
+		daos_size_t ra_len = DAOS_HL_FILE_RA_SIZE;
+
+		if (ra_len > file->size - off)
+			ra_len = file->size - off;
+		if (file_overlap(file->wb_off, file->wb_len, off, ra_len)) {
+			rc = file_flush(file);
+			if (rc != 0)
+				goto out;
+		}
+
+		file->ra_len = 0;
+		rc = file_io(file, file->rabuf, ra_len, off, false);
+		if (rc != 0)
+			goto out;
+		file->ra_off = off;
+		file->ra_len = ra_len;
+		memcpy(buf, file->rabuf, len);
+	}
+	else {
+		rc = file_io(file, buf, len, off, false);
+		if (rc != 0)
+			goto out;
+	}
+
+	file->last_end = off + len;
+out:
+	pthread_mutex_unlock(&file->lock);
+
+	if (rc != 0) {
+		DHL_ERROR("File read failed (%d)\n", rc);
+		return rc;
+	}
+
+	return len;
+}
+
+ssize_t
+daos_hl_file_pwrite(daos_hl_file_t *file, const void *buf, size_t len,
+		    off_t off)
+{
+	int rc = 0;
+
+	if (NULL == file || off < 0) {
+		DHL_ERROR("Invalid file or offset passed\n");
+		return -1;
+	}
+	if (file->rdonly) {
+		DHL_ERROR("File is open read-only\n");
+		return -1;
+	}
+	if (len == 0)
+		return 0;
+
+	pthread_mutex_lock(&file->lock);
+
+	if (file_overlap(file->ra_off, file->ra_len, off, len))
+		file->ra_len = 0;
+
+	/**
+	 * Small writes are appended to the buffer while they follow each
+	 * other. Any other write flushes the buffer first, so the writes reach
+	 * the array in order.
+	 */
+	if (len < DAOS_HL_FILE_WBUF_SIZE && !file->nocache) {
+		if (file->wb_len &&
+		    ((daos_off_t)off != file->wb_off + file->wb_len ||
+		     file->wb_len + len > DAOS_HL_FILE_WBUF_SIZE)) {
+			rc = file_flush(file);
+			if (rc != 0)
+				goto out;
+		}
+		if (file->wb_len == 0)
+			file->wb_off = off;
+		memcpy(file->wbuf + file->wb_len, buf, len);
+		file->wb_len += len;
+	}
+	else {
+		rc = file_flush(file);
+		if (rc != 0)
+			goto out;
+		rc = file_io(file, (void *)buf, len, off, true);
+		if (rc != 0)
+			goto out;
+	}
+
+	if (off + len > file->size) {
+		file->size = off + len;
+		file->size_dirty = true;
+	}
+out:
+	pthread_mutex_unlock(&file->lock);
+
+	if (rc != 0) {
+		DHL_ERROR("File write failed (%d)\n", rc);
+		return rc;
+	}
+
+	return len;
+}
+
+int
+daos_hl_file_ftruncate(daos_hl_file_t *file, off_t size)
+{
+	int rc;
+
+	if (NULL == file || size < 0) {
+		DHL_ERROR("Invalid file or size passed\n");
+		return -1;
+	}
+	if (file->rdonly) {
+		DHL_ERROR("File is open read-only\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&file->lock);
+
+	rc = file_flush(file);
+	if (rc != 0)
+		goto out;
+	file->ra_len = 0;
+
+	if (file->size == (uint64_t)size)
+		goto out;
+
+	/**
+	 * Truncate the array right away, punching the cut tail so that growing
+	 * the file back reads zeros there, and so that the size matches the
+	 * data. Growing only moves the size, reads past the data get holes.
+	 */
+	if ((uint64_t)size < file->size) {
+		/** the array size is the one reads past the cache check */
+		rc = daos_hl_array_set_size(file->oh, file->epoch, size,
+					    NULL);
+		if (rc != 0)
+			goto out;
+	}
+
+	file->size = size;
+	rc = array_md_access(file->oh, file->epoch, DAOS_HL_FILE_SIZE_AKEY,
+			     &file->size, sizeof(file->size),
+			     DAOS_HL_OP_WRITE);
+	file->size_dirty = (rc != 0);
+out:
+	pthread_mutex_unlock(&file->lock);
+
+	if (rc != 0)
+		DHL_ERROR("File truncate failed (%d)\n", rc);
+
+	return rc;
+}
+
+int
+daos_hl_file_fstat(daos_hl_file_t *file, struct stat *st)
+{
+	if (NULL == file || NULL == st) {
+		DHL_ERROR("Invalid file or stat buffer passed\n");
+		return -1;
+	}
+
+	memset(st, 0, sizeof(*st));
+
+	pthread_mutex_lock(&file->lock);
+	st->st_size = file->size;
+	pthread_mutex_unlock(&file->lock);
+
+	st->st_mode = S_IFREG | (file->rdonly ? 0444 : 0644);
+	st->st_nlink = 1;
+	st->st_blksize = file->blksize;
+	st->st_blocks = (st->st_size + 511) / 512;
+
+	return 0;
+}
+
+int
+daos_hl_file_fsync(daos_hl_file_t *file)
+{
+	int rc;
+
+	if (NULL == file) {
+		DHL_ERROR("NULL file passed\n");
+		return -1;
+	}
+
+	if (file->rdonly)
+		return 0;
+
+	pthread_mutex_lock(&file->lock);
+
+	rc = file_flush(file);
+	if (rc == 0 && file->size_dirty) {
+		rc = array_md_access(file->oh, file->epoch,
+				     DAOS_HL_FILE_SIZE_AKEY, &file->size,
+				     sizeof(file->size), DAOS_HL_OP_WRITE);
+		if (rc != 0)
+			DHL_ERROR("Failed to write file size (%d)\n", rc);
+		else
+			file->size_dirty = false;
+	}
+
+	pthread_mutex_unlock(&file->lock);
+
+	return rc;
+}
+
+int
+daos_hl_file_set_cache(daos_hl_file_t *file, bool enable)
+{
+	int rc = 0;
+
+	if (NULL == file) {
+		DHL_ERROR("NULL file passed\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&file->lock);
+
+	if (!enable) {
+		rc = file_flush(file);
+		file->ra_len = 0;
+	}
+	if (rc == 0)
+		file->nocache = !enable;
+
+	pthread_mutex_unlock(&file->lock);
+
+	return rc;
+}
+
+int
+daos_hl_file_read_ranges(daos_hl_file_t *file, daos_hl_array_ranges_t *ranges,
+			 daos_sg_list_t *sgl)
+{
+	int rc;
+
+	if (NULL == file || NULL == ranges) {
+		DHL_ERROR("Invalid file or ranges passed\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&file->lock);
+
+	/** the ranges may cover buffered writes */
+	rc = file_flush(file);
+	if (rc == 0)
+		rc = daos_hl_array_read(file->oh, file->epoch, ranges, sgl,
+					NULL, NULL);
+
+	pthread_mutex_unlock(&file->lock);
+
+	if (rc != 0)
+		DHL_ERROR("File read failed (%d)\n", rc);
+
+	return rc;
+}
+
+int
+daos_hl_file_write_ranges(daos_hl_file_t *file,
+			  daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl)
+{
+	daos_size_t	u;
+	int		rc;
+
+	if (NULL == file || NULL == ranges) {
+		DHL_ERROR("Invalid file or ranges passed\n");
+		return -1;
+	}
+	if (file->rdonly) {
+		DHL_ERROR("File is open read-only\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&file->lock);
+
+	/** keep the buffered writes ordered before this one */
+	rc = file_flush(file);
+	if (rc != 0)
+		goto out;
+	file->ra_len = 0;
+
+	rc = daos_hl_array_write(file->oh, file->epoch, ranges, sgl, NULL,
+				 NULL);
+	if (rc != 0)
+		goto out;
+
+	for (u = 0; u < ranges->ranges_nr; u++) {
+		daos_hl_range_t *rg = &ranges->ranges[u];
+
+		if (rg->len && rg->index + rg->len > file->size) {
+			file->size = rg->index + rg->len;
+			file->size_dirty = true;
+		}
+	}
+out:
+	pthread_mutex_unlock(&file->lock);
+
+	if (rc != 0)
+		DHL_ERROR("File write failed (%d)\n", rc);
+
+	return rc;
+}
@@ -28,12 +28,17 @@
 #define __DAOS_HL_API_H__
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <daos_types.h>
 #include <daos_event.h>
 #include <daos_api.h>
 
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
 typedef struct {
 	daos_size_t		len;
 	daos_off_t		index;
@@ -47,6 +52,366 @@ typedef struct {
 	daos_hl_range_t	       *ranges;
 } daos_hl_array_ranges_t;
 
+/** access to one array object as part of a multi array operation */
+typedef struct {
+	/** Object open handle */
+	daos_handle_t		oh;
+	/** Ranges to access in the array */
+	daos_hl_array_ranges_t	*ranges;
+	/** Memory location of the data for the ranges */
+	daos_sg_list_t		*sgl;
+} daos_hl_array_io_t;
+
+/** Keep a block presence map to skip fetches of never written blocks */
+#define DAOS_HL_ARRAY_BITMAP	(1ULL << 0)
+/**
+ * Records are compound, each field stored under its own akey. Set by
+ * daos_hl_array_create_fields().
+ */
+#define DAOS_HL_ARRAY_FIELDS	(1ULL << 1)
+/**
+ * Keep a zone map: the min, max and zero count of the elements of each block,
+ * for daos_hl_array_read_where(). Needs an element type in da_type.
+ */
+#define DAOS_HL_ARRAY_ZONEMAP	(1ULL << 2)
+
+/** Types of the elements of an array */
+typedef enum {
+	/** Untyped bytes (default) */
+	DAOS_HL_TYPE_NONE = 0,
+	DAOS_HL_TYPE_INT32,
+	DAOS_HL_TYPE_INT64,
+	DAOS_HL_TYPE_UINT32,
+	DAOS_HL_TYPE_UINT64,
+	DAOS_HL_TYPE_FLOAT,
+	DAOS_HL_TYPE_DOUBLE,
+	DAOS_HL_TYPE_NR,
+} daos_hl_type_t;
+
+/**
+ * Value of an element, widened to 64 bits: v_i for signed integer types, v_u
+ * for unsigned ones and v_d for floating point ones.
+ */
+typedef union {
+	int64_t			v_i;
+	uint64_t		v_u;
+	double			v_d;
+} daos_hl_value_t;
+
+/** Policies mapping the bytes of an array to dkeys */
+typedef enum {
+	/**
+	 * Blocks are striped round-robin over the dkeys of a group, each dkey
+	 * holding da_dkey_blocks blocks of the group (default).
+	 */
+	DAOS_HL_LAYOUT_STRIPED = 0,
+	/**
+	 * Each dkey holds one contiguous chunk of da_dkey_blocks blocks. Suits
+	 * append-only streams and large sequential accesses.
+	 */
+	DAOS_HL_LAYOUT_CONTIG,
+	/**
+	 * Blocks are placed on the dkeys of their group by a hash of the block
+	 * number. Suits random accesses with strides that would hit the same
+	 * dkey under the striped layout.
+	 */
+	DAOS_HL_LAYOUT_HASHED,
+	DAOS_HL_LAYOUT_NR,
+} daos_hl_layout_t;
+
+/**
+ * Array attributes, set when the array is created. Layout parameters left to
+ * 0 are set to the library defaults, and the values used are stored with the
+ * array.
+ */
+typedef struct {
+	/** DAOS_HL_ARRAY_* feature flags */
+	uint64_t		da_flags;
+	/** DAOS_HL_LAYOUT_* policy */
+	uint32_t		da_layout;
+	/** Number of dkeys in a group (striped and hashed layouts) */
+	uint32_t		da_dkey_nr;
+	/** Number of bytes in a block */
+	uint64_t		da_block_size;
+	/** Number of blocks a dkey holds in each group */
+	uint64_t		da_dkey_blocks;
+	/** DAOS_HL_TYPE_* type of the elements */
+	uint32_t		da_type;
+	uint32_t		da_pad;
+} daos_hl_array_attr_t;
+
+/**
+ * Create an array object and open it. The attributes are stored in the array
+ * metadata.
+ *
+ * \param coh	[IN]	Container open handle.
+ *
+ * \param oid	[IN]	Object ID of the array.
+ *
+ * \param epoch	[IN]	Epoch to write the metadata at.
+ *
+ * \param attr	[IN]	Attributes of the array. This is optional (pass NULL
+ *			for the defaults).
+ *
+ * \param oh	[OUT]	Returned object open handle.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_create(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		     daos_hl_array_attr_t *attr, daos_handle_t *oh);
+
+/**
+ * Open an array object and cache its metadata.
+ *
+ * The accesses through the handle use the layout stored with the array.
+ * Arrays opened with daos_obj_open instead use the default striped layout.
+ *
+ * With DAOS_HL_ARRAY_BITMAP, the presence map is loaded at open and updated by
+ * the writes made through the handle. Blocks written by other processes after
+ * the open are not seen until the array is opened again.
+ *
+ * \param coh	[IN]	Container open handle.
+ *
+ * \param oid	[IN]	Object ID of the array.
+ *
+ * \param epoch	[IN]	Epoch to read the metadata at.
+ *
+ * \param mode	[IN]	Open mode (DAOS_OO_RO/RW).
+ *
+ * \param attr	[OUT]	Attributes of the array. This is optional (pass NULL
+ *			to ignore).
+ *
+ * \param oh	[OUT]	Returned object open handle.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		   unsigned int mode, daos_hl_array_attr_t *attr,
+		   daos_handle_t *oh);
+
+/** Max number of fields of a compound record */
+#define DAOS_HL_FIELDS_MAX	32
+/** Max length of a field name, including the terminating NUL */
+#define DAOS_HL_FIELD_NAME_MAX	32
+
+/** Field of the records of a compound array */
+typedef struct {
+	/** Name of the field, also the akey storing it */
+	char			df_name[DAOS_HL_FIELD_NAME_MAX];
+	/** Size of the field in bytes */
+	uint64_t		df_size;
+} daos_hl_field_t;
+
+/**
+ * Create an array of compound records and open it, as daos_hl_array_create().
+ *
+ * The array is indexed in records, and da_block_size in \a attr counts
+ * records. Each field is stored under its own akey in the dkeys holding the
+ * record, so an access to a few fields only moves those fields. The array is
+ * accessed with daos_hl_array_read_fields/write_fields, and the field list is
+ * stored with the array and loaded by daos_hl_array_open().
+ * DAOS_HL_ARRAY_BITMAP is not supported.
+ *
+ * \param nr	[IN]	Number of fields, at most DAOS_HL_FIELDS_MAX.
+ *
+ * \param fields	[IN]	Fields of a record, with distinct names.
+ *
+ * Other parameters as daos_hl_array_create().
+ */
+int
+daos_hl_array_create_fields(daos_handle_t coh, daos_obj_id_t oid,
+			    daos_epoch_t epoch, daos_hl_array_attr_t *attr,
+			    unsigned int nr, const daos_hl_field_t *fields,
+			    daos_handle_t *oh);
+
+/**
+ * User memory of one field in an access to a compound array. The records of
+ * the access are numbered in the order of its ranges, and the field of record
+ * i is at fm_buf + i * fm_stride: fm_stride is the field size for a buffer per
+ * field (SoA), and the struct size for an array of structs (AoS), with fm_buf
+ * pointing to the field of the first struct.
+ */
+typedef struct {
+	/** Name of the field */
+	const char		*fm_name;
+	/** Address of the field of the first record */
+	void			*fm_buf;
+	/** Bytes between the field of two consecutive records */
+	daos_size_t		fm_stride;
+} daos_hl_field_mem_t;
+
+/**
+ * Read some fields of the records of a compound array. Each dkey I/O fetches
+ * the akeys of the fields named in \a mem only. Fields in AoS buffers go
+ * through a bounce buffer per dkey I/O, the others land in place.
+ *
+ * \param oh	[IN]	Handle of an array created with
+ *			daos_hl_array_create_fields().
+ *
+ * \param epoch	[IN]	Epoch for the read.
+ *
+ * \param ranges	[IN]	Ranges of records to read.
+ *
+ * \param nr	[IN]	Number of fields to read.
+ *
+ * \param mem	[IN]	Memory of each field, as described above.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_read_fields(daos_handle_t oh, daos_epoch_t epoch,
+			  daos_hl_array_ranges_t *ranges, unsigned int nr,
+			  daos_hl_field_mem_t *mem, daos_event_t *ev);
+
+/**
+ * Write some fields of the records of a compound array. The fields not named
+ * in \a mem are left untouched. Parameters as daos_hl_array_read_fields().
+ */
+int
+daos_hl_array_write_fields(daos_handle_t oh, daos_epoch_t epoch,
+			   daos_hl_array_ranges_t *ranges, unsigned int nr,
+			   daos_hl_field_mem_t *mem, daos_event_t *ev);
+
+/** Summary of the elements of one block of an array with a zone map */
+typedef struct {
+	/** Smallest and largest element, NaNs left out */
+	daos_hl_value_t		dz_min;
+	daos_hl_value_t		dz_max;
+	/** Number of elements written, 0 if the block was never written */
+	uint64_t		dz_count;
+	/** Number of elements equal to 0 */
+	uint64_t		dz_zeros;
+} daos_hl_zone_t;
+
+/** Predicate of daos_hl_array_read_where(): dp_lo <= element <= dp_hi */
+typedef struct {
+	daos_hl_value_t		dp_lo;
+	daos_hl_value_t		dp_hi;
+} daos_hl_predicate_t;
+
+/**
+ * Read the blocks of a range of an array that may hold elements matching a
+ * predicate, according to the zone map of the array. The other blocks are not
+ * fetched and their part of \a sgl is left untouched.
+ *
+ * The zone map is updated by the writes through the array APIs. Each handle
+ * keeps the summaries of its own writes, and the maps of all the writers are
+ * merged when the array is opened and again by every read_where over the
+ * blocks of \a range, so writes committed through other handles are seen. A
+ * block written whole gets an exact summary, partial writes widen the summary
+ * of the block, so counts become upper bounds. A block holding elements
+ * written only in part covers every value and is never pruned.
+ *
+ * \param oh	[IN]	Handle of an array created with DAOS_HL_ARRAY_ZONEMAP.
+ *
+ * \param epoch	[IN]	Epoch for the read.
+ *
+ * \param range	[IN]	Range of the array to scan.
+ *
+ * \param pred	[IN]	Predicate the elements are matched against.
+ *
+ * \param sgl	[IN]	Memory of the whole range, as daos_hl_array_read().
+ *
+ * \param matched	[OUT]	Ranges actually read, in array order. This is
+ *			optional (pass NULL to ignore). Free matched->ranges
+ *			with free().
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_read_where(daos_handle_t oh, daos_epoch_t epoch,
+			 daos_hl_range_t *range,
+			 const daos_hl_predicate_t *pred, daos_sg_list_t *sgl,
+			 daos_hl_array_ranges_t *matched, daos_event_t *ev);
+
+/**
+ * Return the cached zone map entries of blocks [first, first + nr) of an array
+ * created with DAOS_HL_ARRAY_ZONEMAP.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_zones_get(daos_handle_t oh, daos_size_t first, daos_size_t nr,
+			daos_hl_zone_t *zones);
+
+/** Reductions of daos_hl_array_reduce() */
+typedef enum {
+	DAOS_HL_REDUCE_SUM = 0,
+	DAOS_HL_REDUCE_MIN,
+	DAOS_HL_REDUCE_MAX,
+	/** Count of the elements in each bin of a histogram */
+	DAOS_HL_REDUCE_HIST,
+	DAOS_HL_REDUCE_NR,
+} daos_hl_reduce_op_t;
+
+/** Parameters and result of daos_hl_array_reduce() */
+typedef struct {
+	/**
+	 * [OUT] Sum, min or max, in the member of the element type. Sums of
+	 * floats are accumulated in doubles. Min and max leave NaNs out.
+	 */
+	daos_hl_value_t		dr_value;
+	/**
+	 * [OUT] Number of elements reduced, all the elements of the range:
+	 * holes are not told apart and count as elements equal to 0
+	 */
+	uint64_t		dr_count;
+	/**
+	 * [IN] Histogram range [dr_lo, dr_hi), in the member of the element
+	 * type, split into dr_nbins bins of equal width. Elements out of the
+	 * range are not counted.
+	 */
+	daos_hl_value_t		dr_lo;
+	daos_hl_value_t		dr_hi;
+	uint64_t		dr_nbins;
+	/** [OUT] dr_nbins counters of the histogram */
+	uint64_t		*dr_bins;
+} daos_hl_reduce_t;
+
+/**
+ * Reduce a range of a typed array (da_type set at creation). The range is read
+ * through a small ring of buffers, and each buffer is reduced with a vector
+ * kernel (AVX-512 or AVX2 for float and double, when the CPU has them) as soon
+ * as its fetch completes, while the next fetches are in flight. Setting
+ * DAOS_HL_REDUCE_SIMD=0 in the environment forces the scalar kernels.
+ *
+ * \param oh	[IN]	Array object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the read.
+ *
+ * \param range	[IN]	Range of the array, aligned on elements. Blocks
+ *			never written, and holes, read as zeros and are
+ *			reduced and counted as such.
+ *
+ * \param op	[IN]	DAOS_HL_REDUCE_* reduction.
+ *
+ * \param result	[IN/OUT]	Result, and histogram parameters.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_reduce(daos_handle_t oh, daos_epoch_t epoch,
+		     daos_hl_range_t *range, daos_hl_reduce_op_t op,
+		     daos_hl_reduce_t *result);
+
+/**
+ * Close an array object opened with daos_hl_array_open/create.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_close(daos_handle_t oh);
+
 /**
  * Read data from an array object.
  *
@@ -117,11 +482,1013 @@ daos_hl_array_write(daos_handle_t oh, daos_epoch_t epoch,
 		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
 		   daos_csum_buf_t *csums, daos_event_t *ev);
 
+/**
+ * Completion callback of an operation.
+ *
+ * Dkey I/Os failing with a transient error (-DER_UNREACH, -DER_TIMEDOUT,
+ * -DER_BUSY) are reissued alone a bounded number of times, with an exponential
+ * backoff, before the operation gives up on them.
+ *
+ * \param arg	[IN]	Argument given with the callback.
+ *
+ * \param rc	[IN]	Status of the operation, the first error of a dkey I/O
+ *			that failed for good.
+ *
+ * \param bytes	[IN]	Number of bytes moved by the dkey I/Os that
+ *			succeeded. Holes skipped through the presence map are
+ *			not counted.
+ *
+ * \param failed	[IN]	Array ranges of the dkey I/Os that failed for good,
+ *			empty on success. Only valid during the callback.
+ */
+typedef void (*daos_hl_comp_cb_t)(void *arg, int rc, daos_size_t bytes,
+				  daos_hl_array_ranges_t *failed);
+
+/**
+ * Read data from an array object, and run a callback as soon as the last dkey
+ * I/O of the read completes.
+ *
+ * The callback runs from the progress of the event queue of \a ev, before \a ev
+ * itself is completed, so that dependent work can be started right away. It
+ * must not wait on \a ev. In blocking mode, it runs before the call returns.
+ * It is not run if the call itself returns an error.
+ *
+ * \param cb	[IN]	Completion callback.
+ *
+ * \param cb_arg	[IN]	Argument passed to \a cb.
+ *
+ * Other parameters and return values as daos_hl_array_read().
+ */
+int
+daos_hl_array_read_cb(daos_handle_t oh, daos_epoch_t epoch,
+		      daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		      daos_csum_buf_t *csums, daos_hl_comp_cb_t cb,
+		      void *cb_arg, daos_event_t *ev);
+
+/**
+ * Write data to an array object, and run a callback as soon as the last dkey
+ * I/O of the write completes. The callback is run as for
+ * daos_hl_array_read_cb().
+ *
+ * Other parameters and return values as daos_hl_array_write().
+ */
 int
-daos_hl_array_get_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t *size,
-		       daos_event_t *ev);
+daos_hl_array_write_cb(daos_handle_t oh, daos_epoch_t epoch,
+		       daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		       daos_csum_buf_t *csums, daos_hl_comp_cb_t cb,
+		       void *cb_arg, daos_event_t *ev);
+
+/**
+ * Read data from several array objects in a single operation.
+ *
+ * The accesses to all the arrays are planned together and their dkey I/Os are
+ * submitted as children of one event, sharing one in-flight window.
+ *
+ * \param epoch	[IN]	Epoch for the read.
+ *
+ * \param nr	[IN]	Number of entries in \a ios.
+ *
+ * \param ios	[IN/OUT]
+ *			Array object handle, ranges and sgl of each array to
+ *			read. Same rules as daos_hl_array_read() apply to
+ *			each entry.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		Same values as daos_hl_array_read().
+ */
 int
-daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
-		       daos_event_t *ev);
+daos_hl_array_read_multi(daos_epoch_t epoch, unsigned int nr,
+			 daos_hl_array_io_t *ios, daos_event_t *ev);
+
+/**
+ * Write data to several array objects in a single operation.
+ *
+ * The accesses to all the arrays are planned together and their dkey I/Os are
+ * submitted as children of one event, sharing one in-flight window.
+ *
+ * \param epoch	[IN]	Epoch for the write.
+ *
+ * \param nr	[IN]	Number of entries in \a ios.
+ *
+ * \param ios	[IN]	Array object handle, ranges and sgl of each array to
+ *			write. Same rules as daos_hl_array_write() apply to
+ *			each entry.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		Same values as daos_hl_array_write().
+ */
+int
+daos_hl_array_write_multi(daos_epoch_t epoch, unsigned int nr,
+			  daos_hl_array_io_t *ios, daos_event_t *ev);
+
+/**
+ * Range generator of a streamed array access. Each call returns the next range
+ * of the array to access in \a range, and in \a iov the buffer holding its
+ * data, of the same length as the range.
+ *
+ * In non-blocking mode, the generator is called from the completion of the
+ * previous dkey I/Os, so it must not block.
+ *
+ * \return		1 if a range was returned, 0 when there are no more
+ *			ranges, negative value on failure.
+ */
+typedef int (*daos_hl_range_gen_t)(void *arg, daos_hl_range_t *range,
+				   daos_iov_t *iov);
+
+/**
+ * Read data from an array object, with the ranges produced on demand by a
+ * generator instead of a list built up front.
+ *
+ * The ranges are pulled from the generator in small batches as the dkey I/Os
+ * already submitted complete, so the memory used does not depend on the
+ * number of ranges and the first fetches are issued before the generator
+ * reaches the end.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the read.
+ *
+ * \param gen	[IN]	Range generator.
+ *
+ * \param arg	[IN]	Argument passed to \a gen. It must stay valid until
+ *			the operation completes.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		Same values as daos_hl_array_read().
+ */
+int
+daos_hl_array_read_gen(daos_handle_t oh, daos_epoch_t epoch,
+		       daos_hl_range_gen_t gen, void *arg, daos_event_t *ev);
+
+/**
+ * Write data to an array object, with the ranges produced on demand by a
+ * generator instead of a list built up front. Same rules as
+ * daos_hl_array_read_gen() apply.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the write.
+ *
+ * \param gen	[IN]	Range generator.
+ *
+ * \param arg	[IN]	Argument passed to \a gen. It must stay valid until
+ *			the operation completes.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		Same values as daos_hl_array_write().
+ */
+int
+daos_hl_array_write_gen(daos_handle_t oh, daos_epoch_t epoch,
+			daos_hl_range_gen_t gen, void *arg, daos_event_t *ev);
+
+/**
+ * Read single elements of an array object at random indices.
+ *
+ * The elements are grouped by dkey, so that all the elements of a dkey are
+ * fetched by a single dkey I/O in increasing index order, and the cost depends
+ * on the number of dkeys touched rather than on the number of elements. Only
+ * the payload cap of daos_hl_rpc_limits_set() splits a dkey I/O here, not the
+ * cap on the number of recxs.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the read.
+ *
+ * \param nr	[IN]	Number of elements.
+ *
+ * \param indices	[IN]	Index of each element, in elements. Element i
+ *			is at array offset indices[i] * elem_size.
+ *
+ * \param elem_size	[IN]	Size of an element in bytes.
+ *
+ * \param values	[OUT]	Packed buffer of nr * elem_size bytes, receiving
+ *			element i at offset i * elem_size.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_gather(daos_handle_t oh, daos_epoch_t epoch, daos_size_t nr,
+		     const daos_off_t *indices, daos_size_t elem_size,
+		     void *values, daos_event_t *ev);
+
+/**
+ * Write single elements of an array object at random indices, grouped by dkey
+ * as in daos_hl_array_gather(). If an index appears more than once, which of
+ * its values is written is undefined.
+ *
+ * \param values	[IN]	Packed buffer of nr * elem_size bytes, holding
+ *			element i at offset i * elem_size.
+ *
+ * Other parameters as daos_hl_array_gather().
+ */
+int
+daos_hl_array_scatter(daos_handle_t oh, daos_epoch_t epoch, daos_size_t nr,
+		      const daos_off_t *indices, daos_size_t elem_size,
+		      const void *values, daos_event_t *ev);
+
+/** Memory mapping of an array range */
+typedef struct daos_hl_array_map daos_hl_array_map_t;
+
+/**
+ * Map a range of an array object read-only into memory.
+ *
+ * No data is read up front: the first touch of a page faults it in through
+ * userfaultfd. A fault fetches the whole unit holding the page (at least one
+ * block and 64 KiB) plus up to 3 following units that are not resident yet.
+ * Filled pages are clean, and the kernel may drop them under memory pressure;
+ * they are fetched again on the next touch. Pages past the end of the range in
+ * the last page read as zeros, as do pages whose fetch failed.
+ *
+ * Faults are resolved by a handler thread with its own DAOS event queue, not
+ * through the daos_hl engine, so the mapping may be used as the buffer of
+ * other daos_hl calls. Where the kernel supports it, the userfaultfd only
+ * handles faults from user space: system calls touching pages of the mapping
+ * that are not resident yet fail with EFAULT. If the process is not allowed
+ * to use userfaultfd, the whole range is read into the mapping before the call
+ * returns.
+ *
+ * Writes to the array after the mapping is created may or may not show up in
+ * it. Requires a kernel with userfaultfd.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch to read the array at.
+ *
+ * \param range	[IN]	Range of the array to map.
+ *
+ * \param map	[OUT]	Mapping, to release with daos_hl_array_munmap().
+ *
+ * \param addr	[OUT]	Address of the first byte of the range in memory.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_mmap(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_range_t *range, daos_hl_array_map_t **map,
+		   void **addr);
+
+/**
+ * Unmap a range mapped with daos_hl_array_mmap().
+ *
+ * \param map	[IN]	Mapping to release.
+ *
+ * \return		0 on success, negative value if unmapping failed or if
+ *			any fetch of the mapping failed.
+ */
+int
+daos_hl_array_munmap(daos_hl_array_map_t *map);
+
+/**
+ * Copy ranges of an array object to the same ranges of another one.
+ *
+ * The data goes through a ring of buffers, so the fetches from the source
+ * overlap with the updates of the destination. If the source was created with
+ * DAOS_HL_ARRAY_BITMAP, the blocks it never wrote are neither fetched nor
+ * written to the destination. This function runs in blocking mode.
+ *
+ * \param src_oh	[IN]	Open handle of the source array.
+ *
+ * \param src_epoch	[IN]	Epoch to read the source at.
+ *
+ * \param dst_oh	[IN]	Open handle of the destination array.
+ *
+ * \param dst_epoch	[IN]	Epoch to write the destination at.
+ *
+ * \param ranges	[IN]	Ranges to copy.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_copy(daos_handle_t src_oh, daos_epoch_t src_epoch,
+		   daos_handle_t dst_oh, daos_epoch_t dst_epoch,
+		   daos_hl_array_ranges_t *ranges);
+
+/** Checkpoint writer staging array writes */
+typedef struct daos_hl_ckpt daos_hl_ckpt_t;
+
+/** Attributes of a checkpoint writer */
+typedef struct {
+	/** Number of staging buffers, 0 for the default (2) */
+	unsigned int		dc_buf_nr;
+	/** Size of each staging buffer, 0 for the default (4 MiB) */
+	daos_size_t		dc_buf_size;
+} daos_hl_ckpt_attr_t;
+
+/** The checkpoint write uses the buffers of the caller instead of copies */
+#define DAOS_HL_CKPT_BORROW	(1U << 0)
+
+/**
+ * Create a checkpoint writer. Its writes are staged in a pool of buffers and
+ * drained to the arrays by a thread of the writer, so that the application
+ * computes while the previous checkpoint is written.
+ *
+ * \param coh	[IN]	Container open handle, whose epochs are committed by
+ *			daos_hl_ckpt_commit().
+ *
+ * \param attr	[IN]	Attributes of the writer. This is optional (pass NULL
+ *			for the defaults).
+ *
+ * \param ckpt	[OUT]	Returned checkpoint writer.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_ckpt_create(daos_handle_t coh, daos_hl_ckpt_attr_t *attr,
+		    daos_hl_ckpt_t **ckpt);
+
+/**
+ * Write data to an array object through a checkpoint writer. The data is
+ * copied into the staging buffers and the call returns once the write of the
+ * last buffer is started. When all the buffers are in flight, the call waits
+ * for one to drain. Writes of the same epoch may drain in any order, so they
+ * should not overlap.
+ *
+ * \param ckpt	[IN]	Checkpoint writer.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the write.
+ *
+ * \param range	[IN]	Ranges to write to the array.
+ *
+ * \param sgl   [IN]	A scatter/gather list (sgl) to the store array data.
+ *			Buffer sizes do not have to match the indiviual range
+ *			sizes as long as the total size does.
+ *
+ * \param flags	[IN]	DAOS_HL_CKPT_BORROW to write from the buffers of
+ *			\a sgl without a copy. They must then be left
+ *			untouched until daos_hl_ckpt_wait() returns for
+ *			\a epoch.
+ *
+ * \return		0 on success, negative value on failure. Failures of
+ *			the writes themselves are returned by
+ *			daos_hl_ckpt_wait(). A failure after part of the data
+ *			was launched is also recorded against \a epoch.
+ */
+int
+daos_hl_ckpt_write(daos_hl_ckpt_t *ckpt, daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl,
+		   unsigned int flags);
+
+/**
+ * Wait for the checkpoint writes of epochs up to \a epoch to drain. Writes of
+ * later epochs are left in flight.
+ *
+ * \param ckpt	[IN]	Checkpoint writer.
+ *
+ * \param epoch	[IN]	Last epoch to wait for.
+ *
+ * \return		0 on success, the error of the lowest failed epoch up
+ *			to \a epoch otherwise. The errors of the epochs up to
+ *			\a epoch are cleared, the ones of later epochs are
+ *			kept for the waits of those epochs.
+ */
+int
+daos_hl_ckpt_wait(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch);
+
+/**
+ * Wait for the checkpoint writes of epochs up to \a epoch to drain, and
+ * commit \a epoch if they all succeeded.
+ *
+ * \param ckpt	[IN]	Checkpoint writer.
+ *
+ * \param epoch	[IN]	Epoch to commit.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_ckpt_commit(daos_hl_ckpt_t *ckpt, daos_epoch_t epoch);
+
+/**
+ * Drain all the writes of a checkpoint writer and destroy it. Epochs are not
+ * committed.
+ *
+ * \param ckpt	[IN]	Checkpoint writer.
+ *
+ * \return		0 on success, the first error of a write not returned
+ *			by daos_hl_ckpt_wait() otherwise.
+ */
+int
+daos_hl_ckpt_destroy(daos_hl_ckpt_t *ckpt);
+
+/** Append context shared by the processes appending to the same array */
+typedef struct daos_hl_append_ctx daos_hl_append_ctx_t;
+
+/**
+ * Append data to the end of an array object.
+ *
+ * The range to write is reserved from an append counter before the data is
+ * written, so the size of the array does not need to be queried. With a
+ * \a ctx, created through daos_hl_mpi.h, the counter is an MPI atomic on
+ * rank 0 of the context communicator, so the appenders of all the ranks never
+ * overlap. Without a \a ctx, the counter is read and updated in the array
+ * metadata under a lock of the process: the threads of one process never
+ * overlap, but appends from several processes at a time can.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the append.
+ *
+ * \param ctx	[IN]	Append context, or NULL for an uncoordinated append.
+ *
+ * \param sgl   [IN]	A scatter/gather list (sgl) with the data to append.
+ *
+ * \param offset	[OUT]	Array index where the data was appended. This is
+ *			optional (pass NULL to ignore).
+ *
+ * \param ev	[IN]	Completion event for the data write, it is optional
+ *			and can be NULL. The range reservation is always
+ *			done before the function returns.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_append(daos_handle_t oh, daos_epoch_t epoch,
+		     daos_hl_append_ctx_t *ctx, daos_sg_list_t *sgl,
+		     daos_off_t *offset, daos_event_t *ev);
+
+/**
+ * Get the size of an array, the end of the data written to it through the
+ * handles of daos_hl_array_open/create, whatever its layout. Objects opened
+ * with daos_obj_open get the size of their highest dkey.
+ *
+ * \param oh	[IN]	Open object handle.
+ * \param epoch	[IN]	Epoch to read the size at.
+ * \param size	[OUT]	Size of the array.
+ * \param ev	[IN]	Unused, the call is blocking.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_get_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t *size,
+		       daos_event_t *ev);
+
+/**
+ * Set the size of an array. Growing writes a zero at the new end, shrinking
+ * truncates: the data past the new size is punched.
+ */
+int
+daos_hl_array_set_size(daos_handle_t oh, daos_epoch_t epoch, daos_size_t size,
+		       daos_event_t *ev);
+
+/**
+ * Key-value object. Keys are NUL terminated strings stored as akeys, hashed
+ * into a fixed set of dkeys. Values are stored as a single record each.
+ */
+
+/**
+ * Put a value in a KV object.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the put.
+ *
+ * \param key	[IN]	Key of the value.
+ *
+ * \param size	[IN]	Size of the value.
+ *
+ * \param buf	[IN]	Value to store.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_kv_put(daos_handle_t oh, daos_epoch_t epoch, const char *key,
+	       daos_size_t size, const void *buf, daos_event_t *ev);
+
+/**
+ * Put several values in a KV object. All the keys hashing to the same dkey
+ * are stored by a single update, and the updates run concurrently.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the put.
+ *
+ * \param nr	[IN]	Number of values to put.
+ *
+ * \param keys	[IN]	Keys of the values.
+ *
+ * \param sizes	[IN]	Sizes of the values.
+ *
+ * \param bufs	[IN]	Values to store.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *			The keys and values must stay valid until completion.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_kv_put_multi(daos_handle_t oh, daos_epoch_t epoch, unsigned int nr,
+		     const char **keys, daos_size_t *sizes, void **bufs,
+		     daos_event_t *ev);
+
+/**
+ * Get a value from a KV object.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the get.
+ *
+ * \param key	[IN]	Key of the value.
+ *
+ * \param size	[IN/OUT]
+ *			Size of \a buf on input, size of the value on output.
+ *			A value that does not exist has a size of 0.
+ *
+ * \param buf	[OUT]	Buffer for the value.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ *			-DER_REC2BIG	Value does not fit in \a buf
+ */
+int
+daos_hl_kv_get(daos_handle_t oh, daos_epoch_t epoch, const char *key,
+	       daos_size_t *size, void *buf, daos_event_t *ev);
+
+/**
+ * Get several values from a KV object. All the keys hashing to the same dkey
+ * are read by a single fetch, and the fetches run concurrently.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the get.
+ *
+ * \param nr	[IN]	Number of values to get.
+ *
+ * \param keys	[IN]	Keys of the values.
+ *
+ * \param sizes	[IN/OUT]
+ *			Sizes of the buffers on input, sizes of the values on
+ *			output.
+ *
+ * \param bufs	[OUT]	Buffers for the values.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_kv_get_multi(daos_handle_t oh, daos_epoch_t epoch, unsigned int nr,
+		     const char **keys, daos_size_t *sizes, void **bufs,
+		     daos_event_t *ev);
+
+/**
+ * Remove a value from a KV object.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the removal.
+ *
+ * \param key	[IN]	Key of the value.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_kv_remove(daos_handle_t oh, daos_epoch_t epoch, const char *key,
+		  daos_event_t *ev);
+
+/** Iterator over the keys of a KV object */
+typedef struct daos_hl_kv_iter daos_hl_kv_iter_t;
+
+/**
+ * Create an iterator over the keys of a KV object.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch to list.
+ *
+ * \param buf_size [IN]	Size of the enumeration buffer. Larger buffers
+ *			return more keys per round trip. Pass 0 for the
+ *			default size.
+ *
+ * \param iter	[OUT]	Returned iterator.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_kv_iter_create(daos_handle_t oh, daos_epoch_t epoch,
+		       daos_size_t buf_size, daos_hl_kv_iter_t **iter);
+
+/**
+ * Retrieve the next batch of keys. A batch may be empty before the end of the
+ * iteration is reached, so iterate until daos_hl_kv_iter_eof() is true.
+ *
+ * \param iter	[IN]	Iterator.
+ *
+ * \param nr	[OUT]	Number of keys in the batch, set on completion.
+ *
+ * \param ev	[IN]	Completion event, it is optional and can be NULL.
+ *			Function will run in blocking mode if \a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_kv_iter_next(daos_hl_kv_iter_t *iter, uint32_t *nr,
+		     daos_event_t *ev);
+
+/**
+ * Return key \a i of the last batch. The key is not NUL terminated and is
+ * only valid until the next call to daos_hl_kv_iter_next().
+ */
+int
+daos_hl_kv_iter_key(daos_hl_kv_iter_t *iter, uint32_t i, char **key,
+		    daos_size_t *len);
+
+/** Return true once all the keys have been returned */
+bool
+daos_hl_kv_iter_eof(daos_hl_kv_iter_t *iter);
+
+/** Destroy an iterator */
+int
+daos_hl_kv_iter_destroy(daos_hl_kv_iter_t *iter);
+
+/**
+ * Byte-stream file over an array object, with POSIX like semantics. Small
+ * writes are coalesced in a buffer, the file size is cached in the handle and
+ * sequential reads are served from a read-ahead buffer. Writes and size
+ * changes become visible to other handles after daos_hl_file_fsync() or
+ * daos_hl_file_close(), or right away with the buffers off (see
+ * daos_hl_file_set_cache()).
+ */
+typedef struct daos_hl_file daos_hl_file_t;
+
+/**
+ * Open a file stored in an array object, creating it if the object is empty.
+ *
+ * \param coh	[IN]	Container open handle.
+ *
+ * \param oid	[IN]	Object ID of the array.
+ *
+ * \param epoch	[IN]	Epoch to access the file at.
+ *
+ * \param flags	[IN]	O_RDONLY or O_RDWR, optionally with O_TRUNC.
+ *
+ * \param file	[OUT]	Returned file handle.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		  int flags, daos_hl_file_t **file);
+
+/**
+ * Flush the buffered writes and the file size, and close the file.
+ *
+ * \param file	[IN]	File handle.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_close(daos_hl_file_t *file);
+
+/**
+ * Read up to \a len bytes at offset \a off. Reads stop at the end of the file.
+ *
+ * \return		Number of bytes read, 0 at the end of the file,
+ *			negative value on failure.
+ */
+ssize_t
+daos_hl_file_pread(daos_hl_file_t *file, void *buf, size_t len, off_t off);
+
+/**
+ * Write \a len bytes at offset \a off, extending the file if needed.
+ *
+ * \return		Number of bytes written, negative value on failure.
+ */
+ssize_t
+daos_hl_file_pwrite(daos_hl_file_t *file, const void *buf, size_t len,
+		    off_t off);
+
+/**
+ * Set the size of the file. The bytes past a smaller size are punched, so they
+ * read back as zeros if the file grows again.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_ftruncate(daos_hl_file_t *file, off_t size);
+
+/**
+ * Return the size of the file and its block size, from the handle cache.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_fstat(daos_hl_file_t *file, struct stat *st);
+
+/**
+ * Write out the buffered writes and the file size.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_fsync(daos_hl_file_t *file);
+
+/**
+ * Turn the write buffer and the read-ahead buffer of the file on or off. With
+ * the buffers off, every write reaches the array before returning, and reads
+ * past the cached size pick up the size written through other handles.
+ * Turning the buffers off writes out the buffered writes first.
+ *
+ * \param file	[IN]	File handle.
+ *
+ * \param enable	[IN]	Use the buffers (the default at open).
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_set_cache(daos_hl_file_t *file, bool enable);
+
+/**
+ * Read a list of ranges of the file in one operation, for callers that
+ * already describe their accesses as ranges (e.g. flattened MPI datatypes).
+ * The ranges are not clipped to the file size.
+ *
+ * \param file	[IN]	File handle.
+ *
+ * \param ranges	[IN]	Ranges to read.
+ *
+ * \param sgl	[IN/OUT]
+ *			Buffers to read into, same rules as
+ *			daos_hl_array_read().
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_read_ranges(daos_hl_file_t *file, daos_hl_array_ranges_t *ranges,
+			 daos_sg_list_t *sgl);
+
+/**
+ * Write a list of ranges of the file in one operation, extending the file if
+ * needed.
+ *
+ * \param file	[IN]	File handle.
+ *
+ * \param ranges	[IN]	Ranges to write.
+ *
+ * \param sgl	[IN]	Buffers to write, same rules as daos_hl_array_write().
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_file_write_ranges(daos_hl_file_t *file,
+			  daos_hl_array_ranges_t *ranges, daos_sg_list_t *sgl);
+
+/**
+ * Ragged array: an array of variable-length elements over one compound array
+ * object. The payloads of the elements are packed back to back in the bytes
+ * of the array, and the end offset of element i in the payload is record i of
+ * the "ragged_end" field. The blocks of end offsets are cached in the handle,
+ * so an access resolves the payload ranges of its elements locally before
+ * moving the payload in a single array I/O, coalesced per dkey.
+ */
+typedef struct daos_hl_ragged daos_hl_ragged_t;
+
+/**
+ * Create an empty ragged array and open it.
+ *
+ * \param coh	[IN]	Container open handle.
+ *
+ * \param oid	[IN]	Object ID.
+ *
+ * \param epoch	[IN]	Epoch to create the array at.
+ *
+ * \param attr	[IN]	Attributes of the array, as daos_hl_array_create().
+ *			da_block_size counts payload bytes per dkey, and end
+ *			offsets per dkey. This is optional (pass NULL for the
+ *			defaults).
+ *
+ * \param ragged	[OUT]	Returned ragged array handle.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_ragged_create(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		      daos_hl_array_attr_t *attr, daos_hl_ragged_t **ragged);
+
+/**
+ * Open mode flag of daos_hl_ragged_open(): take the writer claim even if
+ * another handle holds it, e.g. to recover an array left claimed by a writer
+ * that exited without closing it.
+ */
+#define DAOS_HL_RAGGED_STEAL	(1U << 31)
+
+/**
+ * Open a ragged array created with daos_hl_ragged_create(). The end offsets
+ * are read in the handle cache on open, unless the index is larger than
+ * 16 MiB; its blocks are then read on first access.
+ *
+ * A ragged array has a single writer at a time: the handle of
+ * daos_hl_ragged_create() or of a read-write open claims the array until it
+ * is closed, and a read-write open fails while another handle holds the claim.
+ * A writer that exits without closing the array leaves it claimed, until a
+ * read-write open with DAOS_HL_RAGGED_STEAL takes the claim over. The claim is
+ * detected, not enforced: it is read then written, so two concurrent opens
+ * can both succeed, and the writer whose claim was taken over only finds out
+ * on its next daos_hl_ragged_put(), which fails. Read-only handles see the
+ * elements appended after their open only once reopened.
+ *
+ * \param mode	[IN]	Open mode: DAOS_OO_RO/RW, or DAOS_OO_RW |
+ *			DAOS_HL_RAGGED_STEAL.
+ *
+ * Other parameters as daos_hl_ragged_create().
+ */
+int
+daos_hl_ragged_open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		    unsigned int mode, daos_hl_ragged_t **ragged);
+
+/** Close a ragged array and free its cached index */
+int
+daos_hl_ragged_close(daos_hl_ragged_t *ragged);
+
+/** Return the number of elements of a ragged array */
+int
+daos_hl_ragged_count(daos_hl_ragged_t *ragged, daos_size_t *nr);
+
+/**
+ * Read a batch of element ranges of a ragged array. The payloads of the
+ * elements are packed in \a buf in the order of the ranges.
+ *
+ * \param ragged	[IN]	Ragged array handle.
+ *
+ * \param elems	[IN]	Ranges of elements to read, indexed in elements.
+ *
+ * \param lens	[OUT]	Length of each element read, in the order of the
+ *			ranges. Set even when \a buf is too small, so the
+ *			caller can size it.
+ *
+ * \param buf	[OUT]	Buffer receiving the payloads.
+ *
+ * \param buf_len	[IN]	Size of \a buf.
+ *
+ * \param ev	[IN]	Completion event of the payload read, it is optional
+ *			and can be NULL. The offsets are resolved before the
+ *			call returns. Function will run in blocking mode if
+ *			\a ev is NULL.
+ *
+ * \return		0 on success, negative value on failure or if \a buf
+ *			is too small.
+ */
+int
+daos_hl_ragged_get(daos_hl_ragged_t *ragged, daos_hl_array_ranges_t *elems,
+		   daos_size_t *lens, void *buf, daos_size_t buf_len,
+		   daos_event_t *ev);
+
+/**
+ * Write a batch of element ranges of a ragged array. The ranges are sorted
+ * and do not overlap. A range starts at most at the current number of
+ * elements, elements past it are appended, and existing elements can only be
+ * rewritten with their current length. The payload is written before the new
+ * end offsets and the element count, so other handles never see an element
+ * without its payload. Fails if the handle lost its writer claim, or if the
+ * element count stored differs from the cached one.
+ *
+ * \param ragged	[IN]	Ragged array handle, opened read-write.
+ *
+ * \param elems	[IN]	Ranges of elements to write, indexed in elements.
+ *
+ * \param lens	[IN]	Length of each element, in the order of the ranges.
+ *
+ * \param buf	[IN]	Payloads of the elements, packed in the same order.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_ragged_put(daos_hl_ragged_t *ragged, daos_hl_array_ranges_t *elems,
+		   const daos_size_t *lens, const void *buf);
+
+/**
+ * Set the limits on the payload of one fetch/update RPC of the process. Dkey
+ * I/Os going over them are split into several I/Os on the same dkey that run
+ * concurrently, except that the recx cap does not split the dkey I/Os of
+ * daos_hl_array_gather() and daos_hl_array_scatter(). The limits can also be
+ * set through the DAOS_HL_RPC_MAX_BYTES and DAOS_HL_RPC_MAX_VECS environment
+ * variables.
+ *
+ * \param max_bytes	[IN]	Max number of bytes of one RPC, 0 for the
+ *				default (1 MiB).
+ *
+ * \param max_vecs	[IN]	Max number of recxs, and of memory buffers, of
+ *				one RPC, 0 for the default (256).
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_rpc_limits_set(daos_size_t max_bytes, daos_size_t max_vecs);
+
+/**
+ * Set how the dkey I/Os of an operation are spread over the storage targets.
+ * They are bucketed by a hash of their object and dkey, standing for their
+ * placement, and submitted to the buckets in turn, starting from a different
+ * one in each process, with at most \a target_inflight dkey I/Os of all the
+ * operations of the process in flight on a bucket. Operations already started
+ * keep the settings they were started with. Settings can also come from the
+ * DAOS_HL_IO_TARGETS and DAOS_HL_IO_TARGET_INFLIGHT environment variables. A
+ * single target with 16 I/Os in flight submits the dkey I/Os in array order.
+ *
+ * \param targets	[IN]	Number of buckets, best set to the number of
+ *				targets of the pool, 0 for the default (16).
+ *
+ * \param target_inflight
+ *			[IN]	Max number of dkey I/Os of the process in
+ *				flight on one bucket, 0 for the default (8).
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_io_sched_set(unsigned int targets, unsigned int target_inflight);
+
+/** Attributes of the background progress thread */
+typedef struct {
+	/** CPU to bind the thread to, -1 to leave it unbound */
+	int			dp_cpu;
+	/** Time in us the thread waits in each poll, 0 for the default */
+	int64_t			dp_poll_timeout;
+} daos_hl_progress_attr_t;
+
+/**
+ * Start a background thread driving the completion of the non-blocking
+ * operations of the process, so that their dkey I/Os keep being submitted while
+ * the application does not poll. Completed events are still reaped by the
+ * application from its own event queues.
+ *
+ * Setting DAOS_HL_PROGRESS=1 in the environment starts the thread on the first
+ * non-blocking operation instead, bound to DAOS_HL_PROGRESS_CPU if set, with
+ * a poll timeout of DAOS_HL_PROGRESS_TIMEOUT us if set. A thread started this
+ * way is stopped at exit if it is still running.
+ *
+ * The thread must be stopped before daos_fini(), however it was started.
+ *
+ * \param attr	[IN]	Attributes of the thread. This is optional (pass NULL
+ *			for the defaults).
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_progress_start(daos_hl_progress_attr_t *attr);
+
+/**
+ * Stop the background progress thread, if running.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_progress_stop(void);
+
+/** Levels of the messages of the library, each includes the ones before */
+typedef enum {
+	DAOS_HL_LOG_NONE,
+	DAOS_HL_LOG_ERROR,
+	DAOS_HL_LOG_WARN,
+	DAOS_HL_LOG_INFO,
+	DAOS_HL_LOG_DEBUG,
+} daos_hl_log_level_t;
+
+/**
+ * Set the level of the messages logged by the library. Messages are recorded
+ * in a ring buffer of the thread issuing them, and formatted and written to
+ * stderr, or to the file named by DAOS_HL_LOG_FILE, by a background thread, at
+ * exit, or when the process crashes. The initial level is DAOS_HL_LOG_ERROR,
+ * or the one set by DAOS_HL_LOG_LEVEL in the environment, either a level name
+ * (none, error, warn, info, debug) or number.
+ *
+ * \param level	[IN]	Messages up to this level are logged.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_log_level_set(daos_hl_log_level_t level);
+
+/**
+ * Write out the messages logged so far by all threads.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_log_flush(void);
+
+#if defined(__cplusplus)
+}
+#endif
 
 #endif /* __DAOS_HL_API_H__ */
@@ -0,0 +1,551 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * C++20 interface to the daos_hl arrays, header only.
+ *
+ * Array handles are move-only and close the array when destroyed. Ranges and
+ * Buffers build the range lists and sgls of an access in storage provided by
+ * the caller, so that issuing an access does not allocate.
+ *
+ * The asynchronous accesses return awaitables. A coroutine awaiting one is
+ * suspended until the access completes, and resumed from the thread calling
+ * EventQueue::poll() on the queue the access was submitted to. Any number of
+ * accesses can be in flight this way without a thread per access. Events of
+ * other operations may share the queue: poll() tells them apart from the
+ * accesses and hands them back to the caller.
+ */
+
+#ifndef __DAOS_HL_HPP__
+#define __DAOS_HL_HPP__
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <daos_hl.h>
+
+namespace daos_hl {
+
+/** Failure of a daos_hl call, with the error code it returned */
+class error : public std::runtime_error {
+public:
+	error(const char *what, int rc)
+		: std::runtime_error(std::string(what) + " failed (" +
+				     std::to_string(rc) + ")"), rc_(rc) {}
+
+	int code() const noexcept { return rc_; }
+
+private:
+	int rc_;
+};
+
+namespace detail {
+
+inline void
+check(const char *what, int rc)
+{
+	if (rc != 0)
+		throw error(what, rc);
+}
+
+/**
+ * State of one access in flight. The event comes first so that the events
+ * returned by the event queue can be turned back into their completion, once
+ * found in the list of the accesses in flight on the queue.
+ */
+struct completion {
+	daos_event_t			ev;
+	std::coroutine_handle<>		waiter;
+	int				rc;
+	completion			*prev;
+	completion			*next;
+};
+
+static_assert(std::is_standard_layout_v<completion>);
+
+} /* namespace detail */
+
+/**
+ * Ranges of an array to access, built in caller storage. Adjacent ranges are
+ * merged as they are added.
+ */
+class Ranges {
+public:
+	explicit Ranges(std::span<daos_hl_range_t> storage) noexcept
+		: storage_(storage), bytes_(0)
+	{
+		desc_.ranges_nr = 0;
+		desc_.ranges = storage_.data();
+	}
+
+	/** Add a range. Returns false if the storage is full. */
+	bool
+	add(daos_off_t index, daos_size_t len) noexcept
+	{
+		if (desc_.ranges_nr > 0) {
+			daos_hl_range_t &last = storage_[desc_.ranges_nr - 1];
+
+			if (last.index + last.len == index) {
+				last.len += len;
+				bytes_ += len;
+				return true;
+			}
+		}
+
+		if (desc_.ranges_nr == storage_.size())
+			return false;
+
+		storage_[desc_.ranges_nr].index = index;
+		storage_[desc_.ranges_nr].len = len;
+		desc_.ranges_nr ++;
+		bytes_ += len;
+		return true;
+	}
+
+	void
+	clear() noexcept
+	{
+		desc_.ranges_nr = 0;
+		bytes_ = 0;
+	}
+
+	std::size_t size() const noexcept { return desc_.ranges_nr; }
+	/** Total number of bytes covered by the ranges */
+	daos_size_t bytes() const noexcept { return bytes_; }
+	daos_hl_array_ranges_t *get() noexcept { return &desc_; }
+
+private:
+	std::span<daos_hl_range_t>	storage_;
+	daos_hl_array_ranges_t		desc_;
+	daos_size_t			bytes_;
+};
+
+/**
+ * Memory buffers of an access, built as an sgl in caller storage. Buffers of
+ * const data may only be used for writes.
+ */
+class Buffers {
+public:
+	explicit Buffers(std::span<daos_iov_t> storage) noexcept
+		: storage_(storage), bytes_(0)
+	{
+		desc_.sg_nr.num = 0;
+		desc_.sg_nr.num_out = 0;
+		desc_.sg_iovs = storage_.data();
+	}
+
+	/** Add a buffer. Returns false if the storage is full. */
+	template <typename T, std::size_t E>
+	bool
+	add(std::span<T, E> buf) noexcept
+	{
+		if (desc_.sg_nr.num == storage_.size())
+			return false;
+
+		daos_iov_set(&storage_[desc_.sg_nr.num],
+			     const_cast<void *>(static_cast<const void *>(
+				     buf.data())),
+			     buf.size_bytes());
+		desc_.sg_nr.num ++;
+		bytes_ += buf.size_bytes();
+		return true;
+	}
+
+	void
+	clear() noexcept
+	{
+		desc_.sg_nr.num = 0;
+		desc_.sg_nr.num_out = 0;
+		bytes_ = 0;
+	}
+
+	std::size_t size() const noexcept { return desc_.sg_nr.num; }
+	/** Total number of bytes of the buffers */
+	daos_size_t bytes() const noexcept { return bytes_; }
+	daos_sg_list_t *get() noexcept { return &desc_; }
+
+private:
+	std::span<daos_iov_t>	storage_;
+	daos_sg_list_t		desc_;
+	daos_size_t		bytes_;
+};
+
+class Access;
+
+/**
+ * Event queue completing the asynchronous accesses. It keeps the list of the
+ * accesses in flight on it, so that it must not be moved while some are.
+ */
+class EventQueue {
+public:
+	EventQueue() : inflight_(nullptr)
+	{
+		detail::check("daos_eq_create", daos_eq_create(&eqh_));
+	}
+
+	~EventQueue()
+	{
+		if (!daos_handle_is_inval(eqh_))
+			daos_eq_destroy(eqh_, 0);
+	}
+
+	EventQueue(EventQueue &&other) noexcept
+		: eqh_(std::exchange(other.eqh_, daos_handle_t{})),
+		  inflight_(nullptr) {}
+
+	EventQueue &
+	operator=(EventQueue &&other) noexcept
+	{
+		if (this != &other) {
+			if (!daos_handle_is_inval(eqh_))
+				daos_eq_destroy(eqh_, 0);
+			eqh_ = std::exchange(other.eqh_, daos_handle_t{});
+		}
+		return *this;
+	}
+
+	EventQueue(const EventQueue &) = delete;
+	EventQueue &operator=(const EventQueue &) = delete;
+
+	/**
+	 * Resume the coroutines whose accesses completed, waiting up to
+	 * \a timeout microseconds for the first one (DAOS_EQ_WAIT to block,
+	 * DAOS_EQ_NOWAIT to return right away). Returns the number of
+	 * coroutines resumed. Completed events that are not accesses are
+	 * dropped, use the other overload to get them back.
+	 */
+	std::size_t
+	poll(int64_t timeout = DAOS_EQ_NOWAIT)
+	{
+		std::size_t nraw;
+
+		return poll(timeout, std::span<daos_event_t *>(), nraw);
+	}
+
+	/**
+	 * Same as poll() above, but the completed events that are not
+	 * accesses are stored in \a raw, and their number in \a nraw. No more
+	 * than raw.size() events are reaped, so none is lost.
+	 */
+	std::size_t
+	poll(int64_t timeout, std::span<daos_event_t *> raw, std::size_t &nraw)
+	{
+		daos_event_t	*evs[POLL_BATCH];
+		unsigned int	batch = POLL_BATCH;
+		std::size_t	resumed = 0;
+		int		n;
+
+		if (!raw.empty())
+			batch = std::min<std::size_t>(batch, raw.size());
+
+		nraw = 0;
+		n = daos_eq_poll(eqh_, 0, timeout, batch, evs);
+		if (n < 0)
+			throw error("daos_eq_poll", n);
+
+		for (int i = 0; i < n; i++) {
+			detail::completion *comp = untrack(evs[i]);
+
+			if (comp == nullptr) {
+				if (!raw.empty())
+					raw[nraw++] = evs[i];
+				continue;
+			}
+
+			comp->rc = comp->ev.ev_error;
+			daos_event_fini(&comp->ev);
+			comp->waiter.resume();
+			resumed ++;
+		}
+
+		return resumed;
+	}
+
+	daos_handle_t handle() const noexcept { return eqh_; }
+
+private:
+	friend class Access;
+
+	void
+	track(detail::completion *comp)
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+
+		comp->prev = nullptr;
+		comp->next = inflight_;
+		if (inflight_ != nullptr)
+			inflight_->prev = comp;
+		inflight_ = comp;
+	}
+
+	void
+	forget(detail::completion *comp)
+	{
+		if (comp->prev != nullptr)
+			comp->prev->next = comp->next;
+		else
+			inflight_ = comp->next;
+		if (comp->next != nullptr)
+			comp->next->prev = comp->prev;
+	}
+
+	/** Remove the access of a completed event, nullptr if it is none */
+	detail::completion *
+	untrack(daos_event_t *ev)
+	{
+		std::lock_guard<std::mutex>	guard(lock_);
+		detail::completion		*comp;
+
+		for (comp = inflight_; comp != nullptr; comp = comp->next)
+			if (&comp->ev == ev)
+				break;
+		if (comp != nullptr)
+			forget(comp);
+
+		return comp;
+	}
+
+	/** An access that failed to launch never completes */
+	void
+	untrack(detail::completion *comp)
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+
+		forget(comp);
+	}
+
+	static constexpr unsigned int	POLL_BATCH = 64;
+
+	daos_handle_t			eqh_;
+	std::mutex			lock_;
+	/** accesses in flight on the queue */
+	detail::completion		*inflight_;
+};
+
+/**
+ * Awaitable access to an array. The access is submitted when the awaiting
+ * coroutine suspends, and co_await returns the number of bytes accessed or
+ * throws daos_hl::error. The ranges and buffers storage must stay valid until
+ * then.
+ */
+class Access {
+public:
+	Access(EventQueue &eq, daos_handle_t oh, daos_epoch_t epoch,
+	       bool write, Ranges &ranges, Buffers &buffers) noexcept
+		: eq_(eq), oh_(oh), epoch_(epoch), write_(write),
+		  ranges_(*ranges.get()), sgl_(*buffers.get()),
+		  bytes_(ranges.bytes()) {}
+
+	/** the event is in flight at the address of the access */
+	Access(const Access &) = delete;
+	Access &operator=(const Access &) = delete;
+
+	bool await_ready() const noexcept { return false; }
+
+	bool
+	await_suspend(std::coroutine_handle<> waiter) noexcept
+	{
+		int rc;
+
+		comp_.waiter = waiter;
+		comp_.rc = 0;
+
+		rc = daos_event_init(&comp_.ev, eq_.handle(), nullptr);
+		if (rc != 0) {
+			comp_.rc = rc;
+			return false;
+		}
+
+		/** the access may complete before the call returns */
+		eq_.track(&comp_);
+		if (write_)
+			rc = daos_hl_array_write(oh_, epoch_, &ranges_, &sgl_,
+						 nullptr, &comp_.ev);
+		else
+			rc = daos_hl_array_read(oh_, epoch_, &ranges_, &sgl_,
+						nullptr, &comp_.ev);
+		if (rc != 0) {
+			/** nothing was launched, the event never completes */
+			eq_.untrack(&comp_);
+			daos_event_fini(&comp_.ev);
+			comp_.rc = rc;
+			return false;
+		}
+
+		return true;
+	}
+
+	daos_size_t
+	await_resume() const
+	{
+		detail::check(write_ ? "daos_hl_array_write" :
+			      "daos_hl_array_read", comp_.rc);
+		return bytes_;
+	}
+
+private:
+	detail::completion	comp_;
+	EventQueue		&eq_;
+	daos_handle_t		oh_;
+	daos_epoch_t		epoch_;
+	bool			write_;
+	daos_hl_array_ranges_t	ranges_;
+	daos_sg_list_t		sgl_;
+	daos_size_t		bytes_;
+};
+
+/** Open array object, closed when the handle is destroyed */
+class Array {
+public:
+	Array() noexcept : oh_{} {}
+
+	static Array
+	create(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+	       daos_hl_array_attr_t *attr = nullptr)
+	{
+		Array array;
+
+		detail::check("daos_hl_array_create",
+			      daos_hl_array_create(coh, oid, epoch, attr,
+						   &array.oh_));
+		return array;
+	}
+
+	static Array
+	open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+	     unsigned int mode, daos_hl_array_attr_t *attr = nullptr)
+	{
+		Array array;
+
+		detail::check("daos_hl_array_open",
+			      daos_hl_array_open(coh, oid, epoch, mode, attr,
+						 &array.oh_));
+		return array;
+	}
+
+	~Array()
+	{
+		if (!daos_handle_is_inval(oh_))
+			daos_hl_array_close(oh_);
+	}
+
+	Array(Array &&other) noexcept
+		: oh_(std::exchange(other.oh_, daos_handle_t{})) {}
+
+	Array &
+	operator=(Array &&other) noexcept
+	{
+		if (this != &other) {
+			if (!daos_handle_is_inval(oh_))
+				daos_hl_array_close(oh_);
+			oh_ = std::exchange(other.oh_, daos_handle_t{});
+		}
+		return *this;
+	}
+
+	Array(const Array &) = delete;
+	Array &operator=(const Array &) = delete;
+
+	explicit operator bool() const noexcept
+	{
+		return !daos_handle_is_inval(oh_);
+	}
+
+	daos_handle_t handle() const noexcept { return oh_; }
+
+	/** Close the array, reporting the error the destructor would drop */
+	void
+	close()
+	{
+		daos_handle_t oh = std::exchange(oh_, daos_handle_t{});
+
+		detail::check("daos_hl_array_close", daos_hl_array_close(oh));
+	}
+
+	daos_size_t
+	read(daos_epoch_t epoch, Ranges &ranges, Buffers &buffers)
+	{
+		detail::check("daos_hl_array_read",
+			      daos_hl_array_read(oh_, epoch, ranges.get(),
+						 buffers.get(), nullptr,
+						 nullptr));
+		return ranges.bytes();
+	}
+
+	daos_size_t
+	write(daos_epoch_t epoch, Ranges &ranges, Buffers &buffers)
+	{
+		detail::check("daos_hl_array_write",
+			      daos_hl_array_write(oh_, epoch, ranges.get(),
+						  buffers.get(), nullptr,
+						  nullptr));
+		return ranges.bytes();
+	}
+
+	Access
+	async_read(EventQueue &eq, daos_epoch_t epoch, Ranges &ranges,
+		   Buffers &buffers) noexcept
+	{
+		return Access(eq, oh_, epoch, false, ranges, buffers);
+	}
+
+	Access
+	async_write(EventQueue &eq, daos_epoch_t epoch, Ranges &ranges,
+		    Buffers &buffers) noexcept
+	{
+		return Access(eq, oh_, epoch, true, ranges, buffers);
+	}
+
+	daos_size_t
+	size(daos_epoch_t epoch) const
+	{
+		daos_size_t size;
+
+		detail::check("daos_hl_array_get_size",
+			      daos_hl_array_get_size(oh_, epoch, &size,
+						     nullptr));
+		return size;
+	}
+
+	void
+	resize(daos_epoch_t epoch, daos_size_t size)
+	{
+		detail::check("daos_hl_array_set_size",
+			      daos_hl_array_set_size(oh_, epoch, size,
+						     nullptr));
+	}
+
+private:
+	daos_handle_t	oh_;
+};
+
+} /* namespace daos_hl */
+
+#endif /* __DAOS_HL_HPP__ */
@@ -0,0 +1,114 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * Internal array services shared with the modules built on top of arrays.
+ */
+
+#ifndef __DAOS_HL_ARRAY_H__
+#define __DAOS_HL_ARRAY_H__
+
+#include <daos_hl.h>
+#include <daos_hl/io.h>
+#include <daos_hl/layout.h>
+
+/** akey under the metadata dkey holding the end of the appended data */
+#define DAOS_HL_MD_APPEND_AKEY		"append_end"
+
+/**
+ * Read or write a metadata value stored as a byte extent under an akey of the
+ * metadata dkey of an array. Values that were never written read back as
+ * zeros.
+ */
+int
+array_md_access(daos_handle_t oh, daos_epoch_t epoch, const char *akey,
+		void *buf, daos_size_t size, daos_hl_op_type_t op_type);
+
+/**
+ * Add to a write request the update raising the size mark of the handle to the
+ * end of the ranges written, if they go past it. Does nothing for handles not
+ * opened with daos_hl_array_open/create.
+ */
+int
+array_size_mark(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+		daos_hl_array_ranges_t *ranges);
+
+/**
+ * Punch the records of the array in [off, off + len), with one zero size
+ * update per dkey covered. The punched records read back as holes. Blocking.
+ */
+int
+array_punch(daos_handle_t oh, daos_epoch_t epoch, daos_off_t off,
+	    daos_size_t len);
+
+/** Fields of a compound array, as stored in its metadata */
+typedef struct {
+	uint32_t	nr;
+	uint32_t	pad;
+	daos_hl_field_t	fields[DAOS_HL_FIELDS_MAX];
+} array_fields;
+
+/** Size of the elements of a DAOS_HL_TYPE_* type, 0 for untyped arrays */
+daos_size_t
+array_type_size(uint32_t type);
+
+/** DAOS_HL_TYPE_* type of the elements of an array opened through oh */
+uint32_t
+array_type_get(daos_handle_t oh);
+
+/**
+ * Attributes of an array opened through oh, -1 if it was not opened with
+ * daos_hl_array_open/create.
+ */
+int
+array_attr_get(daos_handle_t oh, daos_hl_array_attr_t *attr);
+
+/** Layout used to access an array through oh */
+const array_layout *
+array_layout_get(daos_handle_t oh);
+
+/**
+ * Whether any block of [index, index + len) may hold data, according to the
+ * presence map of the array. Arrays opened without DAOS_HL_ARRAY_BITMAP may
+ * hold data anywhere.
+ */
+bool
+array_present(daos_handle_t oh, daos_off_t index, daos_size_t len);
+
+/**
+ * Fields of the records of an array opened through oh, NULL if it was not
+ * created with daos_hl_array_create_fields().
+ */
+const array_fields *
+array_fields_get(daos_handle_t oh);
+
+#ifdef DAOS_HL_MPI
+/**
+ * Reserve len bytes at the end of the data appended through an append context
+ * and return the offset of the reservation.
+ */
+int
+append_ctx_reserve(daos_hl_append_ctx_t *ctx, daos_handle_t oh,
+		   daos_epoch_t epoch, uint64_t len, uint64_t *offset);
+#endif
+
+#endif /* __DAOS_HL_ARRAY_H__ */
@@ -27,19 +27,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define DHL_ERROR(fmt, ...)						\
+/** Current level of the log, see daos_hl_log_level_set */
+extern int dhl_log_level;
+
+void
+dhl_log(int level, const char *file, int line, const char *func,
+	const char *fmt, ...) __attribute__((format(printf, 5, 6)));
+
+/** Whether messages of \a level are logged, to guard costly debug code */
+#define DHL_LOG_ENABLED(level)						\
+	__builtin_expect((level) <= dhl_log_level, 0)
+
+/** Arguments are only evaluated when \a level is logged */
+#define DHL_LOG(level, fmt, ...)					\
 do {									\
-	fprintf(stderr, "%s:%d:%d:%s() " fmt, __FILE__, getpid(),	\
-		__LINE__, __func__, ## __VA_ARGS__);			\
-	fflush(stderr);							\
+	if (DHL_LOG_ENABLED(level))					\
+		dhl_log(level, __FILE__, __LINE__, __func__, fmt,	\
+			## __VA_ARGS__);				\
 } while (0)
 
+#define DHL_ERROR(fmt, ...)	DHL_LOG(DAOS_HL_LOG_ERROR, fmt, ## __VA_ARGS__)
+#define DHL_WARN(fmt, ...)	DHL_LOG(DAOS_HL_LOG_WARN, fmt, ## __VA_ARGS__)
+#define DHL_INFO(fmt, ...)	DHL_LOG(DAOS_HL_LOG_INFO, fmt, ## __VA_ARGS__)
+#define DHL_DEBUG(fmt, ...)	DHL_LOG(DAOS_HL_LOG_DEBUG, fmt, ## __VA_ARGS__)
+
 #define DHL_ASSERT(e)	assert(e)
 
 #define DHL_ASSERTF(cond, fmt, ...)					\
 do {									\
-	if (!(cond))							\
+	if (!(cond)) {							\
 		DHL_ERROR(fmt, ## __VA_ARGS__);				\
+		daos_hl_log_flush();					\
+	}								\
 	assert(cond);							\
 } while (0)
 
@@ -0,0 +1,303 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * Internal dkey I/O engine shared by the daos_hl object modules.
+ */
+
+#ifndef __DAOS_HL_IO_H__
+#define __DAOS_HL_IO_H__
+
+#include <daos_hl.h>
+
+/** MSC - This needs to be configurable later through hints */
+/** Max number of dkey I/Os of one operation in flight at a time */
+#define DAOS_HL_IO_WINDOW		16
+/** Default max number of bytes moved by one fetch/update RPC */
+#define DAOS_HL_RPC_MAX_BYTES		(1 << 20)
+/** Default max number of recxs, and of sgl iovs, of one fetch/update RPC */
+#define DAOS_HL_RPC_MAX_VECS		256
+/** Max number of times a dkey I/O failing with a transient error is reissued */
+#define DAOS_HL_IO_RETRY_MAX		8
+/** Backoff in us before the first retry of a dkey I/O, doubled every retry */
+#define DAOS_HL_IO_RETRY_BASE		10000
+/** Cap on the backoff in us between two retries of a dkey I/O */
+#define DAOS_HL_IO_RETRY_CAP		1000000
+/** Default number of placement targets the dkey I/Os are spread over */
+#define DAOS_HL_IO_TARGETS		16
+/** Default max number of dkey I/Os of the process in flight on a target */
+#define DAOS_HL_IO_TARGET_INFLIGHT	8
+/** Max number of dkey I/Os of one operation queued for submission */
+#define DAOS_HL_IO_LOOKAHEAD		(4 * DAOS_HL_IO_WINDOW)
+
+typedef enum {
+	DAOS_HL_OP_WRITE,
+	DAOS_HL_OP_READ,
+} daos_hl_op_type_t;
+
+struct _io_req;
+struct _io_params;
+
+/**
+ * Hook run when a dkey I/O completes, before its buffers are released. The
+ * return value overrides the status of the dkey I/O.
+ */
+typedef int (*io_comp_cb_t)(struct _io_params *params, int rc);
+
+/**
+ * Planner of a streamed request, run when the in-flight window has room and
+ * every dkey I/O planned so far was submitted. It adds the next dkey I/Os to
+ * the request, and sets *done once there is nothing left to plan.
+ */
+typedef int (*io_plan_cb_t)(struct _io_req *req, void *arg, bool *done);
+
+/** One fetch/update on a single dkey, possibly spanning several akeys */
+typedef struct _io_params{
+	daos_hl_op_type_t	op_type;
+	daos_handle_t		oh;
+	daos_epoch_t		epoch;
+	daos_key_t		dkey;
+	char			*dkey_str;
+	char			*akey_str;
+	/** number of akeys accessed under the dkey */
+	unsigned int		iod_nr;
+	/** descriptors of the akeys, point to iod/sgl for a single akey */
+	daos_vec_iod_t		*iods;
+	daos_sg_list_t		*sgls;
+	daos_vec_iod_t		iod;
+	daos_sg_list_t		sgl;
+	/** sgl is borrowed from the user and must not be freed */
+	bool			user_sgl_used;
+	/** iod recxs and sgl iovs live in priv and are not freed one by one */
+	bool			priv_desc;
+	bool			submitted;
+	/** completed, can be freed before the end of a streamed request */
+	bool			done;
+	/** moves no user data, not counted in the bytes of the request */
+	bool			uncounted;
+	io_comp_cb_t		comp_cb;
+	void			*comp_arg;
+	/** private buffer of the module, freed with the dkey I/O */
+	void			*priv;
+	/**
+	 * Array ranges covered by each recx of the first iod, reported to the
+	 * user if the I/O fails for good. Optional, freed with the dkey I/O.
+	 */
+	daos_hl_range_t		*ranges;
+	/** events of the last two attempts, a retry uses the other one */
+	daos_event_t		events[2];
+	unsigned int		ev_cur;
+	/** bit i set if events[i] is initialized */
+	unsigned int		ev_inited;
+	/** number of times the dkey I/O was reissued */
+	unsigned int		retries;
+	/** time in us from which a dkey I/O waiting for a retry is reissued */
+	uint64_t		retry_at;
+	struct _io_params	*retry_next;
+	/** placement target of the dkey, and next I/O queued on it */
+	unsigned int		target;
+	struct _io_params	*sched_next;
+	struct _io_req		*req;
+	struct _io_params	*next;
+} io_params;
+
+/** Dkey I/Os of an operation queued for one target */
+typedef struct {
+	io_params		*head;
+	io_params		*tail;
+} io_target;
+
+/**
+ * Targets of the process and their in-flight limit, shared by the requests
+ * launched while it is the current table. Replaced by daos_hl_io_sched_set(),
+ * freed once the last request using it is freed. Under the engine lock.
+ */
+typedef struct {
+	unsigned int		refs;
+	unsigned int		target_nr;
+	unsigned int		target_max;
+	/** dkey I/Os of all the requests in flight on each target */
+	unsigned int		*inflight;
+	/** test hook: highest number of dkey I/Os seen in flight on a target */
+	unsigned int		peak;
+} io_sched;
+
+/**
+ * State of one operation, possibly spanning several objects. All the dkey I/Os
+ * of the operation are children of a single parent event: the user event in
+ * non-blocking mode, or an internal event on a private event queue in blocking
+ * mode.
+ */
+typedef struct _io_req {
+	daos_hl_op_type_t	op_type;
+	daos_event_t		*ev;
+	char			*akey;
+	io_params		*head;
+	io_params		*tail;
+	/** next dkey I/O to submit */
+	io_params		*next_io;
+	daos_size_t		num_ios;
+	/** number of successful submissions, including retries */
+	daos_size_t		num_submitted;
+	daos_size_t		num_inflight;
+	/** first error seen while submitting or completing dkey I/Os */
+	int			status;
+	bool			launched;
+	/** planner of a streamed request, NULL if planned up front */
+	io_plan_cb_t		plan_cb;
+	/** private state of the planner, freed with the request */
+	void			*plan_arg;
+	bool			planned;
+	/**
+	 * the recx and iov cap of the RPCs does not split the extents of a
+	 * dkey over several dkey I/Os
+	 */
+	bool			whole_dkeys;
+	/**
+	 * dkey I/O that completed last, kept from being reaped while DAOS
+	 * finishes its event; cleared when the request is freed
+	 */
+	io_params		*completing;
+	/** user callback run once the whole operation completed */
+	daos_hl_comp_cb_t	user_cb;
+	void			*user_cb_arg;
+	/** bytes moved by the dkey I/Os that completed successfully */
+	daos_size_t		bytes;
+	/** dkey I/Os waiting for their backoff to expire */
+	io_params		*retry_head;
+	/**
+	 * parked on the retry timer, with nothing in flight, until the first
+	 * retry is due at timer_at
+	 */
+	bool			timer_queued;
+	uint64_t		timer_at;
+	struct _io_req		*timer_next;
+	/** ranges of the dkey I/Os that failed for good */
+	daos_hl_array_ranges_t	failed;
+	daos_size_t		failed_cap;
+	/**
+	 * dkey I/Os taken from next_io, queued per target and submitted to
+	 * the targets in turn, up to the in-flight limit of the process on
+	 * each, with one queue per target of sched
+	 */
+	io_sched		*sched;
+	io_target		*targets;
+	/** next target to submit to */
+	unsigned int		target_cursor;
+	daos_size_t		num_queued;
+	/**
+	 * parked on the retry timer, with nothing in flight, until another
+	 * request frees a slot on a target at its limit
+	 */
+	bool			sched_blocked;
+} io_req;
+
+/** Allocate an empty request */
+io_req *
+io_req_create(daos_hl_op_type_t op_type);
+
+/**
+ * Add a dkey I/O on a single akey to the request. The caller fills in the
+ * dkey, the iod and the sgl. The I/O has the operation type of the request
+ * unless the caller changes it.
+ */
+io_params *
+io_req_add(io_req *req, daos_handle_t oh, daos_epoch_t epoch);
+
+/**
+ * Make the request streamed: dkey I/Os are planned by \a plan_cb as the window
+ * drains instead of up front, and completed ones are freed along the way, so
+ * the memory used stays bounded. plan_arg is freed with the request.
+ */
+void
+io_req_set_planner(io_req *req, io_plan_cb_t plan_cb, void *plan_arg);
+
+/**
+ * Run \a cb with the status of the request, the number of bytes moved and the
+ * ranges that failed when its last dkey I/O completes, before the parent event
+ * is completed, or right away if the request has nothing to access. The
+ * callback runs without the engine lock held, and is not run if
+ * io_req_launch() fails.
+ */
+void
+io_req_set_comp_cb(io_req *req, daos_hl_comp_cb_t cb, void *cb_arg);
+
+/**
+ * Lock serializing the engine with its completion callbacks, which may run
+ * from the progress thread.
+ */
+void
+io_engine_lock(void);
+
+void
+io_engine_unlock(void);
+
+/**
+ * Limits on the payload of one fetch/update RPC, set by
+ * daos_hl_rpc_limits_set() or the DAOS_HL_RPC_MAX_BYTES and
+ * DAOS_HL_RPC_MAX_VECS environment variables.
+ */
+void
+io_rpc_limits(daos_size_t *max_bytes, daos_size_t *max_vecs);
+
+/**
+ * Start the background progress thread on the first non-blocking operation
+ * if the DAOS_HL_PROGRESS environment variable asks for it.
+ */
+void
+io_progress_auto_start(void);
+
+/**
+ * Test hook: fail the next \a nr dkey I/O submissions of the process with
+ * \a rc, before they reach DAOS.
+ */
+void
+io_test_fault_set(int rc, unsigned int nr);
+
+/**
+ * Test hook: record the targets of the next \a nr dkey I/O submissions of the
+ * process in \a targets, and reset the peak of the current target table. A
+ * NULL \a targets stops the recording.
+ */
+void
+io_test_sched_record(unsigned int *targets, unsigned int nr);
+
+/**
+ * Test hook: number of submissions recorded so far, and highest number of
+ * dkey I/Os of the process seen in flight on one target of the current table.
+ */
+void
+io_test_sched_stats(unsigned int *recorded, unsigned int *peak);
+
+/** Free a request that was not launched */
+void
+io_req_free(io_req *req);
+
+/**
+ * Submit the dkey I/Os of a request, through \a ev or in blocking mode if \a ev
+ * is NULL. The request is owned by the parent event from here on, or freed if
+ * nothing could be submitted.
+ */
+int
+io_req_launch(io_req *req, daos_event_t *ev);
+
+#endif /* __DAOS_HL_IO_H__ */
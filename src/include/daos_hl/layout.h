@@ -0,0 +1,86 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * Internal array layout policies mapping array bytes to dkeys.
+ */
+
+#ifndef __DAOS_HL_LAYOUT_H__
+#define __DAOS_HL_LAYOUT_H__
+
+#include <daos_hl.h>
+
+/** Array cell size - curently a byte array i.e. 1 byte */
+#define DAOS_HL_CELL_SIZE		1
+/** Default number of bytes in a block */
+#define DAOS_HL_DKEY_BLOCK_SIZE		16//1048576
+/** Default number of blocks of a dkey in each group */
+#define DAOS_HL_DKEY_NUM_BLOCKS		3
+/** Default number of dkeys in a group */
+#define DAOS_HL_DKEY_NUM		4
+
+typedef struct _array_layout array_layout;
+
+typedef struct {
+	/**
+	 * Split an access starting at array index array_i: return the dkey
+	 * holding it as the (hi, lo) pair of the "hi_lo" dkey name, the record
+	 * index in that dkey, and the number of records contiguous in the dkey
+	 * from there.
+	 */
+	void	(*lo_split)(const array_layout *layout, daos_off_t array_i,
+			    uint32_t *hi, uint32_t *lo, daos_off_t *record_i,
+			    daos_size_t *num_records);
+} array_layout_ops;
+
+struct _array_layout {
+	const array_layout_ops	*ops;
+	/** bytes in a block */
+	daos_size_t		block_size;
+	/** dkeys in a group */
+	daos_size_t		dkey_nr;
+	/** blocks of a dkey in each group */
+	daos_size_t		dkey_blocks;
+	/** blocks in a group, dkey group hi holds blocks [hi, hi + 1) * this */
+	daos_size_t		grp_blocks;
+};
+
+/** Layout of the arrays not opened through daos_hl_array_open/create */
+extern const array_layout array_layout_default;
+
+/**
+ * Set the layout parameters of attr left to 0 to the defaults, check them
+ * and initialize the layout they describe.
+ */
+int
+array_layout_init(daos_hl_array_attr_t *attr, array_layout *layout);
+
+/**
+ * Split an access at array index array_i following the layout. The dkey
+ * name is returned in dkey_str if it is not NULL and must be freed.
+ */
+int
+array_layout_split(const array_layout *layout, daos_off_t array_i,
+		   uint32_t *hi, uint32_t *lo, daos_off_t *record_i,
+		   daos_size_t *num_records, char **dkey_str);
+
+#endif /* __DAOS_HL_LAYOUT_H__ */
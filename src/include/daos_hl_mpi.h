@@ -0,0 +1,148 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * DAOS High Level APIs taking MPI communicators, available if daos_hl was
+ * built with the DAOS_HL_MPI option.
+ */
+
+#ifndef __DAOS_HL_MPI_H__
+#define __DAOS_HL_MPI_H__
+
+#include <mpi.h>
+#include <daos_hl.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Dump a range of an array object to local files. Collective over comm.
+ *
+ * Each process writes a contiguous share of the range to its own file: path
+ * itself if comm has a single process, path.<rank> otherwise. A file is a
+ * stream of chunked records, each with a CRC-32C, and runs of zero bytes are
+ * recorded as holes that take no space. The array I/Os of the next chunks run
+ * while a thread writes the file. If the array was created with
+ * DAOS_HL_ARRAY_BITMAP, the chunks it never wrote are not fetched. The
+ * attributes of an array opened with daos_hl_array_open/create are stored in
+ * the files, for daos_hl_array_load_create(). Compound arrays can not be
+ * dumped.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch to read the array at.
+ *
+ * \param range	[IN]	Range to dump, the same on all the processes. NULL
+ *			dumps the array up to its size, and needs a handle
+ *			of daos_hl_array_open/create.
+ *
+ * \param comm	[IN]	Communicator of the processes sharing the dump.
+ *
+ * \param path	[IN]	Path of the dump, on a file system local to each
+ *			process or shared.
+ *
+ * \return		0 on success, negative value on failure of any process.
+ */
+int
+daos_hl_array_dump(daos_handle_t oh, daos_epoch_t epoch,
+		   daos_hl_range_t *range, MPI_Comm comm, const char *path);
+
+/**
+ * Load a dump made by daos_hl_array_dump() into an array object, at the same
+ * ranges. Collective over comm, whose size does not have to match the number
+ * of files of the dump: process i loads files i, i + size, ... Holes are not
+ * written, except the last cell of a hole that ends the dumped range, so that
+ * the array size is restored. All the checksums are verified.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch to write the array at.
+ *
+ * \param comm	[IN]	Communicator of the processes sharing the load.
+ *
+ * \param path	[IN]	Path of the dump, as given to daos_hl_array_dump().
+ *
+ * \return		0 on success, negative value on failure of any process.
+ */
+int
+daos_hl_array_load(daos_handle_t oh, daos_epoch_t epoch, MPI_Comm comm,
+		   const char *path);
+
+/**
+ * Create an array with the attributes stored in a dump, open it and load the
+ * dump into it, as daos_hl_array_load(). Collective over comm: rank 0 creates
+ * the array and the other processes open it.
+ *
+ * \param coh	[IN]	Container open handle.
+ *
+ * \param oid	[IN]	Object ID of the array to create.
+ *
+ * \param epoch	[IN]	Epoch to create and write the array at.
+ *
+ * \param comm	[IN]	Communicator of the processes sharing the load.
+ *
+ * \param path	[IN]	Path of the dump, made from a handle of
+ *			daos_hl_array_open/create.
+ *
+ * \param oh	[OUT]	Open handle of the array, on success only.
+ *
+ * \return		0 on success, negative value on failure of any process.
+ */
+int
+daos_hl_array_load_create(daos_handle_t coh, daos_obj_id_t oid,
+			  daos_epoch_t epoch, MPI_Comm comm, const char *path,
+			  daos_handle_t *oh);
+
+/**
+ * Create an append context. Collective over \a comm.
+ *
+ * \param oh	[IN]	Object open handle.
+ *
+ * \param epoch	[IN]	Epoch for the appends made through the context.
+ *
+ * \param comm	[IN]	Communicator of the appending processes.
+ *
+ * \param ctx	[OUT]	Returned append context.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_append_ctx_create(daos_handle_t oh, daos_epoch_t epoch,
+				MPI_Comm comm, daos_hl_append_ctx_t **ctx);
+
+/**
+ * Destroy an append context and persist the end of the appended data in the
+ * array metadata. Collective over the context communicator.
+ *
+ * \param ctx	[IN]	Append context.
+ *
+ * \return		0 on success, negative value on failure.
+ */
+int
+daos_hl_array_append_ctx_destroy(daos_hl_append_ctx_t *ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __DAOS_HL_MPI_H__ */
@@ -0,0 +1,1333 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/io.c
+ */
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/io.h>
+
+/**
+ * Serializes the engine callbacks with the submissions, since completions can
+ * be driven by the progress thread while the application submits or polls.
+ * Recursive because completions may run inline from a submission.
+ */
+static pthread_mutex_t io_engine_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void
+io_engine_lock(void)
+{
+	pthread_mutex_lock(&io_engine_mutex);
+}
+
+void
+io_engine_unlock(void)
+{
+	pthread_mutex_unlock(&io_engine_mutex);
+}
+
+static pthread_once_t	rpc_limits_once = PTHREAD_ONCE_INIT;
+static daos_size_t	rpc_max_bytes = DAOS_HL_RPC_MAX_BYTES;
+static daos_size_t	rpc_max_vecs = DAOS_HL_RPC_MAX_VECS;
+
+static void
+rpc_limits_env(void)
+{
+	char		*val;
+	daos_size_t	n;
+
+	val = getenv("DAOS_HL_RPC_MAX_BYTES");
+	if (val && sscanf(val, "%zu", &n) == 1 && n != 0)
+		rpc_max_bytes = n;
+
+	val = getenv("DAOS_HL_RPC_MAX_VECS");
+	if (val && sscanf(val, "%zu", &n) == 1 && n != 0)
+		rpc_max_vecs = n;
+}
+
+int
+daos_hl_rpc_limits_set(daos_size_t max_bytes, daos_size_t max_vecs)
+{
+	pthread_once(&rpc_limits_once, rpc_limits_env);
+
+	rpc_max_bytes = (max_bytes == 0) ? DAOS_HL_RPC_MAX_BYTES : max_bytes;
+	rpc_max_vecs = (max_vecs == 0) ? DAOS_HL_RPC_MAX_VECS : max_vecs;
+
+	return 0;
+}
+
+void
+io_rpc_limits(daos_size_t *max_bytes, daos_size_t *max_vecs)
+{
+	pthread_once(&rpc_limits_once, rpc_limits_env);
+
+	*max_bytes = rpc_max_bytes;
+	*max_vecs = rpc_max_vecs;
+}
+
+static pthread_once_t	io_sched_once = PTHREAD_ONCE_INIT;
+static unsigned int	io_targets = DAOS_HL_IO_TARGETS;
+static unsigned int	io_target_inflight = DAOS_HL_IO_TARGET_INFLIGHT;
+static unsigned int	io_sched_seq;
+/** target table of the new requests, built on first use, and its users */
+static io_sched		*io_sched_cur;
+/** number of requests parked until a target frees a slot */
+static unsigned int	io_sched_blocked;
+
+/** Test hook: targets of the next io_rec_nr submissions */
+static unsigned int	*io_rec_targets;
+static unsigned int	io_rec_nr;
+static unsigned int	io_rec_cnt;
+
+static void
+io_sched_env(void)
+{
+	char		*val;
+	unsigned int	n;
+
+	val = getenv("DAOS_HL_IO_TARGETS");
+	if (val && sscanf(val, "%u", &n) == 1 && n != 0)
+		io_targets = n;
+
+	val = getenv("DAOS_HL_IO_TARGET_INFLIGHT");
+	if (val && sscanf(val, "%u", &n) == 1 && n != 0)
+		io_target_inflight = n;
+}
+
+static io_sched *
+io_sched_alloc(unsigned int targets, unsigned int target_inflight)
+{
+	io_sched *sched;
+
+	sched = (io_sched *)calloc(1, sizeof(io_sched));
+	if (NULL == sched)
+		return NULL;
+
+	sched->inflight = (unsigned int *)calloc(targets,
+						 sizeof(unsigned int));
+	if (NULL == sched->inflight) {
+		free(sched);
+		return NULL;
+	}
+	sched->refs = 1;
+	sched->target_nr = targets;
+	sched->target_max = target_inflight;
+
+	return sched;
+}
+
+/** Drop a reference on a target table. Called with the engine lock held. */
+static void
+io_sched_put(io_sched *sched)
+{
+	DHL_ASSERT(sched->refs > 0);
+	if (--sched->refs > 0)
+		return;
+
+	free(sched->inflight);
+	free(sched);
+}
+
+/** The target is at the in-flight limit of the process */
+static bool
+io_sched_full(io_sched *sched, unsigned int target)
+{
+	return sched->inflight[target] >= sched->target_max;
+}
+
+/**
+ * Take a reference on the current target table, built from the settings on
+ * first use. Called with the engine lock held.
+ */
+static io_sched *
+io_sched_get(void)
+{
+	pthread_once(&io_sched_once, io_sched_env);
+
+	if (NULL == io_sched_cur) {
+		io_sched_cur = io_sched_alloc(io_targets, io_target_inflight);
+		if (NULL == io_sched_cur)
+			return NULL;
+	}
+
+	io_sched_cur->refs ++;
+	return io_sched_cur;
+}
+
+int
+daos_hl_io_sched_set(unsigned int targets, unsigned int target_inflight)
+{
+	io_sched *sched;
+
+	pthread_once(&io_sched_once, io_sched_env);
+
+	targets = (targets == 0) ? DAOS_HL_IO_TARGETS : targets;
+	target_inflight = (target_inflight == 0) ?
+		DAOS_HL_IO_TARGET_INFLIGHT : target_inflight;
+
+	sched = io_sched_alloc(targets, target_inflight);
+	if (NULL == sched) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	/** requests in flight keep the table they were launched with */
+	io_engine_lock();
+	io_targets = targets;
+	io_target_inflight = target_inflight;
+	if (io_sched_cur)
+		io_sched_put(io_sched_cur);
+	io_sched_cur = sched;
+	io_engine_unlock();
+
+	return 0;
+}
+
+void
+io_test_sched_record(unsigned int *targets, unsigned int nr)
+{
+	io_engine_lock();
+	io_rec_targets = targets;
+	io_rec_nr = (targets == NULL) ? 0 : nr;
+	io_rec_cnt = 0;
+	if (io_sched_cur)
+		io_sched_cur->peak = 0;
+	io_engine_unlock();
+}
+
+void
+io_test_sched_stats(unsigned int *recorded, unsigned int *peak)
+{
+	io_engine_lock();
+	*recorded = io_rec_cnt;
+	*peak = io_sched_cur ? io_sched_cur->peak : 0;
+	io_engine_unlock();
+}
+
+static void
+io_params_release(io_params *params)
+{
+	unsigned int k;
+
+	if (params->dkey_str) {
+		free(params->dkey_str);
+		params->dkey_str = NULL;
+	}
+
+	if (params->ranges) {
+		free(params->ranges);
+		params->ranges = NULL;
+	}
+
+	if (params->priv_desc)
+		return;
+
+	for (k = 0; k < params->iod_nr; k++) {
+		if (!params->user_sgl_used && params->sgls[k].sg_iovs) {
+			free(params->sgls[k].sg_iovs);
+			params->sgls[k].sg_iovs = NULL;
+		}
+
+		if (params->iods[k].vd_recxs) {
+			free(params->iods[k].vd_recxs);
+			params->iods[k].vd_recxs = NULL;
+		}
+	}
+}
+
+static void
+io_params_free(io_params *params)
+{
+	io_params_release(params);
+	if (params->ev_inited & 1)
+		daos_event_fini(&params->events[0]);
+	if (params->ev_inited & 2)
+		daos_event_fini(&params->events[1]);
+	if (params->iods != &params->iod)
+		free(params->iods);
+	if (params->sgls != &params->sgl)
+		free(params->sgls);
+	if (params->priv)
+		free(params->priv);
+	free(params);
+}
+
+void
+io_req_free(io_req *req)
+{
+	io_params *params, *next;
+
+	req->completing = NULL;
+	for (params = req->head; params != NULL; params = next) {
+		next = params->next;
+		io_params_free(params);
+	}
+
+	if (req->akey) {
+		free(req->akey);
+		req->akey = NULL;
+	}
+
+	if (req->plan_arg) {
+		free(req->plan_arg);
+		req->plan_arg = NULL;
+	}
+
+	if (req->failed.ranges)
+		free(req->failed.ranges);
+
+	if (req->targets)
+		free(req->targets);
+
+	if (req->sched) {
+		io_engine_lock();
+		io_sched_put(req->sched);
+		io_engine_unlock();
+	}
+
+	free(req);
+}
+
+void
+io_req_set_planner(io_req *req, io_plan_cb_t plan_cb, void *plan_arg)
+{
+	req->plan_cb = plan_cb;
+	req->plan_arg = plan_arg;
+	req->planned = false;
+}
+
+void
+io_req_set_comp_cb(io_req *req, daos_hl_comp_cb_t cb, void *cb_arg)
+{
+	req->user_cb = cb;
+	req->user_cb_arg = cb_arg;
+}
+
+/** Number of bytes described by the iods of a dkey I/O */
+static daos_size_t
+io_params_bytes(io_params *params)
+{
+	daos_size_t	bytes = 0;
+	unsigned int	k, j;
+
+	if (params->uncounted)
+		return 0;
+
+	for (k = 0; k < params->iod_nr; k++)
+		for (j = 0; j < params->iods[k].vd_nr; j++)
+			bytes += params->iods[k].vd_recxs[j].rx_rsize *
+				params->iods[k].vd_recxs[j].rx_nr;
+
+	return bytes;
+}
+
+/**
+ * Free the completed dkey I/Os of a streamed request, except the one that
+ * completed last since DAOS still uses its event after the callback returns.
+ * It is freed by the next reap after another completion, or with the request.
+ */
+static void
+io_req_reap(io_req *req)
+{
+	io_params *params, **prev;
+
+	prev = &req->head;
+	req->tail = NULL;
+	while ((params = *prev) != NULL) {
+		if (params->done && params != req->completing) {
+			*prev = params->next;
+			io_params_free(params);
+			continue;
+		}
+		req->tail = params;
+		prev = &params->next;
+	}
+}
+
+io_req *
+io_req_create(daos_hl_op_type_t op_type)
+{
+	io_req	*req;
+
+	req = (io_req *)calloc(1, sizeof(io_req));
+	if (NULL == req) {
+		DHL_ERROR("Failed memory allocation\n");
+		return NULL;
+	}
+
+	req->op_type = op_type;
+
+	return req;
+}
+
+io_params *
+io_req_add(io_req *req, daos_handle_t oh, daos_epoch_t epoch)
+{
+	io_params	*params;
+
+	params = (io_params *)calloc(1, sizeof(io_params));
+	if (NULL == params) {
+		DHL_ERROR("Failed memory allocation\n");
+		return NULL;
+	}
+
+	params->op_type = req->op_type;
+	params->oh = oh;
+	params->epoch = epoch;
+	params->akey_str = req->akey;
+	params->iod_nr = 1;
+	params->iods = &params->iod;
+	params->sgls = &params->sgl;
+	params->req = req;
+
+	if (req->tail == NULL)
+		req->head = params;
+	else
+		req->tail->next = params;
+	req->tail = params;
+	req->num_ios ++;
+
+	return params;
+}
+
+/**
+ * Completion callback of the parent event. All the dkey I/Os are done at this
+ * point, so nothing else touches the request: the user callback runs without
+ * the engine lock, and the request is torn down.
+ */
+static int
+io_req_complete_cb(void *arg, daos_event_t *ev, int rc)
+{
+	io_req	*req = (io_req *)arg;
+
+	if (rc == 0)
+		rc = req->status;
+
+	if (req->user_cb)
+		req->user_cb(req->user_cb_arg, rc, req->bytes, &req->failed);
+
+	io_req_free(req);
+
+	return rc;
+}
+
+/**
+ * Complete the parent event of a request that submitted nothing to DAOS, with
+ * the status of the request, so that it goes through the same completion as
+ * one whose dkey I/Os went to DAOS.
+ */
+static int
+io_req_complete_local(daos_event_t *parent, int status)
+{
+	int rc;
+
+	rc = daos_event_launch(parent);
+	if (rc != 0) {
+		DHL_ERROR("Failed to launch event (%d)\n", rc);
+		return rc;
+	}
+
+	daos_event_complete(parent, status);
+
+	return 0;
+}
+
+static bool io_req_progress(io_req *req);
+static int io_timer_arm(io_req *req);
+static void io_sched_wake(void);
+
+/**
+ * Let the parent event of a request complete once its last dkey I/O is done.
+ * Its completion callback may run right away and free the request, so this is
+ * called after the last access to the request, outside of the engine lock.
+ */
+static int
+io_req_barrier(daos_event_t *parent)
+{
+	int rc;
+
+	rc = daos_event_parent_barrier(parent);
+	if (rc != 0)
+		DHL_ERROR("daos_event_parent_barrier Failed (%d)\n", rc);
+
+	return rc;
+}
+
+/** Errors left by a target being unavailable for a while, worth a retry */
+static bool
+io_retryable(int rc)
+{
+	return rc == -DER_UNREACH || rc == -DER_TIMEDOUT || rc == -DER_BUSY;
+}
+
+static uint64_t
+io_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Jitter of the retries, seeded apart in every process and thread */
+static __thread unsigned int	io_retry_seed;
+static __thread bool		io_retry_seeded;
+
+/** Test hook: error of the next io_fault_nr submissions */
+static int			io_fault_rc;
+static unsigned int		io_fault_nr;
+
+void
+io_test_fault_set(int rc, unsigned int nr)
+{
+	io_engine_lock();
+	io_fault_rc = rc;
+	io_fault_nr = nr;
+	io_engine_unlock();
+}
+
+/**
+ * Queue a failed dkey I/O for a retry after an exponential backoff with
+ * jitter, so that the I/Os hit by a target restart do not all come back at
+ * once. Returns false if the error is not transient or the retries are used
+ * up.
+ */
+static bool
+io_retry(io_req *req, io_params *params, int rc)
+{
+	uint64_t delay;
+
+	if (!io_retryable(rc) || params->retries >= DAOS_HL_IO_RETRY_MAX)
+		return false;
+
+	if (!io_retry_seeded) {
+		io_retry_seed = (unsigned int)getpid() ^
+			(unsigned int)time(NULL) ^
+			(unsigned int)(uintptr_t)&io_retry_seed;
+		io_retry_seeded = true;
+	}
+
+	delay = (uint64_t)DAOS_HL_IO_RETRY_BASE << params->retries;
+	if (delay > DAOS_HL_IO_RETRY_CAP)
+		delay = DAOS_HL_IO_RETRY_CAP;
+	/** half fixed, half random */
+	delay = delay / 2 + rand_r(&io_retry_seed) % (delay / 2 + 1);
+
+	params->retries ++;
+	params->retry_at = io_now() + delay;
+	params->retry_next = req->retry_head;
+	req->retry_head = params;
+
+	return true;
+}
+
+/**
+ * Give up on a dkey I/O: record the error of the operation and the ranges the
+ * I/O covered, and release it.
+ */
+static void
+io_fail(io_req *req, io_params *params, int rc)
+{
+	unsigned int i;
+
+	DHL_ERROR("I/O on dkey %s failed (%d)\n", params->dkey_str, rc);
+	if (req->status == 0)
+		req->status = rc;
+
+	for (i = 0; params->ranges && i < params->iods[0].vd_nr; i++) {
+		daos_hl_array_ranges_t *failed = &req->failed;
+
+		if (failed->ranges_nr == req->failed_cap) {
+			daos_hl_range_t	*ranges;
+			daos_size_t	cap;
+
+			cap = req->failed_cap ? req->failed_cap * 2 : 16;
+			ranges = (daos_hl_range_t *)realloc(failed->ranges,
+						cap * sizeof(daos_hl_range_t));
+			if (NULL == ranges) {
+				DHL_ERROR("Failed memory allocation\n");
+				break;
+			}
+			failed->ranges = ranges;
+			req->failed_cap = cap;
+		}
+		failed->ranges[failed->ranges_nr ++] = params->ranges[i];
+	}
+
+	io_params_release(params);
+	params->done = true;
+}
+
+/**
+ * Completion callback of a single dkey I/O. Release the per dkey buffers right
+ * away and refill the in-flight window from the remaining dkey I/Os. The
+ * request may be freed as soon as the parent barrier is set, so it must not be
+ * touched after io_req_progress() reports the last dkey I/O done.
+ */
+static int
+io_complete_cb(void *arg, daos_event_t *ev, int rc)
+{
+	io_params	*params = (io_params *)arg;
+	io_req		*req = params->req;
+	daos_event_t	*parent = req->ev;
+	bool		last;
+
+	io_engine_lock();
+
+	if (params->comp_cb)
+		rc = params->comp_cb(params, rc);
+
+	req->num_inflight --;
+	req->sched->inflight[params->target] --;
+	io_sched_wake();
+	req->completing = params;
+
+	if (rc != 0 && io_retry(req, params, rc)) {
+		/** the reissued I/O decides the status of this dkey */
+		rc = 0;
+	}
+	else if (rc != 0) {
+		io_fail(req, params, rc);
+	}
+	else {
+		req->bytes += io_params_bytes(params);
+		io_params_release(params);
+		params->done = true;
+	}
+
+	last = io_req_progress(req);
+
+	io_engine_unlock();
+
+	if (last)
+		io_req_barrier(parent);
+
+	return rc;
+}
+
+static int
+io_submit(io_req *req, io_params *params)
+{
+	daos_event_t	*ev;
+	unsigned int	bit;
+	int		rc;
+
+	if (io_fault_nr > 0) {
+		io_fault_nr --;
+		return io_fault_rc;
+	}
+
+	/**
+	 * A retry goes through the other event, since the event of the failed
+	 * attempt may still be completing when the retry is issued.
+	 */
+	if (params->submitted)
+		params->ev_cur ^= 1;
+	ev = &params->events[params->ev_cur];
+	bit = 1 << params->ev_cur;
+	if (params->ev_inited & bit) {
+		daos_event_fini(ev);
+		params->ev_inited &= ~bit;
+	}
+
+	rc = daos_event_init(ev, DAOS_HDL_INVAL, req->ev);
+	if (rc != 0) {
+		DHL_ERROR("Failed to init child event (%d)\n", rc);
+		return rc;
+	}
+
+	rc = daos_event_register_comp_cb(ev, io_complete_cb, params);
+	if (rc != 0) {
+		DHL_ERROR("Failed to register completion cb (%d)\n", rc);
+		daos_event_fini(ev);
+		return rc;
+	}
+
+	/* issue KV IO to DAOS */
+	if (DAOS_HL_OP_READ == params->op_type) {
+		rc = daos_obj_fetch(params->oh, params->epoch, &params->dkey,
+				    params->iod_nr, params->iods, params->sgls,
+				    NULL, ev);
+		if (rc != 0) {
+			DHL_ERROR("KV Fetch of dkey %s failed (%d)\n",
+				  params->dkey_str, rc);
+			daos_event_fini(ev);
+			return rc;
+		}
+	}
+	else if (DAOS_HL_OP_WRITE == params->op_type) {
+		rc = daos_obj_update(params->oh, params->epoch, &params->dkey,
+				     params->iod_nr, params->iods, params->sgls,
+				     ev);
+		if (rc != 0) {
+			DHL_ERROR("KV Update of dkey %s failed (%d)\n",
+				  params->dkey_str, rc);
+			daos_event_fini(ev);
+			return rc;
+		}
+	}
+	else {
+		DHL_ASSERTF(0, "Invalid I/O operation.\n");
+	}
+
+	params->submitted = true;
+	params->ev_inited |= bit;
+
+	return 0;
+}
+
+/**
+ * Run the planner of a streamed request for the next dkey I/Os and point
+ * next_io at the first of them.
+ */
+static int
+io_req_plan(io_req *req)
+{
+	io_params	*tail;
+	int		rc;
+
+	io_req_reap(req);
+	tail = req->tail;
+
+	rc = req->plan_cb(req, req->plan_arg, &req->planned);
+	if (rc != 0) {
+		DHL_ERROR("Failed to plan dkey I/Os (%d)\n", rc);
+		req->planned = true;
+		return rc;
+	}
+
+	req->next_io = (tail == NULL) ? req->head : tail->next;
+
+	return 0;
+}
+
+/** Submit a dkey I/O, or queue it for a retry or give up on it if it fails */
+static void
+io_req_submit(io_req *req, io_params *params)
+{
+	int rc;
+
+	rc = io_submit(req, params);
+	if (rc != 0) {
+		if (!io_retry(req, params, rc))
+			io_fail(req, params, rc);
+		return;
+	}
+
+	req->num_submitted ++;
+	req->num_inflight ++;
+	if (++req->sched->inflight[params->target] > req->sched->peak)
+		req->sched->peak = req->sched->inflight[params->target];
+
+	if (io_rec_cnt < io_rec_nr)
+		io_rec_targets[io_rec_cnt++] = params->target;
+}
+
+/**
+ * Reissue the dkey I/Os whose backoff expired. The others wait for a later
+ * completion of the request, or for the retry timer if none is in flight.
+ */
+static void
+io_req_retry(io_req *req)
+{
+	io_params	*params, **prev;
+	uint64_t	now;
+
+	if (req->retry_head == NULL)
+		return;
+
+	now = io_now();
+	prev = &req->retry_head;
+	while ((params = *prev) != NULL &&
+	       req->num_inflight < DAOS_HL_IO_WINDOW) {
+		if (params->retry_at > now ||
+		    io_sched_full(req->sched, params->target)) {
+			prev = &params->retry_next;
+			continue;
+		}
+
+		*prev = params->retry_next;
+		params->retry_next = NULL;
+		/** a retry failing to submit is queued again, not due yet */
+		io_req_submit(req, params);
+	}
+}
+
+/**
+ * Placement target of a dkey I/O. The dkeys of an object are placed on the
+ * targets by a hash of the dkey that the client does not expose, so the I/Os
+ * are bucketed by a hash of the object handle and the dkey instead: all the
+ * I/Os on a dkey share a bucket, and distinct dkeys spread over the buckets.
+ */
+static unsigned int
+io_params_target(io_params *params, unsigned int target_nr)
+{
+	const unsigned char	*p = params->dkey.iov_buf;
+	uint64_t		h = 14695981039346656037ULL;
+	daos_size_t		i;
+
+	/** FNV-1a */
+	h ^= params->oh.cookie;
+	h *= 1099511628211ULL;
+	for (i = 0; i < params->dkey.iov_len; i++) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+
+	return h % target_nr;
+}
+
+/**
+ * Queue the dkey I/Os on their targets in plan order, up to the lookahead,
+ * planning more of them on the way for a streamed request.
+ */
+static void
+io_sched_fill(io_req *req)
+{
+	io_params	*params;
+	io_target	*tgt;
+	int		rc;
+
+	while (req->num_queued < DAOS_HL_IO_LOOKAHEAD) {
+		params = req->next_io;
+		if (params == NULL) {
+			if (req->plan_cb == NULL || req->planned)
+				return;
+
+			rc = io_req_plan(req);
+			if (rc != 0) {
+				if (req->status == 0)
+					req->status = rc;
+				return;
+			}
+			continue;
+		}
+		req->next_io = params->next;
+
+		params->target = io_params_target(params,
+						  req->sched->target_nr);
+		params->sched_next = NULL;
+		tgt = &req->targets[params->target];
+		if (tgt->tail == NULL)
+			tgt->head = params;
+		else
+			tgt->tail->sched_next = params;
+		tgt->tail = params;
+		req->num_queued ++;
+	}
+}
+
+/**
+ * Take the next dkey I/O to submit, from the targets in turn, skipping the
+ * ones at their in-flight limit unless \a force is set. Returns NULL if no
+ * target can take one.
+ */
+static io_params *
+io_sched_pick(io_req *req, bool force)
+{
+	io_params	*params;
+	io_target	*tgt;
+	unsigned int	i, t;
+
+	for (i = 0; i < req->sched->target_nr; i++) {
+		t = (req->target_cursor + i) % req->sched->target_nr;
+		tgt = &req->targets[t];
+		if (tgt->head == NULL ||
+		    (!force && io_sched_full(req->sched, t)))
+			continue;
+
+		params = tgt->head;
+		tgt->head = params->sched_next;
+		if (tgt->head == NULL)
+			tgt->tail = NULL;
+		req->num_queued --;
+		req->target_cursor = t + 1;
+		return params;
+	}
+
+	return NULL;
+}
+
+/**
+ * Submit dkey I/Os until the in-flight window is full, retries first, planning
+ * more of them on the way for a streamed request. The I/Os are interleaved
+ * over their targets, so that the dkeys of an operation do not all hit the
+ * same servers at once, and a target at the in-flight limit of the process
+ * waits for a completion of any request.
+ *
+ * With retries waiting for their backoff, or I/Os waiting for targets kept
+ * full by other requests, and nothing in flight, no completion of the request
+ * comes to reissue them, so it is parked on the retry timer, which drives it
+ * again once the first retry is due or a target frees a slot.
+ *
+ * Returns true once every dkey I/O has completed or failed for good, and only
+ * once per request. The caller then sets the barrier on the parent event with
+ * io_req_barrier(); it is not set earlier since failed I/Os are reissued as
+ * children of the same parent. If nothing was ever submitted, the parent
+ * event never completes and the caller completes it, or frees the request
+ * instead.
+ */
+static bool
+io_req_progress(io_req *req)
+{
+	io_req_retry(req);
+
+	while (req->num_inflight < DAOS_HL_IO_WINDOW) {
+		io_params *params;
+
+		io_sched_fill(req);
+		params = io_sched_pick(req, false);
+		if (params == NULL)
+			break;
+
+		io_req_submit(req, params);
+	}
+
+	if (req->num_inflight == 0 &&
+	    (req->retry_head != NULL || req->num_queued != 0) &&
+	    io_timer_arm(req) != 0) {
+		io_params *params;
+
+		/** nothing would ever wake it, go over the target limits */
+		while (req->num_inflight < DAOS_HL_IO_WINDOW) {
+			io_sched_fill(req);
+			params = io_sched_pick(req, true);
+			if (params == NULL)
+				break;
+
+			io_req_submit(req, params);
+		}
+
+		/** nothing would ever reissue them */
+		while (req->num_inflight == 0 &&
+		       (params = req->retry_head) != NULL) {
+			req->retry_head = params->retry_next;
+			params->retry_next = NULL;
+			io_fail(req, params, -1);
+		}
+	}
+
+	if (req->next_io != NULL || req->num_queued != 0 || req->launched ||
+	    req->num_inflight != 0 || req->retry_head != NULL ||
+	    (req->plan_cb && !req->planned))
+		return false;
+
+	req->launched = true;
+
+	return true;
+}
+
+/**
+ * Let the parent event of a request whose last dkey I/O is done complete. It
+ * is completed here if nothing was ever submitted to DAOS.
+ */
+static int
+io_req_finish(daos_event_t *parent, daos_size_t submitted, int status)
+{
+	if (submitted == 0)
+		return io_req_complete_local(parent, status);
+
+	return io_req_barrier(parent);
+}
+
+/**
+ * Retry timer: queue of the requests parked until their first retry is due,
+ * and the thread driving them. The thread runs while requests are parked and
+ * exits once the queue is empty. Lock order: engine lock, then timer lock.
+ */
+static pthread_mutex_t	io_timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	io_timer_cond;
+static pthread_once_t	io_timer_once = PTHREAD_ONCE_INIT;
+static io_req		*io_timer_head;
+static bool		io_timer_running;
+
+static void
+io_timer_init(void)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&io_timer_cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+/**
+ * Take the first request of the timer queue whose retry is due, or set *first
+ * to the time of the next one and return NULL.
+ */
+static io_req *
+io_timer_pop(uint64_t now, uint64_t *first)
+{
+	io_req *req, **prev;
+
+	*first = UINT64_MAX;
+	for (prev = &io_timer_head; (req = *prev) != NULL;
+	     prev = &req->timer_next) {
+		if (req->timer_at <= now) {
+			*prev = req->timer_next;
+			req->timer_next = NULL;
+			req->timer_queued = false;
+			return req;
+		}
+		if (req->timer_at < *first)
+			*first = req->timer_at;
+	}
+
+	return NULL;
+}
+
+/** Reissue the due retries of a parked request, and complete it if done */
+static void
+io_timer_drive(io_req *req)
+{
+	daos_event_t	*parent;
+	daos_size_t	submitted;
+	int		status;
+	bool		last;
+
+	io_engine_lock();
+	if (req->sched_blocked) {
+		req->sched_blocked = false;
+		io_sched_blocked --;
+	}
+	last = io_req_progress(req);
+	parent = req->ev;
+	submitted = req->num_submitted;
+	status = req->status;
+	io_engine_unlock();
+
+	if (last)
+		io_req_finish(parent, submitted, status);
+}
+
+static void *
+io_timer_func(void *arg)
+{
+	struct timespec	ts;
+	io_req		*req;
+	uint64_t	first;
+
+	pthread_mutex_lock(&io_timer_mutex);
+	while (io_timer_head != NULL) {
+		req = io_timer_pop(io_now(), &first);
+		if (req != NULL) {
+			pthread_mutex_unlock(&io_timer_mutex);
+			io_timer_drive(req);
+			pthread_mutex_lock(&io_timer_mutex);
+			continue;
+		}
+
+		ts.tv_sec = first / 1000000;
+		ts.tv_nsec = (first % 1000000) * 1000;
+		pthread_cond_timedwait(&io_timer_cond, &io_timer_mutex, &ts);
+	}
+	io_timer_running = false;
+	pthread_mutex_unlock(&io_timer_mutex);
+
+	return NULL;
+}
+
+/**
+ * Park a request on the retry timer until its first retry is due, or until a
+ * target it waits for frees a slot. Called with the engine lock held and
+ * nothing of the request in flight.
+ */
+static int
+io_timer_arm(io_req *req)
+{
+	pthread_attr_t	attr;
+	pthread_t	thread;
+	io_params	*params;
+	bool		blocked = (req->num_queued != 0);
+	int		rc = 0;
+
+	pthread_once(&io_timer_once, io_timer_init);
+
+	pthread_mutex_lock(&io_timer_mutex);
+
+	/** retries on a full target wait for it, not for their backoff */
+	req->timer_at = UINT64_MAX;
+	for (params = req->retry_head; params != NULL;
+	     params = params->retry_next) {
+		if (io_sched_full(req->sched, params->target))
+			blocked = true;
+		else if (params->retry_at < req->timer_at)
+			req->timer_at = params->retry_at;
+	}
+
+	if (!req->timer_queued) {
+		req->timer_next = io_timer_head;
+		io_timer_head = req;
+		req->timer_queued = true;
+	}
+
+	if (io_timer_running) {
+		pthread_cond_signal(&io_timer_cond);
+		goto out;
+	}
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	rc = pthread_create(&thread, &attr, io_timer_func, NULL);
+	pthread_attr_destroy(&attr);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create retry timer thread (%d)\n", rc);
+		/** without a thread, the queue was empty before this request */
+		io_timer_head = req->timer_next;
+		req->timer_next = NULL;
+		req->timer_queued = false;
+		rc = -1;
+		goto out;
+	}
+	io_timer_running = true;
+out:
+	if (rc == 0 && blocked != req->sched_blocked) {
+		req->sched_blocked = blocked;
+		if (blocked)
+			io_sched_blocked ++;
+		else
+			io_sched_blocked --;
+	}
+	pthread_mutex_unlock(&io_timer_mutex);
+	return rc;
+}
+
+/**
+ * A target freed a slot: drive the requests parked for a full target again
+ * right away. Called with the engine lock held.
+ */
+static void
+io_sched_wake(void)
+{
+	io_req *req;
+
+	if (io_sched_blocked == 0)
+		return;
+
+	pthread_mutex_lock(&io_timer_mutex);
+	for (req = io_timer_head; req != NULL; req = req->timer_next)
+		if (req->sched_blocked)
+			req->timer_at = 0;
+	pthread_cond_signal(&io_timer_cond);
+	pthread_mutex_unlock(&io_timer_mutex);
+}
+
+/**
+ * Event queue polled by the blocking calls of a thread, created on first use
+ * and destroyed when the thread exits.
+ */
+static pthread_key_t	io_eq_key;
+static pthread_once_t	io_eq_once = PTHREAD_ONCE_INIT;
+/** a blocking call of the thread is polling its event queue */
+static __thread bool	io_eq_busy;
+
+static void
+io_eq_release(void *arg)
+{
+	daos_handle_t *eqh = (daos_handle_t *)arg;
+
+	daos_eq_destroy(*eqh, 0);
+	free(eqh);
+}
+
+static void
+io_eq_key_create(void)
+{
+	pthread_key_create(&io_eq_key, io_eq_release);
+}
+
+/**
+ * Get the event queue of a blocking call. A blocking call made from a
+ * completion callback that runs while the thread polls its event queue gets a
+ * private one, since the two polls would reap each other's events.
+ */
+static int
+io_eq_get(daos_handle_t *eqh, bool *cached)
+{
+	daos_handle_t	*cur;
+	int		rc;
+
+	pthread_once(&io_eq_once, io_eq_key_create);
+
+	*cached = !io_eq_busy;
+	if (!*cached)
+		return daos_eq_create(eqh);
+
+	cur = (daos_handle_t *)pthread_getspecific(io_eq_key);
+	if (cur == NULL) {
+		cur = (daos_handle_t *)malloc(sizeof(daos_handle_t));
+		if (NULL == cur) {
+			DHL_ERROR("Failed memory allocation\n");
+			return -1;
+		}
+
+		rc = daos_eq_create(cur);
+		if (rc != 0) {
+			free(cur);
+			return rc;
+		}
+		pthread_setspecific(io_eq_key, cur);
+	}
+
+	io_eq_busy = true;
+	*eqh = *cur;
+
+	return 0;
+}
+
+static void
+io_eq_put(daos_handle_t eqh, bool cached)
+{
+	if (cached)
+		io_eq_busy = false;
+	else
+		daos_eq_destroy(eqh, 0);
+}
+
+int
+io_req_launch(io_req *req, daos_event_t *ev)
+{
+	daos_handle_t	eqh;
+	daos_event_t	local_ev, *evp;
+	daos_event_t	*parent;
+	daos_size_t	submitted;
+	bool		cached = false;
+	bool		last;
+	int		rc;
+
+	io_engine_lock();
+	req->sched = io_sched_get();
+	io_engine_unlock();
+	if (NULL == req->sched) {
+		DHL_ERROR("Failed memory allocation\n");
+		io_req_free(req);
+		return -1;
+	}
+	req->targets = (io_target *)calloc(req->sched->target_nr,
+					   sizeof(io_target));
+	if (NULL == req->targets) {
+		DHL_ERROR("Failed memory allocation\n");
+		io_req_free(req);
+		return -1;
+	}
+	/** processes start on different targets, so their bursts spread */
+	req->target_cursor = ((unsigned int)getpid() +
+			      __atomic_fetch_add(&io_sched_seq, 1,
+						 __ATOMIC_RELAXED)) %
+		req->sched->target_nr;
+
+	/**
+	 * In blocking mode, run the dkey I/Os as children of an internal
+	 * event on the event queue of the thread, so that they are all in
+	 * flight together instead of being issued one RPC at a time.
+	 */
+	if (ev == NULL) {
+		rc = io_eq_get(&eqh, &cached);
+		if (rc != 0) {
+			DHL_ERROR("Failed to create event queue (%d)\n", rc);
+			io_req_free(req);
+			return rc;
+		}
+
+		rc = daos_event_init(&local_ev, eqh, NULL);
+		if (rc != 0) {
+			DHL_ERROR("Failed to init event (%d)\n", rc);
+			io_req_free(req);
+			io_eq_put(eqh, cached);
+			return rc;
+		}
+
+		req->ev = &local_ev;
+	} else {
+		req->ev = ev;
+	}
+	parent = req->ev;
+
+	rc = daos_event_register_comp_cb(req->ev, io_req_complete_cb, req);
+	if (rc != 0) {
+		DHL_ERROR("Failed to register completion cb (%d)\n", rc);
+		io_req_free(req);
+		goto out;
+	}
+
+	req->next_io = req->head;
+
+	if (ev != NULL)
+		io_progress_auto_start();
+
+	/**
+	 * The request belongs to the completion callbacks as soon as the lock
+	 * is dropped with dkey I/Os in flight, so it is not touched after that.
+	 */
+	io_engine_lock();
+	last = io_req_progress(req);
+	submitted = req->num_submitted;
+	io_engine_unlock();
+
+	if (last && submitted == 0 && req->status != 0) {
+		/** nothing in flight, the parent event will never complete */
+		rc = req->status;
+		io_req_free(req);
+		goto out;
+	}
+
+	if (last && submitted == 0) {
+		/** nothing to access */
+		rc = io_req_complete_local(parent, 0);
+		if (rc != 0) {
+			io_req_free(req);
+			goto out;
+		}
+	}
+	else if (last) {
+		rc = io_req_barrier(parent);
+		if (rc != 0)
+			goto out;
+	}
+
+	if (ev == NULL) {
+		rc = daos_eq_poll(eqh, 0, DAOS_EQ_WAIT, 1, &evp);
+		if (rc != 1) {
+			DHL_ERROR("Failed to poll event queue (%d)\n", rc);
+			rc = (rc < 0) ? rc : -1;
+		}
+		else {
+			rc = local_ev.ev_error;
+		}
+	}
+
+out:
+	if (ev == NULL) {
+		daos_event_fini(&local_ev);
+		io_eq_put(eqh, cached);
+	}
+
+	return rc;
+}
@@ -0,0 +1,492 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/kv/kv.c
+ */
+
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/io.h>
+
+/** MSC - Those need to be configurable later through hints */
+/** Number of dkeys the keys of a KV object are hashed into */
+#define DAOS_HL_KV_NUM_BUCKETS		64
+/** Default size of the enumeration buffer of a KV iterator */
+#define DAOS_HL_KV_ENUM_BUF		(1 << 20)
+/** Average key length used to size the key descriptors of an iterator */
+#define DAOS_HL_KV_KEY_AVG		16
+
+struct daos_hl_kv_iter {
+	daos_handle_t	oh;
+	daos_epoch_t	epoch;
+	/** bucket being enumerated */
+	uint32_t	bucket;
+	char		dkey_str[16];
+	daos_key_t	dkey;
+	daos_hash_out_t	anchor;
+	/** enumeration buffer and key descriptors */
+	char		*buf;
+	daos_size_t	buf_size;
+	daos_key_desc_t	*kds;
+	daos_off_t	*offs;
+	uint32_t	kds_nr;
+	/** number of keys returned by the last call */
+	uint32_t	nr;
+	uint32_t	*user_nr;
+	daos_iov_t	iov;
+	daos_sg_list_t	sgl;
+	bool		eof;
+};
+
+/** FNV-1a hash of the key */
+static uint32_t
+kv_bucket(const char *key)
+{
+	uint32_t	hash = 2166136261u;
+
+	while (*key) {
+		hash ^= (unsigned char)*key++;
+		hash *= 16777619u;
+	}
+
+	return hash % DAOS_HL_KV_NUM_BUCKETS;
+}
+
+/**
+ * Comp hook of a get: return the size of each value to the user. A value that
+ * does not exist reads back with a size of 0.
+ */
+static int
+kv_get_comp_cb(io_params *params, int rc)
+{
+	daos_size_t	**sizes = (daos_size_t **)params->comp_arg;
+	unsigned int	k;
+
+	if (rc != 0)
+		return rc;
+
+	for (k = 0; k < params->iod_nr; k++)
+		*sizes[k] = params->iods[k].vd_recxs[0].rx_rsize;
+
+	return 0;
+}
+
+/**
+ * Build one dkey I/O per bucket, holding the keys of all the entries that hash
+ * into that bucket. The keys are sorted by bucket with a counting sort.
+ */
+static int
+kv_req_plan(io_req *req, daos_handle_t oh, daos_epoch_t epoch,
+	    unsigned int nr, const char **keys, daos_size_t *sizes,
+	    void **bufs)
+{
+	unsigned int	start[DAOS_HL_KV_NUM_BUCKETS + 1];
+	unsigned int	*order, *bucket;
+	daos_csum_buf_t	null_csum;
+	unsigned int	b, i;
+	int		rc = 0;
+
+	order = (unsigned int *)malloc(sizeof(unsigned int) * nr * 2);
+	if (NULL == order) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+	bucket = order + nr;
+
+	memset(start, 0, sizeof(start));
+	for (i = 0; i < nr; i++) {
+		if (NULL == keys[i]) {
+			DHL_ERROR("NULL key passed\n");
+			free(order);
+			return -1;
+		}
+		bucket[i] = kv_bucket(keys[i]);
+		start[bucket[i] + 1] ++;
+	}
+	for (b = 0; b < DAOS_HL_KV_NUM_BUCKETS; b++)
+		start[b + 1] += start[b];
+	for (i = 0; i < nr; i++)
+		order[start[bucket[i]] ++] = i;
+
+	daos_csum_set(&null_csum, NULL, 0);
+
+	/** start[b] is now the end of bucket b in order */
+	for (b = 0, i = 0; b < DAOS_HL_KV_NUM_BUCKETS; b++) {
+		io_params	*params;
+		daos_recx_t	*recxs;
+		daos_iov_t	*iovs;
+		unsigned int	n = start[b] - i;
+		unsigned int	k;
+
+		if (n == 0)
+			continue;
+
+		params = io_req_add(req, oh, epoch);
+		if (NULL == params) {
+			rc = -1;
+			break;
+		}
+
+		params->iods = (daos_vec_iod_t *)calloc(n,
+							sizeof(daos_vec_iod_t));
+		params->sgls = (daos_sg_list_t *)calloc(n,
+							sizeof(daos_sg_list_t));
+		params->priv = malloc(n * (sizeof(daos_recx_t) +
+					   sizeof(daos_iov_t) +
+					   sizeof(daos_size_t *)));
+		if (NULL == params->iods || NULL == params->sgls ||
+		    NULL == params->priv) {
+			DHL_ERROR("Failed memory allocation\n");
+			rc = -1;
+			break;
+		}
+		params->iod_nr = n;
+		params->priv_desc = true;
+		recxs = (daos_recx_t *)params->priv;
+		iovs = (daos_iov_t *)(recxs + n);
+
+		if (DAOS_HL_OP_READ == req->op_type) {
+			params->comp_cb = kv_get_comp_cb;
+			params->comp_arg = (void *)(iovs + n);
+		}
+
+		asprintf(&params->dkey_str, "kv_%u", b);
+		if (NULL == params->dkey_str) {
+			DHL_ERROR("Failed memory allocation\n");
+			rc = -1;
+			break;
+		}
+		daos_iov_set(&params->dkey, (void *)params->dkey_str,
+			     strlen(params->dkey_str));
+
+		for (k = 0; k < n; k++, i++) {
+			unsigned int	 u = order[i];
+			daos_vec_iod_t	*iod = &params->iods[k];
+
+			daos_iov_set(&iod->vd_name, (void *)keys[u],
+				     strlen(keys[u]));
+			iod->vd_kcsum = null_csum;
+			iod->vd_nr = 1;
+			iod->vd_csums = NULL;
+			iod->vd_eprs = NULL;
+			iod->vd_recxs = &recxs[k];
+
+			/**
+			 * A value is a single record of the value size. A
+			 * fetch accepts any record size and returns it, and
+			 * an update with a 0 size punches the value.
+			 */
+			recxs[k].rx_idx = 0;
+			recxs[k].rx_nr = 1;
+			if (DAOS_HL_OP_READ == req->op_type) {
+				recxs[k].rx_rsize = DAOS_REC_ANY;
+				((daos_size_t **)params->comp_arg)[k] =
+					&sizes[u];
+			}
+			else {
+				recxs[k].rx_rsize = sizes ? sizes[u] : 0;
+			}
+
+			daos_iov_set(&iovs[k], bufs ? bufs[u] : NULL,
+				     sizes ? sizes[u] : 0);
+			params->sgls[k].sg_nr.num = 1;
+			params->sgls[k].sg_nr.num_out = 0;
+			params->sgls[k].sg_iovs = &iovs[k];
+		}
+	}
+
+	free(order);
+
+	return rc;
+}
+
+static int
+kv_access(daos_handle_t oh, daos_epoch_t epoch, unsigned int nr,
+	  const char **keys, daos_size_t *sizes, void **bufs,
+	  daos_event_t *ev, daos_hl_op_type_t op_type)
+{
+	io_req		*req;
+	int		rc;
+
+	if (nr != 0 && NULL == keys) {
+		DHL_ERROR("NULL key list passed\n");
+		return -1;
+	}
+	if (nr != 0 && DAOS_HL_OP_READ == op_type && NULL == sizes) {
+		DHL_ERROR("NULL size list passed\n");
+		return -1;
+	}
+
+	req = io_req_create(op_type);
+	if (NULL == req)
+		return -1;
+
+	rc = kv_req_plan(req, oh, epoch, nr, keys, sizes, bufs);
+	if (rc != 0) {
+		io_req_free(req);
+		return rc;
+	}
+
+	return io_req_launch(req, ev);
+}
+
+int
+daos_hl_kv_put(daos_handle_t oh, daos_epoch_t epoch, const char *key,
+	       daos_size_t size, const void *buf, daos_event_t *ev)
+{
+	return daos_hl_kv_put_multi(oh, epoch, 1, &key, &size,
+				    (void **)&buf, ev);
+}
+
+int
+daos_hl_kv_put_multi(daos_handle_t oh, daos_epoch_t epoch, unsigned int nr,
+		     const char **keys, daos_size_t *sizes, void **bufs,
+		     daos_event_t *ev)
+{
+	int rc;
+
+	if (nr != 0 && (NULL == sizes || NULL == bufs)) {
+		DHL_ERROR("NULL value list passed\n");
+		return -1;
+	}
+
+	rc = kv_access(oh, epoch, nr, keys, sizes, bufs, ev,
+		       DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("KV put failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_kv_get(daos_handle_t oh, daos_epoch_t epoch, const char *key,
+	       daos_size_t *size, void *buf, daos_event_t *ev)
+{
+	return daos_hl_kv_get_multi(oh, epoch, 1, &key, size, &buf, ev);
+}
+
+int
+daos_hl_kv_get_multi(daos_handle_t oh, daos_epoch_t epoch, unsigned int nr,
+		     const char **keys, daos_size_t *sizes, void **bufs,
+		     daos_event_t *ev)
+{
+	int rc;
+
+	rc = kv_access(oh, epoch, nr, keys, sizes, bufs, ev,
+		       DAOS_HL_OP_READ);
+	if (0 != rc) {
+		DHL_ERROR("KV get failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_kv_remove(daos_handle_t oh, daos_epoch_t epoch, const char *key,
+		  daos_event_t *ev)
+{
+	int rc;
+
+	rc = kv_access(oh, epoch, 1, &key, NULL, NULL, ev, DAOS_HL_OP_WRITE);
+	if (0 != rc) {
+		DHL_ERROR("KV remove failed (%d)\n", rc);
+		return rc;
+	}
+
+	return rc;
+}
+
+int
+daos_hl_kv_iter_create(daos_handle_t oh, daos_epoch_t epoch,
+		       daos_size_t buf_size, daos_hl_kv_iter_t **iterp)
+{
+	daos_hl_kv_iter_t	*iter;
+
+	if (NULL == iterp) {
+		DHL_ERROR("NULL iterator pointer passed\n");
+		return -1;
+	}
+
+	if (buf_size == 0)
+		buf_size = DAOS_HL_KV_ENUM_BUF;
+
+	iter = (daos_hl_kv_iter_t *)calloc(1, sizeof(daos_hl_kv_iter_t));
+	if (NULL == iter) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+
+	iter->oh = oh;
+	iter->epoch = epoch;
+	iter->buf_size = buf_size;
+	iter->kds_nr = buf_size / DAOS_HL_KV_KEY_AVG;
+	if (iter->kds_nr == 0)
+		iter->kds_nr = 1;
+
+	iter->buf = malloc(buf_size);
+	iter->kds = (daos_key_desc_t *)malloc(sizeof(daos_key_desc_t) *
+					      iter->kds_nr);
+	iter->offs = (daos_off_t *)malloc(sizeof(daos_off_t) * iter->kds_nr);
+	if (NULL == iter->buf || NULL == iter->kds || NULL == iter->offs) {
+		DHL_ERROR("Failed memory allocation\n");
+		daos_hl_kv_iter_destroy(iter);
+		return -1;
+	}
+
+	*iterp = iter;
+
+	return 0;
+}
+
+int
+daos_hl_kv_iter_destroy(daos_hl_kv_iter_t *iter)
+{
+	if (NULL == iter)
+		return 0;
+
+	if (iter->buf)
+		free(iter->buf);
+	if (iter->kds)
+		free(iter->kds);
+	if (iter->offs)
+		free(iter->offs);
+	free(iter);
+
+	return 0;
+}
+
+/** Index the keys returned by the last call and move to the next bucket */
+static void
+kv_iter_advance(daos_hl_kv_iter_t *iter)
+{
+	daos_off_t	off = 0;
+	uint32_t	i;
+
+	for (i = 0; i < iter->nr; i++) {
+		iter->offs[i] = off;
+		off += iter->kds[i].kd_key_len;
+	}
+
+	if (iter->user_nr)
+		*iter->user_nr = iter->nr;
+
+	if (!daos_hash_is_eof(&iter->anchor))
+		return;
+
+	memset(&iter->anchor, 0, sizeof(iter->anchor));
+	iter->bucket ++;
+	if (iter->bucket == DAOS_HL_KV_NUM_BUCKETS)
+		iter->eof = true;
+}
+
+static int
+kv_iter_comp_cb(void *arg, daos_event_t *ev, int rc)
+{
+	daos_hl_kv_iter_t *iter = (daos_hl_kv_iter_t *)arg;
+
+	if (rc == 0)
+		kv_iter_advance(iter);
+	else if (iter->user_nr)
+		*iter->user_nr = 0;
+
+	return rc;
+}
+
+int
+daos_hl_kv_iter_next(daos_hl_kv_iter_t *iter, uint32_t *nr, daos_event_t *ev)
+{
+	int rc;
+
+	if (NULL == iter) {
+		DHL_ERROR("NULL iterator passed\n");
+		return -1;
+	}
+
+	iter->nr = 0;
+	iter->user_nr = nr;
+	if (nr)
+		*nr = 0;
+
+	if (iter->eof)
+		return 0;
+
+	snprintf(iter->dkey_str, sizeof(iter->dkey_str), "kv_%u",
+		 iter->bucket);
+	daos_iov_set(&iter->dkey, (void *)iter->dkey_str,
+		     strlen(iter->dkey_str));
+
+	daos_iov_set(&iter->iov, iter->buf, iter->buf_size);
+	iter->sgl.sg_nr.num = 1;
+	iter->sgl.sg_nr.num_out = 0;
+	iter->sgl.sg_iovs = &iter->iov;
+	iter->nr = iter->kds_nr;
+
+	if (ev) {
+		rc = daos_event_register_comp_cb(ev, kv_iter_comp_cb, iter);
+		if (rc != 0) {
+			DHL_ERROR("Failed to register completion cb (%d)\n",
+				  rc);
+			return rc;
+		}
+	}
+
+	rc = daos_obj_list_akey(iter->oh, iter->epoch, &iter->dkey,
+				&iter->nr, iter->kds, &iter->sgl,
+				&iter->anchor, ev);
+	if (0 != rc) {
+		DHL_ERROR("Akey list of dkey %s failed (%d)\n",
+			  iter->dkey_str, rc);
+		return rc;
+	}
+
+	if (ev == NULL)
+		kv_iter_advance(iter);
+
+	return 0;
+}
+
+int
+daos_hl_kv_iter_key(daos_hl_kv_iter_t *iter, uint32_t i, char **key,
+		    daos_size_t *len)
+{
+	if (NULL == iter || i >= iter->nr) {
+		DHL_ERROR("Invalid iterator key index\n");
+		return -1;
+	}
+
+	*key = iter->buf + iter->offs[i];
+	*len = iter->kds[i].kd_key_len;
+
+	return 0;
+}
+
+bool
+daos_hl_kv_iter_eof(daos_hl_kv_iter_t *iter)
+{
+	return iter->eof;
+}
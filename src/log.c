@@ -0,0 +1,733 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/log.c
+ *
+ * Leveled logging into per-thread ring buffers. A record only stores the
+ * format string, the source location and a binary copy of the arguments; it is
+ * formatted later, out of the critical path, by a background flush thread, by
+ * daos_hl_log_flush(), at exit, or when the process crashes. Each ring has a
+ * single producer, its thread, and is drained by a single consumer at a time,
+ * so records are published with plain atomic loads and stores. Records below
+ * the current level are filtered by the DHL_* macros before their arguments
+ * are even evaluated.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/syscall.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+
+/** MSC - These are configurable later through hints */
+/** Number of records of the ring of each thread */
+#define DAOS_HL_LOG_RING_NR		512
+/** Bytes of arguments captured with a record, longer ones are truncated */
+#define DAOS_HL_LOG_ARGS_SIZE		192
+/** Time in ms the flush thread sleeps between two drains */
+#define DAOS_HL_LOG_FLUSH_INTERVAL	10
+/** Max length of one formatted record */
+#define DAOS_HL_LOG_LINE_SIZE		1024
+/** Size of the buffer formatted records are gathered in before a write */
+#define DAOS_HL_LOG_BATCH_SIZE		(16 * DAOS_HL_LOG_LINE_SIZE)
+
+/** Current level, records of a higher level are not logged */
+int dhl_log_level = DAOS_HL_LOG_ERROR;
+
+typedef struct {
+	struct timespec	time;
+	const char	*file;
+	const char	*func;
+	const char	*fmt;
+	int		line;
+	int		level;
+	/** arguments past the captured bytes were dropped */
+	bool		truncated;
+	char		args[DAOS_HL_LOG_ARGS_SIZE];
+} log_rec;
+
+typedef struct log_ring {
+	log_rec		recs[DAOS_HL_LOG_RING_NR];
+	/** next record written by the owner thread */
+	uint64_t	head __attribute__((aligned(64)));
+	/** next record formatted by the consumer */
+	uint64_t	tail __attribute__((aligned(64)));
+	/** records dropped because the ring was full */
+	uint64_t	dropped;
+	pid_t		tid;
+	/** whether a live thread writes to the ring */
+	int		owned;
+	struct log_ring	*next;
+} log_ring;
+
+/** A conversion specification of a format string */
+typedef struct {
+	const char	*start;
+	/** offset of the length modifier in the specification */
+	size_t		mod_off;
+	size_t		len;
+	/** number of '*' widths and precisions, each taking an int argument */
+	int		stars;
+	char		mod;
+	char		conv;
+} log_spec;
+
+static const char *log_level_names[] = {
+	[DAOS_HL_LOG_NONE]	= "NONE",
+	[DAOS_HL_LOG_ERROR]	= "ERROR",
+	[DAOS_HL_LOG_WARN]	= "WARN",
+	[DAOS_HL_LOG_INFO]	= "INFO",
+	[DAOS_HL_LOG_DEBUG]	= "DEBUG",
+};
+
+/** signals a crash dumps the rings on */
+static const int log_crash_signals[] = {
+	SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT,
+};
+
+static pthread_once_t	log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t	log_key;
+static pthread_mutex_t	log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t	log_wait_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	log_wait_cond = PTHREAD_COND_INITIALIZER;
+static log_ring		*log_rings;
+static __thread log_ring *log_ring_self;
+static int		log_fd = STDERR_FILENO;
+
+static const char *
+log_spec_parse(const char *p, log_spec *spec)
+{
+	spec->start = p++;
+	spec->stars = 0;
+	spec->mod = 0;
+
+	while (*p && strchr("-+ #0'", *p))
+		p++;
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9')
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+
+	spec->mod_off = p - spec->start;
+	if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l')) {
+		/** 'H' for hh, 'q' for ll */
+		spec->mod = (p[0] == 'h') ? 'H' : 'q';
+		p += 2;
+	} else if (*p && strchr("hlLqjzt", *p)) {
+		spec->mod = *p++;
+	}
+
+	spec->conv = *p;
+	if (*p)
+		p++;
+	spec->len = p - spec->start;
+	return p;
+}
+
+static bool
+log_put(log_rec *rec, size_t *off, const void *val, size_t size)
+{
+	if (*off + size > DAOS_HL_LOG_ARGS_SIZE) {
+		rec->truncated = true;
+		return false;
+	}
+	memcpy(rec->args + *off, val, size);
+	*off += size;
+	return true;
+}
+
+/**
+ * Copy the arguments of \a fmt into the record, in the order of the format
+ * string: ints for '*', intmax_t or uintmax_t for integers, doubles for floats,
+ * pointers, and the bytes of strings, which may not outlive the call.
+ */
+static void
+log_capture(log_rec *rec, const char *fmt, va_list ap)
+{
+	log_spec	spec;
+	size_t		off = 0;
+	const char	*p = fmt;
+	int		s;
+
+	rec->truncated = false;
+
+	while ((p = strchr(p, '%')) != NULL) {
+		p = log_spec_parse(p, &spec);
+
+		for (s = 0; s < spec.stars; s++) {
+			int star = va_arg(ap, int);
+
+			if (!log_put(rec, &off, &star, sizeof(star)))
+				return;
+		}
+
+		switch (spec.conv) {
+		case 'd':
+		case 'i':
+		case 'c': {
+			intmax_t v;
+
+			if (spec.mod == 'l')
+				v = va_arg(ap, long);
+			else if (spec.mod == 'q' || spec.mod == 'L')
+				v = va_arg(ap, long long);
+			else if (spec.mod == 'j')
+				v = va_arg(ap, intmax_t);
+			else if (spec.mod == 'z')
+				v = va_arg(ap, ssize_t);
+			else if (spec.mod == 't')
+				v = va_arg(ap, ptrdiff_t);
+			else
+				v = va_arg(ap, int);
+			if (!log_put(rec, &off, &v, sizeof(v)))
+				return;
+			break;
+		}
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X': {
+			uintmax_t v;
+
+			if (spec.mod == 'l')
+				v = va_arg(ap, unsigned long);
+			else if (spec.mod == 'q' || spec.mod == 'L')
+				v = va_arg(ap, unsigned long long);
+			else if (spec.mod == 'j')
+				v = va_arg(ap, uintmax_t);
+			else if (spec.mod == 'z')
+				v = va_arg(ap, size_t);
+			else if (spec.mod == 't')
+				v = va_arg(ap, ptrdiff_t);
+			else
+				v = va_arg(ap, unsigned int);
+			if (!log_put(rec, &off, &v, sizeof(v)))
+				return;
+			break;
+		}
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A': {
+			double v;
+
+			if (spec.mod == 'L')
+				v = va_arg(ap, long double);
+			else
+				v = va_arg(ap, double);
+			if (!log_put(rec, &off, &v, sizeof(v)))
+				return;
+			break;
+		}
+		case 'p': {
+			void *v = va_arg(ap, void *);
+
+			if (!log_put(rec, &off, &v, sizeof(v)))
+				return;
+			break;
+		}
+		case 's': {
+			const char	*v = va_arg(ap, const char *);
+			size_t		len;
+
+			if (v == NULL)
+				v = "(null)";
+			len = strlen(v);
+			if (off + len + 1 > DAOS_HL_LOG_ARGS_SIZE) {
+				/** keep what fits of the string */
+				len = DAOS_HL_LOG_ARGS_SIZE - off - 1;
+				rec->truncated = true;
+			}
+			memcpy(rec->args + off, v, len);
+			rec->args[off + len] = '\0';
+			off += len + 1;
+			if (rec->truncated)
+				return;
+			break;
+		}
+		case 'n':
+			(void)va_arg(ap, void *);
+			break;
+		case '%':
+			break;
+		default:
+			/** the type of the remaining arguments is unknown */
+			rec->truncated = true;
+			return;
+		}
+	}
+}
+
+/** Print one captured argument with the '*' widths it was captured with */
+#define LOG_EMIT(out, size, sub, stars, nr, v)				\
+	((nr) == 0 ? snprintf(out, size, sub, v) :			\
+	 (nr) == 1 ? snprintf(out, size, sub, (stars)[0], v) :		\
+	 snprintf(out, size, sub, (stars)[0], (stars)[1], v))
+
+/** Format \a rec into \a out, return the length of the line */
+static size_t
+log_format(const log_rec *rec, char *out, size_t size)
+{
+	log_spec	spec;
+	const char	*p = rec->fmt;
+	const char	*lit;
+	size_t		off = 0;
+	size_t		pos;
+	int		stars[2];
+	char		sub[64];
+	int		s, n;
+
+	n = snprintf(out, size, "%ld.%06ld %s %s:%d:%d:%s() ",
+		     (long)rec->time.tv_sec, rec->time.tv_nsec / 1000,
+		     log_level_names[rec->level], rec->file, getpid(),
+		     rec->line, rec->func);
+	pos = MIN((size_t)n, size - 1);
+
+	for (lit = p; (p = strchr(lit, '%')) != NULL; lit = p) {
+		n = MIN((size_t)(p - lit), size - 1 - pos);
+		memcpy(out + pos, lit, n);
+		pos += n;
+
+		p = log_spec_parse(p, &spec);
+		if (spec.conv == '%') {
+			if (pos < size - 1)
+				out[pos++] = '%';
+			continue;
+		}
+		if (spec.conv == 'n')
+			continue;
+
+		for (s = 0; s < spec.stars; s++) {
+			if (off + sizeof(int) > DAOS_HL_LOG_ARGS_SIZE)
+				goto truncated;
+			memcpy(&stars[s], rec->args + off, sizeof(int));
+			off += sizeof(int);
+		}
+
+		/** the specification with the length of the captured type */
+		if (spec.len >= sizeof(sub) - 2)
+			goto truncated;
+		memcpy(sub, spec.start, spec.mod_off);
+		n = spec.mod_off;
+		if (strchr("diouxX", spec.conv))
+			sub[n++] = 'j';
+		sub[n++] = spec.conv;
+		sub[n] = '\0';
+
+		switch (spec.conv) {
+		case 'd':
+		case 'i':
+		case 'c':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X': {
+			intmax_t v;
+
+			if (off + sizeof(v) > DAOS_HL_LOG_ARGS_SIZE)
+				goto truncated;
+			memcpy(&v, rec->args + off, sizeof(v));
+			off += sizeof(v);
+			if (spec.conv == 'c')
+				n = LOG_EMIT(out + pos, size - pos, sub, stars,
+					     spec.stars, (int)v);
+			else
+				n = LOG_EMIT(out + pos, size - pos, sub, stars,
+					     spec.stars, v);
+			break;
+		}
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A': {
+			double v;
+
+			if (off + sizeof(v) > DAOS_HL_LOG_ARGS_SIZE)
+				goto truncated;
+			memcpy(&v, rec->args + off, sizeof(v));
+			off += sizeof(v);
+			n = LOG_EMIT(out + pos, size - pos, sub, stars,
+				     spec.stars, v);
+			break;
+		}
+		case 'p': {
+			void *v;
+
+			if (off + sizeof(v) > DAOS_HL_LOG_ARGS_SIZE)
+				goto truncated;
+			memcpy(&v, rec->args + off, sizeof(v));
+			off += sizeof(v);
+			n = LOG_EMIT(out + pos, size - pos, sub, stars,
+				     spec.stars, v);
+			break;
+		}
+		case 's': {
+			const char *v = rec->args + off;
+
+			if (off >= DAOS_HL_LOG_ARGS_SIZE)
+				goto truncated;
+			off += strlen(v) + 1;
+			n = LOG_EMIT(out + pos, size - pos, sub, stars,
+				     spec.stars, v);
+			break;
+		}
+		default:
+			goto truncated;
+		}
+		pos += MIN((size_t)MAX(n, 0), size - 1 - pos);
+	}
+
+	n = MIN(strlen(lit), size - 1 - pos);
+	memcpy(out + pos, lit, n);
+	pos += n;
+	if (rec->truncated)
+		goto truncated;
+	goto out;
+
+truncated:
+	n = snprintf(out + pos, size - pos, " [truncated]\n");
+	pos += MIN((size_t)n, size - 1 - pos);
+out:
+	if (pos == 0 || out[pos - 1] != '\n') {
+		if (pos == size - 1)
+			pos--;
+		out[pos++] = '\n';
+	}
+	out[pos] = '\0';
+	return pos;
+}
+
+static void
+log_write(const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(log_fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/**
+ * Format and write the pending records of all rings. On a crash, the lock may
+ * be held by the crashing thread, so the rings are drained without it.
+ */
+static void
+log_drain(bool crash)
+{
+	char		batch[DAOS_HL_LOG_BATCH_SIZE];
+	size_t		len = 0;
+	log_ring	*ring;
+	uint64_t	head, tail, dropped;
+	bool		locked = true;
+
+	if (crash)
+		locked = (pthread_mutex_trylock(&log_drain_lock) == 0);
+	else
+		pthread_mutex_lock(&log_drain_lock);
+
+	for (ring = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE); ring;
+	     ring = ring->next) {
+		dropped = __atomic_exchange_n(&ring->dropped, 0,
+					      __ATOMIC_RELAXED);
+		if (dropped) {
+			int n;
+
+			if (sizeof(batch) - len < DAOS_HL_LOG_LINE_SIZE) {
+				log_write(batch, len);
+				len = 0;
+			}
+			n = snprintf(batch + len, DAOS_HL_LOG_LINE_SIZE,
+				     "%d: %"PRIu64" log records dropped\n",
+				     ring->tid, dropped);
+			len += MIN((size_t)MAX(n, 0),
+				   DAOS_HL_LOG_LINE_SIZE - 1);
+		}
+
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		for (tail = ring->tail; tail != head; tail++) {
+			if (sizeof(batch) - len < DAOS_HL_LOG_LINE_SIZE) {
+				log_write(batch, len);
+				len = 0;
+			}
+			len += log_format(&ring->recs[tail %
+						      DAOS_HL_LOG_RING_NR],
+					  batch + len, DAOS_HL_LOG_LINE_SIZE);
+			/** hand the record back to the producer */
+			__atomic_store_n(&ring->tail, tail + 1,
+					 __ATOMIC_RELEASE);
+		}
+	}
+	log_write(batch, len);
+
+	if (locked)
+		pthread_mutex_unlock(&log_drain_lock);
+}
+
+static void *
+log_flush_func(void *arg)
+{
+	struct timespec	deadline;
+
+	while (1) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += DAOS_HL_LOG_FLUSH_INTERVAL * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+
+		pthread_mutex_lock(&log_wait_lock);
+		pthread_cond_timedwait(&log_wait_cond, &log_wait_lock,
+				       &deadline);
+		pthread_mutex_unlock(&log_wait_lock);
+
+		log_drain(false);
+	}
+
+	return NULL;
+}
+
+static void
+log_crash(int sig)
+{
+	log_drain(true);
+	/** the handler was reset to the default one, crash for real */
+	raise(sig);
+}
+
+static void
+log_exit(void)
+{
+	log_drain(false);
+}
+
+static void
+log_ring_release(void *arg)
+{
+	log_ring *ring = arg;
+
+	/** the pending records are still drained, and the ring reused */
+	__atomic_store_n(&ring->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void
+log_init(void)
+{
+	struct sigaction	act, old;
+	pthread_attr_t		attr;
+	pthread_t		thread;
+	char			*val;
+	int			i, fd;
+
+	pthread_key_create(&log_key, log_ring_release);
+
+	val = getenv("DAOS_HL_LOG_FILE");
+	if (val) {
+		fd = open(val, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (fd >= 0)
+			log_fd = fd;
+	}
+
+	/** dump the rings on a crash, unless the application handles it */
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = log_crash;
+	act.sa_flags = SA_RESETHAND | SA_NODEFER;
+	sigemptyset(&act.sa_mask);
+	for (i = 0; i < (int)(sizeof(log_crash_signals) / sizeof(int)); i++) {
+		if (sigaction(log_crash_signals[i], NULL, &old) == 0 &&
+		    old.sa_handler == SIG_DFL)
+			sigaction(log_crash_signals[i], &act, NULL);
+	}
+
+	atexit(log_exit);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	/** without it, records are still flushed by daos_hl_log_flush */
+	pthread_create(&thread, &attr, log_flush_func, NULL);
+	pthread_attr_destroy(&attr);
+}
+
+static log_ring *
+log_ring_get(void)
+{
+	log_ring	*ring = log_ring_self;
+	int		free_ring;
+
+	if (ring)
+		return ring;
+
+	pthread_once(&log_once, log_init);
+
+	/** reuse the ring of an exited thread */
+	for (ring = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE); ring;
+	     ring = ring->next) {
+		free_ring = 0;
+		if (__atomic_compare_exchange_n(&ring->owned, &free_ring, 1,
+						false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			break;
+	}
+
+	if (ring == NULL) {
+		if (posix_memalign((void **)&ring, 64, sizeof(*ring)) != 0)
+			return NULL;
+		memset(ring, 0, sizeof(*ring));
+		ring->owned = 1;
+		ring->next = __atomic_load_n(&log_rings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&log_rings, &ring->next,
+						    ring, true,
+						    __ATOMIC_RELEASE,
+						    __ATOMIC_RELAXED))
+			;
+	}
+
+	ring->tid = syscall(SYS_gettid);
+	pthread_setspecific(log_key, ring);
+	log_ring_self = ring;
+	return ring;
+}
+
+void
+dhl_log(int level, const char *file, int line, const char *func,
+	const char *fmt, ...)
+{
+	log_ring	*ring;
+	log_rec		*rec;
+	uint64_t	head, tail;
+	va_list		ap;
+
+	ring = log_ring_get();
+	if (ring == NULL)
+		return;
+
+	head = ring->head;
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= DAOS_HL_LOG_RING_NR) {
+		__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	rec = &ring->recs[head % DAOS_HL_LOG_RING_NR];
+	clock_gettime(CLOCK_REALTIME, &rec->time);
+	rec->file = file;
+	rec->line = line;
+	rec->func = func;
+	rec->fmt = fmt;
+	rec->level = level;
+
+	va_start(ap, fmt);
+	log_capture(rec, fmt, ap);
+	va_end(ap);
+
+	/** publish the record to the consumer */
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	/**
+	 * errors, and bursts filling the ring, are drained without waiting for
+	 * the next interval
+	 */
+	if (level == DAOS_HL_LOG_ERROR ||
+	    head - tail >= DAOS_HL_LOG_RING_NR / 2)
+		pthread_cond_signal(&log_wait_cond);
+}
+
+int
+daos_hl_log_level_set(daos_hl_log_level_t level)
+{
+	if (level < DAOS_HL_LOG_NONE || level > DAOS_HL_LOG_DEBUG) {
+		DHL_ERROR("Invalid log level %d\n", level);
+		return -1;
+	}
+
+	__atomic_store_n(&dhl_log_level, level, __ATOMIC_RELAXED);
+	return 0;
+}
+
+int
+daos_hl_log_flush(void)
+{
+	log_drain(false);
+	return 0;
+}
+
+/** Set the level from DAOS_HL_LOG_LEVEL, a level name or number */
+static void __attribute__((constructor))
+log_env_init(void)
+{
+	char	*val;
+	int	i;
+
+	val = getenv("DAOS_HL_LOG_LEVEL");
+	if (val == NULL)
+		return;
+
+	for (i = DAOS_HL_LOG_NONE; i <= DAOS_HL_LOG_DEBUG; i++) {
+		if (strcasecmp(val, log_level_names[i]) == 0) {
+			dhl_log_level = i;
+			return;
+		}
+	}
+	if (val[0] >= '0' && val[0] <= '9')
+		dhl_log_level = MIN(atoi(val), DAOS_HL_LOG_DEBUG);
+}
@@ -0,0 +1,189 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/progress.c
+ *
+ * Background progress thread. Completions of DAOS events only happen while
+ * some thread polls an event queue, and the dkey I/Os of an operation are
+ * submitted from the completion callbacks as its in-flight window drains. The
+ * progress thread keeps polling an event queue of its own, which drives the
+ * network progress of every event of the process: the completion callbacks
+ * run from it, and completed user events are queued on their own event queue
+ * for the application to reap. A thread started from the environment is
+ * stopped at exit, unless the application stopped it before.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/io.h>
+
+/** Default time in us the progress thread waits in each poll */
+#define DAOS_HL_PROGRESS_TIMEOUT	1000
+
+static pthread_mutex_t	progress_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t	progress_once = PTHREAD_ONCE_INIT;
+static pthread_t	progress_thread;
+static daos_handle_t	progress_eqh;
+static int64_t		progress_timeout;
+static bool		progress_running;
+static volatile bool	progress_stop;
+
+static void *
+progress_func(void *arg)
+{
+	daos_event_t	*evp;
+	int		rc;
+
+	while (!progress_stop) {
+		rc = daos_eq_poll(progress_eqh, 0, progress_timeout, 1, &evp);
+		if (rc < 0) {
+			DHL_ERROR("Progress thread failed to poll (%d)\n", rc);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+int
+daos_hl_progress_start(daos_hl_progress_attr_t *attr)
+{
+	int	cpu = -1;
+	int	rc;
+
+	pthread_mutex_lock(&progress_lock);
+
+	if (progress_running) {
+		DHL_ERROR("Progress thread already running\n");
+		rc = -1;
+		goto out;
+	}
+
+	progress_timeout = DAOS_HL_PROGRESS_TIMEOUT;
+	if (attr) {
+		cpu = attr->dp_cpu;
+		if (attr->dp_poll_timeout > 0)
+			progress_timeout = attr->dp_poll_timeout;
+	}
+
+	rc = daos_eq_create(&progress_eqh);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create event queue (%d)\n", rc);
+		goto out;
+	}
+
+	progress_stop = false;
+	rc = pthread_create(&progress_thread, NULL, progress_func, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to create progress thread (%d)\n", rc);
+		daos_eq_destroy(progress_eqh, 0);
+		rc = -1;
+		goto out;
+	}
+
+	if (cpu >= 0) {
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		rc = pthread_setaffinity_np(progress_thread, sizeof(cpus),
+					    &cpus);
+		if (rc != 0)
+			/** the thread still makes progress, just unbound */
+			DHL_ERROR("Failed to bind progress thread to CPU %d "
+				  "(%d)\n", cpu, rc);
+		rc = 0;
+	}
+
+	progress_running = true;
+out:
+	pthread_mutex_unlock(&progress_lock);
+	return rc;
+}
+
+int
+daos_hl_progress_stop(void)
+{
+	int rc = 0;
+
+	pthread_mutex_lock(&progress_lock);
+
+	if (!progress_running)
+		goto out;
+
+	progress_stop = true;
+	pthread_join(progress_thread, NULL);
+	progress_running = false;
+
+	rc = daos_eq_destroy(progress_eqh, 0);
+	if (rc != 0)
+		DHL_ERROR("Failed to destroy event queue (%d)\n", rc);
+out:
+	pthread_mutex_unlock(&progress_lock);
+	return rc;
+}
+
+static void
+progress_atexit(void)
+{
+	daos_hl_progress_stop();
+}
+
+static void
+progress_env_start(void)
+{
+	daos_hl_progress_attr_t	attr;
+	char			*val;
+
+	val = getenv("DAOS_HL_PROGRESS");
+	if (val == NULL || atoi(val) == 0)
+		return;
+
+	attr.dp_cpu = -1;
+	attr.dp_poll_timeout = 0;
+
+	val = getenv("DAOS_HL_PROGRESS_CPU");
+	if (val)
+		attr.dp_cpu = atoi(val);
+
+	val = getenv("DAOS_HL_PROGRESS_TIMEOUT");
+	if (val)
+		attr.dp_poll_timeout = atoll(val);
+
+	if (daos_hl_progress_start(&attr) != 0)
+		return;
+
+	if (atexit(progress_atexit) != 0)
+		DHL_ERROR("Failed to register the progress thread stop "
+			  "at exit\n");
+}
+
+void
+io_progress_auto_start(void)
+{
+	pthread_once(&progress_once, progress_env_start);
+}
@@ -0,0 +1,777 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/ragged/ragged.c
+ */
+
+#include <pthread.h>
+#include <uuid/uuid.h>
+#include <daos_hl.h>
+#include <daos_hl/common.h>
+#include <daos_hl/array.h>
+
+/** field of the compound records holding the end offset of each element */
+#define DAOS_HL_RAGGED_END_FIELD	"ragged_end"
+/** akey under the array metadata dkey holding the number of elements */
+#define DAOS_HL_RAGGED_NR_AKEY		"ragged_nr"
+/**
+ * akey under the array metadata dkey holding the uuid of the handle open for
+ * writing, all zeros if there is none
+ */
+#define DAOS_HL_RAGGED_WRITER_AKEY	"ragged_writer"
+
+/** Number of end offsets in a block of the index cache */
+#define DAOS_HL_RAGGED_IDX_BLOCK	4096
+/** Largest index read in the cache on open */
+#define DAOS_HL_RAGGED_PREFETCH		(16 * 1048576)
+
+struct daos_hl_ragged {
+	daos_handle_t		oh;
+	daos_epoch_t		epoch;
+	bool			rdonly;
+	/** writer claim of a read-write handle */
+	uuid_t			writer;
+	pthread_mutex_t		lock;
+	/** number of elements */
+	uint64_t		nr;
+	/** cached blocks of end offsets, NULL until read */
+	uint64_t		**blocks;
+	uint64_t		nblocks;
+};
+
+/** Element span [lo, hi] whose end offsets an access needs */
+typedef struct {
+	uint64_t	lo;
+	uint64_t	hi;
+} ragged_span;
+
+static uint64_t
+ragged_end(daos_hl_ragged_t *ragged, uint64_t i)
+{
+	return ragged->blocks[i / DAOS_HL_RAGGED_IDX_BLOCK]
+		[i % DAOS_HL_RAGGED_IDX_BLOCK];
+}
+
+static uint64_t
+ragged_start(daos_hl_ragged_t *ragged, uint64_t i)
+{
+	return i ? ragged_end(ragged, i - 1) : 0;
+}
+
+/** Grow the block table of the cache to hold \a nblocks blocks */
+static int
+ragged_grow(daos_hl_ragged_t *ragged, uint64_t nblocks)
+{
+	uint64_t **blocks;
+
+	if (nblocks <= ragged->nblocks)
+		return 0;
+
+	blocks = (uint64_t **)realloc(ragged->blocks,
+				      nblocks * sizeof(*blocks));
+	if (NULL == blocks) {
+		DHL_ERROR("Failed memory allocation\n");
+		return -1;
+	}
+	memset(blocks + ragged->nblocks, 0,
+	       (nblocks - ragged->nblocks) * sizeof(*blocks));
+	ragged->blocks = blocks;
+	ragged->nblocks = nblocks;
+
+	return 0;
+}
+
+/**
+ * Read in the cache the blocks of end offsets covering \a spans that are not
+ * cached yet, all in one read of the index field. The spans are within the
+ * current elements.
+ */
+static int
+ragged_load(daos_hl_ragged_t *ragged, ragged_span *spans, daos_size_t nr)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		*rg = NULL;
+	daos_hl_field_mem_t	mem;
+	uint64_t		*buf = NULL, *ids = NULL;
+	daos_size_t		nids = 0, cap = 0, total = 0, i;
+	uint64_t		b;
+	int			rc;
+
+	rc = ragged_grow(ragged, (ragged->nr + DAOS_HL_RAGGED_IDX_BLOCK - 1) /
+			 DAOS_HL_RAGGED_IDX_BLOCK);
+	if (rc != 0)
+		return rc;
+
+	/** missing blocks are allocated first, so they are listed once */
+	for (i = 0; i < nr; i++) {
+		for (b = spans[i].lo / DAOS_HL_RAGGED_IDX_BLOCK;
+		     b <= spans[i].hi / DAOS_HL_RAGGED_IDX_BLOCK; b++) {
+			if (ragged->blocks[b])
+				continue;
+			if (nids == cap) {
+				uint64_t *tmp;
+
+				cap = cap ? cap * 2 : 16;
+				tmp = (uint64_t *)realloc(ids,
+							  cap * sizeof(*ids));
+				if (NULL == tmp) {
+					DHL_ERROR("Failed memory allocation\n");
+					rc = -1;
+					goto out;
+				}
+				ids = tmp;
+			}
+			ragged->blocks[b] = (uint64_t *)calloc(
+				DAOS_HL_RAGGED_IDX_BLOCK, sizeof(uint64_t));
+			if (NULL == ragged->blocks[b]) {
+				DHL_ERROR("Failed memory allocation\n");
+				rc = -1;
+				goto out;
+			}
+			ids[nids++] = b;
+		}
+	}
+	if (nids == 0)
+		goto out;
+
+	rg = (daos_hl_range_t *)malloc(nids * sizeof(*rg));
+	if (NULL == rg) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto out;
+	}
+	for (i = 0; i < nids; i++) {
+		rg[i].index = ids[i] * DAOS_HL_RAGGED_IDX_BLOCK;
+		rg[i].len = ragged->nr - rg[i].index;
+		if (rg[i].len > DAOS_HL_RAGGED_IDX_BLOCK)
+			rg[i].len = DAOS_HL_RAGGED_IDX_BLOCK;
+		total += rg[i].len;
+	}
+
+	buf = (uint64_t *)malloc(total * sizeof(uint64_t));
+	if (NULL == buf) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto out;
+	}
+
+	ranges.ranges_nr = nids;
+	ranges.ranges = rg;
+	mem.fm_name = DAOS_HL_RAGGED_END_FIELD;
+	mem.fm_buf = buf;
+	mem.fm_stride = sizeof(uint64_t);
+
+	rc = daos_hl_array_read_fields(ragged->oh, ragged->epoch, &ranges, 1,
+				       &mem, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read element offsets (%d)\n", rc);
+		goto out;
+	}
+
+	for (i = 0, total = 0; i < nids; i++) {
+		memcpy(ragged->blocks[ids[i]], buf + total,
+		       rg[i].len * sizeof(uint64_t));
+		total += rg[i].len;
+	}
+
+out:
+	/** blocks that could not be read stay out of the cache */
+	if (rc != 0) {
+		for (i = 0; i < nids; i++) {
+			free(ragged->blocks[ids[i]]);
+			ragged->blocks[ids[i]] = NULL;
+		}
+	}
+	free(buf);
+	free(rg);
+	free(ids);
+	return rc;
+}
+
+/**
+ * Claim the array for writing through the handle. If \a check, fail if another
+ * handle holds the claim, otherwise take it over. The claim is not atomic, a
+ * writer that lost it fails in ragged_check_writer().
+ */
+static int
+ragged_claim(daos_hl_ragged_t *ragged, bool check)
+{
+	uuid_t	cur;
+	int	rc;
+
+	if (check) {
+		rc = array_md_access(ragged->oh, ragged->epoch,
+				     DAOS_HL_RAGGED_WRITER_AKEY, cur,
+				     sizeof(uuid_t), DAOS_HL_OP_READ);
+		if (rc != 0) {
+			DHL_ERROR("Failed to read writer claim (%d)\n", rc);
+			return rc;
+		}
+		if (!uuid_is_null(cur)) {
+			DHL_ERROR("Ragged array is already open for writing\n");
+			return -1;
+		}
+	}
+
+	uuid_generate(ragged->writer);
+	rc = array_md_access(ragged->oh, ragged->epoch,
+			     DAOS_HL_RAGGED_WRITER_AKEY, ragged->writer,
+			     sizeof(uuid_t), DAOS_HL_OP_WRITE);
+	if (rc != 0)
+		DHL_ERROR("Failed to write writer claim (%d)\n", rc);
+
+	return rc;
+}
+
+/**
+ * Check that the handle still holds the writer claim and that the element
+ * count stored matches the cached one, so that no other writer changed the
+ * array behind the cache.
+ */
+static int
+ragged_check_writer(daos_hl_ragged_t *ragged)
+{
+	uuid_t		cur;
+	uint64_t	nr;
+	int		rc;
+
+	rc = array_md_access(ragged->oh, ragged->epoch,
+			     DAOS_HL_RAGGED_WRITER_AKEY, cur, sizeof(uuid_t),
+			     DAOS_HL_OP_READ);
+	if (rc == 0)
+		rc = array_md_access(ragged->oh, ragged->epoch,
+				     DAOS_HL_RAGGED_NR_AKEY, &nr, sizeof(nr),
+				     DAOS_HL_OP_READ);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read writer state (%d)\n", rc);
+		return rc;
+	}
+
+	if (uuid_compare(cur, ragged->writer) != 0 || nr != ragged->nr) {
+		DHL_ERROR("Ragged array was changed by another writer\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Drop the writer claim of the handle, if it still holds it */
+static int
+ragged_release(daos_hl_ragged_t *ragged)
+{
+	uuid_t	cur;
+	int	rc;
+
+	rc = array_md_access(ragged->oh, ragged->epoch,
+			     DAOS_HL_RAGGED_WRITER_AKEY, cur, sizeof(uuid_t),
+			     DAOS_HL_OP_READ);
+	if (rc != 0 || uuid_compare(cur, ragged->writer) != 0)
+		return rc;
+
+	uuid_clear(cur);
+	rc = array_md_access(ragged->oh, ragged->epoch,
+			     DAOS_HL_RAGGED_WRITER_AKEY, cur, sizeof(uuid_t),
+			     DAOS_HL_OP_WRITE);
+	if (rc != 0)
+		DHL_ERROR("Failed to drop writer claim (%d)\n", rc);
+
+	return rc;
+}
+
+static void
+ragged_free(daos_hl_ragged_t *ragged)
+{
+	uint64_t b;
+
+	for (b = 0; b < ragged->nblocks; b++)
+		free(ragged->blocks[b]);
+	free(ragged->blocks);
+	pthread_mutex_destroy(&ragged->lock);
+	free(ragged);
+}
+
+static daos_hl_ragged_t *
+ragged_alloc(daos_epoch_t epoch, bool rdonly)
+{
+	daos_hl_ragged_t *ragged;
+
+	ragged = (daos_hl_ragged_t *)calloc(1, sizeof(daos_hl_ragged_t));
+	if (NULL == ragged) {
+		DHL_ERROR("Failed memory allocation\n");
+		return NULL;
+	}
+
+	ragged->epoch = epoch;
+	ragged->rdonly = rdonly;
+	pthread_mutex_init(&ragged->lock, NULL);
+
+	return ragged;
+}
+
+int
+daos_hl_ragged_create(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		      daos_hl_array_attr_t *attr, daos_hl_ragged_t **raggedp)
+{
+	daos_hl_ragged_t	*ragged;
+	daos_hl_field_t		field;
+	int			rc;
+
+	if (NULL == raggedp) {
+		DHL_ERROR("NULL ragged array pointer passed\n");
+		return -1;
+	}
+
+	ragged = ragged_alloc(epoch, false);
+	if (NULL == ragged)
+		return -1;
+
+	memset(&field, 0, sizeof(field));
+	strcpy(field.df_name, DAOS_HL_RAGGED_END_FIELD);
+	field.df_size = sizeof(uint64_t);
+
+	rc = daos_hl_array_create_fields(coh, oid, epoch, attr, 1, &field,
+					 &ragged->oh);
+	if (rc != 0) {
+		ragged_free(ragged);
+		return rc;
+	}
+
+	rc = array_md_access(ragged->oh, epoch, DAOS_HL_RAGGED_NR_AKEY,
+			     &ragged->nr, sizeof(ragged->nr),
+			     DAOS_HL_OP_WRITE);
+	if (rc != 0)
+		DHL_ERROR("Failed to write element count (%d)\n", rc);
+	else
+		rc = ragged_claim(ragged, false);
+	if (rc != 0) {
+		daos_hl_array_close(ragged->oh);
+		ragged_free(ragged);
+		return rc;
+	}
+
+	*raggedp = ragged;
+
+	return 0;
+}
+
+int
+daos_hl_ragged_open(daos_handle_t coh, daos_obj_id_t oid, daos_epoch_t epoch,
+		    unsigned int mode, daos_hl_ragged_t **raggedp)
+{
+	daos_hl_ragged_t	*ragged;
+	const array_fields	*fields;
+	ragged_span		span;
+	unsigned int		oo_mode = mode & ~DAOS_HL_RAGGED_STEAL;
+	int			rc;
+
+	if (NULL == raggedp) {
+		DHL_ERROR("NULL ragged array pointer passed\n");
+		return -1;
+	}
+
+	ragged = ragged_alloc(epoch, DAOS_OO_RO == oo_mode);
+	if (NULL == ragged)
+		return -1;
+
+	rc = daos_hl_array_open(coh, oid, epoch, oo_mode, NULL, &ragged->oh);
+	if (rc != 0) {
+		ragged_free(ragged);
+		return rc;
+	}
+
+	fields = array_fields_get(ragged->oh);
+	if (NULL == fields || fields->nr != 1 ||
+	    strcmp(fields->fields[0].df_name, DAOS_HL_RAGGED_END_FIELD) != 0) {
+		DHL_ERROR("Object is not a ragged array\n");
+		rc = -1;
+		goto err;
+	}
+
+	rc = array_md_access(ragged->oh, epoch, DAOS_HL_RAGGED_NR_AKEY,
+			     &ragged->nr, sizeof(ragged->nr), DAOS_HL_OP_READ);
+	if (rc != 0) {
+		DHL_ERROR("Failed to read element count (%d)\n", rc);
+		goto err;
+	}
+
+	if (!ragged->rdonly) {
+		rc = ragged_claim(ragged, !(mode & DAOS_HL_RAGGED_STEAL));
+		if (rc != 0)
+			goto err;
+	}
+
+	if (ragged->nr && ragged->nr * sizeof(uint64_t) <=
+	    DAOS_HL_RAGGED_PREFETCH) {
+		span.lo = 0;
+		span.hi = ragged->nr - 1;
+		rc = ragged_load(ragged, &span, 1);
+		if (rc != 0)
+			goto err;
+	}
+
+	*raggedp = ragged;
+
+	return 0;
+
+err:
+	daos_hl_array_close(ragged->oh);
+	ragged_free(ragged);
+	return rc;
+}
+
+int
+daos_hl_ragged_close(daos_hl_ragged_t *ragged)
+{
+	int rc;
+
+	if (NULL == ragged)
+		return 0;
+
+	rc = ragged->rdonly ? 0 : ragged_release(ragged);
+	if (daos_hl_array_close(ragged->oh) != 0 && rc == 0)
+		rc = -1;
+	ragged_free(ragged);
+
+	return rc;
+}
+
+int
+daos_hl_ragged_count(daos_hl_ragged_t *ragged, daos_size_t *nr)
+{
+	if (NULL == ragged || NULL == nr) {
+		DHL_ERROR("Invalid ragged array or count pointer passed\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&ragged->lock);
+	*nr = ragged->nr;
+	pthread_mutex_unlock(&ragged->lock);
+
+	return 0;
+}
+
+int
+daos_hl_ragged_get(daos_hl_ragged_t *ragged, daos_hl_array_ranges_t *elems,
+		   daos_size_t *lens, void *buf, daos_size_t buf_len,
+		   daos_event_t *ev)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		*rg = NULL;
+	ragged_span		*spans = NULL;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	daos_size_t		nspans = 0, total = 0, i, k = 0;
+	uint64_t		e, end;
+	int			rc = 0;
+
+	if (NULL == ragged || NULL == elems || NULL == lens) {
+		DHL_ERROR("Invalid ragged array or ranges passed\n");
+		return -1;
+	}
+
+	rg = (daos_hl_range_t *)malloc(elems->ranges_nr * sizeof(*rg));
+	spans = (ragged_span *)malloc(elems->ranges_nr * sizeof(*spans));
+	if ((NULL == rg || NULL == spans) && elems->ranges_nr) {
+		DHL_ERROR("Failed memory allocation\n");
+		free(rg);
+		free(spans);
+		return -1;
+	}
+
+	pthread_mutex_lock(&ragged->lock);
+
+	for (i = 0; i < elems->ranges_nr; i++) {
+		daos_hl_range_t *el = &elems->ranges[i];
+
+		if (el->index > ragged->nr ||
+		    el->len > ragged->nr - el->index) {
+			DHL_ERROR("Elements [%zu, %zu) past the %zu elements\n",
+				  (size_t)el->index,
+				  (size_t)(el->index + el->len),
+				  (size_t)ragged->nr);
+			rc = -1;
+			goto out;
+		}
+		if (el->len == 0)
+			continue;
+		spans[nspans].lo = el->index ? el->index - 1 : 0;
+		spans[nspans].hi = el->index + el->len - 1;
+		nspans++;
+	}
+
+	rc = ragged_load(ragged, spans, nspans);
+	if (rc != 0)
+		goto out;
+
+	/** one payload range per element range, elements are contiguous */
+	ranges.ranges_nr = 0;
+	ranges.ranges = rg;
+	for (i = 0; i < elems->ranges_nr; i++) {
+		daos_hl_range_t *el = &elems->ranges[i];
+		daos_off_t	start;
+
+		if (el->len == 0)
+			continue;
+		start = ragged_start(ragged, el->index);
+		end = start;
+		for (e = el->index; e < el->index + el->len; e++) {
+			lens[k++] = ragged_end(ragged, e) - end;
+			end = ragged_end(ragged, e);
+		}
+		rg[ranges.ranges_nr].index = start;
+		rg[ranges.ranges_nr].len = end - start;
+		total += end - start;
+		if (end > start)
+			ranges.ranges_nr++;
+	}
+
+out:
+	pthread_mutex_unlock(&ragged->lock);
+	free(spans);
+
+	if (rc == 0 && total > buf_len) {
+		DHL_ERROR("Buffer of %zu bytes too small for %zu bytes\n",
+			  (size_t)buf_len, (size_t)total);
+		rc = -1;
+	}
+	if (rc != 0) {
+		free(rg);
+		return rc;
+	}
+
+	sgl.sg_nr.num = 1;
+	sgl.sg_nr.num_out = 0;
+	daos_iov_set(&iov, buf, total);
+	sgl.sg_iovs = &iov;
+
+	/** the ranges are planned in the call, the read can still run */
+	rc = daos_hl_array_read(ragged->oh, ragged->epoch, &ranges, &sgl, NULL,
+				ev);
+	free(rg);
+
+	return rc;
+}
+
+int
+daos_hl_ragged_put(daos_hl_ragged_t *ragged, daos_hl_array_ranges_t *elems,
+		   const daos_size_t *lens, const void *buf)
+{
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		*rg = NULL;
+	daos_hl_range_t		idx_rg;
+	ragged_span		*spans = NULL;
+	daos_hl_field_mem_t	mem;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	uint64_t		*ends = NULL;
+	uint64_t		nr, tail_end, e, prev;
+	daos_size_t		nspans = 0, total = 0, i, k;
+	int			rc = 0;
+
+	if (NULL == ragged || NULL == elems || NULL == lens) {
+		DHL_ERROR("Invalid ragged array or ranges passed\n");
+		return -1;
+	}
+	if (ragged->rdonly) {
+		DHL_ERROR("Ragged array is open read-only\n");
+		return -1;
+	}
+
+	rg = (daos_hl_range_t *)malloc(elems->ranges_nr * sizeof(*rg));
+	spans = (ragged_span *)malloc(elems->ranges_nr * sizeof(*spans));
+	if ((NULL == rg || NULL == spans) && elems->ranges_nr) {
+		DHL_ERROR("Failed memory allocation\n");
+		rc = -1;
+		goto out_free;
+	}
+
+	pthread_mutex_lock(&ragged->lock);
+
+	rc = ragged_check_writer(ragged);
+	if (rc != 0)
+		goto out;
+
+	/** validate the ranges and list the offsets they need from the cache */
+	nr = ragged->nr;
+	for (i = 0; i < elems->ranges_nr; i++) {
+		daos_hl_range_t *el = &elems->ranges[i];
+
+		if (el->index > nr ||
+		    (i && el->index < elems->ranges[i - 1].index +
+		     elems->ranges[i - 1].len)) {
+			DHL_ERROR("Element range %zu is unsorted or leaves a "
+				  "gap\n", (size_t)i);
+			rc = -1;
+			goto out;
+		}
+		if (el->len && ragged->nr && el->index <= ragged->nr) {
+			uint64_t hi = el->index + el->len;
+
+			if (hi > ragged->nr)
+				hi = ragged->nr;
+			spans[nspans].lo = el->index ? el->index - 1 : 0;
+			spans[nspans].hi = hi - 1;
+			if (spans[nspans].lo <= spans[nspans].hi)
+				nspans++;
+		}
+		if (el->index + el->len > nr)
+			nr = el->index + el->len;
+	}
+
+	rc = ragged_load(ragged, spans, nspans);
+	if (rc != 0)
+		goto out;
+
+	if (nr > ragged->nr) {
+		ends = (uint64_t *)malloc((nr - ragged->nr) * sizeof(uint64_t));
+		if (NULL == ends) {
+			DHL_ERROR("Failed memory allocation\n");
+			rc = -1;
+			goto out;
+		}
+	}
+
+	/**
+	 * Resolve the payload range of each element range. A range starting
+	 * past the current elements follows the last element appended by the
+	 * previous range.
+	 */
+	tail_end = 0;
+	ranges.ranges_nr = 0;
+	ranges.ranges = rg;
+	for (i = 0, k = 0; i < elems->ranges_nr; i++) {
+		daos_hl_range_t *el = &elems->ranges[i];
+		daos_off_t	start;
+
+		if (el->len == 0)
+			continue;
+		if (el->index <= ragged->nr)
+			start = ragged_start(ragged, el->index);
+		else
+			start = tail_end;
+
+		prev = start;
+		for (e = el->index; e < el->index + el->len; e++, k++) {
+			if (e < ragged->nr) {
+				if (ragged_end(ragged, e) - prev != lens[k]) {
+					DHL_ERROR("Element %zu can only be "
+						  "rewritten with its length\n",
+						  (size_t)e);
+					rc = -1;
+					goto out;
+				}
+			} else {
+				ends[e - ragged->nr] = prev + lens[k];
+			}
+			prev += lens[k];
+		}
+		if (e > ragged->nr)
+			tail_end = prev;
+
+		rg[ranges.ranges_nr].index = start;
+		rg[ranges.ranges_nr].len = prev - start;
+		total += prev - start;
+		if (prev > start)
+			ranges.ranges_nr++;
+	}
+
+	/** payload first, so new offsets never point at missing data */
+	if (total) {
+		sgl.sg_nr.num = 1;
+		sgl.sg_nr.num_out = 0;
+		daos_iov_set(&iov, (void *)buf, total);
+		sgl.sg_iovs = &iov;
+
+		rc = daos_hl_array_write(ragged->oh, ragged->epoch, &ranges,
+					 &sgl, NULL, NULL);
+		if (rc != 0) {
+			DHL_ERROR("Failed to write element payload (%d)\n",
+				  rc);
+			goto out;
+		}
+	}
+
+	if (nr == ragged->nr)
+		goto out;
+
+	/** the appended elements are one run of records of the index */
+	idx_rg.index = ragged->nr;
+	idx_rg.len = nr - ragged->nr;
+	ranges.ranges_nr = 1;
+	ranges.ranges = &idx_rg;
+	mem.fm_name = DAOS_HL_RAGGED_END_FIELD;
+	mem.fm_buf = ends;
+	mem.fm_stride = sizeof(uint64_t);
+
+	rc = daos_hl_array_write_fields(ragged->oh, ragged->epoch, &ranges, 1,
+					&mem, NULL);
+	if (rc != 0) {
+		DHL_ERROR("Failed to write element offsets (%d)\n", rc);
+		goto out;
+	}
+
+	rc = array_md_access(ragged->oh, ragged->epoch, DAOS_HL_RAGGED_NR_AKEY,
+			     &nr, sizeof(nr), DAOS_HL_OP_WRITE);
+	if (rc != 0) {
+		DHL_ERROR("Failed to write element count (%d)\n", rc);
+		goto out;
+	}
+
+	/** write the new offsets through the cache */
+	rc = ragged_grow(ragged, (nr + DAOS_HL_RAGGED_IDX_BLOCK - 1) /
+			 DAOS_HL_RAGGED_IDX_BLOCK);
+	for (e = ragged->nr; rc == 0 && e < nr; e++) {
+		uint64_t b = e / DAOS_HL_RAGGED_IDX_BLOCK;
+
+		if (NULL == ragged->blocks[b]) {
+			ragged->blocks[b] = (uint64_t *)calloc(
+				DAOS_HL_RAGGED_IDX_BLOCK, sizeof(uint64_t));
+			if (NULL == ragged->blocks[b]) {
+				DHL_ERROR("Failed memory allocation\n");
+				rc = -1;
+				break;
+			}
+		}
+		ragged->blocks[b][e % DAOS_HL_RAGGED_IDX_BLOCK] =
+			ends[e - ragged->nr];
+	}
+	/** a block left partial is dropped, and read again when needed */
+	if (rc != 0)
+		for (e = ragged->nr / DAOS_HL_RAGGED_IDX_BLOCK;
+		     e < ragged->nblocks; e++) {
+			free(ragged->blocks[e]);
+			ragged->blocks[e] = NULL;
+		}
+	ragged->nr = nr;
+	rc = 0;
+
+out:
+	pthread_mutex_unlock(&ragged->lock);
+out_free:
+	free(ends);
+	free(spans);
+	free(rg);
+	return rc;
+}
@@ -0,0 +1,17 @@
+## -*- Mode: Makefile; -*-
+## vim: set ft=automake :
+##
+## ROMIO build fragment of the daos_hl ADIO driver, copied to adio/ad_daos_hl
+## in the ROMIO tree by the ROMIO option of the daos_hl build.
+
+if BUILD_AD_DAOS_HL
+
+noinst_HEADERS += adio/ad_daos_hl/ad_daos_hl.h
+
+romio_other_sources +=                  \
+    adio/ad_daos_hl/ad_daos_hl.c        \
+    adio/ad_daos_hl/ad_daos_hl_open.c   \
+    adio/ad_daos_hl/ad_daos_hl_io.c     \
+    adio/ad_daos_hl/ad_daos_hl_fcntl.c
+
+endif BUILD_AD_DAOS_HL
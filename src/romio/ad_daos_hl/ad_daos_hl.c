@@ -0,0 +1,204 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/romio/ad_daos_hl/ad_daos_hl.c
+ */
+
+#include <uuid/uuid.h>
+#include "ad_daos_hl.h"
+
+/** Max number of pool service ranks in DAOS_HL_SVC */
+#define ADIOI_DAOS_HL_SVC_MAX	8
+
+struct ADIOI_Fns_struct ADIO_DAOS_HL_operations = {
+	ADIOI_DAOS_HL_Open,		/* Open */
+	ADIOI_GEN_OpenColl,		/* OpenColl */
+	ADIOI_DAOS_HL_ReadContig,	/* ReadContig */
+	ADIOI_DAOS_HL_WriteContig,	/* WriteContig */
+	ADIOI_GEN_ReadStridedColl,	/* ReadStridedColl */
+	ADIOI_GEN_WriteStridedColl,	/* WriteStridedColl */
+	ADIOI_GEN_SeekIndividual,	/* SeekIndividual */
+	ADIOI_DAOS_HL_Fcntl,		/* Fcntl */
+	ADIOI_GEN_SetInfo,		/* SetInfo */
+	ADIOI_DAOS_HL_ReadStrided,	/* ReadStrided */
+	ADIOI_DAOS_HL_WriteStrided,	/* WriteStrided */
+	ADIOI_DAOS_HL_Close,		/* Close */
+	ADIOI_FAKE_IreadContig,		/* IreadContig */
+	ADIOI_FAKE_IwriteContig,	/* IwriteContig */
+	ADIOI_FAKE_IODone,		/* ReadDone */
+	ADIOI_FAKE_IODone,		/* WriteDone */
+	ADIOI_FAKE_IOComplete,		/* ReadComplete */
+	ADIOI_FAKE_IOComplete,		/* WriteComplete */
+	ADIOI_FAKE_IreadStrided,	/* IreadStrided */
+	ADIOI_FAKE_IwriteStrided,	/* IwriteStrided */
+	ADIOI_DAOS_HL_Flush,		/* Flush */
+	ADIOI_DAOS_HL_Resize,		/* Resize */
+	ADIOI_DAOS_HL_Delete,		/* Delete */
+	ADIOI_DAOS_HL_Feature,		/* Features */
+	"DAOS_HL: ROMIO driver for daos_hl arrays",
+	ADIOI_GEN_IreadStridedColl,	/* IreadStridedColl */
+	ADIOI_GEN_IwriteStridedColl	/* IwriteStridedColl */
+};
+
+static daos_handle_t	ADIOI_DAOS_HL_poh;
+static daos_handle_t	ADIOI_DAOS_HL_coh;
+static int		ADIOI_DAOS_HL_connected;
+
+/** Disconnect from the container when MPI_COMM_SELF is freed at finalize */
+static int
+ADIOI_DAOS_HL_End(MPI_Comm comm, int keyval, void *attr, void *extra)
+{
+	daos_cont_close(ADIOI_DAOS_HL_coh, NULL);
+	daos_pool_disconnect(ADIOI_DAOS_HL_poh, NULL);
+	daos_fini();
+	ADIOI_DAOS_HL_connected = 0;
+
+	return MPI_Comm_free_keyval(&keyval);
+}
+
+/**
+ * Connect each process to the container named by the environment:
+ * DAOS_HL_POOL (pool uuid), DAOS_HL_SVC (pool service ranks separated by ':',
+ * 0 if unset) and DAOS_HL_CONT (container uuid, created if it does not
+ * exist). Returns ADIOI_DAOS_HL_ENOENV if the pool or the container is not set.
+ */
+int
+ADIOI_DAOS_HL_Connect(daos_handle_t *coh)
+{
+	daos_rank_t		ranks[ADIOI_DAOS_HL_SVC_MAX];
+	daos_rank_list_t	svc;
+	uuid_t			pool_uuid, co_uuid;
+	char			*pool, *cont, *svc_str, *str, *tok, *save;
+	int			keyval;
+	int			rc;
+
+	if (ADIOI_DAOS_HL_connected) {
+		*coh = ADIOI_DAOS_HL_coh;
+		return 0;
+	}
+
+	pool = getenv("DAOS_HL_POOL");
+	cont = getenv("DAOS_HL_CONT");
+	if (NULL == pool || NULL == cont ||
+	    uuid_parse(pool, pool_uuid) != 0 ||
+	    uuid_parse(cont, co_uuid) != 0)
+		return ADIOI_DAOS_HL_ENOENV;
+
+	svc.rl_nr.num = 0;
+	svc.rl_nr.num_out = 0;
+	svc.rl_ranks = ranks;
+	svc_str = getenv("DAOS_HL_SVC");
+	str = strdup(svc_str ? svc_str : "0");
+	if (NULL == str)
+		return -1;
+	for (tok = strtok_r(str, ":", &save);
+	     tok != NULL && svc.rl_nr.num < ADIOI_DAOS_HL_SVC_MAX;
+	     tok = strtok_r(NULL, ":", &save))
+		ranks[svc.rl_nr.num++] = atoi(tok);
+	free(str);
+
+	rc = daos_init();
+	if (rc != 0)
+		return rc;
+
+	rc = daos_pool_connect(pool_uuid, NULL, &svc, DAOS_PC_RW,
+			       &ADIOI_DAOS_HL_poh, NULL, NULL);
+	if (rc != 0)
+		goto out_fini;
+
+	rc = daos_cont_open(ADIOI_DAOS_HL_poh, co_uuid, DAOS_COO_RW,
+			    &ADIOI_DAOS_HL_coh, NULL, NULL);
+	if (rc != 0) {
+		/** another process may create it at the same time */
+		daos_cont_create(ADIOI_DAOS_HL_poh, co_uuid, NULL);
+		rc = daos_cont_open(ADIOI_DAOS_HL_poh, co_uuid, DAOS_COO_RW,
+				    &ADIOI_DAOS_HL_coh, NULL, NULL);
+	}
+	if (rc != 0)
+		goto out_disconnect;
+
+	MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, ADIOI_DAOS_HL_End,
+			       &keyval, NULL);
+	MPI_Comm_set_attr(MPI_COMM_SELF, keyval, NULL);
+
+	ADIOI_DAOS_HL_connected = 1;
+	*coh = ADIOI_DAOS_HL_coh;
+
+	return 0;
+
+out_disconnect:
+	daos_pool_disconnect(ADIOI_DAOS_HL_poh, NULL);
+out_fini:
+	daos_fini();
+	return rc;
+}
+
+/** Hash the file name, without the prefix, into the object ID */
+daos_obj_id_t
+ADIOI_DAOS_HL_Oid(const char *filename)
+{
+	daos_obj_id_t	oid;
+	uint64_t	h1 = 14695981039346656037ULL;
+	uint64_t	h2 = 5381;
+	const char	*p;
+
+	if (strncmp(filename, ADIOI_DAOS_HL_PREFIX,
+		    strlen(ADIOI_DAOS_HL_PREFIX)) == 0)
+		filename += strlen(ADIOI_DAOS_HL_PREFIX);
+
+	for (p = filename; *p != '\0'; p++) {
+		h1 = (h1 ^ (unsigned char)*p) * 1099511628211ULL;
+		h2 = h2 * 33 + (unsigned char)*p;
+	}
+
+	oid.lo = h1;
+	oid.mid = h2;
+	oid.hi = 0;
+	daos_obj_id_generate(&oid, DAOS_OC_REPL_MAX_RW);
+
+	return oid;
+}
+
+int
+ADIOI_DAOS_HL_Sync_size(ADIO_File fd)
+{
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+	struct stat		st;
+	ADIO_Offset		size, max_size;
+	int			rc;
+
+	rc = daos_hl_file_fstat(fs->file, &st);
+	if (rc != 0)
+		return rc;
+
+	size = st.st_size;
+	MPI_Allreduce(&size, &max_size, 1, ADIO_OFFSET, MPI_MAX, fd->comm);
+
+	/** growing the size only updates the cached value */
+	if (max_size > size && !(fd->access_mode & ADIO_RDONLY))
+		rc = daos_hl_file_ftruncate(fs->file, max_size);
+
+	return rc;
+}
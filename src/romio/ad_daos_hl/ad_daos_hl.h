@@ -0,0 +1,83 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/romio/ad_daos_hl/ad_daos_hl.h
+ *
+ * ROMIO ADIO driver storing MPI files in daos_hl arrays. The sources are
+ * meant to be dropped in the adio/ directory of a ROMIO tree, see README.md.
+ */
+
+#ifndef __AD_DAOS_HL_H__
+#define __AD_DAOS_HL_H__
+
+#include "adio.h"
+#include <daos_hl.h>
+
+/** Prefix of the file names handled by the driver */
+#define ADIOI_DAOS_HL_PREFIX	"daos_hl:"
+
+/** Per file state, hung off fd->fs_ptr */
+typedef struct {
+	daos_hl_file_t	*file;
+} ADIOI_DAOS_HL_fs;
+
+/** Error of ADIOI_DAOS_HL_Connect(): the container is not set */
+#define ADIOI_DAOS_HL_ENOENV	(-2)
+
+/** Container holding the files, connected on the first open */
+int ADIOI_DAOS_HL_Connect(daos_handle_t *coh);
+
+/** Object ID of the array holding a file, derived from its name */
+daos_obj_id_t ADIOI_DAOS_HL_Oid(const char *filename);
+
+/** Make the cached file size of all the processes the largest one */
+int ADIOI_DAOS_HL_Sync_size(ADIO_File fd);
+
+void ADIOI_DAOS_HL_Open(ADIO_File fd, int *error_code);
+void ADIOI_DAOS_HL_Close(ADIO_File fd, int *error_code);
+void ADIOI_DAOS_HL_ReadContig(ADIO_File fd, void *buf, int count,
+			      MPI_Datatype datatype, int file_ptr_type,
+			      ADIO_Offset offset, ADIO_Status *status,
+			      int *error_code);
+void ADIOI_DAOS_HL_WriteContig(ADIO_File fd, const void *buf, int count,
+			       MPI_Datatype datatype, int file_ptr_type,
+			       ADIO_Offset offset, ADIO_Status *status,
+			       int *error_code);
+void ADIOI_DAOS_HL_ReadStrided(ADIO_File fd, void *buf, int count,
+			       MPI_Datatype datatype, int file_ptr_type,
+			       ADIO_Offset offset, ADIO_Status *status,
+			       int *error_code);
+void ADIOI_DAOS_HL_WriteStrided(ADIO_File fd, const void *buf, int count,
+				MPI_Datatype datatype, int file_ptr_type,
+				ADIO_Offset offset, ADIO_Status *status,
+				int *error_code);
+void ADIOI_DAOS_HL_Fcntl(ADIO_File fd, int flag, ADIO_Fcntl_t *fcntl_struct,
+			 int *error_code);
+void ADIOI_DAOS_HL_Flush(ADIO_File fd, int *error_code);
+void ADIOI_DAOS_HL_Resize(ADIO_File fd, ADIO_Offset size, int *error_code);
+void ADIOI_DAOS_HL_Delete(const char *filename, int *error_code);
+int ADIOI_DAOS_HL_Feature(ADIO_File fd, int flag);
+
+#endif /* __AD_DAOS_HL_H__ */
@@ -0,0 +1,150 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/romio/ad_daos_hl/ad_daos_hl_fcntl.c
+ */
+
+#include "ad_daos_hl.h"
+#include "adio_extern.h"
+
+void
+ADIOI_DAOS_HL_Fcntl(ADIO_File fd, int flag, ADIO_Fcntl_t *fcntl_struct,
+		    int *error_code)
+{
+	static char		myname[] = "ADIOI_DAOS_HL_FCNTL";
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+	struct stat		st;
+
+	switch (flag) {
+	case ADIO_FCNTL_GET_FSIZE:
+		if (ADIOI_DAOS_HL_Sync_size(fd) != 0 ||
+		    daos_hl_file_fstat(fs->file, &st) != 0) {
+			*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+							   MPIR_ERR_RECOVERABLE,
+							   myname, __LINE__,
+							   MPI_ERR_IO, "**io",
+							   0);
+			return;
+		}
+		fcntl_struct->fsize = st.st_size;
+		*error_code = MPI_SUCCESS;
+		break;
+
+	case ADIO_FCNTL_SET_DISKSPACE:
+		/** arrays are sparse, there is nothing to preallocate */
+		*error_code = MPI_SUCCESS;
+		break;
+
+	case ADIO_FCNTL_SET_ATOMICITY:
+		/** atomic accesses must not sit in the file buffers */
+		if (daos_hl_file_set_cache(fs->file,
+					   fcntl_struct->atomicity == 0) != 0) {
+			*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+							   MPIR_ERR_RECOVERABLE,
+							   myname, __LINE__,
+							   MPI_ERR_IO, "**io",
+							   0);
+			return;
+		}
+		fd->atomicity = (fcntl_struct->atomicity == 0) ? 0 : 1;
+		*error_code = MPI_SUCCESS;
+		break;
+
+	default:
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__,
+						   MPI_ERR_ARG,
+						   "**flag", "**flag %d", flag);
+		break;
+	}
+}
+
+void
+ADIOI_DAOS_HL_Flush(ADIO_File fd, int *error_code)
+{
+	static char		myname[] = "ADIOI_DAOS_HL_FLUSH";
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+
+	if (ADIOI_DAOS_HL_Sync_size(fd) != 0 ||
+	    daos_hl_file_fsync(fs->file) != 0) {
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__, MPI_ERR_IO,
+						   "**io", 0);
+		return;
+	}
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_DAOS_HL_Resize(ADIO_File fd, ADIO_Offset size, int *error_code)
+{
+	static char		myname[] = "ADIOI_DAOS_HL_RESIZE";
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+	int			rc;
+
+	/** every process flushes its writes before the size changes */
+	rc = daos_hl_file_fsync(fs->file);
+	MPI_Barrier(fd->comm);
+	if (rc == 0)
+		rc = daos_hl_file_ftruncate(fs->file, (off_t)size);
+	if (rc != 0) {
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__, MPI_ERR_IO,
+						   "**io", 0);
+		return;
+	}
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_DAOS_HL_Delete(const char *filename, int *error_code)
+{
+	static char myname[] = "ADIOI_DAOS_HL_DELETE";
+
+	/** MSC - punching the array object is not supported yet */
+	*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE,
+					   myname, __LINE__,
+					   MPI_ERR_UNSUPPORTED_OPERATION,
+					   "**fileopunsupported", 0);
+}
+
+int
+ADIOI_DAOS_HL_Feature(ADIO_File fd, int flag)
+{
+	switch (flag) {
+	case ADIO_SCALABLE_OPEN:
+		return 1;
+	case ADIO_UNLINK_AFTER_CLOSE:
+	case ADIO_SHARED_FP:
+	case ADIO_LOCKS:
+	case ADIO_SEQUENTIAL:
+	case ADIO_DATA_SIEVING_WRITES:
+	default:
+		return 0;
+	}
+}
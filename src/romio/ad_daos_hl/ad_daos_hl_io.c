@@ -0,0 +1,321 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/romio/ad_daos_hl/ad_daos_hl_io.c
+ */
+
+#include "ad_daos_hl.h"
+#include "adio_extern.h"
+
+static void
+ADIOI_DAOS_HL_Err(int *error_code, const char *myname, int line)
+{
+	*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE,
+					   (char *)myname, line, MPI_ERR_IO,
+					   "**io", "**io %s",
+					   "daos_hl array access failed");
+}
+
+static void
+ADIOI_DAOS_HL_Contig(ADIO_File fd, void *buf, int count,
+		     MPI_Datatype datatype, int file_ptr_type,
+		     ADIO_Offset offset, ADIO_Status *status, int *error_code,
+		     int write)
+{
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+	MPI_Count		datatype_size;
+	ADIO_Offset		len;
+	ssize_t			n;
+
+	MPI_Type_size_x(datatype, &datatype_size);
+	len = (ADIO_Offset)datatype_size * count;
+
+	/** the offset is already in bytes for contiguous accesses */
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+		offset = fd->fp_ind;
+
+	if (write)
+		n = daos_hl_file_pwrite(fs->file, buf, len, offset);
+	else
+		n = daos_hl_file_pread(fs->file, buf, len, offset);
+	if (n < 0) {
+		ADIOI_DAOS_HL_Err(error_code, write ?
+				  "ADIOI_DAOS_HL_WRITECONTIG" :
+				  "ADIOI_DAOS_HL_READCONTIG", __LINE__);
+		return;
+	}
+
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+		fd->fp_ind += n;
+	fd->fp_sys_posn = offset + n;
+
+#ifdef HAVE_STATUS_SET_BYTES
+	MPIR_Status_set_bytes(status, datatype, n);
+#endif
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_DAOS_HL_ReadContig(ADIO_File fd, void *buf, int count,
+			 MPI_Datatype datatype, int file_ptr_type,
+			 ADIO_Offset offset, ADIO_Status *status,
+			 int *error_code)
+{
+	ADIOI_DAOS_HL_Contig(fd, buf, count, datatype, file_ptr_type, offset,
+			     status, error_code, 0);
+}
+
+void
+ADIOI_DAOS_HL_WriteContig(ADIO_File fd, const void *buf, int count,
+			  MPI_Datatype datatype, int file_ptr_type,
+			  ADIO_Offset offset, ADIO_Status *status,
+			  int *error_code)
+{
+	ADIOI_DAOS_HL_Contig(fd, (void *)buf, count, datatype, file_ptr_type,
+			     offset, status, error_code, 1);
+}
+
+/**
+ * Translate the memory datatype into an sgl: one iov per flattened block of
+ * each of the count copies of the datatype.
+ */
+static int
+ADIOI_DAOS_HL_Mem_sgl(void *buf, int count, MPI_Datatype datatype,
+		      ADIO_Offset len, daos_sg_list_t *sgl)
+{
+	ADIOI_Flatlist_node	*flat_buf;
+	MPI_Aint		lb, extent;
+	int			is_contig;
+	int			i, j, k;
+
+	sgl->sg_nr.num_out = 0;
+
+	ADIOI_Datatype_iscontig(datatype, &is_contig);
+	if (is_contig) {
+		sgl->sg_iovs = (daos_iov_t *)ADIOI_Malloc(sizeof(daos_iov_t));
+		daos_iov_set(&sgl->sg_iovs[0], buf, len);
+		sgl->sg_nr.num = 1;
+		return 0;
+	}
+
+	flat_buf = ADIOI_Flatten_and_find(datatype);
+	MPI_Type_get_extent(datatype, &lb, &extent);
+
+	sgl->sg_iovs = (daos_iov_t *)ADIOI_Malloc(sizeof(daos_iov_t) *
+						  count * flat_buf->count);
+	for (i = 0, k = 0; i < count; i++) {
+		for (j = 0; j < flat_buf->count; j++) {
+			if (flat_buf->blocklens[j] == 0)
+				continue;
+			daos_iov_set(&sgl->sg_iovs[k++],
+				     (char *)buf + i * extent +
+				     flat_buf->indices[j],
+				     flat_buf->blocklens[j]);
+		}
+	}
+	sgl->sg_nr.num = k;
+
+	return 0;
+}
+
+/**
+ * Translate the file view into ranges: walk the flattened filetype from the
+ * start of the access for len bytes of data, merging adjacent blocks.
+ * Returns the absolute offset following the last byte accessed in *end.
+ */
+static int
+ADIOI_DAOS_HL_File_ranges(ADIO_File fd, int file_ptr_type,
+			  ADIO_Offset offset, ADIO_Offset len,
+			  daos_hl_array_ranges_t *ranges, ADIO_Offset *end)
+{
+	ADIOI_Flatlist_node	*flat_file;
+	MPI_Count		filetype_size;
+	MPI_Aint		lb, filetype_extent;
+	ADIO_Offset		data_off, n_filetypes, rem, cum;
+	int			is_contig;
+	int			i, cap;
+
+	ranges->ranges_nr = 0;
+
+	ADIOI_Datatype_iscontig(fd->filetype, &is_contig);
+	if (is_contig) {
+		ADIO_Offset start;
+
+		start = (file_ptr_type == ADIO_EXPLICIT_OFFSET) ?
+			fd->disp + (ADIO_Offset)fd->etype_size * offset :
+			fd->fp_ind;
+		ranges->ranges = (daos_hl_range_t *)
+			ADIOI_Malloc(sizeof(daos_hl_range_t));
+		ranges->ranges[0].index = start;
+		ranges->ranges[0].len = len;
+		ranges->ranges_nr = 1;
+		*end = start + len;
+		return 0;
+	}
+
+	flat_file = ADIOI_Flatten_and_find(fd->filetype);
+	MPI_Type_size_x(fd->filetype, &filetype_size);
+	MPI_Type_get_extent(fd->filetype, &lb, &filetype_extent);
+
+	/** position of the access in the data of the view */
+	if (file_ptr_type == ADIO_EXPLICIT_OFFSET) {
+		data_off = (ADIO_Offset)fd->etype_size * offset;
+	}
+	else {
+		rem = fd->fp_ind - fd->disp;
+		n_filetypes = rem / filetype_extent;
+		rem -= n_filetypes * filetype_extent;
+		data_off = n_filetypes * filetype_size;
+		for (i = 0; i < flat_file->count; i++) {
+			if (rem < flat_file->indices[i])
+				break;
+			if (rem < flat_file->indices[i] +
+			    flat_file->blocklens[i]) {
+				data_off += rem - flat_file->indices[i];
+				break;
+			}
+			data_off += flat_file->blocklens[i];
+		}
+	}
+
+	cap = 0;
+	ranges->ranges = NULL;
+	*end = fd->disp;
+	while (len > 0) {
+		ADIO_Offset index, n;
+
+		n_filetypes = data_off / filetype_size;
+		rem = data_off - n_filetypes * filetype_size;
+
+		/** find the block holding the data at rem */
+		for (i = 0, cum = 0; i < flat_file->count; i++) {
+			if (rem < cum + flat_file->blocklens[i])
+				break;
+			cum += flat_file->blocklens[i];
+		}
+
+		index = fd->disp + n_filetypes * filetype_extent +
+			flat_file->indices[i] + (rem - cum);
+		n = flat_file->blocklens[i] - (rem - cum);
+		if (n > len)
+			n = len;
+
+		if (ranges->ranges_nr &&
+		    ranges->ranges[ranges->ranges_nr - 1].index +
+		    ranges->ranges[ranges->ranges_nr - 1].len == index) {
+			ranges->ranges[ranges->ranges_nr - 1].len += n;
+		}
+		else {
+			if (ranges->ranges_nr == cap) {
+				cap = cap ? cap * 2 : 64;
+				ranges->ranges = (daos_hl_range_t *)
+					ADIOI_Realloc(ranges->ranges,
+						      sizeof(daos_hl_range_t) *
+						      cap);
+			}
+			ranges->ranges[ranges->ranges_nr].index = index;
+			ranges->ranges[ranges->ranges_nr].len = n;
+			ranges->ranges_nr ++;
+		}
+
+		data_off += n;
+		len -= n;
+		*end = index + n;
+	}
+
+	return 0;
+}
+
+static void
+ADIOI_DAOS_HL_Strided(ADIO_File fd, void *buf, int count,
+		      MPI_Datatype datatype, int file_ptr_type,
+		      ADIO_Offset offset, ADIO_Status *status,
+		      int *error_code, int write)
+{
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+	daos_hl_array_ranges_t	ranges;
+	daos_sg_list_t		sgl;
+	MPI_Count		datatype_size;
+	ADIO_Offset		len, end;
+	int			rc;
+
+	MPI_Type_size_x(datatype, &datatype_size);
+	len = (ADIO_Offset)datatype_size * count;
+	if (len == 0) {
+#ifdef HAVE_STATUS_SET_BYTES
+		MPIR_Status_set_bytes(status, datatype, 0);
+#endif
+		*error_code = MPI_SUCCESS;
+		return;
+	}
+
+	ADIOI_DAOS_HL_File_ranges(fd, file_ptr_type, offset, len, &ranges,
+				  &end);
+	ADIOI_DAOS_HL_Mem_sgl(buf, count, datatype, len, &sgl);
+
+	if (write)
+		rc = daos_hl_file_write_ranges(fs->file, &ranges, &sgl);
+	else
+		rc = daos_hl_file_read_ranges(fs->file, &ranges, &sgl);
+
+	ADIOI_Free(ranges.ranges);
+	ADIOI_Free(sgl.sg_iovs);
+
+	if (rc != 0) {
+		ADIOI_DAOS_HL_Err(error_code, write ?
+				  "ADIOI_DAOS_HL_WRITESTRIDED" :
+				  "ADIOI_DAOS_HL_READSTRIDED", __LINE__);
+		return;
+	}
+
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+		fd->fp_ind = end;
+	fd->fp_sys_posn = -1;
+
+#ifdef HAVE_STATUS_SET_BYTES
+	MPIR_Status_set_bytes(status, datatype, len);
+#endif
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_DAOS_HL_ReadStrided(ADIO_File fd, void *buf, int count,
+			  MPI_Datatype datatype, int file_ptr_type,
+			  ADIO_Offset offset, ADIO_Status *status,
+			  int *error_code)
+{
+	ADIOI_DAOS_HL_Strided(fd, buf, count, datatype, file_ptr_type, offset,
+			      status, error_code, 0);
+}
+
+void
+ADIOI_DAOS_HL_WriteStrided(ADIO_File fd, const void *buf, int count,
+			   MPI_Datatype datatype, int file_ptr_type,
+			   ADIO_Offset offset, ADIO_Status *status,
+			   int *error_code)
+{
+	ADIOI_DAOS_HL_Strided(fd, (void *)buf, count, datatype, file_ptr_type,
+			      offset, status, error_code, 1);
+}
@@ -0,0 +1,127 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/romio/ad_daos_hl/ad_daos_hl_open.c
+ */
+
+#include <fcntl.h>
+#include "ad_daos_hl.h"
+
+void
+ADIOI_DAOS_HL_Open(ADIO_File fd, int *error_code)
+{
+	static char		myname[] = "ADIOI_DAOS_HL_OPEN";
+	ADIOI_DAOS_HL_fs	*fs;
+	daos_handle_t		coh;
+	int			flags;
+	int			rc;
+
+	rc = ADIOI_DAOS_HL_Connect(&coh);
+	if (rc != 0) {
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__,
+						   MPI_ERR_IO, "**io",
+						   "**io %s",
+						   rc == ADIOI_DAOS_HL_ENOENV ?
+						   "DAOS_HL_POOL and "
+						   "DAOS_HL_CONT must be set "
+						   "to the pool and container "
+						   "uuids" :
+						   "DAOS connect failed");
+		return;
+	}
+
+	fs = (ADIOI_DAOS_HL_fs *)ADIOI_Malloc(sizeof(ADIOI_DAOS_HL_fs));
+
+	flags = (fd->access_mode & ADIO_RDONLY) ? O_RDONLY : O_RDWR;
+	rc = daos_hl_file_open(coh, ADIOI_DAOS_HL_Oid(fd->filename), 0, flags,
+			       &fs->file);
+	if (rc != 0) {
+		ADIOI_Free(fs);
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__,
+						   MPI_ERR_NO_SUCH_FILE,
+						   "**filenoexist",
+						   "**filenoexist %s",
+						   fd->filename);
+		return;
+	}
+
+	if (fd->atomicity && daos_hl_file_set_cache(fs->file, false) != 0) {
+		daos_hl_file_close(fs->file);
+		ADIOI_Free(fs);
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__,
+						   MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	fd->fs_ptr = fs;
+	fd->fd_sys = -1;
+	fd->fp_ind = fd->fp_sys_posn = 0;
+
+	/** appends start at the end of the file */
+	if (fd->access_mode & ADIO_APPEND) {
+		struct stat st;
+
+		if (daos_hl_file_fstat(fs->file, &st) == 0)
+			fd->fp_ind = fd->fp_sys_posn = st.st_size;
+	}
+
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_DAOS_HL_Close(ADIO_File fd, int *error_code)
+{
+	static char		myname[] = "ADIOI_DAOS_HL_CLOSE";
+	ADIOI_DAOS_HL_fs	*fs = (ADIOI_DAOS_HL_fs *)fd->fs_ptr;
+	int			rc;
+
+	/** close is collective: agree on the size before persisting it */
+	rc = ADIOI_DAOS_HL_Sync_size(fd);
+	if (rc == 0)
+		rc = daos_hl_file_close(fs->file);
+	else
+		daos_hl_file_close(fs->file);
+
+	ADIOI_Free(fs);
+	fd->fs_ptr = NULL;
+
+	if (rc != 0) {
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS,
+						   MPIR_ERR_RECOVERABLE,
+						   myname, __LINE__,
+						   MPI_ERR_IO, "**io",
+						   "**io %s",
+						   "daos_hl file close failed");
+		return;
+	}
+
+	*error_code = MPI_SUCCESS;
+}
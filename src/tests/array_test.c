@@ -26,40 +26,34 @@
  * src/tests/array_test
  */
 
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
 #include <daos_hl_test.h>
+#include <daos_hl/io.h>
 
 /** number of elements to write to array */
 #define NUM_ELEMS 64
 /** num of mem segments for strided access - Must evenly divide NUM_ELEMS */
 #define NUM_SEGS 4
-
-#define DTS_OCLASS_DEF		DAOS_OC_REPL_MAX_RW
-
-static uint64_t obj_id_gen	= 1;
+/** threads appending to the same array without a context */
+#define APPEND_THREAD_NR 8
 
 static void contig_mem_contig_arr_io(void **state);
 static void contig_mem_str_arr_io(void **state);
 static void str_mem_str_arr_io(void **state);
 static void read_empty_records(void **state);
-
-static daos_obj_id_t
-dts_oid_gen(uint16_t oclass, unsigned seed)
-{
-	daos_obj_id_t	oid;
-
-	srand(time(NULL));
-
-	if (oclass == 0)
-		oclass = DTS_OCLASS_DEF;
-
-	/* generate an unique and not scary long object ID */
-	oid.lo	= obj_id_gen++;
-	oid.mid	= seed;
-	oid.hi	= rand() % 100;
-	daos_obj_id_generate(&oid, oclass);
-
-	return oid;
-}
+static void append_io(void **state);
+static void append_threads_io(void **state);
+static void multi_arr_io(void **state);
+static void sparse_bitmap_io(void **state);
+static void layout_io(void **state);
+static void gen_io(void **state);
+static void copy_io(void **state);
+static void comp_cb_io(void **state);
+static void progress_io(void **state);
+static void rpc_split_io(void **state);
+static void gather_scatter_io(void **state);
 
 static void
 contig_mem_contig_arr_io(void **state)
@@ -515,133 +509,2390 @@ read_empty_records(void **state)
 	}
 } /* End read_empty_records */
 
-static const struct CMUnitTest array_io_tests[] = {
-	{"Array I/O: Contiguous memory and array (blocking)",
-	 contig_mem_contig_arr_io, async_disable, NULL},
-	{"Array I/O: Contiguous memory and array (non-blocking)",
-	contig_mem_contig_arr_io, async_enable, NULL},
-	{"Array I/O: Contiguous memory Strided array (blocking)",
-	 contig_mem_str_arr_io, async_disable, NULL},
-	{"Array I/O: Contiguous memory Strided array (non-blocking)",
-	contig_mem_str_arr_io, async_enable, NULL},
-	{"Array I/O: Strided memory and array (blocking)", 
-	 str_mem_str_arr_io, async_disable, NULL},
-	{"Array I/O: Strided memory and array (non-blocking)",
-	str_mem_str_arr_io, async_enable, NULL},
-//	{"Array I/O: Read from Empty array & records (blocking)", 
-//	 read_empty_records, async_disable, NULL},
-//	{"Array I/O: Read from Empty array & records (blocking)", 
-//	read_empty_records, async_enable, NULL},
+static void
+append_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_append_ctx_t *ctx;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	daos_off_t	offset;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	/** all ranks append to the same object */
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, 0);
+	MPI_Bcast(&oid, sizeof(oid), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_array_append_ctx_create(oh, 0, MPI_COMM_WORLD, &ctx);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS*sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS*sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = arg->myrank * NUM_ELEMS + i;
+
+	/** set memory location */
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	/** Append */
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_append(oh, 0, ctx, &sgl, &offset,
+				  arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** each rank gets its own slot of the appended data */
+	assert_int_equal(offset % (NUM_ELEMS * sizeof(int)), 0);
+	assert_true(offset < arg->rank_size * NUM_ELEMS * sizeof(int));
+
+	rc = daos_hl_array_append_ctx_destroy(ctx);
+	assert_int_equal(rc, 0);
+
+	/** Read back at the returned offset */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = offset;
+	ranges.ranges = &rg;
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Verify data */
+	for (i = 0; i < NUM_ELEMS; i++) {
+		if(wbuf[i] != rbuf[i]) {
+			printf("Data verification failed\n");
+			printf("%zu: written %d != read %d\n",
+				i, wbuf[i], rbuf[i]);
+		}
+		assert_int_equal(wbuf[i], rbuf[i]);
+	}
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End append_io */
+
+struct append_arg {
+	daos_handle_t	oh;
+	int		id;
+	daos_off_t	offset[NUM_ELEMS];
+	int		rc;
 };
 
-static int
-setup(void **state)
-{
-	test_arg_t	*arg;
-	int		 rc;
-
-	arg = malloc(sizeof(test_arg_t));
-	if (arg == NULL)
-		return -1;
-
-	rc = daos_eq_create(&arg->eq);
-	if (rc)
-		return rc;
-
-	arg->svc.rl_nr.num = 8;
-	arg->svc.rl_nr.num_out = 0;
-	arg->svc.rl_ranks = arg->ranks;
-
-	arg->hdl_share = false;
-	uuid_clear(arg->pool_uuid);
-	MPI_Comm_rank(MPI_COMM_WORLD, &arg->myrank);
-	MPI_Comm_size(MPI_COMM_WORLD, &arg->rank_size);
-
-	if (arg->myrank == 0) {
-		/** create pool with minimal size */
-		rc = daos_pool_create(0731, geteuid(), getegid(), NULL,
-				      NULL, "pmem", 256 << 20, &arg->svc,
-				      arg->pool_uuid, NULL);
-	}
-	MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if (rc)
-		return rc;
-
-	if (arg->myrank == 0) {
-		/** connect to pool */
-		rc = daos_pool_connect(arg->pool_uuid, NULL,
-				       &arg->svc, DAOS_PC_RW, &arg->poh,
-				       &arg->pool_info, NULL /* ev */);
-	}
-	MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if (rc)
-		return rc;
-	MPI_Bcast(&arg->pool_info, sizeof(arg->pool_info), MPI_CHAR, 0,
-		  MPI_COMM_WORLD);
-
-	/** l2g and g2l the pool handle */
-	handle_share(&arg->poh, HANDLE_POOL, arg->myrank, arg->poh, 1);
-	if (arg->myrank == 0) {
-		/** create container */
-		uuid_generate(arg->co_uuid);
-		rc = daos_cont_create(arg->poh, arg->co_uuid, NULL);
-	}
-	MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if (rc)
-		return rc;
-
-	if (arg->myrank == 0) {
-		/** open container */
-		rc = daos_cont_open(arg->poh, arg->co_uuid, DAOS_COO_RW,
-				    &arg->coh, NULL, NULL);
-	}
-	MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if (rc)
-		return rc;
-
-	/** l2g and g2l the container handle */
-	handle_share(&arg->coh, HANDLE_CO, arg->myrank, arg->poh, 1);
-
-	*state = arg;
-	return 0;
+/** Append NUM_ELEMS ints of the thread id one by one */
+static void *
+append_thread(void *data)
+{
+	struct append_arg *a = data;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	daos_size_t 	i;
+
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, &a->id, sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	for (i = 0; i < NUM_ELEMS && a->rc == 0; i++)
+		a->rc = daos_hl_array_append(a->oh, 0, NULL, &sgl,
+					     &a->offset[i], NULL);
+	return NULL;
 }
 
-static int
-teardown(void **state) {
+static void
+append_threads_io(void **state)
+{
 	test_arg_t	*arg = *state;
-	int		 rc, rc_reduce = 0;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	struct append_arg args[APPEND_THREAD_NR];
+	pthread_t	threads[APPEND_THREAD_NR];
+	int		*rbuf;
+	int		t, val;
+	daos_size_t 	i;
+	int		rc;
 
-	MPI_Barrier(MPI_COMM_WORLD);
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+	rc = daos_hl_array_create(arg->coh, oid, 0, NULL, &oh);
+	assert_int_equal(rc, 0);
 
-	rc = daos_cont_close(arg->coh, NULL);
-	MPI_Allreduce(&rc, &rc_reduce, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
-	if (rc_reduce)
-		return rc_reduce;
-
-	if (arg->myrank == 0)
-		rc = daos_cont_destroy(arg->poh, arg->co_uuid, 1, NULL);
-	MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if (rc)
-		return rc;
-
-	rc = daos_pool_disconnect(arg->poh, NULL /* ev */);
-	MPI_Allreduce(&rc, &rc_reduce, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
-	if (rc_reduce)
-		return rc_reduce;
-
-	if (arg->myrank == 0)
-		rc = daos_pool_destroy(arg->pool_uuid, "srv_grp", 1, NULL);
-	MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
-	if (rc)
-		return rc;
-
-	rc = daos_eq_destroy(arg->eq, 0);
-	if (rc)
-		return rc;
-
-	free(arg);
-	return 0;
-}
+	for (t = 0; t < APPEND_THREAD_NR; t++) {
+		args[t].oh = oh;
+		args[t].id = t;
+		args[t].rc = 0;
+		rc = pthread_create(&threads[t], NULL, append_thread,
+				    &args[t]);
+		assert_int_equal(rc, 0);
+	}
+	for (t = 0; t < APPEND_THREAD_NR; t++) {
+		pthread_join(threads[t], NULL);
+		assert_int_equal(args[t].rc, 0);
+	}
+
+	/** the reservations tile the array, each slot holds its thread id */
+	rbuf = malloc(APPEND_THREAD_NR * NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	memset(rbuf, 0xff, APPEND_THREAD_NR * NUM_ELEMS * sizeof(int));
+
+	ranges.ranges_nr = 1;
+	rg.len = APPEND_THREAD_NR * NUM_ELEMS * sizeof(int);
+	rg.index = 0;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, rbuf, rg.len);
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	for (t = 0; t < APPEND_THREAD_NR; t++) {
+		for (i = 0; i < NUM_ELEMS; i++) {
+			assert_int_equal(args[t].offset[i] % sizeof(int), 0);
+			val = rbuf[args[t].offset[i] / sizeof(int)];
+			assert_int_equal(val, t);
+		}
+	}
+
+	free(rbuf);
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+} /* End append_threads_io */
+
+static void
+multi_arr_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh[NUM_SEGS];
+	daos_hl_array_io_t ios[NUM_SEGS];
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl[NUM_SEGS];
+	daos_iov_t	iov[NUM_SEGS];
+	int		*wbuf[NUM_SEGS], *rbuf[NUM_SEGS];
+	daos_size_t 	i, j;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	/** set array location, same for all arrays */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = arg->myrank * rg.len;
+	ranges.ranges = &rg;
+
+	for (i = 0; i < NUM_SEGS; i++) {
+		oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+		/** open the object */
+		rc = daos_obj_open(arg->coh, oid, 0, 0, &oh[i], NULL);
+		assert_int_equal(rc, 0);
+
+		/** Allocate and set buffer */
+		wbuf[i] = malloc(NUM_ELEMS * sizeof(int));
+		assert_non_null(wbuf[i]);
+		rbuf[i] = malloc(NUM_ELEMS * sizeof(int));
+		assert_non_null(rbuf[i]);
+		for (j = 0; j < NUM_ELEMS; j++)
+			wbuf[i][j] = (i * NUM_ELEMS) + j;
+
+		/** set memory location */
+		sgl[i].sg_nr.num = 1;
+		daos_iov_set(&iov[i], wbuf[i], NUM_ELEMS * sizeof(int));
+		sgl[i].sg_iovs = &iov[i];
+
+		ios[i].oh = oh[i];
+		ios[i].ranges = &ranges;
+		ios[i].sgl = &sgl[i];
+	}
+
+	/** Write */
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_write_multi(0, NUM_SEGS, ios,
+				       arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Read */
+	for (i = 0; i < NUM_SEGS; i++)
+		daos_iov_set(&iov[i], rbuf[i], NUM_ELEMS * sizeof(int));
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_read_multi(0, NUM_SEGS, ios,
+				      arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Verify data */
+	for (i = 0; i < NUM_SEGS; i++) {
+		for (j = 0; j < NUM_ELEMS; j++) {
+			if(wbuf[i][j] != rbuf[i][j]) {
+				printf("Data verification failed\n");
+				printf("%zu: written %d != read %d\n",
+				       i, wbuf[i][j], rbuf[i][j]);
+			}
+			assert_int_equal(wbuf[i][j], rbuf[i][j]);
+		}
+	}
+
+	for (i = 0; i < NUM_SEGS; i++) {
+		free(rbuf[i]);
+		free(wbuf[i]);
+
+		rc = daos_obj_close(oh[i], NULL);
+		assert_int_equal(rc, 0);
+	}
+} /* End multi_arr_io */
+
+static void
+sparse_bitmap_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_attr_t attr;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i, pass;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** create the array with a presence map */
+	memset(&attr, 0, sizeof(attr));
+	attr.da_flags = DAOS_HL_ARRAY_BITMAP;
+	rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_SEGS * NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** Write the second quarter of the array only */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = rg.len;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/**
+	 * Read the whole array, through the handle that wrote it and
+	 * through a new handle that loads the presence map.
+	 */
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			rc = daos_hl_array_close(oh);
+			assert_int_equal(rc, 0);
+			rc = daos_hl_array_open(arg->coh, oid, 0, DAOS_OO_RW,
+						&attr, &oh);
+			assert_int_equal(rc, 0);
+			assert_int_equal(attr.da_flags, DAOS_HL_ARRAY_BITMAP);
+		}
+
+		memset(rbuf, 0xff, NUM_SEGS * NUM_ELEMS * sizeof(int));
+		rg.len = NUM_SEGS * NUM_ELEMS * sizeof(int);
+		rg.index = 0;
+		daos_iov_set(&iov, rbuf, NUM_SEGS * NUM_ELEMS * sizeof(int));
+
+		if (arg->async) {
+			rc = daos_event_init(&ev, arg->eq, NULL);
+			assert_int_equal(rc, 0);
+		}
+		rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL,
+					arg->async ? &ev : NULL);
+		assert_int_equal(rc, 0);
+		if (arg->async) {
+			/** Wait for completion */
+			rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+			assert_int_equal(rc, 1);
+			assert_ptr_equal(evp, &ev);
+			assert_int_equal(evp->ev_error, 0);
+
+			rc = daos_event_fini(&ev);
+			assert_int_equal(rc, 0);
+		}
+
+		/** Verify data, holes read back as zeros */
+		for (i = 0; i < NUM_SEGS * NUM_ELEMS; i++) {
+			if (i >= NUM_ELEMS && i < 2 * NUM_ELEMS)
+				assert_int_equal(rbuf[i], wbuf[i - NUM_ELEMS]);
+			else
+				assert_int_equal(rbuf[i], 0);
+		}
+	}
+
+	/** A read of holes only completes without any fetch */
+	memset(rbuf, 0xff, NUM_ELEMS * sizeof(int));
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = 3 * rg.len;
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL,
+				arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(rbuf[i], 0);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+} /* End sparse_bitmap_io */
+
+static void
+layout_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_attr_t attr, md_attr;
+	daos_hl_array_ranges_t ranges;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	uint32_t	layout;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** set array location, strided over several dkey groups */
+	ranges.ranges_nr = NUM_ELEMS;
+	ranges.ranges = (daos_hl_range_t *)malloc(sizeof(daos_hl_range_t) *
+						  NUM_ELEMS);
+	assert_non_null(ranges.ranges);
+	for (i = 0; i < NUM_ELEMS; i++) {
+		ranges.ranges[i].len = sizeof(int);
+		ranges.ranges[i].index = i * arg->rank_size * sizeof(int) +
+			arg->myrank * sizeof(int) +
+			i * NUM_SEGS * sizeof(int);
+	}
+
+	for (layout = 0; layout < DAOS_HL_LAYOUT_NR; layout++) {
+		oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+		/** create the array, with a non default block size */
+		memset(&attr, 0, sizeof(attr));
+		attr.da_layout = layout;
+		attr.da_block_size = 32;
+		rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+		assert_int_equal(rc, 0);
+
+		sgl.sg_nr.num = 1;
+		daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+		sgl.sg_iovs = &iov;
+		rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+		assert_int_equal(rc, 0);
+
+		/** the layout is picked up from the metadata on open */
+		rc = daos_hl_array_close(oh);
+		assert_int_equal(rc, 0);
+		rc = daos_hl_array_open(arg->coh, oid, 0, DAOS_OO_RW,
+					&md_attr, &oh);
+		assert_int_equal(rc, 0);
+		assert_int_equal(md_attr.da_layout, layout);
+		assert_int_equal(md_attr.da_block_size, 32);
+		assert_true(md_attr.da_dkey_nr > 0);
+		assert_true(md_attr.da_dkey_blocks > 0);
+
+		if (arg->async) {
+			rc = daos_event_init(&ev, arg->eq, NULL);
+			assert_int_equal(rc, 0);
+		}
+		memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+		daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+		rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL,
+					arg->async ? &ev : NULL);
+		assert_int_equal(rc, 0);
+		if (arg->async) {
+			/** Wait for completion */
+			rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+			assert_int_equal(rc, 1);
+			assert_ptr_equal(evp, &ev);
+			assert_int_equal(evp->ev_error, 0);
+
+			rc = daos_event_fini(&ev);
+			assert_int_equal(rc, 0);
+		}
+
+		/** Verify data */
+		for (i = 0; i < NUM_ELEMS; i++)
+			assert_int_equal(wbuf[i], rbuf[i]);
+
+		rc = daos_hl_array_close(oh);
+		assert_int_equal(rc, 0);
+	}
+
+	free(ranges.ranges);
+	free(rbuf);
+	free(wbuf);
+} /* End layout_io */
+
+/** strided ranges of one int each, several generator batches long */
+#define GEN_RANGES	(NUM_SEGS * NUM_ELEMS)
+
+struct gen_arg {
+	int		*buf;
+	daos_size_t	next;
+	daos_size_t	stride;
+	daos_off_t	base;
+};
+
+static int
+gen_next(void *arg, daos_hl_range_t *range, daos_iov_t *iov)
+{
+	struct gen_arg *g = (struct gen_arg *)arg;
+
+	if (g->next == GEN_RANGES)
+		return 0;
+
+	range->len = sizeof(int);
+	range->index = g->base + g->next * g->stride;
+	daos_iov_set(iov, &g->buf[g->next], sizeof(int));
+	g->next ++;
+
+	return 1;
+}
+
+static void
+gen_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	struct gen_arg	g;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(GEN_RANGES * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(GEN_RANGES * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < GEN_RANGES; i++)
+		wbuf[i] = i+1;
+
+	/** Write */
+	g.buf = wbuf;
+	g.next = 0;
+	g.stride = arg->rank_size * 3 * sizeof(int);
+	g.base = arg->myrank * sizeof(int);
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_write_gen(oh, 0, gen_next, &g,
+				     arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+	assert_int_equal(g.next, GEN_RANGES);
+
+	/** Read */
+	memset(rbuf, 0, GEN_RANGES * sizeof(int));
+	g.buf = rbuf;
+	g.next = 0;
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_read_gen(oh, 0, gen_next, &g,
+				    arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Verify data */
+	for (i = 0; i < GEN_RANGES; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End gen_io */
+
+static void
+copy_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	src_oid, dst_oid;
+	daos_handle_t	src_oh, dst_oh;
+	daos_hl_array_attr_t attr;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	int		rc;
+
+	src_oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+	dst_oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/**
+	 * The source has a presence map, so its holes are skipped. So does
+	 * the destination, so they read back as zeros.
+	 */
+	memset(&attr, 0, sizeof(attr));
+	attr.da_flags = DAOS_HL_ARRAY_BITMAP;
+	rc = daos_hl_array_create(arg->coh, src_oid, 0, &attr, &src_oh);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_create(arg->coh, dst_oid, 0, &attr, &dst_oh);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_SEGS * NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** Write the second and last quarters of the source */
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = rg.len;
+	rc = daos_hl_array_write(src_oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	rg.index = (NUM_SEGS - 1) * rg.len;
+	rc = daos_hl_array_write(src_oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Copy the whole source */
+	rg.len = NUM_SEGS * NUM_ELEMS * sizeof(int);
+	rg.index = 0;
+	rc = daos_hl_array_copy(src_oh, 0, dst_oh, 0, &ranges);
+	assert_int_equal(rc, 0);
+
+	/** Read the destination back */
+	memset(rbuf, 0xff, NUM_SEGS * NUM_ELEMS * sizeof(int));
+	daos_iov_set(&iov, rbuf, NUM_SEGS * NUM_ELEMS * sizeof(int));
+	rc = daos_hl_array_read(dst_oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Verify data, holes read back as zeros */
+	for (i = 0; i < NUM_SEGS * NUM_ELEMS; i++) {
+		if (i >= NUM_ELEMS && i < 2 * NUM_ELEMS)
+			assert_int_equal(rbuf[i], wbuf[i - NUM_ELEMS]);
+		else if (i >= (NUM_SEGS - 1) * NUM_ELEMS)
+			assert_int_equal(rbuf[i],
+					 wbuf[i - (NUM_SEGS - 1) * NUM_ELEMS]);
+		else
+			assert_int_equal(rbuf[i], 0);
+	}
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_hl_array_close(src_oh);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_close(dst_oh);
+	assert_int_equal(rc, 0);
+} /* End copy_io */
+
+struct comp_arg {
+	int		calls;
+	int		rc;
+	daos_size_t	bytes;
+	daos_size_t	failed_nr;
+};
+
+static void
+comp_cb(void *arg, int rc, daos_size_t bytes, daos_hl_array_ranges_t *failed)
+{
+	struct comp_arg *c = (struct comp_arg *)arg;
+
+	c->calls ++;
+	c->rc = rc;
+	c->bytes = bytes;
+	c->failed_nr = failed->ranges_nr;
+}
+
+static void
+comp_cb_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	struct comp_arg	c;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** set array location, spanning several dkeys */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = arg->myrank * rg.len;
+	ranges.ranges = &rg;
+
+	/** set memory location */
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	/** Write */
+	memset(&c, 0, sizeof(c));
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_write_cb(oh, 0, &ranges, &sgl, NULL, comp_cb, &c,
+				    arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+	/** the callback ran once, before the event completed */
+	assert_int_equal(c.calls, 1);
+	assert_int_equal(c.rc, 0);
+	assert_int_equal(c.bytes, NUM_ELEMS * sizeof(int));
+	assert_int_equal(c.failed_nr, 0);
+
+	/** Read */
+	memset(&c, 0, sizeof(c));
+	memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_read_cb(oh, 0, &ranges, &sgl, NULL, comp_cb, &c,
+				   arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+	assert_int_equal(c.calls, 1);
+	assert_int_equal(c.rc, 0);
+	assert_int_equal(c.bytes, NUM_ELEMS * sizeof(int));
+	assert_int_equal(c.failed_nr, 0);
+
+	/** Verify data */
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End comp_cb_io */
+
+static void
+progress_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	daos_hl_progress_attr_t pattr;
+	struct comp_arg	c;
+	int		*wbuf = NULL;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		waited;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	pattr.dp_cpu = -1;
+	pattr.dp_poll_timeout = 0;
+	rc = daos_hl_progress_start(&pattr);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer, many more dkeys than the I/O window */
+	wbuf = malloc(NUM_SEGS * NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	for (i = 0; i < NUM_SEGS * NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	ranges.ranges_nr = 1;
+	rg.len = NUM_SEGS * NUM_ELEMS * sizeof(int);
+	rg.index = arg->myrank * rg.len;
+	ranges.ranges = &rg;
+
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_SEGS * NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	/** Write, and let the progress thread complete it without polling */
+	memset(&c, 0, sizeof(c));
+	rc = daos_event_init(&ev, arg->eq, NULL);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_write_cb(oh, 0, &ranges, &sgl, NULL, comp_cb, &c,
+				    &ev);
+	assert_int_equal(rc, 0);
+	for (waited = 0; waited < 10000; waited++) {
+		if (__atomic_load_n(&c.calls, __ATOMIC_ACQUIRE) != 0)
+			break;
+		usleep(1000);
+	}
+	assert_int_equal(c.calls, 1);
+	assert_int_equal(c.rc, 0);
+	assert_int_equal(c.bytes, NUM_SEGS * NUM_ELEMS * sizeof(int));
+
+	/** the event is completed and waits to be reaped */
+	rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+	assert_int_equal(rc, 1);
+	assert_ptr_equal(evp, &ev);
+	assert_int_equal(evp->ev_error, 0);
+	rc = daos_event_fini(&ev);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_progress_stop();
+	assert_int_equal(rc, 0);
+
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End progress_io */
+
+static void
+rpc_split_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t *rgs;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** RPCs of at most 3 ints, in at most 2 pieces */
+	rc = daos_hl_rpc_limits_set(3 * sizeof(int), 2);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** one int every other int, so dkeys get several recxs */
+	rgs = malloc(NUM_ELEMS * sizeof(daos_hl_range_t));
+	assert_non_null(rgs);
+	for (i = 0; i < NUM_ELEMS; i++) {
+		rgs[i].len = sizeof(int);
+		rgs[i].index = (arg->myrank * NUM_ELEMS + i) * 2 * sizeof(int);
+	}
+	ranges.ranges_nr = NUM_ELEMS;
+	ranges.ranges = rgs;
+
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	/** Write */
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL,
+				 arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Read back with the default limits */
+	rc = daos_hl_rpc_limits_set(0, 0);
+	assert_int_equal(rc, 0);
+
+	memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Verify data */
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	free(rgs);
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End rpc_split_io */
+
+static void
+gather_scatter_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_off_t	*indices, *rindices;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	indices = malloc(NUM_ELEMS * sizeof(daos_off_t));
+	assert_non_null(indices);
+	rindices = malloc(NUM_ELEMS * sizeof(daos_off_t));
+	assert_non_null(rindices);
+
+	/** distinct scattered indices, disjoint between ranks */
+	for (i = 0; i < NUM_ELEMS; i++) {
+		wbuf[i] = i+1;
+		indices[i] = (arg->myrank * NUM_ELEMS + (i * 37) % NUM_ELEMS) *
+			5;
+	}
+
+	/** Scatter */
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_scatter(oh, 0, NUM_ELEMS, indices, sizeof(int),
+				   wbuf, arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/**
+	 * Gather in the reverse order, with a recx cap lower than the number
+	 * of elements of a dkey, that must not split it
+	 */
+	rc = daos_hl_rpc_limits_set(0, 2);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++)
+		rindices[i] = indices[NUM_ELEMS - 1 - i];
+	memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_gather(oh, 0, NUM_ELEMS, rindices, sizeof(int),
+				  rbuf, arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	rc = daos_hl_rpc_limits_set(0, 0);
+	assert_int_equal(rc, 0);
+
+	/** Verify data */
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[NUM_ELEMS - 1 - i]);
+
+	free(rindices);
+	free(indices);
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End gather_scatter_io */
+
+static void
+mmap_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid;
+	daos_handle_t		oh;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	daos_hl_array_map_t	*map;
+	void			*addr;
+	const int		*mbuf;
+	int			*wbuf = NULL;
+	daos_size_t 		i;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** set array location */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = arg->myrank * NUM_ELEMS * sizeof(int);
+	ranges.ranges = &rg;
+
+	/** set memory location */
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	/** Write */
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Map and read through the mapping, back to front */
+	rc = daos_hl_array_mmap(oh, 0, &rg, &map, &addr);
+	assert_int_equal(rc, 0);
+	mbuf = addr;
+	for (i = NUM_ELEMS; i > 0; i--)
+		assert_int_equal(mbuf[i - 1], wbuf[i - 1]);
+
+	rc = daos_hl_array_munmap(map);
+	assert_int_equal(rc, 0);
+
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End mmap_io */
+
+static void
+dump_load_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid, load_oid;
+	daos_handle_t		oh, load_oh;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg, dump_rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	int			*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 		i;
+	int			rc;
+
+	/** all ranks dump and load the same objects */
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, 0);
+	load_oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, 0);
+	MPI_Bcast(&oid, sizeof(oid), MPI_BYTE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&load_oid, sizeof(load_oid), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+	/** open the objects */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+	rc = daos_obj_open(arg->coh, load_oid, 0, 0, &load_oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** each rank writes a slice followed by a hole of the same size */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = arg->myrank * 2 * NUM_ELEMS * sizeof(int);
+	ranges.ranges = &rg;
+
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	/** Dump all the slices and holes, then load them in another array */
+	dump_rg.index = 0;
+	dump_rg.len = arg->rank_size * 2 * NUM_ELEMS * sizeof(int);
+	rc = daos_hl_array_dump(oh, 0, &dump_rg, MPI_COMM_WORLD,
+				"/tmp/daos_hl_dump_test");
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_load(load_oh, 0, MPI_COMM_WORLD,
+				"/tmp/daos_hl_dump_test");
+	assert_int_equal(rc, 0);
+
+	/** Verify the slice and the hole after it */
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	rc = daos_hl_array_read(load_oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+	rg.index += NUM_ELEMS * sizeof(int);
+	rc = daos_hl_array_read(load_oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(rbuf[i], 0);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(load_oh, NULL);
+	assert_int_equal(rc, 0);
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End dump_load_io */
+
+static void
+dump_load_create(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid, load_oid;
+	daos_handle_t		oh, load_oh;
+	daos_hl_array_attr_t	attr, load_attr;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	daos_size_t		size;
+	char			path[64];
+	int			*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 		i;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+	load_oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+	snprintf(path, sizeof(path), "/tmp/daos_hl_dump_create.%d",
+		 arg->myrank);
+
+	/** a typed array with a non default layout */
+	memset(&attr, 0, sizeof(attr));
+	attr.da_layout = DAOS_HL_LAYOUT_CONTIG;
+	attr.da_block_size = 4 * sizeof(int);
+	attr.da_dkey_blocks = 2;
+	attr.da_type = DAOS_HL_TYPE_INT32;
+	rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = 3 * sizeof(int);
+	ranges.ranges = &rg;
+
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Dump up to the array size, and load it in a new array */
+	rc = daos_hl_array_dump(oh, 0, NULL, MPI_COMM_SELF, path);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_load_create(arg->coh, load_oid, 0, MPI_COMM_SELF,
+				       path, &load_oh);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_close(load_oh);
+	assert_int_equal(rc, 0);
+
+	/** The new array has the attributes, size and data of the first */
+	rc = daos_hl_array_open(arg->coh, load_oid, 0, DAOS_OO_RW, &load_attr,
+				&load_oh);
+	assert_int_equal(rc, 0);
+	assert_int_equal(load_attr.da_layout, DAOS_HL_LAYOUT_CONTIG);
+	assert_int_equal(load_attr.da_block_size, 4 * sizeof(int));
+	assert_int_equal(load_attr.da_dkey_blocks, 2);
+	assert_int_equal(load_attr.da_type, DAOS_HL_TYPE_INT32);
+
+	rc = daos_hl_array_get_size(load_oh, 0, &size, NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(size, rg.index + rg.len);
+
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	rc = daos_hl_array_read(load_oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	free(rbuf);
+	free(wbuf);
+	unlink(path);
+
+	rc = daos_hl_array_close(load_oh);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+} /* End dump_load_create */
+
+static void
+fields_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	struct particle {
+		double	x;
+		double	v;
+		int	id;
+	}			*wbuf = NULL, *rbuf = NULL;
+	daos_hl_field_t		fields[3] = {{"x", sizeof(double)},
+					     {"v", sizeof(double)},
+					     {"id", sizeof(int)}};
+	daos_hl_field_mem_t	mem[3];
+	daos_obj_id_t		oid;
+	daos_handle_t		oh;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	double			*xs;
+	int			*ids;
+	daos_size_t 		i;
+	daos_event_t		ev, *evp;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** create the object with one akey per field */
+	rc = daos_hl_array_create_fields(arg->coh, oid, 0, NULL, 3, fields,
+					 &oh);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(*wbuf));
+	assert_non_null(wbuf);
+	rbuf = calloc(NUM_ELEMS, sizeof(*rbuf));
+	assert_non_null(rbuf);
+	xs = malloc(NUM_ELEMS * sizeof(double));
+	assert_non_null(xs);
+	ids = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(ids);
+	for (i = 0; i < NUM_ELEMS; i++) {
+		wbuf[i].x = i * 0.5;
+		wbuf[i].v = i * 2.0;
+		wbuf[i].id = i+1;
+	}
+
+	/** set array location, in records */
+	ranges.ranges_nr = 1;
+	rg.len = NUM_ELEMS;
+	rg.index = arg->myrank * NUM_ELEMS;
+	ranges.ranges = &rg;
+
+	/** Write all the fields from an array of structs */
+	mem[0].fm_name = "x";
+	mem[0].fm_buf = &wbuf[0].x;
+	mem[1].fm_name = "v";
+	mem[1].fm_buf = &wbuf[0].v;
+	mem[2].fm_name = "id";
+	mem[2].fm_buf = &wbuf[0].id;
+	for (i = 0; i < 3; i++)
+		mem[i].fm_stride = sizeof(*wbuf);
+
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_write_fields(oh, 0, &ranges, 3, mem,
+					arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Read two fields into one buffer per field */
+	mem[0].fm_name = "id";
+	mem[0].fm_buf = ids;
+	mem[0].fm_stride = sizeof(int);
+	mem[1].fm_name = "x";
+	mem[1].fm_buf = xs;
+	mem[1].fm_stride = sizeof(double);
+
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_read_fields(oh, 0, &ranges, 2, mem,
+				       arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Read one field into an array of structs */
+	mem[0].fm_name = "v";
+	mem[0].fm_buf = &rbuf[0].v;
+	mem[0].fm_stride = sizeof(*rbuf);
+	rc = daos_hl_array_read_fields(oh, 0, &ranges, 1, mem, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Verify data */
+	for (i = 0; i < NUM_ELEMS; i++) {
+		assert_int_equal(ids[i], wbuf[i].id);
+		assert_true(xs[i] == wbuf[i].x);
+		assert_true(rbuf[i].v == wbuf[i].v);
+		assert_true(rbuf[i].x == 0);
+		assert_int_equal(rbuf[i].id, 0);
+	}
+
+	free(ids);
+	free(xs);
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+} /* End fields_io */
+
+static void
+zonemap_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_hl_array_attr_t	attr;
+	daos_obj_id_t		oid;
+	daos_handle_t		oh;
+	daos_hl_array_ranges_t	ranges, matched;
+	daos_hl_range_t		rg;
+	daos_hl_predicate_t	pred;
+	daos_hl_zone_t		zone;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	float			*wbuf = NULL, *rbuf = NULL;
+	daos_size_t		nr = NUM_ELEMS * 16;
+	daos_size_t 		i;
+	daos_event_t		ev, *evp;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** 16 floats per block */
+	memset(&attr, 0, sizeof(attr));
+	attr.da_flags = DAOS_HL_ARRAY_ZONEMAP;
+	attr.da_type = DAOS_HL_TYPE_FLOAT;
+	attr.da_block_size = 16 * sizeof(float);
+	rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(nr * sizeof(float));
+	assert_non_null(wbuf);
+	rbuf = malloc(nr * sizeof(float));
+	assert_non_null(rbuf);
+	for (i = 0; i < nr; i++)
+		wbuf[i] = i;
+
+	ranges.ranges_nr = 1;
+	rg.len = nr * sizeof(float);
+	rg.index = 0;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, nr * sizeof(float));
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** A write not aligned on elements makes the last block unknown */
+	rg.len = sizeof(float);
+	rg.index = (nr - 16) * sizeof(float) + 2;
+	daos_iov_set(&iov, wbuf, sizeof(float));
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_array_zones_get(oh, 0, 1, &zone);
+	assert_int_equal(rc, 0);
+	assert_int_equal(zone.dz_count, 16);
+	assert_int_equal(zone.dz_zeros, 1);
+	assert_true(zone.dz_min.v_d == 0 && zone.dz_max.v_d == 15);
+
+	rc = daos_hl_array_zones_get(oh, nr / 16 - 1, 1, &zone);
+	assert_int_equal(rc, 0);
+	assert_int_equal(zone.dz_count, 16);
+	assert_true(zone.dz_min.v_d == -INFINITY &&
+		    zone.dz_max.v_d == INFINITY);
+
+	/** Only blocks 6 to 8, and the unknown one, may hold [100, 130] */
+	for (i = 0; i < nr; i++)
+		rbuf[i] = -1;
+	rg.len = nr * sizeof(float);
+	rg.index = 0;
+	daos_iov_set(&iov, rbuf, nr * sizeof(float));
+	pred.dp_lo.v_d = 100;
+	pred.dp_hi.v_d = 130;
+
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_read_where(oh, 0, &rg, &pred, &sgl, &matched,
+				      arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	assert_int_equal(matched.ranges_nr, 2);
+	assert_int_equal(matched.ranges[0].index, 96 * sizeof(float));
+	assert_int_equal(matched.ranges[0].len, 48 * sizeof(float));
+	assert_int_equal(matched.ranges[1].index, (nr - 16) * sizeof(float));
+	assert_int_equal(matched.ranges[1].len, 16 * sizeof(float));
+	free(matched.ranges);
+	for (i = 0; i < nr - 16; i++) {
+		if (i >= 96 && i < 144)
+			assert_true(rbuf[i] == wbuf[i]);
+		else
+			assert_true(rbuf[i] == -1);
+	}
+
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+
+	free(rbuf);
+	free(wbuf);
+} /* End zonemap_io */
+
+static void
+zonemap_writers(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_hl_array_attr_t	attr;
+	daos_obj_id_t		oid, load_oid;
+	daos_handle_t		oh, oh2, load_oh;
+	daos_hl_array_ranges_t	ranges, matched;
+	daos_hl_range_t		rg;
+	daos_hl_predicate_t	pred;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	daos_size_t		size;
+	char			path[64];
+	float			wbuf[128], rbuf[128];
+	daos_size_t 		i;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+	load_oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+	snprintf(path, sizeof(path), "/tmp/daos_hl_dump_zonemap.%d",
+		 arg->myrank);
+
+	/** 16 floats per block, and a second handle opened before any write */
+	memset(&attr, 0, sizeof(attr));
+	attr.da_flags = DAOS_HL_ARRAY_ZONEMAP;
+	attr.da_type = DAOS_HL_TYPE_FLOAT;
+	attr.da_block_size = 16 * sizeof(float);
+	rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_open(arg->coh, oid, 0, DAOS_OO_RW, NULL, &oh2);
+	assert_int_equal(rc, 0);
+
+	for (i = 0; i < 128; i++)
+		wbuf[i] = i;
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+
+	rg.index = 0;
+	rg.len = sizeof(wbuf);
+	daos_iov_set(&iov, wbuf, sizeof(wbuf));
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** The second handle sees the blocks written through the first */
+	pred.dp_lo.v_d = 100;
+	pred.dp_hi.v_d = 130;
+	daos_iov_set(&iov, rbuf, sizeof(rbuf));
+	rc = daos_hl_array_read_where(oh2, 0, &rg, &pred, &sgl, &matched,
+				      NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(matched.ranges_nr, 1);
+	assert_int_equal(matched.ranges[0].index, 96 * sizeof(float));
+	assert_int_equal(matched.ranges[0].len, 32 * sizeof(float));
+	free(matched.ranges);
+
+	/**
+	 * Both handles write half of block 0: the summary of the first does
+	 * not hide the values written through the second
+	 */
+	for (i = 0; i < 8; i++)
+		wbuf[i] = 500;
+	rg.len = 8 * sizeof(float);
+	daos_iov_set(&iov, wbuf, rg.len);
+	rc = daos_hl_array_write(oh2, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	rg.index = 8 * sizeof(float);
+	daos_iov_set(&iov, &wbuf[8], rg.len);
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	pred.dp_lo.v_d = 400;
+	pred.dp_hi.v_d = 600;
+	rg.index = 0;
+	rg.len = 16 * sizeof(float);
+	daos_iov_set(&iov, rbuf, rg.len);
+	rc = daos_hl_array_read_where(oh, 0, &rg, &pred, &sgl, &matched,
+				      NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(matched.ranges_nr, 1);
+	assert_int_equal(matched.ranges[0].index, 0);
+	assert_int_equal(matched.ranges[0].len, 16 * sizeof(float));
+	free(matched.ranges);
+	for (i = 0; i < 16; i++)
+		assert_true(rbuf[i] == wbuf[i]);
+
+	/** Growing the array to a size not aligned on elements works */
+	rc = daos_hl_array_set_size(oh, 0, 200 * sizeof(float) + 1, NULL);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_get_size(oh2, 0, &size, NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(size, 200 * sizeof(float) + 1);
+
+	/** And so does loading its dump into a new array with a zone map */
+	rc = daos_hl_array_dump(oh, 0, NULL, MPI_COMM_SELF, path);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_load_create(arg->coh, load_oid, 0, MPI_COMM_SELF,
+				       path, &load_oh);
+	assert_int_equal(rc, 0);
+	unlink(path);
+
+	for (i = 0; i < 16; i++)
+		rbuf[i] = -1;
+	rc = daos_hl_array_read_where(load_oh, 0, &rg, &pred, &sgl, &matched,
+				      NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(matched.ranges_nr, 1);
+	free(matched.ranges);
+	for (i = 0; i < 16; i++)
+		assert_true(rbuf[i] == wbuf[i]);
+
+	rc = daos_hl_array_close(load_oh);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_close(oh2);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+} /* End zonemap_writers */
+
+static void
+reduce_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_hl_array_attr_t	attr;
+	daos_obj_id_t		oid;
+	daos_handle_t		oh;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_hl_reduce_t	res;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	uint64_t		bins[4];
+	double			*wbuf = NULL;
+	double			sum = 0;
+	daos_size_t		nr = 100 * 2048;
+	daos_size_t 		i;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	memset(&attr, 0, sizeof(attr));
+	attr.da_type = DAOS_HL_TYPE_DOUBLE;
+	rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+	assert_int_equal(rc, 0);
+
+	/** Values are small integers, summed exactly over two ring buffers */
+	wbuf = malloc(nr * sizeof(double));
+	assert_non_null(wbuf);
+	for (i = 0; i < nr; i++) {
+		wbuf[i] = (double)(i % 100) - 50;
+		sum += wbuf[i];
+	}
+
+	ranges.ranges_nr = 1;
+	rg.len = nr * sizeof(double);
+	rg.index = 0;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, nr * sizeof(double));
+	sgl.sg_iovs = &iov;
+
+	rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_array_reduce(oh, 0, &rg, DAOS_HL_REDUCE_SUM, &res);
+	assert_int_equal(rc, 0);
+	assert_int_equal(res.dr_count, nr);
+	assert_true(res.dr_value.v_d == sum);
+
+	rc = daos_hl_array_reduce(oh, 0, &rg, DAOS_HL_REDUCE_MIN, &res);
+	assert_int_equal(rc, 0);
+	assert_true(res.dr_value.v_d == -50);
+
+	rc = daos_hl_array_reduce(oh, 0, &rg, DAOS_HL_REDUCE_MAX, &res);
+	assert_int_equal(rc, 0);
+	assert_true(res.dr_value.v_d == 49);
+
+	/** 4 bins over [-50, 50), 25 values each */
+	res.dr_lo.v_d = -50;
+	res.dr_hi.v_d = 50;
+	res.dr_nbins = 4;
+	res.dr_bins = bins;
+	rc = daos_hl_array_reduce(oh, 0, &rg, DAOS_HL_REDUCE_HIST, &res);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < 4; i++)
+		assert_int_equal(bins[i], nr / 4);
+
+	/**
+	 * Holes past the data, read through buffers reused from the data,
+	 * reduce and count as zeros
+	 */
+	rg.len = (nr + 6 * 131072) * sizeof(double);
+	rc = daos_hl_array_reduce(oh, 0, &rg, DAOS_HL_REDUCE_SUM, &res);
+	assert_int_equal(rc, 0);
+	assert_int_equal(res.dr_count, nr + 6 * 131072);
+	assert_true(res.dr_value.v_d == sum);
+
+	/** A range not aligned on elements is rejected */
+	rg.index = 1;
+	rg.len = sizeof(double);
+	rc = daos_hl_array_reduce(oh, 0, &rg, DAOS_HL_REDUCE_SUM, &res);
+	assert_true(rc < 0);
+
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+
+	free(wbuf);
+} /* End reduce_io */
+
+static void
+ckpt_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid;
+	daos_handle_t		oh;
+	daos_hl_ckpt_t		*ckpt;
+	daos_hl_ckpt_attr_t	cattr;
+	daos_hl_array_ranges_t	ranges;
+	daos_hl_range_t		rg;
+	daos_sg_list_t		sgl;
+	daos_iov_t		iov;
+	int			*wbuf = NULL, *rbuf = NULL;
+	daos_size_t		len = NUM_ELEMS * sizeof(int);
+	daos_size_t 		i;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	rc = daos_hl_array_create(arg->coh, oid, 0, NULL, &oh);
+	assert_int_equal(rc, 0);
+
+	/** Small buffers, so that the writes go through all of them */
+	cattr.dc_buf_nr = 2;
+	cattr.dc_buf_size = len / 8;
+	rc = daos_hl_ckpt_create(arg->coh, &cattr, &ckpt);
+	assert_int_equal(rc, 0);
+
+	wbuf = malloc(len);
+	assert_non_null(wbuf);
+	rbuf = malloc(2 * len);
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+	daos_iov_set(&iov, wbuf, len);
+
+	/** A staged write does not need the buffer once it returns */
+	rg.len = len;
+	rg.index = 0;
+	rc = daos_hl_ckpt_write(ckpt, oh, 0, &ranges, &sgl, 0);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = -(i+1);
+
+	/** A borrowed write needs it until the wait */
+	rg.index = len;
+	rc = daos_hl_ckpt_write(ckpt, oh, 0, &ranges, &sgl,
+				DAOS_HL_CKPT_BORROW);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_ckpt_wait(ckpt, 0);
+	assert_int_equal(rc, 0);
+
+	/** Read both writes back */
+	rg.len = 2 * len;
+	rg.index = 0;
+	daos_iov_set(&iov, rbuf, 2 * len);
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++) {
+		assert_int_equal(rbuf[i], i+1);
+		assert_int_equal(rbuf[NUM_ELEMS + i], -(i+1));
+	}
+
+	/**
+	 * The writes of epochs 2 and 3 run out of retries: each wait returns
+	 * the error of its own epoch, once
+	 */
+	io_test_fault_set(-DER_BUSY, 2 * (DAOS_HL_IO_RETRY_MAX + 1));
+	rg.len = len / 8;
+	daos_iov_set(&iov, wbuf, len / 8);
+	rc = daos_hl_ckpt_write(ckpt, oh, 2, &ranges, &sgl, 0);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ckpt_write(ckpt, oh, 3, &ranges, &sgl, 0);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_ckpt_wait(ckpt, 1);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ckpt_wait(ckpt, 2);
+	assert_int_equal(rc, -DER_BUSY);
+	rc = daos_hl_ckpt_wait(ckpt, 3);
+	assert_int_equal(rc, -DER_BUSY);
+	rc = daos_hl_ckpt_wait(ckpt, 3);
+	assert_int_equal(rc, 0);
+	io_test_fault_set(0, 0);
+
+	/** Unequal memory and array extents are rejected */
+	rg.len = len;
+	daos_iov_set(&iov, rbuf, 2 * len);
+	rc = daos_hl_ckpt_write(ckpt, oh, 0, &ranges, &sgl, 0);
+	assert_true(rc < 0);
+
+	rc = daos_hl_ckpt_destroy(ckpt);
+	assert_int_equal(rc, 0);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_hl_array_close(oh);
+	assert_int_equal(rc, 0);
+} /* End ckpt_io */
+
+/** ints spanning many more dkeys than the in-flight window of an operation */
+#define WINDOW_ELEMS	(8 * NUM_SEGS * NUM_ELEMS)
+/** max number of dkey I/O submissions recorded by sched_io */
+#define SCHED_REC_NR	4096
+
+static void
+sched_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges, ranges2;
+	daos_hl_range_t rg, rg2;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t	nr = WINDOW_ELEMS;
+	daos_size_t 	i;
+	unsigned int	*targets;
+	unsigned int	recorded, peak;
+	bool		seen[3] = {false, false, false};
+	daos_event_t	ev, ev2, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** 3 targets taking a single dkey I/O at a time */
+	rc = daos_hl_io_sched_set(3, 1);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(nr * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(nr * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < nr; i++)
+		wbuf[i] = i+1;
+
+	/** a range over many dkeys */
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	rg.len = nr * sizeof(int);
+	rg.index = arg->myrank * rg.len;
+	sgl.sg_nr.num = 1;
+	daos_iov_set(&iov, wbuf, nr * sizeof(int));
+	sgl.sg_iovs = &iov;
+
+	targets = malloc(SCHED_REC_NR * sizeof(unsigned int));
+	assert_non_null(targets);
+	io_test_sched_record(targets, SCHED_REC_NR);
+
+	/**
+	 * Write, in non-blocking mode as two operations in flight together
+	 * over the two halves of the range
+	 */
+	if (arg->async) {
+		ranges2.ranges_nr = 1;
+		ranges2.ranges = &rg2;
+		rg.len /= 2;
+		rg2.index = rg.index + rg.len;
+		rg2.len = rg.len;
+
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+		rc = daos_event_init(&ev2, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+
+		daos_iov_set(&iov, wbuf, nr / 2 * sizeof(int));
+		rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, &ev);
+		assert_int_equal(rc, 0);
+		daos_iov_set(&iov, wbuf + nr / 2, nr / 2 * sizeof(int));
+		rc = daos_hl_array_write(oh, 0, &ranges2, &sgl, NULL, &ev2);
+		assert_int_equal(rc, 0);
+
+		/** Wait for completion */
+		for (i = 0; i < 2; i++) {
+			rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+			assert_int_equal(rc, 1);
+			assert_true(evp == &ev || evp == &ev2);
+			assert_int_equal(evp->ev_error, 0);
+		}
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+		rc = daos_event_fini(&ev2);
+		assert_int_equal(rc, 0);
+		rg.len *= 2;
+	} else {
+		rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+		assert_int_equal(rc, 0);
+	}
+
+	/**
+	 * The dkey I/Os went to all the targets, never more than one at a time
+	 * on a target across the operations
+	 */
+	io_test_sched_stats(&recorded, &peak);
+	io_test_sched_record(NULL, 0);
+	assert_true(recorded > 0 && recorded <= SCHED_REC_NR);
+	for (i = 0; i < recorded; i++) {
+		assert_true(targets[i] < 3);
+		seen[targets[i]] = true;
+	}
+	assert_true(seen[0] && seen[1] && seen[2]);
+	assert_int_equal(peak, 1);
+	free(targets);
+
+	/** Read back with the default scheduling */
+	rc = daos_hl_io_sched_set(0, 0);
+	assert_int_equal(rc, 0);
+
+	memset(rbuf, 0, nr * sizeof(int));
+	daos_iov_set(&iov, rbuf, nr * sizeof(int));
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Verify data */
+	for (i = 0; i < nr; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End sched_io */
+
+static void
+window_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	struct comp_arg	c;
+	int		*wbuf = NULL, *rbuf = NULL;
+	daos_size_t 	i;
+	int		iter;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	/** Allocate buffers */
+	wbuf = malloc(WINDOW_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(WINDOW_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	rg.len = WINDOW_ELEMS * sizeof(int);
+	rg.index = arg->myrank * rg.len;
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+
+	/** back to back operations, reusing the event queue of the thread */
+	for (iter = 0; iter < 4; iter++) {
+		for (i = 0; i < WINDOW_ELEMS; i++)
+			wbuf[i] = i + iter;
+
+		/** Write */
+		memset(&c, 0, sizeof(c));
+		daos_iov_set(&iov, wbuf, WINDOW_ELEMS * sizeof(int));
+		if (arg->async) {
+			rc = daos_event_init(&ev, arg->eq, NULL);
+			assert_int_equal(rc, 0);
+		}
+		rc = daos_hl_array_write_cb(oh, 0, &ranges, &sgl, NULL,
+					    comp_cb, &c,
+					    arg->async ? &ev : NULL);
+		assert_int_equal(rc, 0);
+		if (arg->async) {
+			/** Wait for completion */
+			rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+			assert_int_equal(rc, 1);
+			assert_ptr_equal(evp, &ev);
+			assert_int_equal(evp->ev_error, 0);
+
+			rc = daos_event_fini(&ev);
+			assert_int_equal(rc, 0);
+		}
+		/** every dkey I/O went through the window exactly once */
+		assert_int_equal(c.calls, 1);
+		assert_int_equal(c.rc, 0);
+		assert_int_equal(c.bytes, WINDOW_ELEMS * sizeof(int));
+
+		/** Read */
+		memset(rbuf, 0, WINDOW_ELEMS * sizeof(int));
+		daos_iov_set(&iov, rbuf, WINDOW_ELEMS * sizeof(int));
+		if (arg->async) {
+			rc = daos_event_init(&ev, arg->eq, NULL);
+			assert_int_equal(rc, 0);
+		}
+		rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL,
+					arg->async ? &ev : NULL);
+		assert_int_equal(rc, 0);
+		if (arg->async) {
+			/** Wait for completion */
+			rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+			assert_int_equal(rc, 1);
+			assert_ptr_equal(evp, &ev);
+			assert_int_equal(evp->ev_error, 0);
+
+			rc = daos_event_fini(&ev);
+			assert_int_equal(rc, 0);
+		}
+
+		/** Verify data */
+		for (i = 0; i < WINDOW_ELEMS; i++)
+			assert_int_equal(wbuf[i], rbuf[i]);
+	}
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End window_io */
+
+static void
+size_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh, oh2;
+	daos_hl_array_attr_t attr;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	daos_size_t	size;
+	int		val = 1;
+	uint32_t	layout;
+	int		rc;
+
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	rg.len = sizeof(int);
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+	daos_iov_set(&iov, &val, sizeof(int));
+
+	for (layout = 0; layout < DAOS_HL_LAYOUT_NR; layout++) {
+		oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+		memset(&attr, 0, sizeof(attr));
+		attr.da_layout = layout;
+		rc = daos_hl_array_create(arg->coh, oid, 0, &attr, &oh);
+		assert_int_equal(rc, 0);
+
+		rc = daos_hl_array_get_size(oh, 0, &size, NULL);
+		assert_int_equal(rc, 0);
+		assert_int_equal(size, 0);
+
+		/** far past the first dkey, then below it */
+		rg.index = 1000000;
+		rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+		assert_int_equal(rc, 0);
+		rg.index = 0;
+		rc = daos_hl_array_write(oh, 0, &ranges, &sgl, NULL, NULL);
+		assert_int_equal(rc, 0);
+
+		/** the size is seen through another handle */
+		rc = daos_hl_array_open(arg->coh, oid, 0, DAOS_OO_RW, NULL,
+					&oh2);
+		assert_int_equal(rc, 0);
+		rc = daos_hl_array_get_size(oh2, 0, &size, NULL);
+		assert_int_equal(rc, 0);
+		assert_int_equal(size, 1000000 + sizeof(int));
+
+		/** grow, then shrink from the other handle */
+		rc = daos_hl_array_set_size(oh, 0, 2000000, NULL);
+		assert_int_equal(rc, 0);
+		rc = daos_hl_array_get_size(oh2, 0, &size, NULL);
+		assert_int_equal(rc, 0);
+		assert_int_equal(size, 2000000);
+
+		rc = daos_hl_array_set_size(oh2, 0, 100, NULL);
+		assert_int_equal(rc, 0);
+		rc = daos_hl_array_get_size(oh, 0, &size, NULL);
+		assert_int_equal(rc, 0);
+		assert_int_equal(size, 100);
+
+		/** the cut tail was punched, growing back reads a hole */
+		rc = daos_hl_array_set_size(oh, 0, 2000000, NULL);
+		assert_int_equal(rc, 0);
+		rg.index = 1000000;
+		val = 0;
+		rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+		assert_int_equal(rc, 0);
+		assert_int_equal(val, 0);
+		val = 1;
+
+		rc = daos_hl_array_close(oh2);
+		assert_int_equal(rc, 0);
+		rc = daos_hl_array_close(oh);
+		assert_int_equal(rc, 0);
+	}
+} /* End size_io */
+
+static uint64_t
+retry_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Write with the first nr submissions failing with a transient error */
+static void
+retry_write(test_arg_t *arg, daos_handle_t oh, daos_hl_array_ranges_t *ranges,
+	    daos_sg_list_t *sgl, unsigned int nr, struct comp_arg *c)
+{
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	memset(c, 0, sizeof(*c));
+	io_test_fault_set(-DER_BUSY, nr);
+
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_array_write_cb(oh, 0, ranges, sgl, NULL, comp_cb, c,
+				    arg->async ? &ev : NULL);
+	if (arg->async) {
+		/** the launch returns while the retries wait for the timer */
+		assert_int_equal(rc, 0);
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		rc = evp->ev_error;
+		assert_int_equal(daos_event_fini(&ev), 0);
+	}
+	assert_int_equal(rc, c->rc);
+
+	io_test_fault_set(0, 0);
+}
+
+static void
+retry_io(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_array_ranges_t ranges;
+	daos_hl_range_t rg;
+	daos_sg_list_t 	sgl;
+	daos_iov_t	iov;
+	struct comp_arg	c;
+	int		*wbuf = NULL, *rbuf = NULL;
+	uint64_t	start;
+	daos_size_t 	i;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** a plain object, so that the write is a single dkey I/O */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i + 1;
+
+	ranges.ranges_nr = 1;
+	ranges.ranges = &rg;
+	rg.len = NUM_ELEMS * sizeof(int);
+	rg.index = 0;
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+
+	/**
+	 * Three failed submissions: the dkey I/O goes through after three
+	 * backoffs, each at least half of the base doubled every retry.
+	 */
+	start = retry_now();
+	retry_write(arg, oh, &ranges, &sgl, 3, &c);
+	assert_int_equal(c.calls, 1);
+	assert_int_equal(c.rc, 0);
+	assert_int_equal(c.bytes, NUM_ELEMS * sizeof(int));
+	assert_true(retry_now() - start >= 7 * DAOS_HL_IO_RETRY_BASE / 2);
+
+	memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+	daos_iov_set(&iov, rbuf, NUM_ELEMS * sizeof(int));
+	rc = daos_hl_array_read(oh, 0, &ranges, &sgl, NULL, NULL);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	/** past the last retry, the error and the range are reported */
+	daos_iov_set(&iov, wbuf, NUM_ELEMS * sizeof(int));
+	retry_write(arg, oh, &ranges, &sgl, DAOS_HL_IO_RETRY_MAX + 1, &c);
+	assert_int_equal(c.calls, 1);
+	assert_int_equal(c.rc, -DER_BUSY);
+	assert_int_equal(c.bytes, 0);
+	assert_int_equal(c.failed_nr, 1);
+
+	free(rbuf);
+	free(wbuf);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End retry_io */
+
+static const struct CMUnitTest array_io_tests[] = {
+	{"Array I/O: Contiguous memory and array (blocking)",
+	 contig_mem_contig_arr_io, async_disable, NULL},
+	{"Array I/O: Contiguous memory and array (non-blocking)",
+	contig_mem_contig_arr_io, async_enable, NULL},
+	{"Array I/O: Contiguous memory Strided array (blocking)",
+	 contig_mem_str_arr_io, async_disable, NULL},
+	{"Array I/O: Contiguous memory Strided array (non-blocking)",
+	contig_mem_str_arr_io, async_enable, NULL},
+	{"Array I/O: Strided memory and array (blocking)", 
+	 str_mem_str_arr_io, async_disable, NULL},
+	{"Array I/O: Strided memory and array (non-blocking)",
+	str_mem_str_arr_io, async_enable, NULL},
+//	{"Array I/O: Read from Empty array & records (blocking)", 
+//	 read_empty_records, async_disable, NULL},
+//	{"Array I/O: Read from Empty array & records (blocking)", 
+//	read_empty_records, async_enable, NULL},
+	{"Array I/O: Append from all ranks (blocking)",
+	 append_io, async_disable, NULL},
+	{"Array I/O: Append from all ranks (non-blocking)",
+	append_io, async_enable, NULL},
+	{"Array I/O: Append from threads without a context (blocking)",
+	 append_threads_io, async_disable, NULL},
+	{"Array I/O: Multiple arrays in one call (blocking)",
+	 multi_arr_io, async_disable, NULL},
+	{"Array I/O: Multiple arrays in one call (non-blocking)",
+	multi_arr_io, async_enable, NULL},
+	{"Array I/O: Sparse array with presence map (blocking)",
+	 sparse_bitmap_io, async_disable, NULL},
+	{"Array I/O: Sparse array with presence map (non-blocking)",
+	sparse_bitmap_io, async_enable, NULL},
+	{"Array I/O: Layout policies (blocking)",
+	 layout_io, async_disable, NULL},
+	{"Array I/O: Layout policies (non-blocking)",
+	layout_io, async_enable, NULL},
+	{"Array I/O: Ranges from a generator (blocking)",
+	 gen_io, async_disable, NULL},
+	{"Array I/O: Ranges from a generator (non-blocking)",
+	gen_io, async_enable, NULL},
+	{"Array I/O: Copy an array skipping holes (blocking)",
+	 copy_io, async_disable, NULL},
+	{"Array I/O: Completion callbacks (blocking)",
+	 comp_cb_io, async_disable, NULL},
+	{"Array I/O: Completion callbacks (non-blocking)",
+	comp_cb_io, async_enable, NULL},
+	{"Array I/O: Background progress thread (non-blocking)",
+	progress_io, async_enable, NULL},
+	{"Array I/O: Dkey I/Os split by the RPC limits (blocking)",
+	 rpc_split_io, async_disable, NULL},
+	{"Array I/O: Dkey I/Os split by the RPC limits (non-blocking)",
+	rpc_split_io, async_enable, NULL},
+	{"Array I/O: Gather and scatter of single elements (blocking)",
+	 gather_scatter_io, async_disable, NULL},
+	{"Array I/O: Gather and scatter of single elements (non-blocking)",
+	gather_scatter_io, async_enable, NULL},
+	{"Array I/O: Read through a memory mapping (blocking)",
+	 mmap_io, async_disable, NULL},
+	{"Array I/O: Dump to local files and load back (blocking)",
+	 dump_load_io, async_disable, NULL},
+	{"Array I/O: Dump and load into a new array (blocking)",
+	 dump_load_create, async_disable, NULL},
+	{"Array I/O: Fields of compound records (blocking)",
+	 fields_io, async_disable, NULL},
+	{"Array I/O: Fields of compound records (non-blocking)",
+	fields_io, async_enable, NULL},
+	{"Array I/O: Reads pruned by the zone map (blocking)",
+	 zonemap_io, async_disable, NULL},
+	{"Array I/O: Reads pruned by the zone map (non-blocking)",
+	zonemap_io, async_enable, NULL},
+	{"Array I/O: Zone maps of several writers (blocking)",
+	 zonemap_writers, async_disable, NULL},
+	{"Array I/O: Reductions streamed over a buffer ring (blocking)",
+	 reduce_io, async_disable, NULL},
+	{"Array I/O: Checkpoint writes drained in the background (blocking)",
+	 ckpt_io, async_disable, NULL},
+	{"Array I/O: Dkey I/Os interleaved over targets (blocking)",
+	 sched_io, async_disable, NULL},
+	{"Array I/O: Dkey I/Os interleaved over targets (non-blocking)",
+	sched_io, async_enable, NULL},
+	{"Array I/O: Operations over many windows of dkey I/Os (blocking)",
+	 window_io, async_disable, NULL},
+	{"Array I/O: Operations over many windows of dkey I/Os (non-blocking)",
+	window_io, async_enable, NULL},
+	{"Array I/O: Size of arrays of every layout (blocking)",
+	 size_io, async_disable, NULL},
+	{"Array I/O: Transient errors retried after a backoff (blocking)",
+	 retry_io, async_disable, NULL},
+	{"Array I/O: Transient errors retried after a backoff (non-blocking)",
+	retry_io, async_enable, NULL},
+};
 
 int
 run_array_test(int rank, int size)
@@ -649,7 +2900,7 @@ run_array_test(int rank, int size)
 	int rc = 0;
 
 	rc = cmocka_run_group_tests_name("Array io tests", array_io_tests,
-					 setup, teardown);
+					 test_setup, test_teardown);
 	MPI_Barrier(MPI_COMM_WORLD);
 	return rc;
 }
@@ -34,7 +34,7 @@
 
 #include <mpi.h>
 
-#include <daos_hl.h>
+#include <daos_hl_mpi.h>
 #include <daos_event.h>
 #include <daos_mgmt.h>
 
@@ -60,7 +60,7 @@ typedef struct {
 static inline int
 async_enable(void **state)
 {
-	test_arg_t	*arg = *state;
+	test_arg_t	*arg = (test_arg_t *)*state;
 
 	arg->async = true;
 	return 0;
@@ -69,7 +69,7 @@ async_enable(void **state)
 static inline int
 async_disable(void **state)
 {
-	test_arg_t	*arg = *state;
+	test_arg_t	*arg = (test_arg_t *)*state;
 
 	arg->async = false;
 	return 0;
@@ -78,13 +78,22 @@ async_disable(void **state)
 static inline int
 hdl_share_enable(void **state)
 {
-	test_arg_t	*arg = *state;
+	test_arg_t	*arg = (test_arg_t *)*state;
 
 	arg->hdl_share = true;
 	return 0;
 }
 
+daos_obj_id_t dts_oid_gen(uint16_t oclass, unsigned seed);
+int test_setup(void **state);
+int test_teardown(void **state);
+
 int run_array_test(int rank, int size);
+int run_kv_test(int rank, int size);
+int run_file_test(int rank, int size);
+int run_ragged_test(int rank, int size);
+int run_log_test(int rank, int size);
+int run_hpp_test(int rank, int size);
 
 enum {
 	HANDLE_POOL,
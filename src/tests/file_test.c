@@ -0,0 +1,193 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/tests/file_test
+ */
+
+#include <fcntl.h>
+#include <daos_hl_test.h>
+
+/** number of ints to write to the file */
+#define NUM_ELEMS 1024
+
+static void
+file_rw(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_hl_file_t	*file;
+	struct stat	st;
+	int		*wbuf = NULL, *rbuf = NULL;
+	ssize_t		n;
+	daos_size_t 	i;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	rc = daos_hl_file_open(arg->coh, oid, 0, O_RDWR | O_TRUNC, &file);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffer */
+	wbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * sizeof(int));
+	assert_non_null(rbuf);
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i+1;
+
+	/** Small sequential writes, coalesced by the file */
+	for (i = 0; i < NUM_ELEMS; i++) {
+		n = daos_hl_file_pwrite(file, &wbuf[i], sizeof(int),
+					i * sizeof(int));
+		assert_int_equal(n, sizeof(int));
+	}
+
+	rc = daos_hl_file_fstat(file, &st);
+	assert_int_equal(rc, 0);
+	assert_int_equal(st.st_size, NUM_ELEMS * sizeof(int));
+
+	/** Small sequential reads, served from the read-ahead buffer */
+	memset(rbuf, 0, NUM_ELEMS * sizeof(int));
+	for (i = 0; i < NUM_ELEMS; i++) {
+		n = daos_hl_file_pread(file, &rbuf[i], sizeof(int),
+				       i * sizeof(int));
+		assert_int_equal(n, sizeof(int));
+	}
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(wbuf[i], rbuf[i]);
+
+	/** Reads stop at the end of the file */
+	n = daos_hl_file_pread(file, rbuf, NUM_ELEMS * sizeof(int),
+			       (NUM_ELEMS - 1) * sizeof(int));
+	assert_int_equal(n, sizeof(int));
+	n = daos_hl_file_pread(file, rbuf, sizeof(int),
+			       NUM_ELEMS * sizeof(int));
+	assert_int_equal(n, 0);
+
+	/** Truncate to half, then grow back: the cut half reads as zeros */
+	rc = daos_hl_file_ftruncate(file, NUM_ELEMS / 2 * sizeof(int));
+	assert_int_equal(rc, 0);
+	rc = daos_hl_file_fstat(file, &st);
+	assert_int_equal(rc, 0);
+	assert_int_equal(st.st_size, NUM_ELEMS / 2 * sizeof(int));
+
+	rc = daos_hl_file_ftruncate(file, NUM_ELEMS * sizeof(int));
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_file_close(file);
+	assert_int_equal(rc, 0);
+
+	/** The size and data persist across opens */
+	rc = daos_hl_file_open(arg->coh, oid, 0, O_RDONLY, &file);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_file_fstat(file, &st);
+	assert_int_equal(rc, 0);
+	assert_int_equal(st.st_size, NUM_ELEMS * sizeof(int));
+
+	memset(rbuf, 0xff, NUM_ELEMS * sizeof(int));
+	n = daos_hl_file_pread(file, rbuf, NUM_ELEMS * sizeof(int), 0);
+	assert_int_equal(n, NUM_ELEMS * sizeof(int));
+	for (i = 0; i < NUM_ELEMS; i++) {
+		if (i < NUM_ELEMS / 2)
+			assert_int_equal(rbuf[i], wbuf[i]);
+		else
+			assert_int_equal(rbuf[i], 0);
+	}
+
+	/** A read-only file can not be written */
+	n = daos_hl_file_pwrite(file, wbuf, sizeof(int), 0);
+	assert_true(n < 0);
+
+	rc = daos_hl_file_close(file);
+	assert_int_equal(rc, 0);
+
+	free(rbuf);
+	free(wbuf);
+} /* End file_rw */
+
+static void
+file_nocache(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_hl_file_t	*wfile, *rfile;
+	int		val, rval;
+	ssize_t		n;
+	daos_size_t 	i;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	rc = daos_hl_file_open(arg->coh, oid, 0, O_RDWR | O_TRUNC, &wfile);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_file_open(arg->coh, oid, 0, O_RDWR, &rfile);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_file_set_cache(wfile, false);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_file_set_cache(rfile, false);
+	assert_int_equal(rc, 0);
+
+	/**
+	 * Without the buffers, every small write is seen by the other handle
+	 * right away, without an fsync, and extends the size it sees.
+	 */
+	for (i = 0; i < NUM_ELEMS; i++) {
+		val = i + 1;
+		n = daos_hl_file_pwrite(wfile, &val, sizeof(int),
+					i * sizeof(int));
+		assert_int_equal(n, sizeof(int));
+
+		rval = 0;
+		n = daos_hl_file_pread(rfile, &rval, sizeof(int),
+				       i * sizeof(int));
+		assert_int_equal(n, sizeof(int));
+		assert_int_equal(rval, val);
+	}
+
+	rc = daos_hl_file_close(rfile);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_file_close(wfile);
+	assert_int_equal(rc, 0);
+} /* End file_nocache */
+
+static const struct CMUnitTest file_tests[] = {
+	{"File: pread/pwrite/ftruncate/fstat (blocking)",
+	 file_rw, async_disable, NULL},
+	{"File: unbuffered accesses seen by other handles (blocking)",
+	 file_nocache, async_disable, NULL},
+};
+
+int
+run_file_test(int rank, int size)
+{
+	int rc = 0;
+
+	rc = cmocka_run_group_tests_name("File tests", file_tests,
+					 test_setup, test_teardown);
+	MPI_Barrier(MPI_COMM_WORLD);
+	return rc;
+}
@@ -0,0 +1,141 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/tests/hpp_test
+ */
+
+#include <mpi.h>
+#include <vector>
+#include <daos_hl.hpp>
+
+extern "C" {
+#include <daos_hl_test.h>
+}
+
+/** number of ints to access */
+#define NUM_ELEMS 1024
+
+/** the wrappers own their handles and events */
+static_assert(!std::is_copy_constructible_v<daos_hl::Array>);
+static_assert(std::is_nothrow_move_constructible_v<daos_hl::Array>);
+static_assert(!std::is_copy_constructible_v<daos_hl::EventQueue>);
+static_assert(!std::is_copy_constructible_v<daos_hl::Access>);
+
+namespace {
+
+/** Coroutine run eagerly, until its first suspension */
+struct task {
+	struct promise_type {
+		task get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+task
+read_back(daos_hl::Array &array, daos_hl::EventQueue &eq,
+	  daos_hl::Ranges &ranges, daos_hl::Buffers &buffers,
+	  daos_size_t *bytes)
+{
+	*bytes = co_await array.async_read(eq, 0, ranges, buffers);
+}
+
+} /* namespace */
+
+static void
+hpp_async_read(void **state)
+{
+	test_arg_t		*arg = static_cast<test_arg_t *>(*state);
+	daos_hl_range_t		rg_storage[1];
+	daos_iov_t		wiov_storage[1], riov_storage[1];
+	daos_event_t		raw_ev, *raw[4];
+	std::vector<int>	wbuf(NUM_ELEMS), rbuf(NUM_ELEMS, 0);
+	daos_size_t		bytes = 0;
+	std::size_t		nraw, raw_seen = 0, i;
+	int			rc;
+
+	for (i = 0; i < NUM_ELEMS; i++)
+		wbuf[i] = i + 1;
+
+	auto array = daos_hl::Array::create(
+		arg->coh, dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank), 0);
+
+	daos_hl::Ranges ranges(rg_storage);
+	assert_true(ranges.add(0, NUM_ELEMS * sizeof(int)));
+	daos_hl::Buffers wbufs(wiov_storage);
+	assert_true(wbufs.add(std::span<const int>(wbuf)));
+	daos_hl::Buffers rbufs(riov_storage);
+	assert_true(rbufs.add(std::span<int>(rbuf)));
+
+	assert_int_equal(array.write(0, ranges, wbufs),
+			 NUM_ELEMS * sizeof(int));
+
+	daos_hl::EventQueue eq;
+
+	/** an event of another operation, completed on the same queue */
+	rc = daos_event_init(&raw_ev, eq.handle(), NULL);
+	assert_int_equal(rc, 0);
+	rc = daos_event_launch(&raw_ev);
+	assert_int_equal(rc, 0);
+	daos_event_complete(&raw_ev, 0);
+
+	read_back(array, eq, ranges, rbufs, &bytes);
+
+	/** the access resumes its coroutine, the other event comes back */
+	while (bytes == 0 || raw_seen == 0) {
+		eq.poll(DAOS_EQ_WAIT, raw, nraw);
+		for (i = 0; i < nraw; i++) {
+			assert_ptr_equal(raw[i], &raw_ev);
+			raw_seen ++;
+		}
+	}
+	assert_int_equal(raw_seen, 1);
+	assert_int_equal(bytes, NUM_ELEMS * sizeof(int));
+	for (i = 0; i < NUM_ELEMS; i++)
+		assert_int_equal(rbuf[i], wbuf[i]);
+
+	rc = daos_event_fini(&raw_ev);
+	assert_int_equal(rc, 0);
+
+	array.close();
+} /* End hpp_async_read */
+
+static const struct CMUnitTest hpp_tests[] = {
+	{"C++: coroutine read with a raw event on the queue",
+	 hpp_async_read, async_disable, NULL},
+};
+
+int
+run_hpp_test(int rank, int size)
+{
+	int rc = 0;
+
+	rc = cmocka_run_group_tests_name("C++ tests", hpp_tests,
+					 test_setup, test_teardown);
+	MPI_Barrier(MPI_COMM_WORLD);
+	return rc;
+}
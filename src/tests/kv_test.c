@@ -0,0 +1,223 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/tests/kv_test
+ */
+
+#include <daos_hl_test.h>
+
+/** number of keys to put in the KV object */
+#define NUM_KEYS 128
+#define KEY_LEN 32
+
+static void
+kv_put_get(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	char		*keys[NUM_KEYS];
+	daos_size_t	sizes[NUM_KEYS];
+	void		*bufs[NUM_KEYS];
+	int		wvals[NUM_KEYS], rvals[NUM_KEYS];
+	daos_size_t	size;
+	int		val;
+	daos_size_t 	i;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		keys[i] = malloc(KEY_LEN);
+		assert_non_null(keys[i]);
+		snprintf(keys[i], KEY_LEN, "key_%zu", i);
+		wvals[i] = arg->myrank * NUM_KEYS + i;
+		sizes[i] = sizeof(int);
+		bufs[i] = &wvals[i];
+	}
+
+	/** Put */
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_kv_put_multi(oh, 0, NUM_KEYS, (const char **)keys,
+				  sizes, bufs, arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Get */
+	for (i = 0; i < NUM_KEYS; i++) {
+		rvals[i] = -1;
+		bufs[i] = &rvals[i];
+	}
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	rc = daos_hl_kv_get_multi(oh, 0, NUM_KEYS, (const char **)keys,
+				  sizes, bufs, arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	/** Verify data */
+	for (i = 0; i < NUM_KEYS; i++) {
+		assert_int_equal(sizes[i], sizeof(int));
+		assert_int_equal(wvals[i], rvals[i]);
+	}
+
+	/** Remove one key and check that it is gone */
+	rc = daos_hl_kv_remove(oh, 0, keys[0], NULL);
+	assert_int_equal(rc, 0);
+
+	size = sizeof(int);
+	rc = daos_hl_kv_get(oh, 0, keys[0], &size, &val, NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(size, 0);
+
+	size = sizeof(int);
+	rc = daos_hl_kv_get(oh, 0, keys[1], &size, &val, NULL);
+	assert_int_equal(rc, 0);
+	assert_int_equal(size, sizeof(int));
+	assert_int_equal(val, wvals[1]);
+
+	for (i = 0; i < NUM_KEYS; i++)
+		free(keys[i]);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End kv_put_get */
+
+static void
+kv_list(void **state)
+{
+	test_arg_t	*arg = *state;
+	daos_obj_id_t	oid;
+	daos_handle_t	oh;
+	daos_hl_kv_iter_t *iter;
+	char		key[KEY_LEN];
+	char		*k;
+	daos_size_t	len;
+	uint32_t	nr, j;
+	daos_size_t	total;
+	daos_size_t 	i;
+	int		val = 0;
+	daos_event_t	ev, *evp;
+	int		rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** open the object */
+	rc = daos_obj_open(arg->coh, oid, 0, 0, &oh, NULL);
+	assert_int_equal(rc, 0);
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		snprintf(key, KEY_LEN, "key_%zu", i);
+		rc = daos_hl_kv_put(oh, 0, key, sizeof(int), &val, NULL);
+		assert_int_equal(rc, 0);
+	}
+
+	rc = daos_hl_kv_iter_create(oh, 0, 0, &iter);
+	assert_int_equal(rc, 0);
+
+	total = 0;
+	while (!daos_hl_kv_iter_eof(iter)) {
+		if (arg->async) {
+			rc = daos_event_init(&ev, arg->eq, NULL);
+			assert_int_equal(rc, 0);
+		}
+		rc = daos_hl_kv_iter_next(iter, &nr, arg->async ? &ev : NULL);
+		assert_int_equal(rc, 0);
+		if (arg->async) {
+			/** Wait for completion */
+			rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+			assert_int_equal(rc, 1);
+			assert_ptr_equal(evp, &ev);
+			assert_int_equal(evp->ev_error, 0);
+
+			rc = daos_event_fini(&ev);
+			assert_int_equal(rc, 0);
+		}
+
+		for (j = 0; j < nr; j++) {
+			rc = daos_hl_kv_iter_key(iter, j, &k, &len);
+			assert_int_equal(rc, 0);
+			assert_true(len > 4 && strncmp(k, "key_", 4) == 0);
+		}
+		total += nr;
+	}
+	assert_int_equal(total, NUM_KEYS);
+
+	rc = daos_hl_kv_iter_destroy(iter);
+	assert_int_equal(rc, 0);
+
+	rc = daos_obj_close(oh, NULL);
+	assert_int_equal(rc, 0);
+} /* End kv_list */
+
+static const struct CMUnitTest kv_tests[] = {
+	{"KV: Put/Get/Remove (blocking)",
+	 kv_put_get, async_disable, NULL},
+	{"KV: Put/Get/Remove (non-blocking)",
+	kv_put_get, async_enable, NULL},
+	{"KV: List keys (blocking)",
+	 kv_list, async_disable, NULL},
+	{"KV: List keys (non-blocking)",
+	kv_list, async_enable, NULL},
+};
+
+int
+run_kv_test(int rank, int size)
+{
+	int rc = 0;
+
+	rc = cmocka_run_group_tests_name("KV tests", kv_tests,
+					 test_setup, test_teardown);
+	MPI_Barrier(MPI_COMM_WORLD);
+	return rc;
+}
@@ -0,0 +1,204 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/tests/log_test
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <daos_hl_test.h>
+#include <daos_hl/common.h>
+
+static int log_evals;
+
+static int
+log_eval(void)
+{
+	return ++log_evals;
+}
+
+static void
+log_levels(void **state)
+{
+	char	line[256];
+	FILE	*out;
+	int	err_fd;
+	bool	found_err = false, found_debug = false;
+	char	str[16];
+	int	rc;
+
+	/** capture what the library writes to stderr */
+	out = tmpfile();
+	assert_non_null(out);
+	fflush(stderr);
+	err_fd = dup(STDERR_FILENO);
+	assert_true(err_fd >= 0);
+	rc = dup2(fileno(out), STDERR_FILENO);
+	assert_true(rc >= 0);
+
+	/** Messages above the level are not recorded, nor evaluated */
+	rc = daos_hl_log_level_set(DAOS_HL_LOG_ERROR);
+	assert_int_equal(rc, 0);
+	DHL_DEBUG("log test hidden %d\n", log_eval());
+	assert_int_equal(log_evals, 0);
+
+	/** Arguments are captured when logged, not when formatted */
+	strcpy(str, "before");
+	DHL_ERROR("log test error %d %s %zu %.2f\n", -3, str, (size_t)7, 1.5);
+	strcpy(str, "after");
+
+	rc = daos_hl_log_level_set(DAOS_HL_LOG_DEBUG);
+	assert_int_equal(rc, 0);
+	DHL_DEBUG("log test debug %d %5s|\n", log_eval(), "ab");
+	assert_int_equal(log_evals, 1);
+
+	rc = daos_hl_log_flush();
+	assert_int_equal(rc, 0);
+
+	rc = dup2(err_fd, STDERR_FILENO);
+	assert_true(rc >= 0);
+	close(err_fd);
+
+	rewind(out);
+	while (fgets(line, sizeof(line), out)) {
+		if (strstr(line, "ERROR") &&
+		    strstr(line, "log test error -3 before 7 1.50\n"))
+			found_err = true;
+		if (strstr(line, "DEBUG") &&
+		    strstr(line, "log test debug 1    ab|\n"))
+			found_debug = true;
+		assert_true(strstr(line, "log test hidden") == NULL);
+	}
+	fclose(out);
+	assert_true(found_err);
+	assert_true(found_debug);
+
+	/** Invalid levels are rejected */
+	rc = daos_hl_log_level_set(DAOS_HL_LOG_DEBUG + 1);
+	assert_true(rc < 0);
+
+	rc = daos_hl_log_level_set(DAOS_HL_LOG_ERROR);
+	assert_int_equal(rc, 0);
+} /* End log_levels */
+
+/** records logged by each thread of log_overflow, many more than a ring */
+#define LOG_FLOOD_NR	16384
+
+static pthread_barrier_t log_barrier;
+
+static void *
+log_flood(void *arg)
+{
+	int i;
+
+	/** lines cut at the max length, so that batches fill up to the end */
+	for (i = 0; i < LOG_FLOOD_NR; i++)
+		DHL_ERROR("log test flood %d %2000s\n", i, "x");
+
+	/** keep the ring until it is drained, so both rings have drops */
+	pthread_barrier_wait(&log_barrier);
+	pthread_barrier_wait(&log_barrier);
+	return NULL;
+}
+
+static void
+log_overflow(void **state)
+{
+	char		line[4096];
+	pthread_t	threads[2];
+	FILE		*out;
+	unsigned long	seen = 0, dropped = 0, n;
+	char		*p;
+	int		err_fd;
+	int		i;
+	int		rc;
+
+	out = tmpfile();
+	assert_non_null(out);
+	fflush(stderr);
+	err_fd = dup(STDERR_FILENO);
+	assert_true(err_fd >= 0);
+	rc = dup2(fileno(out), STDERR_FILENO);
+	assert_true(rc >= 0);
+
+	/** Two threads overflow their rings faster than they are drained */
+	rc = pthread_barrier_init(&log_barrier, NULL, 3);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < 2; i++) {
+		rc = pthread_create(&threads[i], NULL, log_flood, NULL);
+		assert_int_equal(rc, 0);
+	}
+	pthread_barrier_wait(&log_barrier);
+	rc = daos_hl_log_flush();
+	pthread_barrier_wait(&log_barrier);
+	assert_int_equal(rc, 0);
+	for (i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&log_barrier);
+
+	rc = dup2(err_fd, STDERR_FILENO);
+	assert_true(rc >= 0);
+	close(err_fd);
+
+	/** Every record is either written or counted as dropped */
+	rewind(out);
+	while (fgets(line, sizeof(line), out)) {
+		if (strstr(line, "log test flood")) {
+			assert_non_null(strchr(line, '\n'));
+			seen ++;
+			continue;
+		}
+		p = strstr(line, " log records dropped\n");
+		if (p == NULL)
+			continue;
+		*p = '\0';
+		p = strrchr(line, ' ');
+		assert_non_null(p);
+		n = strtoul(p + 1, NULL, 10);
+		assert_true(n > 0);
+		dropped += n;
+	}
+	fclose(out);
+
+	assert_true(dropped > 0);
+	assert_int_equal(seen + dropped, 2 * LOG_FLOOD_NR);
+} /* End log_overflow */
+
+static const struct CMUnitTest log_tests[] = {
+	{"Log: leveled, lazily formatted messages",
+	 log_levels, NULL, NULL},
+	{"Log: records dropped by full rings are counted",
+	 log_overflow, NULL, NULL},
+};
+
+int
+run_log_test(int rank, int size)
+{
+	int rc = 0;
+
+	rc = cmocka_run_group_tests_name("Log tests", log_tests, NULL, NULL);
+	MPI_Barrier(MPI_COMM_WORLD);
+	return rc;
+}
@@ -0,0 +1,271 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/tests/ragged_test
+ */
+
+#include <daos_hl_test.h>
+
+/** number of elements of the ragged array */
+#define NUM_ELEMS	10000
+/** elements are 0 to ELEM_MAX_LEN - 1 bytes long */
+#define ELEM_MAX_LEN	17
+
+static void
+ragged_io(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid;
+	daos_hl_ragged_t	*ragged;
+	daos_hl_array_ranges_t	elems;
+	daos_hl_range_t		rg[3];
+	daos_size_t		*lens, *rlens;
+	char			*wbuf, *rbuf;
+	daos_size_t		i, e, nr, len, off;
+	daos_event_t		ev, *evp;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	rc = daos_hl_ragged_create(arg->coh, oid, 0, NULL, &ragged);
+	assert_int_equal(rc, 0);
+
+	/** Allocate and set buffers, element i is filled with i */
+	lens = malloc(NUM_ELEMS * sizeof(daos_size_t));
+	assert_non_null(lens);
+	rlens = malloc(NUM_ELEMS * sizeof(daos_size_t));
+	assert_non_null(rlens);
+	wbuf = malloc(NUM_ELEMS * ELEM_MAX_LEN);
+	assert_non_null(wbuf);
+	rbuf = malloc(NUM_ELEMS * ELEM_MAX_LEN);
+	assert_non_null(rbuf);
+	for (i = 0, len = 0; i < NUM_ELEMS; i++) {
+		lens[i] = i % ELEM_MAX_LEN;
+		memset(wbuf + len, (char)i, lens[i]);
+		len += lens[i];
+	}
+
+	/** Append all the elements in two ranges */
+	rg[0].index = 0;
+	rg[0].len = NUM_ELEMS / 2;
+	rg[1].index = NUM_ELEMS / 2;
+	rg[1].len = NUM_ELEMS - NUM_ELEMS / 2;
+	elems.ranges_nr = 2;
+	elems.ranges = rg;
+	rc = daos_hl_ragged_put(ragged, &elems, lens, wbuf);
+	assert_int_equal(rc, 0);
+
+	/** An element can not be rewritten with another length */
+	rg[0].index = 1;
+	rg[0].len = 1;
+	elems.ranges_nr = 1;
+	rc = daos_hl_ragged_put(ragged, &elems, &lens[2], wbuf);
+	assert_true(rc < 0);
+
+	rc = daos_hl_ragged_close(ragged);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RO, &ragged);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_ragged_count(ragged, &nr);
+	assert_int_equal(rc, 0);
+	assert_int_equal(nr, NUM_ELEMS);
+
+	/** Read a batch of ranges, across blocks of the offset index */
+	rg[0].index = 4090;
+	rg[0].len = 20;
+	rg[1].index = 5000;
+	rg[1].len = 1000;
+	rg[2].index = NUM_ELEMS - 1;
+	rg[2].len = 1;
+	elems.ranges_nr = 3;
+
+	if (arg->async) {
+		rc = daos_event_init(&ev, arg->eq, NULL);
+		assert_int_equal(rc, 0);
+	}
+	memset(rbuf, 0, NUM_ELEMS * ELEM_MAX_LEN);
+	rc = daos_hl_ragged_get(ragged, &elems, rlens, rbuf,
+				NUM_ELEMS * ELEM_MAX_LEN,
+				arg->async ? &ev : NULL);
+	assert_int_equal(rc, 0);
+	if (arg->async) {
+		/** Wait for completion */
+		rc = daos_eq_poll(arg->eq, 0, DAOS_EQ_WAIT, 1, &evp);
+		assert_int_equal(rc, 1);
+		assert_ptr_equal(evp, &ev);
+		assert_int_equal(evp->ev_error, 0);
+
+		rc = daos_event_fini(&ev);
+		assert_int_equal(rc, 0);
+	}
+
+	for (i = 0, nr = 0, off = 0; i < elems.ranges_nr; i++) {
+		for (e = rg[i].index; e < rg[i].index + rg[i].len; e++) {
+			assert_int_equal(rlens[nr], lens[e]);
+			for (len = 0; len < lens[e]; len++)
+				assert_int_equal(rbuf[off + len], (char)e);
+			off += lens[e];
+			nr++;
+		}
+	}
+
+	/** A read-only ragged array can not be written */
+	rc = daos_hl_ragged_put(ragged, &elems, lens, wbuf);
+	assert_true(rc < 0);
+
+	rc = daos_hl_ragged_close(ragged);
+	assert_int_equal(rc, 0);
+
+	free(rbuf);
+	free(wbuf);
+	free(rlens);
+	free(lens);
+} /* End ragged_io */
+
+static void
+ragged_writer(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid;
+	daos_hl_ragged_t	*ragged, *other;
+	daos_hl_array_ranges_t	elems;
+	daos_hl_range_t		rg;
+	daos_size_t		lens[2] = {3, 5};
+	char			wbuf[8] = "abcdefgh";
+	daos_size_t		nr;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	rc = daos_hl_ragged_create(arg->coh, oid, 0, NULL, &ragged);
+	assert_int_equal(rc, 0);
+
+	/** A second writer is rejected, readers are not */
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RW, &other);
+	assert_true(rc < 0);
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RO, &other);
+	assert_int_equal(rc, 0);
+
+	rg.index = 0;
+	rg.len = 2;
+	elems.ranges_nr = 1;
+	elems.ranges = &rg;
+	rc = daos_hl_ragged_put(ragged, &elems, lens, wbuf);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_ragged_close(other);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ragged_close(ragged);
+	assert_int_equal(rc, 0);
+
+	/** Closing the writer releases the array */
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RW, &ragged);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ragged_count(ragged, &nr);
+	assert_int_equal(rc, 0);
+	assert_int_equal(nr, 2);
+
+	rg.index = 2;
+	rc = daos_hl_ragged_put(ragged, &elems, lens, wbuf);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ragged_close(ragged);
+	assert_int_equal(rc, 0);
+} /* End ragged_writer */
+
+static void
+ragged_steal(void **state)
+{
+	test_arg_t		*arg = *state;
+	daos_obj_id_t		oid;
+	daos_hl_ragged_t	*ragged, *other;
+	daos_hl_array_ranges_t	elems;
+	daos_hl_range_t		rg;
+	daos_size_t		lens[2] = {3, 5};
+	char			wbuf[8] = "abcdefgh";
+	daos_size_t		nr;
+	int			rc;
+
+	oid = dts_oid_gen(DAOS_OC_REPL_MAX_RW, arg->myrank);
+
+	/** The first writer stands for one that exited without closing */
+	rc = daos_hl_ragged_create(arg->coh, oid, 0, NULL, &ragged);
+	assert_int_equal(rc, 0);
+
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RW, &other);
+	assert_true(rc < 0);
+	rc = daos_hl_ragged_open(arg->coh, oid, 0,
+				 DAOS_OO_RW | DAOS_HL_RAGGED_STEAL, &other);
+	assert_int_equal(rc, 0);
+
+	/** The writer that lost the claim can no longer put */
+	rg.index = 0;
+	rg.len = 2;
+	elems.ranges_nr = 1;
+	elems.ranges = &rg;
+	rc = daos_hl_ragged_put(ragged, &elems, lens, wbuf);
+	assert_true(rc < 0);
+	rc = daos_hl_ragged_put(other, &elems, lens, wbuf);
+	assert_int_equal(rc, 0);
+
+	/** Closing it leaves the claim of the new writer in place */
+	rc = daos_hl_ragged_close(ragged);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RW, &ragged);
+	assert_true(rc < 0);
+
+	rc = daos_hl_ragged_close(other);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ragged_open(arg->coh, oid, 0, DAOS_OO_RW, &ragged);
+	assert_int_equal(rc, 0);
+	rc = daos_hl_ragged_count(ragged, &nr);
+	assert_int_equal(rc, 0);
+	assert_int_equal(nr, 2);
+	rc = daos_hl_ragged_close(ragged);
+	assert_int_equal(rc, 0);
+} /* End ragged_steal */
+
+static const struct CMUnitTest ragged_tests[] = {
+	{"Ragged: batched get/put of element ranges (blocking)",
+	 ragged_io, async_disable, NULL},
+	{"Ragged: batched get/put of element ranges (non-blocking)",
+	 ragged_io, async_enable, NULL},
+	{"Ragged: single writer at a time (blocking)",
+	 ragged_writer, async_disable, NULL},
+	{"Ragged: stealing the writer claim (blocking)",
+	 ragged_steal, async_disable, NULL},
+};
+
+int
+run_ragged_test(int rank, int size)
+{
+	int rc = 0;
+
+	rc = cmocka_run_group_tests_name("Ragged array tests", ragged_tests,
+					 test_setup, test_teardown);
+	MPI_Barrier(MPI_COMM_WORLD);
+	return rc;
+}
@@ -0,0 +1,201 @@
+/**
+ * (C) Copyright 2016 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * GOVERNMENT LICENSE RIGHTS-OPEN SOURCE SOFTWARE
+ * The Government's rights to use, modify, reproduce, release, perform, display,
+ * or disclose this software are subject to the terms of the Apache License as
+ * provided in Contract No. B609815.
+ * Any reproduction of computer software, computer software documentation, or
+ * portions thereof marked with this legend must also reproduce the markings.
+ */
+/**
+ * This file is part of daos_hl
+ *
+ * src/tools/daos_hl_array_tool.c
+ *
+ * Dump an array object to local files or load it back, run by one or more MPI
+ * processes:
+ *
+ *	daos_hl_array_tool dump|load --pool UUID --cont UUID --oid HI.MID.LO
+ *		[--svc RANKS] [--epoch E] [--index I --len L] PATH
+ *
+ * A load creates the array with the attributes stored in the dump.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <uuid/uuid.h>
+#include <daos_hl_mpi.h>
+
+/** Most pool service ranks */
+#define TOOL_SVC_MAX	8
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s dump|load [options] PATH\n"
+		"  -p, --pool UUID      pool uuid\n"
+		"  -s, --svc RANKS      pool service ranks, ':' separated "
+		"(default 0)\n"
+		"  -c, --cont UUID      container uuid\n"
+		"  -o, --oid HI.MID.LO  array object ID\n"
+		"  -e, --epoch E        epoch (default 0)\n"
+		"  -i, --index I        dump: first index of the range, with "
+		"--len\n"
+		"  -l, --len L          dump: length of the range (default up "
+		"to the array size)\n", prog);
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct option	opts[] = {
+		{"pool",	required_argument,	NULL,	'p'},
+		{"svc",		required_argument,	NULL,	's'},
+		{"cont",	required_argument,	NULL,	'c'},
+		{"oid",		required_argument,	NULL,	'o'},
+		{"epoch",	required_argument,	NULL,	'e'},
+		{"index",	required_argument,	NULL,	'i'},
+		{"len",		required_argument,	NULL,	'l'},
+		{NULL,		0,			NULL,	0}
+	};
+	daos_rank_t		ranks[TOOL_SVC_MAX];
+	daos_rank_list_t	svc;
+	uuid_t			pool_uuid, co_uuid;
+	daos_obj_id_t		oid;
+	daos_handle_t		poh, coh, oh;
+	daos_epoch_t		epoch = 0;
+	daos_hl_range_t		range = {0, 0};
+	const char		*op, *path;
+	char			*svc_str = "0", *tok, *save;
+	bool			has_pool = false, has_cont = false;
+	bool			has_oid = false;
+	bool			has_index = false, has_len = false;
+	bool			dump;
+	int			c;
+	int			rc;
+
+	MPI_Init(&argc, &argv);
+
+	while ((c = getopt_long(argc, argv, "p:s:c:o:e:i:l:", opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'p':
+			has_pool = (uuid_parse(optarg, pool_uuid) == 0);
+			break;
+		case 's':
+			svc_str = optarg;
+			break;
+		case 'c':
+			has_cont = (uuid_parse(optarg, co_uuid) == 0);
+			break;
+		case 'o':
+			has_oid = (sscanf(optarg, "%"SCNu64".%"SCNu64".%"SCNu64,
+					  &oid.hi, &oid.mid, &oid.lo) == 3);
+			break;
+		case 'e':
+			epoch = strtoull(optarg, NULL, 0);
+			break;
+		case 'i':
+			range.index = strtoull(optarg, NULL, 0);
+			has_index = true;
+			break;
+		case 'l':
+			range.len = strtoull(optarg, NULL, 0);
+			has_len = true;
+			break;
+		default:
+			usage(argv[0]);
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+	}
+
+	if (argc - optind != 2 || !has_pool || !has_cont || !has_oid ||
+	    (strcmp(argv[optind], "dump") && strcmp(argv[optind], "load"))) {
+		usage(argv[0]);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	op = argv[optind];
+	path = argv[optind + 1];
+	dump = (strcmp(op, "dump") == 0);
+
+	if ((has_index && !has_len) || (!dump && (has_index || has_len)) ||
+	    (has_len && range.len == 0)) {
+		fprintf(stderr, "--index needs --len, and both are only valid "
+			"for a dump of a non empty range\n");
+		usage(argv[0]);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	svc.rl_nr.num = 0;
+	svc.rl_nr.num_out = 0;
+	svc.rl_ranks = ranks;
+	for (tok = strtok_r(svc_str, ":", &save);
+	     tok != NULL && svc.rl_nr.num < TOOL_SVC_MAX;
+	     tok = strtok_r(NULL, ":", &save))
+		ranks[svc.rl_nr.num++] = atoi(tok);
+
+	rc = daos_init();
+	if (rc) {
+		fprintf(stderr, "daos_init() failed with %d\n", rc);
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+
+	rc = daos_pool_connect(pool_uuid, NULL, &svc, DAOS_PC_RW, &poh, NULL,
+			       NULL);
+	if (rc) {
+		fprintf(stderr, "Failed to connect to pool (%d)\n", rc);
+		goto out_fini;
+	}
+
+	rc = daos_cont_open(poh, co_uuid, DAOS_COO_RW, &coh, NULL, NULL);
+	if (rc) {
+		fprintf(stderr, "Failed to open container (%d)\n", rc);
+		goto out_disconnect;
+	}
+
+	if (dump) {
+		rc = daos_hl_array_open(coh, oid, epoch, DAOS_OO_RO, NULL,
+					&oh);
+		if (rc) {
+			fprintf(stderr, "Failed to open array (%d)\n", rc);
+			goto out_close;
+		}
+		rc = daos_hl_array_dump(oh, epoch, has_len ? &range : NULL,
+					MPI_COMM_WORLD, path);
+	} else {
+		rc = daos_hl_array_load_create(coh, oid, epoch,
+					       MPI_COMM_WORLD, path, &oh);
+		if (rc) {
+			fprintf(stderr, "Array load failed (%d)\n", rc);
+			goto out_close;
+		}
+	}
+	if (rc)
+		fprintf(stderr, "Array %s failed (%d)\n", op, rc);
+
+	daos_hl_array_close(oh);
+out_close:
+	daos_cont_close(coh, NULL);
+out_disconnect:
+	daos_pool_disconnect(poh, NULL);
+out_fini:
+	daos_fini();
+	MPI_Finalize();
+	return rc ? 1 : 0;
+}